@@ -37,6 +37,7 @@ static void usage(std::string binary_name) {
 	--config_file=<filename, required>
 	--results_folder=<filename, required> (really a prefix to output filenames)
 	--load_from_lmdb <flag, optional>
+	--load_state_snapshot=<block number, optional> (implies --load_from_lmdb)
 )");
 	exit(1);
 }
@@ -49,6 +50,7 @@ enum opttag {
 	EXPERIMENT_DATA_FOLDER,
 	RESULTS_FOLDER,
 	LOAD_FROM_LMDB,
+	LOAD_STATE_SNAPSHOT,
 
 	EXPERIMENT_OPTIONS,
 	EXPERIMENT_NAME,
@@ -67,6 +69,7 @@ static const struct option opts[] = {
 	{"exp_data_folder", required_argument, nullptr, EXPERIMENT_DATA_FOLDER},
 	{"results_folder", required_argument, nullptr, RESULTS_FOLDER},
 	{"load_lmdb", no_argument, nullptr, LOAD_FROM_LMDB},
+	{"load_state_snapshot", required_argument, nullptr, LOAD_STATE_SNAPSHOT},
 
 	{"exp_options", required_argument, nullptr, EXPERIMENT_OPTIONS},
 	{"exp_name", required_argument, nullptr, EXPERIMENT_NAME},
@@ -89,6 +92,7 @@ struct CommandLineArgs
 	std::string experiment_results_folder;
 
 	bool load_from_lmdb = false;
+	uint64_t state_snapshot_block = 0;
 
 	std::string experiment_options_file;
 	std::string experiment_name;
@@ -128,6 +132,10 @@ parse_cmd(int argc, char* const* argv, std::string binary_name)
 			case LOAD_FROM_LMDB:
 				out.load_from_lmdb = true;
 				break;
+			case LOAD_STATE_SNAPSHOT:
+				out.state_snapshot_block = std::stoull(optarg);
+				out.load_from_lmdb = true;
+				break;
 			case EXPERIMENT_OPTIONS:
 				out.experiment_options_file = optarg;
 				break;
@@ -20,6 +20,7 @@
 
 #include <array>
 #include <cstddef>
+#include <filesystem>
 #include <stdexcept>
 #include <string>
 
@@ -35,6 +36,7 @@ constexpr static const char* DATA_FOLDER_FILENAME = "automation/data_folder";
 constexpr static const char* RESULTS_FOLDER_FILENAME = "automation/results_folder";
 constexpr static const char* NUM_THREADS_FILENAME = "automation/num_threads";
 constexpr static const char* CHECK_SIGS_FILENAME = "automation/check_sigs";
+constexpr static const char* NUM_ACCOUNT_DB_SHARDS_FILENAME = "automation/num_account_db_shards";
 
 static std::string
 get_experiment_var(const char* var) {
@@ -104,6 +106,16 @@ get_check_sigs() {
 	return (std::stoi(get_experiment_var(CHECK_SIGS_FILENAME)) == 1);
 }
 
+//! Optional; defaults to the compile-time NUM_ACCOUNT_DB_SHARDS.
+[[maybe_unused]]
+static uint32_t
+get_num_account_db_shards() {
+	if (!std::filesystem::exists(NUM_ACCOUNT_DB_SHARDS_FILENAME)) {
+		return NUM_ACCOUNT_DB_SHARDS;
+	}
+	return std::stoi(get_experiment_var(NUM_ACCOUNT_DB_SHARDS_FILENAME));
+}
+
 [[maybe_unused]]
 static
 SpeedexRuntimeConfigs
@@ -111,7 +123,8 @@ get_runtime_configs()
 {
 	return SpeedexRuntimeConfigs
 	{
-		.check_sigs = get_check_sigs()
+		.check_sigs = get_check_sigs(),
+		.num_account_db_shards = get_num_account_db_shards()
 	};
 }
 
@@ -18,10 +18,14 @@
 
 #include "block_processing/block_producer.h"
 
+#include <algorithm>
 #include <atomic>
 #include <cinttypes>
 #include <cstdint>
 #include <mutex>
+#include <tuple>
+#include <vector>
+
 #include <tbb/parallel_reduce.h>
 
 #include "block_processing/serial_transaction_processor.h"
@@ -69,19 +73,115 @@ bool delete_tx_from_mempool(TransactionProcessingStatus status) {
 	}
 }
 
+//! Failures that can go away once the rest of the block has executed:
+//! a sequence number or new account id held by a tx that later failed,
+//! or a balance that another tx in the block pays into.
+//! SEQ_NUM_TOO_HIGH is not included; the sequence number window only
+//! moves when a block commits.
+bool retry_tx_in_deferred_wave(TransactionProcessingStatus status) {
+	switch(status) {
+		case SEQ_NUM_TEMP_IN_USE:
+		case NEW_ACCOUNT_TEMP_RESERVED:
+		case INSUFFICIENT_BALANCE:
+			return true;
+		default:
+			return false;
+	}
+}
+
+//! A tx set aside by the first wave for the deferred retry wave.
+struct DeferredTx {
+	size_t chunk_idx;
+	size_t tx_idx;
+	AccountID source_account;
+	uint64_t sequence_number;
+	//! Output of the retry wave: remove the tx from the mempool.
+	bool remove = false;
+
+	bool operator<(const DeferredTx& other) const {
+		return std::tie(source_account, sequence_number, chunk_idx, tx_idx)
+			< std::tie(other.source_account, other.sequence_number, 
+				other.chunk_idx, other.tx_idx);
+	}
+};
+
 class BlockProductionReduce {
 	SpeedexManagementStructures& management_structures;
 	Mempool& mempool;
 	utils::ThreadlocalCache<SerialTransactionProcessor>& serial_processor_cache;
 	std::atomic<int64_t>& remaining_block_space;
 	std::atomic<uint64_t>& total_block_size;
+	const bool defer_retries;
+	//! Chunk indices per account-affinity shard (empty if unsharded).
+	const std::vector<std::vector<size_t>>& shard_chunks;
+
+	//! Returns false once the block is full.
+	bool process_chunk(
+		size_t i,
+		SerialTransactionProcessor& tx_processor,
+		SerialAccountModificationLog& serial_account_log) {
+		auto& chunk = mempool[i];
+		std::vector<bool> bitmap;
+
+		int64_t chunk_sz = chunk.size();
+
+		bitmap.resize(chunk_sz, false);
+
+
+		//reserve space for txs in output block
+		int64_t remaining_space 
+			= remaining_block_space.fetch_sub(
+				chunk_sz, std::memory_order_relaxed);
+
+		if (remaining_space < chunk_sz) {
+			remaining_block_space.fetch_add(
+				chunk_sz - remaining_space, std::memory_order_relaxed);
+			//reduce the number of txs that we look at, according to reservation
+			//We'll guarantee that we don't exceed a block limit, but we might ignore a few valid txs.
+			chunk_sz = remaining_space;
+			//chunk_sz += remaining_space;
+			//remaining_block_space.fetch_add(-remaining_space, std::memory_order_relaxed);
+			if (chunk_sz <= 0) {
+				return false;
+			}
+		}
+
+
+		int64_t elts_added_to_block = 0;
+
+		for (int64_t j = 0; j < chunk_sz; j++) {
+			auto status = tx_processor.process_transaction(
+				chunk[j], stats, serial_account_log);
+			status_counts[status] ++;
+			if (status == TransactionProcessingStatus::SUCCESS) {
+				bitmap[j] = true;
+				elts_added_to_block++;
+			} else if (defer_retries && retry_tx_in_deferred_wave(status)) {
+				auto const& metadata = chunk[j].transaction.metadata;
+				deferred_txs.push_back(DeferredTx{
+					.chunk_idx = i,
+					.tx_idx = static_cast<size_t>(j),
+					.source_account = metadata.sourceAccount,
+					.sequence_number = metadata.sequenceNumber
+				});
+			} else if(delete_tx_from_mempool(status)) {
+				bitmap[j] = true;
+			}
+		}
+		chunk.set_confirmed_txs(std::move(bitmap));
 
+		auto post_check = remaining_block_space.fetch_add(
+			chunk_sz - elts_added_to_block, std::memory_order_relaxed);
+		total_block_size.fetch_add(
+			elts_added_to_block, std::memory_order_release);
+		return post_check > 0;
+	}
 
 public:
 	std::unordered_map<TransactionProcessingStatus, uint64_t> status_counts;
 	BlockStateUpdateStatsWrapper stats;
+	std::vector<DeferredTx> deferred_txs;
 
-	
 	void operator() (const tbb::blocked_range<std::size_t> r) {
 
 		SerialAccountModificationLog serial_account_log(
@@ -90,94 +190,246 @@ public:
 		SerialTransactionProcessor&  tx_processor 
 			= serial_processor_cache.get(management_structures);
 
-		for (size_t i = r.begin(); i < r.end(); i++) {
-			auto& chunk = mempool[i];
-			std::vector<bool> bitmap;
+		for (size_t idx = r.begin(); idx < r.end(); idx++) {
+			if (shard_chunks.empty()) {
+				if (!process_chunk(idx, tx_processor, serial_account_log)) {
+					return;
+				}
+				continue;
+			}
+			// a shard's chunks all run here, in order, so the
+			// accounts of the shard are only touched by this thread
+			for (size_t i : shard_chunks[idx]) {
+				if (!process_chunk(i, tx_processor, serial_account_log)) {
+					return;
+				}
+			}
+		}
+	}
 
-			int64_t chunk_sz = chunk.size();
+	BlockProductionReduce(BlockProductionReduce& x, tbb::split)
+		: management_structures(x.management_structures)
+		, mempool(x.mempool)
+		, serial_processor_cache(x.serial_processor_cache)
+		, remaining_block_space(x.remaining_block_space)
+		, total_block_size(x.total_block_size)
+		, defer_retries(x.defer_retries)
+		, shard_chunks(x.shard_chunks)
+		, status_counts()
+		, stats()
+		, deferred_txs()
+			{};
 
-			bitmap.resize(chunk_sz, false);
+	void join(BlockProductionReduce& other) {
 
+		for (auto iter = other.status_counts.begin(); iter != other.status_counts.end(); iter++) {
+			status_counts[iter->first] += iter->second;
+		}
+
+		stats += other.stats;
+		deferred_txs.insert(
+			deferred_txs.end(), 
+			other.deferred_txs.begin(),
+			other.deferred_txs.end());
+	}
+
+	BlockProductionReduce(
+		SpeedexManagementStructures& management_structures,
+		Mempool& mempool,
+		utils::ThreadlocalCache<SerialTransactionProcessor>& serial_processor_cache,
+		std::atomic<int64_t>& remaining_block_space,
+		std::atomic<uint64_t>& total_block_size,
+		bool defer_retries,
+		const std::vector<std::vector<size_t>>& shard_chunks)
+		: management_structures(management_structures)
+		, mempool(mempool)
+		, serial_processor_cache(serial_processor_cache)
+		, remaining_block_space(remaining_block_space)
+		, total_block_size(total_block_size)
+		, defer_retries(defer_retries)
+		, shard_chunks(shard_chunks)
+		, status_counts()
+		, stats()
+		, deferred_txs()
+		{}
+};
+
+/*!
+Second wave: re-execute deferred txs.
+The range is over groups of deferred txs with the same source account
+(sorted by sequence number).  Each group runs serially, in order,
+so an account's txs no longer race each other for sequence numbers.
+*/
+class DeferredRetryReduce {
+	SpeedexManagementStructures& management_structures;
+	Mempool& mempool;
+	utils::ThreadlocalCache<SerialTransactionProcessor>& serial_processor_cache;
+	std::atomic<int64_t>& remaining_block_space;
+	std::atomic<uint64_t>& total_block_size;
+	std::vector<DeferredTx>& deferred_txs;
+	const std::vector<size_t>& group_starts;
+
+public:
+	std::unordered_map<TransactionProcessingStatus, uint64_t> status_counts;
+	BlockStateUpdateStatsWrapper stats;
+	uint64_t txs_added = 0;
+
+	void operator() (const tbb::blocked_range<std::size_t> r) {
+
+		SerialAccountModificationLog serial_account_log(
+			management_structures.account_modification_log);
+
+		SerialTransactionProcessor&  tx_processor 
+			= serial_processor_cache.get(management_structures);
+
+		for (size_t g = r.begin(); g < r.end(); g++) {
+			const size_t group_start = group_starts[g];
+			int64_t group_sz = group_starts[g+1] - group_start;
 
-			//reserve space for txs in output block
 			int64_t remaining_space 
 				= remaining_block_space.fetch_sub(
-					chunk_sz, std::memory_order_relaxed);
+					group_sz, std::memory_order_relaxed);
 
-			if (remaining_space < chunk_sz) {
+			if (remaining_space < group_sz) {
+				int64_t granted = std::max<int64_t>(remaining_space, 0);
 				remaining_block_space.fetch_add(
-					chunk_sz - remaining_space, std::memory_order_relaxed);
-				//reduce the number of txs that we look at, according to reservation
-				//We'll guarantee that we don't exceed a block limit, but we might ignore a few valid txs.
-				chunk_sz = remaining_space;
-				//chunk_sz += remaining_space;
-				//remaining_block_space.fetch_add(-remaining_space, std::memory_order_relaxed);
-				if (chunk_sz <= 0) {
-					return;
+					group_sz - granted, std::memory_order_relaxed);
+				// later txs of the account stay in the mempool
+				group_sz = granted;
+				if (group_sz == 0) {
+					// space may still be returned by groups on
+					// other threads, so keep going with the range
+					continue;
 				}
 			}
 
-
 			int64_t elts_added_to_block = 0;
 
-			for (int64_t j = 0; j < chunk_sz; j++) {
+			for (int64_t k = 0; k < group_sz; k++) {
+				auto& deferred = deferred_txs[group_start + k];
 				auto status = tx_processor.process_transaction(
-					chunk[j], stats, serial_account_log);
+					mempool[deferred.chunk_idx][deferred.tx_idx], 
+					stats, 
+					serial_account_log);
 				status_counts[status] ++;
 				if (status == TransactionProcessingStatus::SUCCESS) {
-					bitmap[j] = true;
+					deferred.remove = true;
 					elts_added_to_block++;
-				} else if(delete_tx_from_mempool(status)) {
-					bitmap[j] = true;
+				} else {
+					deferred.remove = delete_tx_from_mempool(status);
 				}
 			}
-			chunk.set_confirmed_txs(std::move(bitmap));
 
-			auto post_check = remaining_block_space.fetch_add(
-				chunk_sz - elts_added_to_block, std::memory_order_relaxed);
+			remaining_block_space.fetch_add(
+				group_sz - elts_added_to_block, std::memory_order_relaxed);
 			total_block_size.fetch_add(
 				elts_added_to_block, std::memory_order_release);
-			if (post_check <= 0) {
-				return;
-			}
+			txs_added += elts_added_to_block;
 		}
 	}
 
-	BlockProductionReduce(BlockProductionReduce& x, tbb::split)
+	DeferredRetryReduce(DeferredRetryReduce& x, tbb::split)
 		: management_structures(x.management_structures)
 		, mempool(x.mempool)
 		, serial_processor_cache(x.serial_processor_cache)
 		, remaining_block_space(x.remaining_block_space)
 		, total_block_size(x.total_block_size)
+		, deferred_txs(x.deferred_txs)
+		, group_starts(x.group_starts)
 		, status_counts()
 		, stats()
-			{};
-
-	void join(BlockProductionReduce& other) {
+		, txs_added(0)
+		{}
 
-		for (auto iter = other.status_counts.begin(); iter != other.status_counts.end(); iter++) {
-			status_counts[iter->first] += iter->second;
+	void join(DeferredRetryReduce& other) {
+		for (auto const& [status, count] : other.status_counts) {
+			status_counts[status] += count;
 		}
-
 		stats += other.stats;
+		txs_added += other.txs_added;
 	}
 
-	BlockProductionReduce(
+	DeferredRetryReduce(
 		SpeedexManagementStructures& management_structures,
 		Mempool& mempool,
 		utils::ThreadlocalCache<SerialTransactionProcessor>& serial_processor_cache,
 		std::atomic<int64_t>& remaining_block_space,
-		std::atomic<uint64_t>& total_block_size)
+		std::atomic<uint64_t>& total_block_size,
+		std::vector<DeferredTx>& deferred_txs,
+		const std::vector<size_t>& group_starts)
 		: management_structures(management_structures)
 		, mempool(mempool)
 		, serial_processor_cache(serial_processor_cache)
 		, remaining_block_space(remaining_block_space)
 		, total_block_size(total_block_size)
+		, deferred_txs(deferred_txs)
+		, group_starts(group_starts)
 		, status_counts()
 		, stats()
 		{}
 };
 
+//! Run the deferred retry wave over the txs set aside by the first wave,
+//! and mark the ones that succeeded (or failed for good) in their
+//! mempool chunks.  Returns the number of txs added to the block.
+uint64_t
+run_deferred_retry_wave(
+	SpeedexManagementStructures& management_structures,
+	Mempool& mempool,
+	utils::ThreadlocalCache<SerialTransactionProcessor>& serial_processor_cache,
+	std::atomic<int64_t>& remaining_space,
+	std::atomic<uint64_t>& total_block_size,
+	std::vector<DeferredTx>& deferred_txs,
+	BlockStateUpdateStatsWrapper& stats)
+{
+	if (deferred_txs.size() == 0) {
+		return 0;
+	}
+
+	std::sort(deferred_txs.begin(), deferred_txs.end());
+
+	std::vector<size_t> group_starts;
+	for (size_t k = 0; k < deferred_txs.size(); k++) {
+		if (k == 0 
+			|| deferred_txs[k].source_account 
+				!= deferred_txs[k-1].source_account) {
+			group_starts.push_back(k);
+		}
+	}
+	size_t num_groups = group_starts.size();
+	group_starts.push_back(deferred_txs.size());
+
+	auto retry = DeferredRetryReduce(
+		management_structures,
+		mempool,
+		serial_processor_cache,
+		remaining_space,
+		total_block_size,
+		deferred_txs,
+		group_starts);
+
+	tbb::parallel_reduce(
+		tbb::blocked_range<size_t>(0, num_groups), retry);
+
+	for (auto const& deferred : deferred_txs) {
+		if (deferred.remove) {
+			mempool[deferred.chunk_idx].mark_confirmed_tx(deferred.tx_idx);
+		}
+	}
+
+	MEMPOOL_INFO_F(
+		for (auto const& [status, count] : retry.status_counts) {
+			std::printf("block_producer.cc:   retry wave stats: code %" PRId32 " count %" PRIu64 "\n", status, count);
+		}
+	);
+
+	BLOCK_INFO("deferred retry wave: %lu deferred txs from %lu accounts, %lu added",
+		deferred_txs.size(), num_groups, retry.txs_added);
+
+	stats += retry.stats;
+	return retry.txs_added;
+}
+
 
 //returns block size
 uint64_t 
@@ -198,15 +450,20 @@ BlockProducer::build_block(
 	std::atomic<int64_t> remaining_space = max_block_size;
 	std::atomic<uint64_t> total_block_size = 0;
 
+	// in a sharded mempool, schedule whole shards instead of single chunks
+	auto shard_chunks = mempool.get_shard_chunks();
 
 	auto producer = BlockProductionReduce(
 		management_structures, 
 		mempool,
 		serial_processor_cache,
 		remaining_space, 
-		total_block_size);
+		total_block_size,
+		management_structures.configs.deferred_retry_wave,
+		shard_chunks);
 
-	tbb::blocked_range<size_t> range(0, mempool.num_chunks());
+	tbb::blocked_range<size_t> range(0, 
+		shard_chunks.empty() ? mempool.num_chunks() : shard_chunks.size());
 
 	BLOCK_INFO("starting produce block from mempool, max size=%ld", max_block_size);
 
@@ -224,6 +481,19 @@ BlockProducer::build_block(
 			producer.stats.new_offer_count, producer.stats.cancel_offer_count, producer.stats.payment_count, producer.stats.new_account_count); 
 	);
 
+	auto retry_timestamp = utils::init_time_measurement();
+
+	measurements.deferred_retry_txs = run_deferred_retry_wave(
+		management_structures,
+		mempool,
+		serial_processor_cache,
+		remaining_space,
+		total_block_size,
+		producer.deferred_txs,
+		producer.stats);
+
+	measurements.deferred_retry_time = utils::measure_time(retry_timestamp);
+
 	worker.do_merge();
 
 	size_t num_orderbooks 
@@ -257,7 +527,8 @@ BlockProducer::build_block(
 	BLOCK_INFO("produced block of size %lu", block_size);
 
 	state_update_stats += producer.stats;
-	worker.wait_for_merge_finish();
+	// The mod log merge is left running.  Its first consumer (offer
+	// clearing, after Tatonnement) waits for it if need be.
 	return block_size;
 }
 
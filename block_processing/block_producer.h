@@ -22,6 +22,14 @@
 
 Produce a block of transactions (of an approximate target size),
 given a mempool of uncommitted (new) transactions.
+
+Mempool chunks are processed in parallel, so a tx can fail only because
+of the order in which it met other txs of the same block (a sequence number
+or new account id held by a tx that later failed, or a balance that a later
+tx would have funded).  When the deferred retry wave is enabled,
+these txs are collected, grouped by source account, sorted by sequence
+number, and re-executed in a second parallel wave (each account's txs
+in order on one thread) before the block is closed.
 */
 
 #include "modlog/log_merge_worker.h"
@@ -25,6 +25,7 @@
 #include "orderbook/commitment_checker.h"
 
 #include "speedex/speedex_management_structures.h"
+#include "speedex/speedex_static_configs.h"
 #include "stats/block_update_stats.h"
 
 #include <atomic>
@@ -50,6 +51,10 @@ struct SignedTransactionListWrapper {
 		return tx_validator.validate_transaction(data[i], stats, serial_account_log);
 	}
 
+	void add_to_filter_log(FilterLog& log, const MemoryDatabase& db) const {
+		log.add_txs(data, db);
+	}
+
 	size_t size() const {
 		return data.size();
 	}
@@ -69,6 +74,15 @@ struct AccountModificationBlockWrapper {
 		return success;
 	}
 
+	void add_to_filter_log(FilterLog& log, const MemoryDatabase& db) const {
+		log.add_tx_lists(
+			data.size(),
+			[this] (size_t i) -> const std::vector<SignedTransaction>* {
+				return &(data[i].new_transactions_self);
+			},
+			db);
+	}
+
 	size_t size() const {
 		return data.size();
 	}
@@ -147,6 +161,77 @@ public:
 		{}
 };
 
+//! Validate the txs grouped by a FilterLog, one account at a time.
+//! Each account's txs are validated in seq num order on one thread.
+template<typename serial_cache_t>
+class AccountOrderedValidate {
+	SpeedexManagementStructures& management_structures;
+	const OrderbookStateCommitmentChecker& clearing_commitment;
+	ThreadsafeValidationStatistics& main_stats;
+	serial_cache_t& serial_validator_cache;
+
+	utils::ThreadlocalCache<BlockStateUpdateStatsWrapper> stats_cache;
+
+public:
+
+	std::atomic<bool> valid = true;
+
+	void operator() (const AccountFilterEntry& entry) {
+		if (!valid.load(std::memory_order_relaxed)) {
+			return;
+		}
+		SerialAccountModificationLog serial_account_log(
+			management_structures.account_modification_log);
+		auto& tx_validator = serial_validator_cache.get(
+			management_structures,
+			clearing_commitment,
+			main_stats);
+		auto& stats = stats_cache.get();
+
+		entry.for_each_tx(
+			[&] (const SignedTransaction& tx) -> bool {
+				if (!tx_validator.validate_transaction(tx, stats, serial_account_log)) {
+					valid.store(false, std::memory_order_relaxed);
+					return false;
+				}
+				return true;
+			});
+	}
+
+	void add_stats_to(BlockStateUpdateStatsWrapper& out) {
+		for (auto& stats : stats_cache.get_objects()) {
+			if (stats) {
+				out += *stats;
+			}
+		}
+	}
+
+	AccountOrderedValidate(
+		SpeedexManagementStructures& management_structures,
+		const OrderbookStateCommitmentChecker& clearing_commitment,
+		ThreadsafeValidationStatistics& main_stats,
+		serial_cache_t& serial_validator_cache)
+		: management_structures(management_structures)
+		, clearing_commitment(clearing_commitment)
+		, main_stats(main_stats)
+		, serial_validator_cache(serial_validator_cache)
+		{}
+};
+
+template<typename WrappedType>
+bool
+BlockValidator::run_filter_precheck(const WrappedType& transactions) {
+	filter_log.clear();
+	try {
+		transactions.add_to_filter_log(filter_log, management_structures.db);
+	} catch (std::runtime_error const& e) {
+		// i.e. unknown operation types
+		BLOCK_INFO("filter precheck error: %s", e.what());
+		return false;
+	}
+	return !filter_log.found_certain_invalid();
+}
+
 template<typename WrappedType>
 bool 
 BlockValidator::validate_transaction_block_(
@@ -174,20 +259,61 @@ BlockValidator::validate_transaction_block_(
 		throw std::runtime_error("forgot to clear mod log");
 	}
 
-	auto timestamp = utils::init_time_measurement();
+	// If set, every account's debits are covered by its balance
+	// before the block, so the final balance check cannot fail.
+	bool skip_state_check = false;
 
-	auto range = tbb::blocked_range<size_t>(
-		0, transactions.size(), VALIDATION_BATCH_SIZE);
+	if (use_filter_precheck) {
+		auto filter_timestamp = utils::init_time_measurement();
+		bool precheck_res = run_filter_precheck(transactions);
+		measurements.tx_validation_filter_time = utils::measure_time(filter_timestamp);
 
-	tbb::parallel_reduce(range, validator);
-	BLOCK_INFO("done validating");
+		BLOCK_INFO("filter precheck took %lf, result %d", 
+			measurements.tx_validation_filter_time, precheck_res);
 
-	if (!validator.valid) {
-		BLOCK_INFO("transaction returned as invalid");
-		return false;
+		if (!precheck_res) {
+			return false;
+		}
+		skip_state_check = filter_log.all_requirements_met();
 	}
 
-	stats += validator.state_update_stats;
+	auto timestamp = utils::init_time_measurement();
+
+	if (use_filter_precheck) {
+		// every tx of the block is in exactly one account's list
+		// (the precheck rejects repeated txs and committed seq nums)
+		AccountOrderedValidate<serial_cache_t> account_validator(
+			management_structures,
+			clearing_commitment,
+			main_stats,
+			serial_validator_cache);
+
+		auto apply_lambda = [&account_validator] (const AccountFilterEntry& entry) {
+			account_validator(entry);
+		};
+		filter_log.parallel_apply_accounts(apply_lambda);
+		BLOCK_INFO("done validating by account");
+
+		if (!account_validator.valid.load(std::memory_order_relaxed)) {
+			BLOCK_INFO("transaction returned as invalid");
+			return false;
+		}
+
+		account_validator.add_stats_to(stats);
+	} else {
+		auto range = tbb::blocked_range<size_t>(
+			0, transactions.size(), VALIDATION_BATCH_SIZE);
+
+		tbb::parallel_reduce(range, validator);
+		BLOCK_INFO("done validating");
+
+		if (!validator.valid) {
+			BLOCK_INFO("transaction returned as invalid");
+			return false;
+		}
+
+		stats += validator.state_update_stats;
+	}
 
 	measurements.tx_validation_processing_time = utils::measure_time(timestamp);
 
@@ -225,6 +351,11 @@ BlockValidator::validate_transaction_block_(
 
 	measurements.tx_validation_trie_merge_time = utils::measure_time(timestamp);
 
+	if (skip_state_check) {
+		BLOCK_INFO("tx validation success, db state check implied by filter");
+		return true;
+	}
+
 	BLOCK_INFO("tx validation success, checking db state");
 	auto res = management_structures.db.check_valid_state(
 		management_structures.account_modification_log);
@@ -24,8 +24,21 @@ Convenience wrapper around logic for validating a block of transactions.
 
 Only does the actual iteration over transactions.  Does not do 
 offer clearing/validation checks.
+
+If the filter precheck is on (FILTER_LOG_VALIDATION_PRECHECK, off by
+default), first runs a FilterLog over the block.  This cheap parallel
+pass groups txs by source account and checks seq nums (conflicts,
+repeats, and the account's window) and each account's aggregate debits.
+Blocks that the filter shows to be invalid are rejected before any
+modification to the account database.  Blocks that pass are then applied
+account by account: each account's txs run in seq num order on one
+thread, instead of in block order across all threads.
 */
 
+#include "filtering/filter_log.h"
+
+#include "speedex/speedex_static_configs.h"
+
 #include "xdr/block.h"
 #include "xdr/transaction.h"
 #include "xdr/database_commitments.h"
@@ -51,6 +64,15 @@ class BlockValidator {
 	SpeedexManagementStructures& management_structures;
 	LogMergeWorker& worker;
 
+	//! Per-account pre-check, reused across blocks.
+	FilterLog filter_log;
+	const bool use_filter_precheck;
+
+	//! Run filter_log over a batch of transactions.
+	//! Returns false if the batch is certain to be invalid.
+	template<typename WrappedType>
+	bool run_filter_precheck(const WrappedType& transactions);
+
 	//! Validate a batch of transactions
 	template<typename WrappedType>
 	bool validate_transaction_block_(
@@ -63,9 +85,12 @@ class BlockValidator {
 public:
 	//! Create a new block validator.
 	BlockValidator(SpeedexManagementStructures& management_structures,
-		LogMergeWorker& log_merge_worker)
+		LogMergeWorker& log_merge_worker,
+		bool use_filter_precheck = FILTER_LOG_VALIDATION_PRECHECK)
 		: management_structures(management_structures)
-		, worker(log_merge_worker) {}
+		, worker(log_merge_worker)
+		, filter_log()
+		, use_filter_precheck(use_filter_precheck) {}
 
 	bool validate_transaction_block(
 		const AccountModificationBlock& transactions,
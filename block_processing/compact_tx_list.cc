@@ -0,0 +1,471 @@
+/**
+ * SPEEDEX: A Scalable, Parallelizable, and Economically Efficient Decentralized Exchange
+ * Copyright (C) 2023 Geoffrey Ramseyer
+
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "block_processing/compact_tx_list.h"
+
+#include <array>
+#include <cstring>
+#include <stdexcept>
+
+namespace speedex {
+
+namespace {
+
+constexpr uint32_t COMPACT_TX_LIST_MAGIC = 0x31585443; // "CTX1"
+
+enum Column : uint32_t
+{
+	SOURCE_ACCOUNTS = 0,
+	SEQUENCE_NUMBERS,
+	FEES,
+	OP_COUNTS,
+	OP_TYPES,
+	CREATE_ACCOUNT_OPS,
+	CREATE_SELL_OFFER_OPS,
+	CANCEL_SELL_OFFER_OPS,
+	PAYMENT_OPS,
+	MONEY_PRINTER_OPS,
+	SIGNATURES,
+	NUM_COLUMNS
+};
+
+Column
+op_column(OperationType type)
+{
+	switch(type)
+	{
+		case CREATE_ACCOUNT:
+			return CREATE_ACCOUNT_OPS;
+		case CREATE_SELL_OFFER:
+			return CREATE_SELL_OFFER_OPS;
+		case CANCEL_SELL_OFFER:
+			return CANCEL_SELL_OFFER_OPS;
+		case PAYMENT:
+			return PAYMENT_OPS;
+		case MONEY_PRINTER:
+			return MONEY_PRINTER_OPS;
+	}
+	throw std::runtime_error("invalid operation type");
+}
+
+[[noreturn]] void
+malformed()
+{
+	throw std::runtime_error("malformed compact tx list");
+}
+
+uint64_t
+zigzag(int64_t v)
+{
+	return (static_cast<uint64_t>(v) << 1) ^ static_cast<uint64_t>(v >> 63);
+}
+
+int64_t
+unzigzag(uint64_t v)
+{
+	return static_cast<int64_t>(v >> 1) ^ -static_cast<int64_t>(v & 1);
+}
+
+// Deltas between 64-bit ids are taken mod 2^64, so any pair of ids
+// round trips.
+int64_t
+delta(uint64_t cur, uint64_t base)
+{
+	return static_cast<int64_t>(cur - base);
+}
+
+struct ColumnWriter
+{
+	std::vector<uint8_t> buf;
+
+	void put_varint(uint64_t v)
+	{
+		while (v >= 0x80)
+		{
+			buf.push_back(static_cast<uint8_t>(v | 0x80));
+			v >>= 7;
+		}
+		buf.push_back(static_cast<uint8_t>(v));
+	}
+
+	void put_signed(int64_t v)
+	{
+		put_varint(zigzag(v));
+	}
+
+	void put_byte(uint8_t b)
+	{
+		buf.push_back(b);
+	}
+
+	void put_bytes(const uint8_t* data, size_t len)
+	{
+		buf.insert(buf.end(), data, data + len);
+	}
+};
+
+struct ColumnReader
+{
+	const uint8_t* cur = nullptr;
+	const uint8_t* end = nullptr;
+
+	uint64_t get_varint()
+	{
+		uint64_t out = 0;
+		for (uint32_t shift = 0; shift < 64; shift += 7)
+		{
+			if (cur == end)
+			{
+				malformed();
+			}
+			uint8_t b = *cur++;
+			out |= static_cast<uint64_t>(b & 0x7F) << shift;
+			if (!(b & 0x80))
+			{
+				return out;
+			}
+		}
+		malformed();
+	}
+
+	uint32_t get_varint32()
+	{
+		uint64_t v = get_varint();
+		if (v > UINT32_MAX)
+		{
+			malformed();
+		}
+		return static_cast<uint32_t>(v);
+	}
+
+	int64_t get_signed()
+	{
+		return unzigzag(get_varint());
+	}
+
+	uint8_t get_byte()
+	{
+		if (cur == end)
+		{
+			malformed();
+		}
+		return *cur++;
+	}
+
+	void get_bytes(uint8_t* out, size_t len)
+	{
+		if (static_cast<size_t>(end - cur) < len)
+		{
+			malformed();
+		}
+		std::memcpy(out, cur, len);
+		cur += len;
+	}
+
+	bool done() const
+	{
+		return cur == end;
+	}
+};
+
+void
+put_category(ColumnWriter& w, OfferCategory const& category)
+{
+	w.put_varint(category.sellAsset);
+	w.put_varint(category.buyAsset);
+	w.put_varint(category.type);
+}
+
+void
+get_category(ColumnReader& r, OfferCategory& category)
+{
+	category.sellAsset = r.get_varint32();
+	category.buyAsset = r.get_varint32();
+	if (r.get_varint() != OfferType::SELL)
+	{
+		malformed();
+	}
+	category.type = OfferType::SELL;
+}
+
+void
+encode_op(ColumnWriter& w, Operation const& op, AccountID source)
+{
+	switch(op.body.type())
+	{
+		case CREATE_ACCOUNT:
+		{
+			auto const& body = op.body.createAccountOp();
+			w.put_signed(body.startingBalance);
+			w.put_signed(delta(body.newAccountId, source));
+			w.put_bytes(body.newAccountPublicKey.data(), body.newAccountPublicKey.size());
+			return;
+		}
+		case CREATE_SELL_OFFER:
+		{
+			auto const& body = op.body.createSellOfferOp();
+			put_category(w, body.category);
+			w.put_signed(body.amount);
+			w.put_varint(body.minPrice);
+			return;
+		}
+		case CANCEL_SELL_OFFER:
+		{
+			auto const& body = op.body.cancelSellOfferOp();
+			put_category(w, body.category);
+			w.put_varint(body.offerId);
+			w.put_varint(body.minPrice);
+			return;
+		}
+		case PAYMENT:
+		{
+			auto const& body = op.body.paymentOp();
+			w.put_signed(delta(body.receiver, source));
+			w.put_varint(body.asset);
+			w.put_signed(body.amount);
+			return;
+		}
+		case MONEY_PRINTER:
+		{
+			auto const& body = op.body.moneyPrinterOp();
+			w.put_varint(body.asset);
+			w.put_signed(body.amount);
+			return;
+		}
+	}
+	throw std::runtime_error("invalid operation type");
+}
+
+void
+decode_op(ColumnReader& r, Operation& op, OperationType type, AccountID source)
+{
+	op.body.type(type);
+	switch(type)
+	{
+		case CREATE_ACCOUNT:
+		{
+			auto& body = op.body.createAccountOp();
+			body.startingBalance = r.get_signed();
+			body.newAccountId = source + static_cast<uint64_t>(r.get_signed());
+			r.get_bytes(body.newAccountPublicKey.data(), body.newAccountPublicKey.size());
+			return;
+		}
+		case CREATE_SELL_OFFER:
+		{
+			auto& body = op.body.createSellOfferOp();
+			get_category(r, body.category);
+			body.amount = r.get_signed();
+			body.minPrice = r.get_varint();
+			return;
+		}
+		case CANCEL_SELL_OFFER:
+		{
+			auto& body = op.body.cancelSellOfferOp();
+			get_category(r, body.category);
+			body.offerId = r.get_varint();
+			body.minPrice = r.get_varint();
+			return;
+		}
+		case PAYMENT:
+		{
+			auto& body = op.body.paymentOp();
+			body.receiver = source + static_cast<uint64_t>(r.get_signed());
+			body.asset = r.get_varint32();
+			body.amount = r.get_signed();
+			return;
+		}
+		case MONEY_PRINTER:
+		{
+			auto& body = op.body.moneyPrinterOp();
+			body.asset = r.get_varint32();
+			body.amount = r.get_signed();
+			return;
+		}
+	}
+	malformed();
+}
+
+} /* anonymous namespace */
+
+void
+encode_compact_tx_list(SignedTransactionList const& txs, std::vector<uint8_t>& out)
+{
+	std::array<ColumnWriter, NUM_COLUMNS> columns;
+
+	AccountID prev_source = 0;
+	uint64_t prev_seq = 0;
+
+	for (size_t i = 0; i < txs.size(); i++)
+	{
+		auto const& tx = txs[i].transaction;
+		AccountID source = tx.metadata.sourceAccount;
+
+		columns[SOURCE_ACCOUNTS].put_signed(delta(source, prev_source));
+
+		if (i > 0 && source == prev_source)
+		{
+			columns[SEQUENCE_NUMBERS].put_signed(delta(tx.metadata.sequenceNumber, prev_seq));
+		}
+		else
+		{
+			columns[SEQUENCE_NUMBERS].put_varint(tx.metadata.sequenceNumber);
+		}
+		prev_source = source;
+		prev_seq = tx.metadata.sequenceNumber;
+
+		columns[FEES].put_varint(tx.maxFee);
+		columns[OP_COUNTS].put_varint(tx.operations.size());
+
+		for (auto const& op : tx.operations)
+		{
+			columns[OP_TYPES].put_byte(static_cast<uint8_t>(op.body.type()));
+			encode_op(columns[op_column(op.body.type())], op, source);
+		}
+
+		columns[SIGNATURES].put_bytes(txs[i].signature.data(), txs[i].signature.size());
+	}
+
+	ColumnWriter header;
+	for (uint32_t i = 0; i < 4; i++)
+	{
+		header.put_byte(static_cast<uint8_t>(COMPACT_TX_LIST_MAGIC >> (8 * i)));
+	}
+	header.put_varint(txs.size());
+	for (auto const& column : columns)
+	{
+		header.put_varint(column.buf.size());
+	}
+
+	size_t total = header.buf.size();
+	for (auto const& column : columns)
+	{
+		total += column.buf.size();
+	}
+	out.reserve(out.size() + total);
+
+	out.insert(out.end(), header.buf.begin(), header.buf.end());
+	for (auto const& column : columns)
+	{
+		out.insert(out.end(), column.buf.begin(), column.buf.end());
+	}
+}
+
+void
+decode_compact_tx_list(const uint8_t* data, size_t len, SignedTransactionList& out)
+{
+	ColumnReader header{data, data + len};
+
+	uint32_t magic = 0;
+	for (uint32_t i = 0; i < 4; i++)
+	{
+		magic |= static_cast<uint32_t>(header.get_byte()) << (8 * i);
+	}
+	if (magic != COMPACT_TX_LIST_MAGIC)
+	{
+		malformed();
+	}
+
+	uint64_t num_txs = header.get_varint();
+
+	std::array<uint64_t, NUM_COLUMNS> column_lens;
+	for (auto& column_len : column_lens)
+	{
+		column_len = header.get_varint();
+	}
+
+	std::array<ColumnReader, NUM_COLUMNS> columns;
+	const uint8_t* column_start = header.cur;
+	for (uint32_t i = 0; i < NUM_COLUMNS; i++)
+	{
+		if (static_cast<uint64_t>(header.end - column_start) < column_lens[i])
+		{
+			malformed();
+		}
+		columns[i] = ColumnReader{column_start, column_start + column_lens[i]};
+		column_start += column_lens[i];
+	}
+	if (column_start != header.end)
+	{
+		malformed();
+	}
+
+	// bounds num_txs before allocating anything
+	const size_t sig_len = Signature().size();
+	if (column_lens[SIGNATURES] / sig_len != num_txs
+		|| column_lens[SIGNATURES] % sig_len != 0)
+	{
+		malformed();
+	}
+
+	out.clear();
+	out.resize(num_txs);
+
+	AccountID prev_source = 0;
+	uint64_t prev_seq = 0;
+
+	for (size_t i = 0; i < num_txs; i++)
+	{
+		auto& tx = out[i].transaction;
+
+		AccountID source = prev_source + static_cast<uint64_t>(columns[SOURCE_ACCOUNTS].get_signed());
+		tx.metadata.sourceAccount = source;
+
+		if (i > 0 && source == prev_source)
+		{
+			tx.metadata.sequenceNumber = prev_seq + static_cast<uint64_t>(columns[SEQUENCE_NUMBERS].get_signed());
+		}
+		else
+		{
+			tx.metadata.sequenceNumber = columns[SEQUENCE_NUMBERS].get_varint();
+		}
+		prev_source = source;
+		prev_seq = tx.metadata.sequenceNumber;
+
+		tx.maxFee = columns[FEES].get_varint32();
+
+		uint64_t num_ops = columns[OP_COUNTS].get_varint();
+		if (num_ops > MAX_OPS_PER_TX)
+		{
+			malformed();
+		}
+		tx.operations.resize(num_ops);
+
+		for (auto& op : tx.operations)
+		{
+			uint8_t type = columns[OP_TYPES].get_byte();
+			if (type > MONEY_PRINTER)
+			{
+				malformed();
+			}
+			auto op_type = static_cast<OperationType>(type);
+			decode_op(columns[op_column(op_type)], op, op_type, source);
+		}
+
+		columns[SIGNATURES].get_bytes(out[i].signature.data(), out[i].signature.size());
+	}
+
+	for (auto const& column : columns)
+	{
+		if (!column.done())
+		{
+			malformed();
+		}
+	}
+}
+
+} /* speedex */
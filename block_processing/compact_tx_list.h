@@ -0,0 +1,58 @@
+/**
+ * SPEEDEX: A Scalable, Parallelizable, and Economically Efficient Decentralized Exchange
+ * Copyright (C) 2023 Geoffrey Ramseyer
+
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#pragma once
+
+/*! \file compact_tx_list.h
+
+Columnar, varint-coded encoding of a block's transaction list.
+
+Payment-heavy blocks are mostly redundant in plain XDR: source accounts
+repeat (the list comes out of the account modification log in account
+order), amounts and ids are small, and every field is padded to 4 or 8
+bytes.  This format stores each field as its own column:
+
+- source accounts, delta-coded from the previous transaction
+- sequence numbers, delta-coded within a run of one source account
+- fees and operation counts
+- operation types, one byte each
+- one column of operation bodies per operation type
+	(receivers and new account ids are coded relative to the source account)
+- signatures, raw
+
+Signed values use zigzag varints.  Encoding preserves transaction order,
+so decode(encode(x)) == x for any list.
+*/
+
+#include "xdr/block.h"
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+namespace speedex {
+
+//! Append the compact encoding of txs to out.
+void
+encode_compact_tx_list(SignedTransactionList const& txs, std::vector<uint8_t>& out);
+
+//! Decode a compact tx list.  Throws std::runtime_error on malformed input.
+void
+decode_compact_tx_list(const uint8_t* data, size_t len, SignedTransactionList& out);
+
+} /* speedex */
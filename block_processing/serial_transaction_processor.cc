@@ -81,6 +81,13 @@ inline std::string make_tx_id_string(const TransactionMetadata& metadata)
 		+ ")";
 }
 
+// Transfer reasons are only read when logging transfers.
+// Otherwise, don't build the string (which allocates on every op).
+#define TX_REASON(tx_metadata, suffix) \
+	(LOG_TRANSFERS \
+		? (make_tx_id_string(tx_metadata) + suffix).c_str() \
+		: "unknown")
+
 
 inline bool
 is_valid_amount(int64_t amount)
@@ -219,7 +226,7 @@ bool SerialTransactionValidator<ManagerViewType>::validate_transaction(
 //		source_account_idx, tx.metadata.sequenceNumber);
 
 	if (op_metadata.db_view.transfer_available(
-		source_account_idx, MemoryDatabase::NATIVE_ASSET, -fee_req, (make_tx_id_string(tx.metadata) + " fee").c_str())
+		source_account_idx, MemoryDatabase::NATIVE_ASSET, -fee_req, TX_REASON(tx.metadata, " fee"))
 		!= TransactionProcessingStatus::SUCCESS)
 	{
 		return false;
@@ -359,7 +366,7 @@ SerialTransactionProcessor::process_transaction(
 
 	auto fee_status = 
 		op_metadata.db_view.transfer_available(
-			source_account_idx, MemoryDatabase::NATIVE_ASSET, -fee_req, (make_tx_id_string(tx.metadata) + " fee").c_str());
+			source_account_idx, MemoryDatabase::NATIVE_ASSET, -fee_req, TX_REASON(tx.metadata, " fee"));
 
 	if (fee_status != TransactionProcessingStatus::SUCCESS)
 	{
@@ -509,7 +516,7 @@ SerialTransactionHandler<SerialManager>::process_operation(
 		metadata.source_account_idx,
 		Database::NATIVE_ASSET,
 		-op.startingBalance,
-		(make_tx_id_string(metadata.tx_metadata) + " create account send initial funding").c_str());
+		TX_REASON(metadata.tx_metadata, " create account send initial funding"));
 	if (status != TransactionProcessingStatus::SUCCESS) {
 		return status;
 	}
@@ -522,7 +529,7 @@ SerialTransactionHandler<SerialManager>::process_operation(
 		new_account_idx,
 		Database::NATIVE_ASSET,
 		op.startingBalance,
-		(make_tx_id_string(metadata.tx_metadata) + " create account recv initial funding").c_str());
+		TX_REASON(metadata.tx_metadata, " create account recv initial funding"));
 
 	if (status != TransactionProcessingStatus::SUCCESS) {
 		return status;
@@ -566,7 +573,7 @@ SerialTransactionHandler<SerialManager>::process_operation(
 
 	auto status = metadata.db_view.escrow(
 		metadata.source_account_idx, op.category.sellAsset, op.amount,
-		(make_tx_id_string(metadata.tx_metadata) + " create sell funding").c_str());
+		TX_REASON(metadata.tx_metadata, " create sell funding"));
 	if (status != TransactionProcessingStatus::SUCCESS) {
 		TX("escrow failed, unwinding create sell offer: account %lu, account_db_idx %lu, asset %lu, op.amount %lu", 
 			metadata.tx_metadata.sourceAccount, metadata.source_account_idx, op.category.sellAsset, op.amount);
@@ -610,7 +617,7 @@ SerialTransactionHandler<SerialManager>::process_operation(
 			metadata.source_account_idx, 
 			op.category.sellAsset, 
 			-found_offer -> amount,
-			(make_tx_id_string(metadata.tx_metadata) + " cancel offer recv back initial funding").c_str());
+			TX_REASON(metadata.tx_metadata, " cancel offer recv back initial funding"));
 		if (status != TransactionProcessingStatus::SUCCESS) {
 			serial_manager.undelete_offer(
 				market_idx, 
@@ -664,13 +671,13 @@ SerialTransactionHandler<SerialManager>::process_operation(
 
 	auto status = metadata.db_view.transfer_available(
 		metadata.source_account_idx, op.asset, -op.amount,
-		(make_tx_id_string(metadata.tx_metadata) + " transfer send").c_str());
+		TX_REASON(metadata.tx_metadata, " transfer send"));
 	if (status != TransactionProcessingStatus::SUCCESS) {
 		return status;
 	}
 	status = metadata.db_view.transfer_available(
 		target_account_idx, op.asset, op.amount,
-		(make_tx_id_string(metadata.tx_metadata) + " transfer recv").c_str());
+		TX_REASON(metadata.tx_metadata, " transfer recv"));
 	if (status != TransactionProcessingStatus::SUCCESS) {
 		return status;
 	}
@@ -693,7 +700,7 @@ SerialTransactionHandler<SerialManager>::process_operation(
 
 	return metadata.db_view.transfer_available(
 		metadata.source_account_idx, op.asset, op.amount,
-		(make_tx_id_string(metadata.tx_metadata) + " money printer").c_str());
+		TX_REASON(metadata.tx_metadata, " money printer"));
 }
 
 } // namespace speedex
@@ -0,0 +1,110 @@
+#include <catch2/catch_test_macros.hpp>
+
+#include "block_processing/block_producer.h"
+
+#include "mempool/mempool.h"
+
+#include "modlog/log_merge_worker.h"
+
+#include "speedex/speedex_management_structures.h"
+
+#include "stats/block_update_stats.h"
+
+#include "test_utils/formatting.h"
+
+#include "utils/transaction_type_formatter.h"
+
+namespace speedex
+{
+
+using test::make_seqno;
+
+SignedTransaction
+make_producer_test_payment(AccountID src, uint64_t seqno, AccountID dst, AssetID asset, int64_t amount)
+{
+	SignedTransaction tx;
+	tx.transaction.metadata.sourceAccount = src;
+	tx.transaction.metadata.sequenceNumber = make_seqno(seqno);
+	tx.transaction.operations.push_back(test::make_payment(dst, asset, amount));
+	tx.transaction.maxFee = tx_formatter::compute_min_fee(tx);
+	return tx;
+}
+
+uint64_t
+produce_funded_later_block(bool deferred_retry_wave, uint64_t& remaining_in_mempool)
+{
+	SpeedexManagementStructures management_structures(
+		2,
+		ApproximationParameters{
+			.tax_rate = 10,
+			.smooth_mult = 10
+		},
+		SpeedexRuntimeConfigs{
+			.check_sigs = false,
+			.deferred_retry_wave = deferred_retry_wave
+		});
+
+	auto& db = management_structures.db;
+
+	MemoryDatabaseGenesisData data;
+	data.id_list = {0, 1, 2};
+	data.pk_list.resize(data.id_list.size());
+
+	auto init_lambda = [&](UserAccount& user)
+	{
+		// account 1 cannot pay a fee until account 0 pays it
+		if (user.get_owner() != 1) {
+			db.transfer_available(&user, 0, 1000);
+		}
+		db.transfer_available(&user, 1, 1000);
+		user.commit();
+	};
+
+	db.install_initial_accounts_and_commit(data, init_lambda);
+
+	// one chunk, so the first wave processes these in order
+	Mempool mempool(100, 1000);
+	std::vector<SignedTransaction> txs;
+	txs.push_back(make_producer_test_payment(1, 1, 2, 1, 10));
+	txs.push_back(make_producer_test_payment(1, 2, 2, 1, 10));
+	txs.push_back(make_producer_test_payment(0, 1, 1, 0, 100));
+	mempool.chunkify_and_add_to_mempool_buffer(std::move(txs));
+	mempool.push_mempool_buffer_to_mempool();
+
+	LogMergeWorker worker(management_structures.account_modification_log);
+	BlockProducer producer(management_structures, worker);
+
+	BlockCreationMeasurements measurements;
+	BlockStateUpdateStatsWrapper stats;
+
+	uint64_t block_size = producer.build_block(mempool, 100, measurements, stats);
+
+	if (deferred_retry_wave) {
+		REQUIRE(measurements.deferred_retry_txs == 2);
+	} else {
+		REQUIRE(measurements.deferred_retry_txs == 0);
+	}
+
+	mempool.remove_confirmed_txs();
+	remaining_in_mempool = mempool.size();
+	return block_size;
+}
+
+TEST_CASE("deferred retry wave includes txs funded later in the block", "[block_producer]")
+{
+	uint64_t remaining = 0;
+
+	SECTION("without retry wave")
+	{
+		REQUIRE(produce_funded_later_block(false, remaining) == 1);
+		// INSUFFICIENT_BALANCE txs are dropped from the mempool
+		REQUIRE(remaining == 0);
+	}
+	SECTION("with retry wave")
+	{
+		REQUIRE(produce_funded_later_block(true, remaining) == 3);
+		REQUIRE(remaining == 0);
+	}
+}
+
+}
@@ -0,0 +1,159 @@
+#include <catch2/catch_test_macros.hpp>
+
+#include "block_processing/block_validator.h"
+
+#include "memory_database/sequence_tracker.h"
+
+#include "modlog/log_merge_worker.h"
+
+#include "orderbook/commitment_checker.h"
+
+#include "speedex/speedex_management_structures.h"
+
+#include "stats/block_update_stats.h"
+
+#include "test_utils/formatting.h"
+
+#include "utils/transaction_type_formatter.h"
+
+#include <algorithm>
+
+namespace speedex
+{
+
+using test::make_seqno;
+
+constexpr static AccountID VALIDATOR_TEST_NUM_ACCOUNTS = 10;
+
+SignedTransaction
+make_validator_test_payment(AccountID src, uint64_t seqno, AccountID dst, int64_t amount)
+{
+	SignedTransaction tx;
+	tx.transaction.metadata.sourceAccount = src;
+	tx.transaction.metadata.sequenceNumber = make_seqno(seqno);
+	tx.transaction.operations.push_back(test::make_payment(dst, 1, amount));
+	tx.transaction.maxFee = tx_formatter::compute_min_fee(tx);
+	return tx;
+}
+
+bool
+validate_test_block(bool use_precheck, SignedTransactionList const& txs, uint32_t& payment_count)
+{
+	SpeedexManagementStructures management_structures(
+		2,
+		ApproximationParameters{
+			.tax_rate = 10,
+			.smooth_mult = 10
+		},
+		SpeedexRuntimeConfigs{
+			.check_sigs = false
+		});
+
+	auto& db = management_structures.db;
+
+	MemoryDatabaseGenesisData data;
+	for (AccountID i = 0; i < VALIDATOR_TEST_NUM_ACCOUNTS; i++)
+	{
+		data.id_list.push_back(i);
+	}
+	data.pk_list.resize(data.id_list.size());
+
+	db.install_initial_accounts_and_commit(data, [&db] (UserAccount& user) {
+		db.transfer_available(&user, MemoryDatabase::NATIVE_ASSET, 1000);
+		db.transfer_available(&user, 1, 1000);
+		user.commit();
+	});
+
+	auto num_orderbooks = management_structures.orderbook_manager.get_num_orderbooks();
+
+	OrderbookStateCommitment clearing_details;
+	clearing_details.resize(num_orderbooks);
+
+	OrderbookStateCommitmentChecker commitment_checker(
+		clearing_details,
+		std::vector<Price>(2, 1),
+		management_structures.approx_params.tax_rate);
+
+	ThreadsafeValidationStatistics validation_stats(num_orderbooks);
+
+	LogMergeWorker worker(management_structures.account_modification_log);
+	BlockValidator validator(management_structures, worker, use_precheck);
+
+	BlockValidationMeasurements measurements;
+	BlockStateUpdateStatsWrapper stats;
+
+	bool res = validator.validate_transaction_block(
+		txs, commitment_checker, validation_stats, measurements, stats);
+
+	payment_count = stats.payment_count;
+	return res;
+}
+
+void
+check_validation_modes_agree(SignedTransactionList const& txs, bool expect, uint32_t expect_payments = 0)
+{
+	for (bool use_precheck : {false, true})
+	{
+		INFO("use_precheck " << use_precheck);
+		uint32_t payment_count = 0;
+		REQUIRE(validate_test_block(use_precheck, txs, payment_count) == expect);
+		if (expect)
+		{
+			REQUIRE(payment_count == expect_payments);
+		}
+	}
+}
+
+TEST_CASE("per-account validation matches block order validation", "[block_validator]")
+{
+	constexpr uint64_t window = SEQUENCE_TRACKER_WINDOW<MAX_SEQ_NUMS_PER_BLOCK>;
+
+	SignedTransactionList txs;
+
+	SECTION("valid block, seq nums out of order")
+	{
+		for (uint64_t seq = 1; seq <= 5; seq++)
+		{
+			for (AccountID acc = 0; acc < VALIDATOR_TEST_NUM_ACCOUNTS; acc++)
+			{
+				txs.push_back(make_validator_test_payment(acc, seq, (acc + 1) % VALIDATOR_TEST_NUM_ACCOUNTS, 10));
+			}
+		}
+		std::reverse(txs.begin(), txs.end());
+
+		check_validation_modes_agree(txs, true, 5 * VALIDATOR_TEST_NUM_ACCOUNTS);
+	}
+	SECTION("last seq num in the window")
+	{
+		txs.push_back(make_validator_test_payment(0, window, 1, 10));
+		check_validation_modes_agree(txs, true, 1);
+	}
+	SECTION("seq num past the window")
+	{
+		txs.push_back(make_validator_test_payment(0, window + 1, 1, 10));
+		check_validation_modes_agree(txs, false);
+	}
+	SECTION("repeated tx")
+	{
+		txs.push_back(make_validator_test_payment(0, 1, 1, 10));
+		txs.push_back(make_validator_test_payment(1, 1, 0, 10));
+		txs.push_back(make_validator_test_payment(0, 1, 1, 10));
+		check_validation_modes_agree(txs, false);
+	}
+	SECTION("account overdraft")
+	{
+		txs.push_back(make_validator_test_payment(0, 1, 1, 600));
+		txs.push_back(make_validator_test_payment(0, 2, 1, 600));
+		check_validation_modes_agree(txs, false);
+	}
+	SECTION("debits covered by a credit earlier in the block")
+	{
+		// 0's debits exceed its starting balance, but 1 pays it first
+		txs.push_back(make_validator_test_payment(1, 1, 0, 500));
+		txs.push_back(make_validator_test_payment(0, 1, 2, 600));
+		txs.push_back(make_validator_test_payment(0, 2, 2, 600));
+		check_validation_modes_agree(txs, true, 3);
+	}
+}
+
+}
@@ -0,0 +1,130 @@
+#include <catch2/catch_test_macros.hpp>
+
+#include "block_processing/compact_tx_list.h"
+
+#include "utils/transaction_type_formatter.h"
+
+#include <xdrpp/marshal.h>
+
+#include <cstdint>
+#include <random>
+#include <vector>
+
+namespace speedex
+{
+
+using xdr::operator==;
+
+using namespace tx_formatter;
+
+static SignedTransaction
+make_tx(AccountID source, uint64_t seqno, std::vector<Operation> const& ops)
+{
+	SignedTransaction tx;
+	tx.transaction.metadata.sourceAccount = source;
+	tx.transaction.metadata.sequenceNumber = seqno;
+	tx.transaction.maxFee = 100;
+	for (auto const& op : ops)
+	{
+		tx.transaction.operations.push_back(op);
+	}
+	tx.signature[0] = static_cast<uint8_t>(source);
+	tx.signature[63] = static_cast<uint8_t>(seqno);
+	return tx;
+}
+
+static void
+check_round_trip(SignedTransactionList const& txs)
+{
+	std::vector<uint8_t> buf;
+	encode_compact_tx_list(txs, buf);
+
+	SignedTransactionList out;
+	decode_compact_tx_list(buf.data(), buf.size(), out);
+
+	REQUIRE(out == txs);
+}
+
+TEST_CASE("compact tx list empty", "[compact]")
+{
+	check_round_trip(SignedTransactionList());
+}
+
+TEST_CASE("compact tx list all op types", "[compact]")
+{
+	OfferCategory category(1, 2, OfferType::SELL);
+
+	PublicKey pk;
+	pk[7] = 3;
+
+	SignedTransactionList txs;
+	txs.push_back(make_tx(5, 1 << 8, {
+		make_operation(CreateAccountOp(1000, 2, pk)),
+		make_operation(PaymentOp(UINT64_MAX, 3, INT64_MIN))
+	}));
+	txs.push_back(make_tx(5, 2 << 8, {
+		make_operation(CreateSellOfferOp(category, 10, 1ull << 40)),
+		make_operation(CancelSellOfferOp(category, (1 << 8) + 1, 1ull << 40))
+	}));
+	txs.push_back(make_tx(1, UINT64_MAX, {
+		make_operation(MoneyPrinterOp(UINT32_MAX, INT64_MAX))
+	}));
+	txs.push_back(make_tx(UINT64_MAX, 0, {}));
+
+	check_round_trip(txs);
+}
+
+TEST_CASE("compact tx list payments", "[compact]")
+{
+	std::minstd_rand gen(0);
+	std::uniform_int_distribution<uint64_t> account_dist(0, 100'000);
+	std::uniform_int_distribution<int64_t> amount_dist(1, 1'000);
+
+	SignedTransactionList txs;
+	for (AccountID source = 0; source < 1000; source++)
+	{
+		for (uint64_t seq = 1; seq <= 3; seq++)
+		{
+			txs.push_back(make_tx(source, seq << 8, {
+				make_operation(PaymentOp(account_dist(gen), 0, amount_dist(gen)))
+			}));
+		}
+	}
+
+	check_round_trip(txs);
+
+	std::vector<uint8_t> buf;
+	encode_compact_tx_list(txs, buf);
+	REQUIRE(buf.size() < xdr::xdr_to_opaque(txs).size());
+}
+
+TEST_CASE("compact tx list malformed", "[compact]")
+{
+	SignedTransactionList txs;
+	txs.push_back(make_tx(5, 1 << 8, {
+		make_operation(PaymentOp(6, 0, 10))
+	}));
+
+	std::vector<uint8_t> buf;
+	encode_compact_tx_list(txs, buf);
+
+	SignedTransactionList out;
+
+	SECTION("truncated")
+	{
+		buf.pop_back();
+		REQUIRE_THROWS(decode_compact_tx_list(buf.data(), buf.size(), out));
+	}
+	SECTION("trailing bytes")
+	{
+		buf.push_back(0);
+		REQUIRE_THROWS(decode_compact_tx_list(buf.data(), buf.size(), out));
+	}
+	SECTION("bad magic")
+	{
+		buf[0] ^= 1;
+		REQUIRE_THROWS(decode_compact_tx_list(buf.data(), buf.size(), out));
+	}
+}
+
+} /* speedex */
@@ -21,6 +21,8 @@
 
 #include "memory_database/memory_database.h"
 
+#include <algorithm>
+
 namespace speedex
 {
 
@@ -31,8 +33,6 @@ AccountFilterEntry::AccountFilterEntry(AccountID account)
     : account(account)
     , min_seq_no(UINT64_MAX)
     , initialized(true)
-    , txs()
-    , required_assets()
 {}
 
 void
@@ -40,13 +40,12 @@ AccountFilterEntry::assert_initialized() const
 {
     if (!initialized)
     {
-        std::printf("uninitialized\n");
         throw std::runtime_error("uninit");
     }
 }
 
 void
-AccountFilterEntry::add_req(AssetID const& asset, int64_t amount)
+AccountFilterEntry::add_req(FilterScratch& scratch, AssetID const& asset, int64_t amount)
 {
     if (amount < 0)
     {
@@ -60,63 +59,124 @@ AccountFilterEntry::add_req(AssetID const& asset, int64_t amount)
         return;
     }
 
+    // accounts typically touch only a few assets
+    auto it = scratch.required_assets.begin();
+    for (; it != scratch.required_assets.end(); it++)
+    {
+        if (it->first == asset)
+        {
+            break;
+        }
+    }
+    if (it == scratch.required_assets.end())
+    {
+        scratch.required_assets.emplace_back(asset, 0);
+        it = scratch.required_assets.end() - 1;
+    }
+
+    int64_t& req = it->second;
+
     #if __has_builtin(__builtin_add_overflow_p)
         if (__builtin_add_overflow_p(
-                amount, required_assets[asset], static_cast<int64_t>(0)))
+                amount, req, static_cast<int64_t>(0)))
         {
     #else
         int64_t temp = 0;
-        if (__builtin_add_overflow(amount, required_assets[asset], &temp))
+        if (__builtin_add_overflow(amount, req, &temp))
         {
     #endif 
     
         // overflow max requirement
-        required_assets[asset] = INT64_MAX;
+        req = INT64_MAX;
 	    log_overflow_req();
         return;
     }
 
-    required_assets[asset] += amount;
+    req += amount;
 }
 
 void
-AccountFilterEntry::add_cancel_id(uint64_t id)
+AccountFilterEntry::collect_txs(FilterScratch& scratch)
 {
-    if (consumed_cancel_ids.find(id) != consumed_cancel_ids.end())
+    for (auto* node = txs_head; node != nullptr; node = node -> next)
     {
-        log_double_cancel();
-        return;
+        scratch.txs.emplace_back(node -> seqno, node -> tx);
+    }
+
+    std::sort(scratch.txs.begin(), scratch.txs.end(),
+        [] (auto const& a, auto const& b) {
+            return a.first < b.first;
+        });
+
+    // drop exact duplicates, flag conflicting ones
+    size_t out = 0;
+    for (size_t i = 0; i < scratch.txs.size(); i++)
+    {
+        if (out > 0 && scratch.txs[out - 1].first == scratch.txs[i].first)
+        {
+            if (*scratch.txs[out - 1].second != *scratch.txs[i].second)
+            {
+                log_bad_duplicate();
+                return;
+            }
+            // the second copy would fail in a block
+            invalid_in_block = true;
+            continue;
+        }
+        scratch.txs[out] = scratch.txs[i];
+        out++;
+    }
+    scratch.txs.resize(out);
+
+    // reuse the list nodes to store the sorted order
+    FilterTxNode* node = txs_head;
+    FilterTxNode* prev = nullptr;
+    for (auto const& [seqno, tx] : scratch.txs)
+    {
+        node -> seqno = seqno;
+        node -> tx = tx;
+        prev = node;
+        node = node -> next;
+    }
+    if (prev == nullptr)
+    {
+        txs_head = nullptr;
+    }
+    else
+    {
+        prev -> next = nullptr;
     }
-    consumed_cancel_ids.insert(id);
+    txs_tail = prev;
 }
 
 void
-AccountFilterEntry::compute_reqs(AccountCreationFilter& accounts)
+AccountFilterEntry::compute_reqs(FilterScratch& scratch, AccountCreationFilter& accounts)
 {
 	if (reqs_computed)
 	{
 		throw std::runtime_error("double compute reqs");
 	}
-    for (auto const& [_, tx] : txs)
+    for (auto const& [_, tx_ptr] : scratch.txs)
     {
+        auto const& tx = *tx_ptr;
         for (auto const& op : tx.transaction.operations)
         {        
             switch (op.body.type())
             {
                 case CREATE_ACCOUNT:
-                    add_req(MemoryDatabase::NATIVE_ASSET,
+                    add_req(scratch, MemoryDatabase::NATIVE_ASSET,
                             op.body.createAccountOp().startingBalance);
                     accounts.log_account_creation(op.body.createAccountOp().newAccountId);
                     break;
                 case CREATE_SELL_OFFER:
-                    add_req(op.body.createSellOfferOp().category.sellAsset,
+                    add_req(scratch, op.body.createSellOfferOp().category.sellAsset,
                             op.body.createSellOfferOp().amount);
                     break;
                 case CANCEL_SELL_OFFER:
-                    add_cancel_id(op.body.cancelSellOfferOp().offerId);
+                    scratch.cancel_ids.push_back(op.body.cancelSellOfferOp().offerId);
                     break;
                 case PAYMENT:
-                    add_req(op.body.paymentOp().asset,
+                    add_req(scratch, op.body.paymentOp().asset,
                             op.body.paymentOp().amount);
                     break;
                 case MONEY_PRINTER:
@@ -125,19 +185,26 @@ AccountFilterEntry::compute_reqs(AccountCreationFilter& accounts)
                     throw std::runtime_error("filtering unknown optype");
             }
         }
-        add_req(MemoryDatabase::NATIVE_ASSET, tx.transaction.maxFee);
+        add_req(scratch, MemoryDatabase::NATIVE_ASSET, tx.transaction.maxFee);
     }
+
+    std::sort(scratch.cancel_ids.begin(), scratch.cancel_ids.end());
+    if (std::adjacent_find(scratch.cancel_ids.begin(), scratch.cancel_ids.end())
+        != scratch.cancel_ids.end())
+    {
+        log_double_cancel();
+    }
+
     reqs_computed = true;
 }
 
 void
 AccountFilterEntry::add_tx(SignedTransaction const& tx,
-                           MemoryDatabase const& db)
+                           MemoryDatabase const& db,
+                           FilterArena& arena)
 {
-//	std:printf("add tx\n");
     if (found_error()) // short circuit a bad account
     {
-    //	std::printf("already error\n");
         return;
     }
 
@@ -147,8 +214,7 @@ AccountFilterEntry::add_tx(SignedTransaction const& tx,
 
         if (acc == nullptr)
         {
-        //	std::printf("no account\n");
-            log_reqs_invalid();
+            log_invalid_account();
             return;
         }
         min_seq_no = acc->get_last_committed_seq_number();
@@ -158,23 +224,34 @@ AccountFilterEntry::add_tx(SignedTransaction const& tx,
 
     if (seqno <= min_seq_no)
     {
-    	//std::printf("low seqno, ignoring seqno=%lu min=%lu\n", seqno, min_seq_no);
+        // already committed
+        invalid_in_block = true;
         return;
     }
 
-    auto it = txs.find(seqno);
-    if (it != txs.end())
+    if (detail::array_get_seq_num_offset(seqno, min_seq_no) 
+        >= SEQUENCE_TRACKER_WINDOW<MAX_SEQ_NUMS_PER_BLOCK>)
     {
-        auto const& tx_old = it->second;
+        // cannot be reserved until the account's window moves,
+        // so its debits do not count against the account
+        invalid_in_block = true;
+        return;
+    }
 
-        if (!(tx_old == tx))
-        {
-        //	std::printf("dup seqno mismatch, error\n");
-            log_bad_duplicate();
-            return;
-        }
+    FilterTxNode* node = arena.allocate();
+    node -> seqno = seqno;
+    node -> tx = &tx;
+    node -> next = nullptr;
+
+    if (txs_tail == nullptr)
+    {
+        txs_head = node;
     }
-    txs.emplace(seqno, tx);
+    else
+    {
+        txs_tail -> next = node;
+    }
+    txs_tail = node;
 }
 
 void
@@ -215,15 +292,21 @@ AccountFilterEntry::log_double_cancel()
 
 
 void
-AccountFilterEntry::compute_validity(MemoryDatabase const& db, AccountCreationFilter& accounts)
+AccountFilterEntry::compute_validity(MemoryDatabase const& db, AccountCreationFilter& accounts, FilterScratch& scratch)
 {
-//	std::printf("compute_validity\n");
     if (checked_reqs_cached)
     {
         std::printf("double check valid\n");
         throw std::runtime_error("double check valid");
     }
 
+    scratch.clear();
+
+    if (!found_error())
+    {
+        collect_txs(scratch);
+    }
+
     if (found_error())
     {
         log_reqs_checked();
@@ -232,22 +315,21 @@ AccountFilterEntry::compute_validity(MemoryDatabase const& db, AccountCreationFi
 
     assert_initialized();
 
-    compute_reqs(accounts);
+    compute_reqs(scratch, accounts);
 
     auto const* acc = db.lookup_user(account);
     if (acc == nullptr)
     {
         log_invalid_account();
+        log_reqs_checked();
         return;
     }
 
-    for (auto const& [asset, req] : required_assets)
+    for (auto const& [asset, req] : scratch.required_assets)
     {
         int64_t avail = acc->lookup_available_balance(asset);
-    //    std::printf("asset %lu req %ld avail %ld\n", asset, req, avail);
         if (avail < req)
         {
-        //	std::printf("found invalid\n");
             log_reqs_invalid();
             return;
         }
@@ -282,6 +364,11 @@ AccountFilterEntry::check_valid() const
 	{
 		return FilterResult::OVERFLOW_REQ;
 	}
+
+    if (double_cancel)
+    {
+        return FilterResult::DOUBLE_CANCEL;
+    }
     return FilterResult::VALID_HAS_TXS;
 }
 
@@ -293,6 +380,8 @@ AccountFilterEntry::merge_in(AccountFilterEntry& other)
     found_invalid_reqs = found_invalid_reqs || other.found_invalid_reqs;
 	found_account_nexist = found_account_nexist || other.found_account_nexist;
 	overflow_req = overflow_req || other.overflow_req;
+    double_cancel = double_cancel || other.double_cancel;
+    invalid_in_block = invalid_in_block || other.invalid_in_block;
     
     if (found_error())
     {
@@ -307,6 +396,7 @@ AccountFilterEntry::merge_in(AccountFilterEntry& other)
     		throw std::runtime_error("invalid merge");
     	}
     }
+    account = other.account;
     initialized = true;
 
     if (other.reqs_computed || reqs_computed)
@@ -319,22 +409,21 @@ AccountFilterEntry::merge_in(AccountFilterEntry& other)
         throw std::runtime_error("improper merge in post check");
     }
 
-    txs.merge(other.txs);
-    
-    for (auto const& [seqno, tx] : other.txs)
+    // splice other's list onto the end of ours
+    if (other.txs_head != nullptr)
     {
-        auto it = txs.find(seqno);
-        if (it == txs.end())
+        if (txs_tail == nullptr)
         {
-            throw std::runtime_error("error in map merge");
+            txs_head = other.txs_head;
         }
-
-        if (it->second != tx)
+        else
         {
-        	log_bad_duplicate();
-            return;
+            txs_tail -> next = other.txs_head;
         }
+        txs_tail = other.txs_tail;
     }
+    other.txs_head = nullptr;
+    other.txs_tail = nullptr;
 }
 
 } // namespace speedex
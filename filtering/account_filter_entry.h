@@ -24,10 +24,9 @@
 #include "mtt/common/prefix.h"
 
 #include <cstdint>
-#include <map>
-#include <set>
 
 #include "filtering/error_code.h"
+#include "filtering/filter_arena.h"
 
 #include <utils/non_movable.h>
 
@@ -37,6 +36,17 @@ namespace speedex
 class MemoryDatabase;
 class AccountCreationFilter;
 
+/*! Filtering state for one account.
+
+Holds pointers to (not copies of) the account's txs, so
+the txs must outlive the call to compute_validity().
+Duplicate seq nums are detected in compute_validity().
+
+Some txs are harmless in a mempool but make a block invalid
+(exact duplicates, and seq nums outside the account's current window).
+These do not change check_valid(), and are reported separately
+by found_invalid_in_block().  Txs outside the window are not logged.
+*/
 class AccountFilterEntry
 {
     AccountID account;
@@ -44,11 +54,10 @@ class AccountFilterEntry
     bool initialized = false;
     bool reqs_computed = false;
 
-    std::map<uint64_t, SignedTransaction> txs;
-
-    std::map<AssetID, int64_t> required_assets;
-
-    std::set<uint64_t> consumed_cancel_ids;
+    //! txs, allocated from per-thread arenas.  In arbitrary order
+    //! until compute_validity(), then sorted by seqno (without duplicates).
+    FilterTxNode* txs_head = nullptr;
+    FilterTxNode* txs_tail = nullptr;
 
     bool found_bad_duplicate = false;
     bool found_invalid_reqs = false;
@@ -57,10 +66,11 @@ class AccountFilterEntry
     bool overflow_req = false;
     bool double_cancel = false;
 
+    bool invalid_in_block = false;
+
     bool checked_reqs_cached = false;
 
-    void add_req(AssetID const& asset, int64_t amount);
-    void add_cancel_id(uint64_t id);
+    void add_req(FilterScratch& scratch, AssetID const& asset, int64_t amount);
 
     void log_invalid_account();
     void log_bad_duplicate();
@@ -69,7 +79,10 @@ class AccountFilterEntry
     void log_reqs_invalid();
     void log_reqs_checked();
 
-    void compute_reqs(AccountCreationFilter& accounts);
+    //! Sorts txs into scratch.txs by seqno, and drops exact duplicates.
+    //! Relinks the tx list in the same order.
+    void collect_txs(FilterScratch& scratch);
+    void compute_reqs(FilterScratch& scratch, AccountCreationFilter& accounts);
 
     void assert_initialized() const;
 
@@ -83,51 +96,59 @@ public:
         : account(0)
         , min_seq_no(UINT64_MAX)
         , initialized(false)
-        , txs()
-        , required_assets()
     {}
 
     AccountFilterEntry(AccountID account);
 
-    void add_tx(SignedTransaction const& tx, MemoryDatabase const& db);
+    void add_tx(SignedTransaction const& tx, MemoryDatabase const& db, FilterArena& arena);
 
-    void compute_validity(MemoryDatabase const& db, AccountCreationFilter& accounts);
+    void compute_validity(MemoryDatabase const& db, AccountCreationFilter& accounts, FilterScratch& scratch);
 
     void merge_in(AccountFilterEntry& other);
 
     FilterResult check_valid() const;
+
+    //! True if these txs, as part of one block, are certain to make
+    //! the block invalid, even if check_valid() allows them.
+    bool found_invalid_in_block() const
+    {
+        return invalid_in_block;
+    }
+
+    //! Visit the account's txs, in seqno order (after compute_validity()).
+    //! Stops early if fn returns false.
+    template<typename Fn>
+    void for_each_tx(Fn const& fn) const
+    {
+        for (auto* node = txs_head; node != nullptr; node = node -> next)
+        {
+            if (!fn(*(node -> tx)))
+            {
+                return;
+            }
+        }
+    }
+};
+
+struct AccountFilterInsert
+{
+    const SignedTransaction* tx;
+    const MemoryDatabase* db;
+    FilterArena* arena;
 };
 
 struct AccountFilterInsertFn
 {
     static AccountFilterEntry new_value(trie::UInt64Prefix const& prefix)
     {
-        try
-        {
-            return AccountFilterEntry(prefix.uint64());
-        }
-        catch (...)
-        {
-            std::printf("wat2\n");
-            std::fflush(stdout);
-            throw;
-        }
+        return AccountFilterEntry(prefix.uint64());
     }
 
     static void value_insert(
         AccountFilterEntry& to_modify,
-        std::pair<SignedTransaction, const MemoryDatabase*> const& inserted)
+        AccountFilterInsert const& inserted)
     {
-        try
-        {
-            to_modify.add_tx(inserted.first, *(inserted.second));
-        }
-        catch (...)
-        {
-            std::printf("wat\n");
-            std::fflush(stdout);
-            throw;
-        }
+        to_modify.add_tx(*inserted.tx, *inserted.db, *inserted.arena);
     }
 };
 
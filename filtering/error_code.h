@@ -34,6 +34,7 @@ enum FilterResult : int32_t
     INVALID_DUPLICATE = -2,
     ACCOUNT_NEXIST = -3,
     OVERFLOW_REQ = -4,
+    DOUBLE_CANCEL = -5,
 };
 
 }
@@ -0,0 +1,103 @@
+#pragma once
+
+/**
+ * SPEEDEX: A Scalable, Parallelizable, and Economically Efficient Decentralized Exchange
+ * Copyright (C) 2023 Geoffrey Ramseyer
+
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/*! \file filter_arena.h
+
+Per-thread storage for the filtering log.
+
+Tx lists of AccountFilterEntry are singly linked lists of nodes
+allocated from a FilterArena.  Arenas are reset (but keep their
+memory) when the FilterLog is cleared, so filtering a block
+does not allocate once the arenas have grown to size.
+*/
+
+#include "xdr/transaction.h"
+#include "xdr/types.h"
+
+#include <cstdint>
+#include <memory>
+#include <utility>
+#include <vector>
+
+namespace speedex
+{
+
+struct FilterTxNode
+{
+    uint64_t seqno;
+    const SignedTransaction* tx;
+    FilterTxNode* next;
+};
+
+class FilterArena
+{
+    constexpr static size_t BLOCK_SIZE = 4096;
+
+    std::vector<std::unique_ptr<FilterTxNode[]>> blocks;
+
+    //! block currently allocating from
+    size_t cur_block = 0;
+    //! next unused node in cur_block
+    size_t cur_idx = BLOCK_SIZE;
+
+public:
+
+    FilterTxNode* allocate()
+    {
+        if (cur_idx == BLOCK_SIZE)
+        {
+            if (cur_block + 1 < blocks.size())
+            {
+                cur_block++;
+            }
+            else
+            {
+                blocks.emplace_back(std::make_unique<FilterTxNode[]>(BLOCK_SIZE));
+                cur_block = blocks.size() - 1;
+            }
+            cur_idx = 0;
+        }
+        return &blocks[cur_block][cur_idx++];
+    }
+
+    //! Invalidates all allocated nodes.  Keeps the memory for reuse.
+    void reset()
+    {
+        cur_block = 0;
+        cur_idx = (blocks.size() > 0) ? 0 : BLOCK_SIZE;
+    }
+};
+
+//! Reusable buffers for computing the validity of one account's txs.
+struct FilterScratch
+{
+    std::vector<std::pair<uint64_t, const SignedTransaction*>> txs;
+    std::vector<std::pair<AssetID, int64_t>> required_assets;
+    std::vector<uint64_t> cancel_ids;
+
+    void clear()
+    {
+        txs.clear();
+        required_assets.clear();
+        cancel_ids.clear();
+    }
+};
+
+} // namespace speedex
@@ -18,6 +18,7 @@
 
 #include "filtering/filter_log.h"
 
+#include <algorithm>
 #include <stdexcept>
 
 namespace speedex
@@ -32,24 +33,57 @@ FilterLog::add_txs(std::vector<SignedTransaction> const& txs,
     auto serial_add_lambda = [&cache, &txs, &db, this](
                                  const tbb::blocked_range<size_t> r) {
         auto& local_log = cache.get(entries);
+        auto& arena = arenas.get();
 
         for (size_t i = r.begin(); i < r.end(); i++)
         {
             auto const& tx = txs[i];
             local_log.template insert<AccountFilterInsertFn>(
-                tx.transaction.metadata.sourceAccount, std::make_pair(tx, &db));
+                tx.transaction.metadata.sourceAccount, 
+                AccountFilterInsert{&tx, &db, &arena});
         }
     };
 
     tbb::blocked_range<size_t> r(0, txs.size());
     tbb::parallel_for(r, serial_add_lambda);
 
+    merge_and_validate(cache, db);
+}
+
+void
+FilterLog::merge_and_validate(serial_cache_t& cache, MemoryDatabase const& db)
+{
     entries.template batch_merge_in<AccountFilterMergeFn>(cache);
 
     auto const validate_lambda = [&db, this](AccountFilterEntry& entry) {
-        entry.compute_validity(db, accounts);
+        entry.compute_validity(db, accounts, scratch_buffers.get());
+
+        if (entry.found_invalid_in_block())
+        {
+            found_invalid_in_block.store(true, std::memory_order_relaxed);
+        }
+
+        switch(entry.check_valid())
+        {
+            case FilterResult::VALID_NO_TXS:
+            case FilterResult::VALID_HAS_TXS:
+                break;
+            case FilterResult::INVALID_DUPLICATE:
+            case FilterResult::ACCOUNT_NEXIST:
+            case FilterResult::DOUBLE_CANCEL:
+                found_invalid_entry.store(true, std::memory_order_relaxed);
+                found_unmet_requirement.store(true, std::memory_order_relaxed);
+                break;
+            case FilterResult::MISSING_REQUIREMENT:
+            case FilterResult::OVERFLOW_REQ:
+                // the account might receive payments in the same block
+                found_unmet_requirement.store(true, std::memory_order_relaxed);
+                break;
+        }
     };
     entries.parallel_apply<decltype(validate_lambda), 1000>(validate_lambda);
+
+    accounts.finalize();
 }
 
 FilterResult
@@ -63,22 +97,46 @@ FilterLog::check_valid_account(AccountID const& account) const
 	return res -> check_valid();
 }
 
+bool
+FilterLog::found_certain_invalid() const
+{
+    return found_invalid_entry.load(std::memory_order_relaxed)
+        || found_invalid_in_block.load(std::memory_order_relaxed)
+        || accounts.found_duplicate_creation();
+}
+
 bool 
 AccountCreationFilter::is_valid_account_creation(AccountID account) const
 {
-    auto it = created_counts.find(account);
-    if (it == created_counts.end())
-    {
-        return true;
-    }
-    return it -> second == 1;
+    auto [lo, hi] = std::equal_range(created_accounts.begin(), created_accounts.end(), account);
+    return (hi - lo) <= 1;
 }
 
 void
 AccountCreationFilter::log_account_creation(AccountID src)
 {
-    std::lock_guard lock(mtx);
-    created_counts[src] ++;
+    pending_creations.get().push_back(src);
+}
+
+void
+AccountCreationFilter::finalize()
+{
+    created_accounts.clear();
+    for (auto const& pending : pending_creations.get_objects())
+    {
+        if (pending)
+        {
+            created_accounts.insert(created_accounts.end(), pending->begin(), pending->end());
+        }
+    }
+    std::sort(created_accounts.begin(), created_accounts.end());
+}
+
+bool
+AccountCreationFilter::found_duplicate_creation() const
+{
+    return std::adjacent_find(created_accounts.begin(), created_accounts.end())
+        != created_accounts.end();
 }
 
 bool 
@@ -24,26 +24,49 @@
 
 #include <utils/threadlocal_cache.h>
 
+#include <atomic>
+
+#include <tbb/parallel_for.h>
+
 #include "filtering/error_code.h"
+#include "filtering/filter_arena.h"
 
 namespace speedex
 {
 
+//! Counts account creations.  Creations are logged to per-thread
+//! buffers (no locking), and counted in finalize().
 class AccountCreationFilter
 {
-    std::mutex mtx;
-    std::map<AccountID, uint32_t> created_counts;
+    utils::ThreadlocalCache<std::vector<AccountID>> pending_creations;
+
+    //! Sorted, after finalize()
+    std::vector<AccountID> created_accounts;
 
     bool is_valid_account_creation(AccountID account) const;
 public:
 
     void log_account_creation(AccountID src);
 
+    //! Gather logged creations.  Must be called before any
+    //! checks, and not concurrently with log_account_creation.
+    void finalize();
+
     bool check_valid_tx(const SignedTransaction& tx) const;
 
+    //! True if some account is created more than once
+    bool found_duplicate_creation() const;
+
     void clear()
     {
-        created_counts.clear();
+        for (auto& pending : pending_creations.get_objects())
+        {
+            if (pending)
+            {
+                pending->clear();
+            }
+        }
+        created_accounts.clear();
     }
 };
 
@@ -58,10 +81,31 @@ class FilterLog
 
     AccountCreationFilter accounts;
 
+    //! Storage for entries' tx lists, reset on clear()
+    utils::ThreadlocalCache<FilterArena> arenas;
+    utils::ThreadlocalCache<FilterScratch> scratch_buffers;
+
+    std::atomic<bool> found_invalid_entry = false;
+    std::atomic<bool> found_unmet_requirement = false;
+    std::atomic<bool> found_invalid_in_block = false;
+
+    void merge_and_validate(serial_cache_t& cache, MemoryDatabase const& db);
+
 public:
+    //! Add a batch of txs and compute the validity of each account.
+    //! The log holds pointers to txs, which must remain valid
+    //! until this call returns.
     void add_txs(std::vector<SignedTransaction> const& txs,
                  MemoryDatabase const& db);
 
+    //! Add txs from many lists at once (i.e. the chunks of a mempool).
+    //! get_list(i) returns a pointer to the i'th list,
+    //! or nullptr to skip it.
+    template<typename ListAccessor>
+    void add_tx_lists(size_t num_lists,
+                      ListAccessor const& get_list,
+                      MemoryDatabase const& db);
+
     FilterResult check_valid_account(AccountID const& account) const;
     bool check_valid_tx(const SignedTransaction& tx) const
     {
@@ -72,10 +116,77 @@ public:
         return accounts.check_valid_tx(tx);
     }
 
+    //! True if the logged txs, taken as one block, are certain
+    //! to fail validation (conflicting or repeated txs with the same
+    //! seq num, seq nums outside an account's window, double cancels,
+    //! duplicate account creations, or nonexistent source accounts).
+    bool found_certain_invalid() const;
+
+    //! Apply fn to the entry of every account with logged txs, in parallel.
+    //! Each entry's txs are visited in seqno order via for_each_tx().
+    template<typename ApplyFn>
+    void parallel_apply_accounts(ApplyFn& fn)
+    {
+        entries.parallel_apply<ApplyFn, 1000>(fn);
+    }
+
+    //! True if, for every account, the total debits of the account's txs
+    //! (offer amounts, payments, new account balances, and max fees)
+    //! are covered by the account's balance before the txs.
+    //! If this holds and every tx is individually valid, no account
+    //! balance can end up negative.
+    bool all_requirements_met() const
+    {
+        return !found_unmet_requirement.load(std::memory_order_relaxed);
+    }
+
     void clear() {
         entries.clear();
         accounts.clear();
+        for (auto& arena : arenas.get_objects())
+        {
+            if (arena)
+            {
+                arena->reset();
+            }
+        }
+        found_invalid_entry = false;
+        found_unmet_requirement = false;
+        found_invalid_in_block = false;
     }
 };
 
+template<typename ListAccessor>
+void
+FilterLog::add_tx_lists(size_t num_lists,
+                        ListAccessor const& get_list,
+                        MemoryDatabase const& db)
+{
+    serial_cache_t cache;
+
+    tbb::parallel_for(
+        tbb::blocked_range<size_t>(0, num_lists),
+        [&cache, &get_list, &db, this](auto const& r) {
+            auto& local_log = cache.get(entries);
+            auto& arena = arenas.get();
+
+            for (size_t i = r.begin(); i < r.end(); i++)
+            {
+                std::vector<SignedTransaction> const* txs = get_list(i);
+                if (txs == nullptr)
+                {
+                    continue;
+                }
+                for (auto const& tx : *txs)
+                {
+                    local_log.template insert<AccountFilterInsertFn>(
+                        tx.transaction.metadata.sourceAccount, 
+                        AccountFilterInsert{&tx, &db, &arena});
+                }
+            }
+        });
+
+    merge_and_validate(cache, db);
+}
+
 } // namespace speedex
@@ -4,10 +4,13 @@
 #include "memory_database/memory_database.h"
 
 #include "filtering/account_filter_entry.h"
+#include "filtering/filter_arena.h"
 #include "filtering/filter_log.h"
 
 #include "xdr/types.h"
 
+#include <set>
+
 namespace speedex
 {
 
@@ -72,6 +75,8 @@ TEST_CASE("single account", "[filtering]")
 	AccountFilterEntry entry(id);
 
 	AccountCreationFilter acf;
+	FilterArena arena;
+	FilterScratch scratch;
 	MemoryDatabase db;
 	MemoryDatabaseGenesisData memdb_genesis;
 	memdb_genesis.id_list.push_back(id);
@@ -100,7 +105,7 @@ TEST_CASE("single account", "[filtering]")
 
 	SECTION("no txs, is valid")
 	{
-		entry.compute_validity(db, acf);
+		entry.compute_validity(db, acf, scratch);
 		//misnomer here, valid_no_txs is when there's no txs so accountfilterentry doesn't exist
 		REQUIRE(entry.check_valid() == FilterResult::VALID_HAS_TXS);
 	}
@@ -108,87 +113,288 @@ TEST_CASE("single account", "[filtering]")
 	SECTION("empty tx, just fee (payable)")
 	{
 		auto tx = make_empty_tx(id, initial_seqno + 10 * 256, 10);
-		entry.add_tx(tx, db);
-		entry.compute_validity(db, acf);
+		entry.add_tx(tx, db, arena);
+		entry.compute_validity(db, acf, scratch);
 		REQUIRE(entry.check_valid() == FilterResult::VALID_HAS_TXS);
 	}
 	SECTION("empty tx, just fee (not payable)")
 	{
 		auto tx = make_empty_tx(id, initial_seqno + 10 * 256, 100000);
-		entry.add_tx(tx, db);
-		entry.compute_validity(db, acf);
+		entry.add_tx(tx, db, arena);
+		entry.compute_validity(db, acf, scratch);
 		REQUIRE(entry.check_valid() == FilterResult::MISSING_REQUIREMENT);
 	}
 	SECTION("empty tx, just fee (bad seqno)")
 	{
 		auto tx = make_empty_tx(id, initial_seqno - 10 * 256, 10);
-		entry.add_tx(tx, db);
-		entry.compute_validity(db, acf);
+		entry.add_tx(tx, db, arena);
+		entry.compute_validity(db, acf, scratch);
 		REQUIRE(entry.check_valid() == FilterResult::VALID_HAS_TXS);
 	}
 	SECTION("empty tx, just fee (bad seqno, bad fee ignored)")
 	{
 		auto tx = make_empty_tx(id, initial_seqno - 10 * 256, 10000000);
-		entry.add_tx(tx, db);
-		entry.compute_validity(db, acf);
+		entry.add_tx(tx, db, arena);
+		entry.compute_validity(db, acf, scratch);
 		REQUIRE(entry.check_valid() == FilterResult::VALID_HAS_TXS);
 	}
 	SECTION("payment tx good")
 	{
 		auto tx = make_payment_tx(id, initial_seqno + 10 * 256, 10, id, 1, 10);
-		entry.add_tx(tx, db);
-		entry.compute_validity(db, acf);
+		entry.add_tx(tx, db, arena);
+		entry.compute_validity(db, acf, scratch);
 		REQUIRE(entry.check_valid() == FilterResult::VALID_HAS_TXS);
 	}	
 	SECTION("payment tx bad")
 	{
 		auto tx = make_payment_tx(id, initial_seqno + 10 * 256, 10, id, 1, 11);
-		entry.add_tx(tx, db);
-		entry.compute_validity(db, acf);
+		entry.add_tx(tx, db, arena);
+		entry.compute_validity(db, acf, scratch);
 		REQUIRE(entry.check_valid() == FilterResult::MISSING_REQUIREMENT);
 	}
 	SECTION("payment tx bad conflict with fee")
 	{
 		auto tx = make_payment_tx(id, initial_seqno + 10 * 256, 5, id, 0, 6);
-		entry.add_tx(tx, db);
-		entry.compute_validity(db, acf);
+		entry.add_tx(tx, db, arena);
+		entry.compute_validity(db, acf, scratch);
 		REQUIRE(entry.check_valid() == FilterResult::MISSING_REQUIREMENT);
 	}
 	SECTION("two payment tx good")
 	{
 		auto tx1 = make_payment_tx(id, initial_seqno + 10 * 256, 5, id, 1, 6);
 		auto tx2 = make_payment_tx(id, initial_seqno + 11 * 256, 5, id, 2, 6);
-		entry.add_tx(tx1, db);
-		entry.add_tx(tx2, db);
-		entry.compute_validity(db, acf);
+		entry.add_tx(tx1, db, arena);
+		entry.add_tx(tx2, db, arena);
+		entry.compute_validity(db, acf, scratch);
 		REQUIRE(entry.check_valid() == FilterResult::VALID_HAS_TXS);
 	}
 	SECTION("two payment tx bad")
 	{
 		auto tx1 = make_payment_tx(id, initial_seqno + 10 * 256, 5, id, 1, 6);
 		auto tx2 = make_payment_tx(id, initial_seqno + 11 * 256, 5, id, 1, 6);
-		entry.add_tx(tx1, db);
-		entry.add_tx(tx2, db);
-		entry.compute_validity(db, acf);
+		entry.add_tx(tx1, db, arena);
+		entry.add_tx(tx2, db, arena);
+		entry.compute_validity(db, acf, scratch);
 		REQUIRE(entry.check_valid() == FilterResult::MISSING_REQUIREMENT);
 	}
 	SECTION("same seqno fail")
 	{
 		auto tx1 = make_payment_tx(id, initial_seqno + 10 * 256, 5, id, 1, 1);
 		auto tx2 = make_payment_tx(id, initial_seqno + 10 * 256, 5, id, 2, 1);
-		entry.add_tx(tx1, db);
-		entry.add_tx(tx2, db);
-		entry.compute_validity(db, acf);
+		entry.add_tx(tx1, db, arena);
+		entry.add_tx(tx2, db, arena);
+		entry.compute_validity(db, acf, scratch);
 		REQUIRE(entry.check_valid() == FilterResult::INVALID_DUPLICATE);
 	}
 	SECTION("same seqno duplicate ok")
 	{
 		auto tx1 = make_payment_tx(id, initial_seqno + 10 * 256, 5, id, 1, 10);
 		auto tx2 = make_payment_tx(id, initial_seqno + 10 * 256, 5, id, 1, 10);
-		entry.add_tx(tx1, db);
-		entry.add_tx(tx2, db);
-		entry.compute_validity(db, acf);
+		entry.add_tx(tx1, db, arena);
+		entry.add_tx(tx2, db, arena);
+		entry.compute_validity(db, acf, scratch);
+		REQUIRE(entry.check_valid() == FilterResult::VALID_HAS_TXS);
+		// but not twice in one block
+		REQUIRE(entry.found_invalid_in_block());
+	}
+	SECTION("txs visited in seqno order")
+	{
+		auto tx1 = make_payment_tx(id, initial_seqno + 3 * 256, 1, id, 1, 1);
+		auto tx2 = make_payment_tx(id, initial_seqno + 1 * 256, 1, id, 1, 1);
+		auto tx3 = make_payment_tx(id, initial_seqno + 2 * 256, 1, id, 1, 1);
+		entry.add_tx(tx1, db, arena);
+		entry.add_tx(tx2, db, arena);
+		entry.add_tx(tx3, db, arena);
+		entry.compute_validity(db, acf, scratch);
 		REQUIRE(entry.check_valid() == FilterResult::VALID_HAS_TXS);
+		REQUIRE(!entry.found_invalid_in_block());
+
+		std::vector<uint64_t> seqnos;
+		entry.for_each_tx([&seqnos] (SignedTransaction const& tx) {
+			seqnos.push_back(tx.transaction.metadata.sequenceNumber);
+			return true;
+		});
+		REQUIRE(seqnos == std::vector<uint64_t>{initial_seqno + 256, initial_seqno + 512, initial_seqno + 768});
+	}
+}
+
+TEST_CASE("filter log over tx lists", "[filtering]")
+{
+	const AccountID id_a = 0x1234, id_b = 0x5678;
+
+	MemoryDatabase db;
+	MemoryDatabaseGenesisData memdb_genesis;
+	memdb_genesis.id_list.push_back(id_a);
+	memdb_genesis.id_list.push_back(id_b);
+
+	make_pks(memdb_genesis);
+
+	uint64_t initial_seqno = 50 * 256;
+
+	auto account_init_lambda = [&] (UserAccount& user_account) -> void {
+		db.transfer_available(&user_account, 0, 100);
+		db.transfer_available(&user_account, 1, 100);
+		REQUIRE(user_account.reserve_sequence_number(initial_seqno) == TransactionProcessingStatus::SUCCESS);
+		user_account.commit_sequence_number(initial_seqno);
+		user_account.commit();
+	};
+
+	db.install_initial_accounts_and_commit(memdb_genesis, account_init_lambda);
+
+	// conflicting seqnos for account a, split across lists
+	std::vector<std::vector<SignedTransaction>> lists;
+	lists.resize(3);
+	lists[0].push_back(make_payment_tx(id_a, initial_seqno + 256, 5, id_b, 1, 1));
+	lists[0].push_back(make_payment_tx(id_b, initial_seqno + 256, 5, id_a, 1, 1));
+	lists[2].push_back(make_payment_tx(id_a, initial_seqno + 256, 5, id_b, 1, 2));
+	lists[2].push_back(make_payment_tx(id_b, initial_seqno + 512, 5, id_a, 1, 1));
+
+	FilterLog log;
+
+	SECTION("all lists")
+	{
+		log.add_tx_lists(lists.size(), [&lists] (size_t i) { return &lists[i]; }, db);
+
+		REQUIRE(log.check_valid_account(id_a) == FilterResult::INVALID_DUPLICATE);
+		REQUIRE(log.check_valid_account(id_b) == FilterResult::VALID_HAS_TXS);
+		REQUIRE(!log.check_valid_tx(lists[0][0]));
+		REQUIRE(log.check_valid_tx(lists[0][1]));
+	}
+	SECTION("skipped list")
+	{
+		log.add_tx_lists(lists.size(), 
+			[&lists] (size_t i) -> std::vector<SignedTransaction> const* { 
+				if (i == 2) {
+					return nullptr;
+				}
+				return &lists[i]; 
+			}, db);
+		REQUIRE(log.check_valid_account(id_a) == FilterResult::VALID_HAS_TXS);
+	}
+}
+
+TEST_CASE("filter log block summary", "[filtering]")
+{
+	const AccountID id_a = 0x1234, id_b = 0x5678;
+
+	MemoryDatabase db;
+	MemoryDatabaseGenesisData memdb_genesis;
+	memdb_genesis.id_list.push_back(id_a);
+	memdb_genesis.id_list.push_back(id_b);
+
+	make_pks(memdb_genesis);
+
+	uint64_t initial_seqno = 50 * 256;
+
+	auto account_init_lambda = [&] (UserAccount& user_account) -> void {
+		db.transfer_available(&user_account, 0, 100);
+		db.transfer_available(&user_account, 1, 100);
+		REQUIRE(user_account.reserve_sequence_number(initial_seqno) == TransactionProcessingStatus::SUCCESS);
+		user_account.commit_sequence_number(initial_seqno);
+		user_account.commit();
+	};
+
+	db.install_initial_accounts_and_commit(memdb_genesis, account_init_lambda);
+
+	FilterLog log;
+	std::vector<SignedTransaction> txs;
+
+	SECTION("valid")
+	{
+		txs.push_back(make_payment_tx(id_a, initial_seqno + 256, 5, id_b, 1, 10));
+		txs.push_back(make_payment_tx(id_b, initial_seqno + 256, 5, id_a, 1, 10));
+		log.add_txs(txs, db);
+
+		REQUIRE(!log.found_certain_invalid());
+		REQUIRE(log.all_requirements_met());
+	}
+	SECTION("overdraft is not certain")
+	{
+		// b could be paid by someone else in the same block
+		txs.push_back(make_payment_tx(id_b, initial_seqno + 256, 5, id_a, 1, 1000));
+		log.add_txs(txs, db);
+
+		REQUIRE(!log.found_certain_invalid());
+		REQUIRE(!log.all_requirements_met());
+	}
+	SECTION("conflicting seqno")
+	{
+		txs.push_back(make_payment_tx(id_a, initial_seqno + 256, 5, id_b, 1, 10));
+		txs.push_back(make_payment_tx(id_a, initial_seqno + 256, 5, id_b, 1, 11));
+		log.add_txs(txs, db);
+
+		REQUIRE(log.found_certain_invalid());
+	}
+	SECTION("repeated tx")
+	{
+		txs.push_back(make_payment_tx(id_a, initial_seqno + 256, 5, id_b, 1, 10));
+		txs.push_back(make_payment_tx(id_a, initial_seqno + 256, 5, id_b, 1, 10));
+		log.add_txs(txs, db);
+
+		REQUIRE(log.found_certain_invalid());
+	}
+	SECTION("committed seqno")
+	{
+		txs.push_back(make_payment_tx(id_a, initial_seqno, 5, id_b, 1, 10));
+		log.add_txs(txs, db);
+
+		REQUIRE(log.found_certain_invalid());
+	}
+	SECTION("seqno window")
+	{
+		constexpr uint64_t window = SEQUENCE_TRACKER_WINDOW<MAX_SEQ_NUMS_PER_BLOCK>;
+
+		// last seq num in the window
+		txs.push_back(make_payment_tx(id_a, initial_seqno + window * 256, 5, id_b, 1, 10));
+		log.add_txs(txs, db);
+		REQUIRE(!log.found_certain_invalid());
+
+		// out of window, and not counted against b's balance
+		txs.push_back(make_payment_tx(id_b, initial_seqno + (window + 1) * 256, 5, id_a, 1, 1000));
+		log.clear();
+		log.add_txs(txs, db);
+		REQUIRE(log.found_certain_invalid());
+		REQUIRE(log.all_requirements_met());
+	}
+	SECTION("nonexistent source")
+	{
+		txs.push_back(make_payment_tx(0xAAAA, 256, 5, id_b, 1, 10));
+		log.add_txs(txs, db);
+
+		REQUIRE(log.check_valid_account(0xAAAA) == FilterResult::ACCOUNT_NEXIST);
+		REQUIRE(log.found_certain_invalid());
+	}
+	SECTION("clear resets")
+	{
+		txs.push_back(make_payment_tx(id_a, initial_seqno + 256, 5, id_b, 1, 10));
+		txs.push_back(make_payment_tx(id_a, initial_seqno + 256, 5, id_b, 1, 11));
+		log.add_txs(txs, db);
+		log.clear();
+
+		REQUIRE(!log.found_certain_invalid());
+		REQUIRE(log.all_requirements_met());
+	}
+}
+
+TEST_CASE("filter arena reuse", "[filtering]")
+{
+	FilterArena arena;
+
+	std::vector<FilterTxNode*> first;
+	for (size_t i = 0; i < 10000; i++)
+	{
+		first.push_back(arena.allocate());
+	}
+
+	std::set<FilterTxNode*> distinct(first.begin(), first.end());
+	REQUIRE(distinct.size() == first.size());
+
+	arena.reset();
+
+	// same memory is handed out again after a reset
+	for (size_t i = 0; i < 10000; i++)
+	{
+		REQUIRE(arena.allocate() == first[i]);
 	}
 }
 
@@ -52,13 +52,14 @@ BlockHeaderHashMap::BlockHeaderHashMap()
     , last_committed_block_number(0)
     , lmdb_mtx()
     , last_committed_block_number_mtx()
+    , reader_mtx()
 {}
 
 void
 BlockHeaderHashMap::hash(Hash& hash_out)
 {
     std::lock_guard lock(last_committed_block_number_mtx);
-    block_map.hash(hash_out);
+    hash_out = block_map.root(block_map.size());
 }
 
 void
@@ -80,15 +81,11 @@ BlockHeaderHashMap::insert(const Block& block, bool res)
         throw std::runtime_error("inserting wrong block number");
     }
 
-    prefix_t key_buf;
-
-    utils::write_unsigned_big_endian(key_buf, block_number);
-
     BlockHeaderHashValue value;
     value.hash = hash_xdr(block);
     value.validation_success = res ? 1 : 0;
 
-    block_map.insert(key_buf, ValueT(value));
+    block_map.append(value);
 
     last_committed_block_number = block_number;
 }
@@ -120,7 +117,7 @@ BlockHeaderHashMap::persist_lmdb(uint64_t current_block_number)
     {
         if (i == 0)
             continue;
-        TrieT::prefix_t round_buf;
+        prefix_t round_buf;
 
         utils::write_unsigned_big_endian(round_buf, i);
 
@@ -129,15 +126,12 @@ BlockHeaderHashMap::persist_lmdb(uint64_t current_block_number)
         dbval key{ round_bytes };
 
         // querying for round i
-        auto hash_opt = block_map.get_value(round_buf);
-        if (!hash_opt)
+        if (i > block_map.size())
         {
             throw std::runtime_error("did not find hash in hash_map!");
         }
 
-        BlockHeaderHashValue unwrapped_value = *hash_opt;
-
-        auto cur_bytes = xdr::xdr_to_opaque(unwrapped_value);
+        auto cur_bytes = xdr::xdr_to_opaque(block_map.get(i - 1));
 
         dbval hash_val{ cur_bytes };
         wtx.put(lmdb_instance.get_data_dbi(), &key, &hash_val);
@@ -159,20 +153,10 @@ BlockHeaderHashMap::rollback_to_committed_round(uint64_t committed_block_number)
     {
         throw std::runtime_error("can't rollback beyond lmdb persist");
     }
-    for (uint64_t i = committed_block_number + 1;
-         i <= last_committed_block_number;
-         i++)
+    if (committed_block_number < last_committed_block_number)
     {
-        if (i == 0)
-            continue;
-        TrieT::prefix_t round_buf;
-        utils::write_unsigned_big_endian(round_buf, i);
-
-        if (!block_map.perform_deletion(round_buf))
-        {
-            throw std::runtime_error(
-                "error when deleting from header hash map");
-        }
+        std::unique_lock lock3(reader_mtx);
+        block_map.truncate(committed_block_number);
     }
     last_committed_block_number
         = committed_block_number; //(committed_block_number == 0) ? 0 :
@@ -193,7 +177,7 @@ BlockHeaderHashMap::load_lmdb_contents_to_memory()
     {
         auto bytes = kv.first.bytes();
 
-        TrieT::prefix_t prefix;
+        prefix_t prefix;
         prefix.from_bytes_array(bytes);
 
         uint64_t round_number;
@@ -212,8 +196,10 @@ BlockHeaderHashMap::load_lmdb_contents_to_memory()
                 "lmdb contains round idx beyond committed max");
         }
 
-        prefix_t round_buf;
-        utils::write_unsigned_big_endian(round_buf, round_number);
+        if (round_number != block_map.size() + 1)
+        {
+            throw std::runtime_error("gap in lmdb header hashes");
+        }
 
         BlockHeaderHashValue block;
         // if (kv.second.mv_size != 32) {
@@ -224,12 +210,47 @@ BlockHeaderHashMap::load_lmdb_contents_to_memory()
         xdr::xdr_from_opaque(db_value_bytes, block);
 
         // memcpy(value.data(), kv.second.mv_data, 32);
-        block_map.insert(round_buf, ValueT(block));
+        block_map.append(block);
     }
     last_committed_block_number = lmdb_instance.get_persisted_round_number();
     rtx.commit();
 }
 
+std::vector<BlockHeaderHashValue>
+BlockHeaderHashMap::snapshot_hashes(uint64_t round_number) const
+{
+    std::vector<BlockHeaderHashValue> out;
+    out.reserve(round_number);
+
+    for_each_in_range(1, round_number, [&out](uint64_t, BlockHeaderHashValue const& value) {
+        out.push_back(value);
+    });
+
+    if (out.size() != round_number)
+    {
+        throw std::runtime_error("header hash map is missing snapshot rounds");
+    }
+    return out;
+}
+
+void
+BlockHeaderHashMap::load_snapshot_contents_to_memory(
+    std::vector<BlockHeaderHashValue> const& hashes)
+{
+    std::lock_guard lock(last_committed_block_number_mtx);
+
+    if (block_map.size() != 0)
+    {
+        throw std::runtime_error("can only load a snapshot into an empty header hash map");
+    }
+
+    for (auto const& value : hashes)
+    {
+        block_map.append(value);
+    }
+    last_committed_block_number = hashes.size();
+}
+
 std::optional<BlockHeaderHashValue>
 BlockHeaderHashMap::get(uint64_t round_number) const
 {
@@ -240,16 +261,76 @@ BlockHeaderHashMap::get(uint64_t round_number) const
         return std::nullopt;
     }
 
-    prefix_t round_buf;
-    utils::write_unsigned_big_endian(round_buf, round_number);
-    auto* out_opt = block_map.get_value(round_buf);
+    std::shared_lock lock2(reader_mtx);
 
-    if (!out_opt)
+    if (round_number == 0 || round_number > block_map.size())
     {
         throw std::runtime_error("failed to load hash that lmdb should have");
     }
 
-    return { *out_opt };
+    return { block_map.get(round_number - 1) };
+}
+
+std::vector<std::optional<BlockHeaderHashValue>>
+BlockHeaderHashMap::get_batch(std::vector<uint64_t> const& round_numbers) const
+{
+    std::shared_lock lock(reader_mtx);
+
+    uint64_t map_size = block_map.size();
+
+    std::vector<std::optional<BlockHeaderHashValue>> out;
+    out.reserve(round_numbers.size());
+
+    for (auto round_number : round_numbers)
+    {
+        if (round_number == 0 || round_number > map_size)
+        {
+            out.emplace_back(std::nullopt);
+        }
+        else
+        {
+            out.emplace_back(block_map.get(round_number - 1));
+        }
+    }
+    return out;
+}
+
+BlockHeaderHashMapProof
+BlockHeaderHashMap::make_proof(
+    std::vector<uint64_t> const& round_numbers, uint64_t map_size) const
+{
+    std::vector<uint64_t> leaves;
+    leaves.reserve(round_numbers.size());
+    for (auto round_number : round_numbers)
+    {
+        if (round_number == 0)
+        {
+            throw std::runtime_error("no proofs for genesis block");
+        }
+        leaves.push_back(round_number - 1);
+    }
+
+    std::shared_lock lock(reader_mtx);
+
+    BlockHeaderHashMapProof proof;
+    block_map.make_proof(map_size, leaves, proof);
+    return proof;
+}
+
+BlockHeaderHashMapProof
+BlockHeaderHashMap::make_range_proof(
+    uint64_t first_round, uint64_t last_round, uint64_t map_size) const
+{
+    std::vector<uint64_t> round_numbers;
+    if (first_round <= last_round)
+    {
+        round_numbers.reserve(last_round - first_round + 1);
+    }
+    for (uint64_t i = first_round; i <= last_round; i++)
+    {
+        round_numbers.push_back(i);
+    }
+    return make_proof(round_numbers, map_size);
 }
 
 void
@@ -20,28 +20,30 @@
 
 /*! \file block_header_hash_map.h
 
-The block header-hash map is a merkle trie mapping block number to block hash.
+The block header-hash map is a merkle tree mapping block number to block hash.
 
-Possible future optimization: Block numbers increment sequentially.
-Once some subtrie fills up, it will never be modified again.  We don't need
-to load that data into memory.  Would only be relevant if Speedex runs for
-millions of blocks.
+Block numbers increment sequentially, so the map is an append-only
+merkle tree (header_hash/header_merkle_tree.h), which supports
+compact proofs for arbitrary sets (and ranges) of blocks.
+Lookups and proofs do not block insertion.
 */
 
+#include "header_hash/header_merkle_tree.h"
+
 #include "lmdb/lmdb_wrapper.h"
 #include "lmdb/lmdb_loading.h"
 
-#include <mtt/trie/merkle_trie.h>
-#include <mtt/trie/metadata.h>
 #include <mtt/common/prefix.h>
 
 #include "xdr/block.h"
 #include "xdr/types.h"
 
+#include <algorithm>
 #include <cstdint>
-#include <map>
 #include <mutex>
 #include <optional>
+#include <shared_mutex>
+#include <vector>
 
 #include <xdrpp/marshal.h>
 
@@ -67,27 +69,14 @@ struct BlockHeaderHashMapLMDB : public lmdb::LMDBInstance
     void open_db() { LMDBInstance::open_db(DB_NAME); }
 };
 
-/*! Stores a merkle trie mapping block numbers to block root hashes.
+/*! Stores a merkle tree mapping block numbers to block root hashes.
  */
 class BlockHeaderHashMap
 {
-
-    static std::vector<uint8_t> serialize(const BlockHeaderHashValue& v)
-    {
-        return xdr::xdr_to_opaque(v);
-    }
-
-    using ValueT = trie::XdrTypeWrapper<BlockHeaderHashValue, &serialize>;
-
     using prefix_t = trie::UInt64Prefix;
 
-    using MetadataT = trie::CombinedMetadata<trie::SizeMixin>;
-
-    using TrieT = trie::MerkleTrie<prefix_t, ValueT, MetadataT>;
-
-    static_assert(TrieT::USE_LOCKS, "need locks in internal block map");
-
-    TrieT block_map;
+    //! Block N is leaf N-1
+    BlockHeaderMerkleTree block_map;
 
     BlockHeaderHashMapLMDB lmdb_instance;
 
@@ -98,6 +87,10 @@ class BlockHeaderHashMap
     // are always consistent) and one managing access to local state.
     mutable std::mutex lmdb_mtx, last_committed_block_number_mtx;
 
+    //! Readers hold this shared.  Only rollback (which truncates
+    //! the tree) takes it exclusively; insertion does not take it.
+    mutable std::shared_mutex reader_mtx;
+
 public:
     constexpr static unsigned int KEY_LEN = sizeof(uint64_t);
 
@@ -132,7 +125,54 @@ public:
     //! Read in trie contents from disk.
     void load_lmdb_contents_to_memory();
 
+    //! Copy out the values of blocks 1 through \a round_number,
+    //! for a full state snapshot.
+    std::vector<BlockHeaderHashValue> snapshot_hashes(uint64_t round_number) const;
+
+    //! Load the values of blocks 1 through hashes.size()
+    //! (from a full state snapshot) into an empty map.
+    void load_snapshot_contents_to_memory(
+        std::vector<BlockHeaderHashValue> const& hashes);
+
     std::optional<BlockHeaderHashValue> get(uint64_t round_number) const;
+
+    //! Number of blocks in the map (blocks 1 through get_map_size()).
+    //! Unlike get(), batched lookups and proofs see every inserted
+    //! block, persisted or not.
+    uint64_t get_map_size() const
+    {
+        return block_map.size();
+    }
+
+    //! Batched lookup.  Output entry is nullopt if the block is
+    //! not in the map.
+    std::vector<std::optional<BlockHeaderHashValue>>
+    get_batch(std::vector<uint64_t> const& round_numbers) const;
+
+    //! Call fn(round_number, value) for every block in the map
+    //! in [first_round, last_round], in order.
+    template<typename Fn>
+    void for_each_in_range(uint64_t first_round, uint64_t last_round, Fn&& fn) const
+    {
+        std::shared_lock lock(reader_mtx);
+        uint64_t end = std::min(last_round, block_map.size());
+        for (uint64_t round = std::max<uint64_t>(first_round, 1); round <= end; round++)
+        {
+            fn(round, block_map.get(round - 1));
+        }
+    }
+
+    /*! Proof for a set of blocks, against the map hash
+    when the map contained blocks 1 through map_size 
+    (i.e. the blockMapHash of block map_size + 1).
+    Input must be sorted and distinct, and within [1, map_size].
+    */
+    BlockHeaderHashMapProof make_proof(
+        std::vector<uint64_t> const& round_numbers, uint64_t map_size) const;
+
+    //! Proof for blocks [first_round, last_round], against map_size.
+    BlockHeaderHashMapProof make_range_proof(
+        uint64_t first_round, uint64_t last_round, uint64_t map_size) const;
 };
 
 //! Mock around BlockHeaderHashMap that makes calls into no-ops when replaying
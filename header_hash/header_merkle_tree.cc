@@ -0,0 +1,315 @@
+/**
+ * SPEEDEX: A Scalable, Parallelizable, and Economically Efficient Decentralized Exchange
+ * Copyright (C) 2023 Geoffrey Ramseyer
+
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "header_hash/header_merkle_tree.h"
+
+#include <algorithm>
+#include <cstring>
+
+#include <sodium.h>
+
+#include <xdrpp/marshal.h>
+
+namespace speedex
+{
+
+namespace
+{
+
+constexpr uint8_t LEAF_TAG = 0;
+constexpr uint8_t NODE_TAG = 1;
+
+bool
+is_pow2(uint64_t x)
+{
+    return x != 0 && (x & (x - 1)) == 0;
+}
+
+uint32_t
+log2_floor(uint64_t x)
+{
+    return 63 - __builtin_clzll(x);
+}
+
+//! Size of the left subtree of a tree with n > 1 leaves:
+//! largest power of two strictly less than n.
+uint64_t
+split_point(uint64_t n)
+{
+    return static_cast<uint64_t>(1) << log2_floor(n - 1);
+}
+
+uint64_t
+perfect_node_index(uint32_t height, uint64_t idx)
+{
+    return (idx << (height + 1)) + (static_cast<uint64_t>(1) << height) - 1;
+}
+
+} // namespace
+
+Hash
+BlockHeaderMerkleTree::leaf_hash(const BlockHeaderHashValue& value)
+{
+    auto serialized = xdr::xdr_to_opaque(value);
+
+    Hash out;
+    crypto_generichash_state state;
+    crypto_generichash_init(&state, NULL, 0, out.size());
+    crypto_generichash_update(&state, &LEAF_TAG, 1);
+    crypto_generichash_update(&state, serialized.data(), serialized.size());
+    crypto_generichash_final(&state, out.data(), out.size());
+    return out;
+}
+
+Hash
+BlockHeaderMerkleTree::node_hash(const Hash& left, const Hash& right)
+{
+    Hash out;
+    crypto_generichash_state state;
+    crypto_generichash_init(&state, NULL, 0, out.size());
+    crypto_generichash_update(&state, &NODE_TAG, 1);
+    crypto_generichash_update(&state, left.data(), left.size());
+    crypto_generichash_update(&state, right.data(), right.size());
+    crypto_generichash_final(&state, out.data(), out.size());
+    return out;
+}
+
+const Hash&
+BlockHeaderMerkleTree::perfect_node(uint32_t height, uint64_t idx) const
+{
+    return nodes.get(perfect_node_index(height, idx));
+}
+
+void
+BlockHeaderMerkleTree::append(const BlockHeaderHashValue& value)
+{
+    uint64_t leaf = num_leaves.load(std::memory_order_relaxed);
+
+    values.get_for_write(leaf) = value;
+    nodes.get_for_write(perfect_node_index(0, leaf)) = leaf_hash(value);
+
+    // fill in every perfect subtree that this leaf completes
+    for (uint32_t height = 1; ((leaf + 1) & ((static_cast<uint64_t>(1) << height) - 1)) == 0; height++)
+    {
+        uint64_t idx = (leaf + 1) >> height;
+        idx--;
+
+        nodes.get_for_write(perfect_node_index(height, idx)) 
+            = node_hash(
+                perfect_node(height - 1, 2 * idx), 
+                perfect_node(height - 1, 2 * idx + 1));
+    }
+
+    num_leaves.store(leaf + 1, std::memory_order_release);
+}
+
+void
+BlockHeaderMerkleTree::truncate(uint64_t new_size)
+{
+    if (new_size > size())
+    {
+        throw std::runtime_error("can't truncate to larger size");
+    }
+    // Slots past the new size are overwritten by later appends.
+    num_leaves.store(new_size, std::memory_order_release);
+}
+
+Hash
+BlockHeaderMerkleTree::subtree_hash(uint64_t lo, uint64_t hi) const
+{
+    uint64_t n = hi - lo;
+    if (is_pow2(n))
+    {
+        // always aligned: see file comment
+        uint32_t height = log2_floor(n);
+        return perfect_node(height, lo >> height);
+    }
+    uint64_t k = split_point(n);
+    return node_hash(subtree_hash(lo, lo + k), subtree_hash(lo + k, hi));
+}
+
+Hash
+BlockHeaderMerkleTree::root(uint64_t tree_size) const
+{
+    if (tree_size > size())
+    {
+        throw std::runtime_error("root of nonexistent tree");
+    }
+    if (tree_size == 0)
+    {
+        return Hash();
+    }
+    return subtree_hash(0, tree_size);
+}
+
+void
+BlockHeaderMerkleTree::make_proof_recursive(
+    uint64_t lo, uint64_t hi,
+    const uint64_t* leaves_begin, const uint64_t* leaves_end,
+    BlockHeaderHashMapProof& proof) const
+{
+    if (leaves_begin == leaves_end)
+    {
+        proof.hashes.push_back(subtree_hash(lo, hi));
+        return;
+    }
+    if (hi - lo == 1)
+    {
+        // proven leaf, verifier hashes the value
+        return;
+    }
+
+    uint64_t mid = lo + split_point(hi - lo);
+    const uint64_t* leaves_mid = std::lower_bound(leaves_begin, leaves_end, mid);
+
+    make_proof_recursive(lo, mid, leaves_begin, leaves_mid, proof);
+    make_proof_recursive(mid, hi, leaves_mid, leaves_end, proof);
+}
+
+void
+BlockHeaderMerkleTree::make_proof(
+    uint64_t tree_size,
+    std::vector<uint64_t> const& leaf_indices,
+    BlockHeaderHashMapProof& proof) const
+{
+    if (tree_size > size())
+    {
+        throw std::runtime_error("proof for nonexistent tree");
+    }
+
+    for (size_t i = 0; i < leaf_indices.size(); i++)
+    {
+        if (leaf_indices[i] >= tree_size 
+            || (i > 0 && leaf_indices[i-1] >= leaf_indices[i]))
+        {
+            throw std::runtime_error("invalid proof leaf indices");
+        }
+    }
+
+    proof.mapSize = tree_size;
+    proof.blockNumbers.clear();
+    proof.values.clear();
+    proof.hashes.clear();
+
+    proof.blockNumbers.reserve(leaf_indices.size());
+    proof.values.reserve(leaf_indices.size());
+
+    for (auto idx : leaf_indices)
+    {
+        proof.blockNumbers.push_back(idx + 1);
+        proof.values.push_back(get(idx));
+    }
+
+    if (tree_size == 0)
+    {
+        return;
+    }
+
+    make_proof_recursive(0, tree_size, leaf_indices.data(), leaf_indices.data() + leaf_indices.size(), proof);
+}
+
+namespace
+{
+
+struct ProofChecker
+{
+    const BlockHeaderHashMapProof& proof;
+    size_t next_hash = 0;
+    bool ok = true;
+
+    // leaf indices are block numbers - 1
+    size_t
+    lower_bound_leaf(size_t begin, size_t end, uint64_t leaf) const
+    {
+        auto it = std::lower_bound(
+            proof.blockNumbers.begin() + begin, 
+            proof.blockNumbers.begin() + end, 
+            leaf + 1);
+        return it - proof.blockNumbers.begin();
+    }
+
+    Hash
+    compute(uint64_t lo, uint64_t hi, size_t begin, size_t end)
+    {
+        if (begin == end)
+        {
+            if (next_hash >= proof.hashes.size())
+            {
+                ok = false;
+                return Hash();
+            }
+            return proof.hashes[next_hash++];
+        }
+        if (hi - lo == 1)
+        {
+            if (end - begin != 1)
+            {
+                ok = false;
+                return Hash();
+            }
+            return BlockHeaderMerkleTree::leaf_hash(proof.values[begin]);
+        }
+        uint64_t mid = lo + split_point(hi - lo);
+        size_t split = lower_bound_leaf(begin, end, mid);
+
+        Hash left = compute(lo, mid, begin, split);
+        Hash right = compute(mid, hi, split, end);
+        return BlockHeaderMerkleTree::node_hash(left, right);
+    }
+};
+
+} // namespace
+
+bool
+check_block_header_proof(
+    const BlockHeaderHashMapProof& proof,
+    const Hash& block_map_hash)
+{
+    if (proof.blockNumbers.size() != proof.values.size())
+    {
+        return false;
+    }
+
+    for (size_t i = 0; i < proof.blockNumbers.size(); i++)
+    {
+        uint64_t block_number = proof.blockNumbers[i];
+        if (block_number == 0 || block_number > proof.mapSize)
+        {
+            return false;
+        }
+        if (i > 0 && proof.blockNumbers[i-1] >= block_number)
+        {
+            return false;
+        }
+    }
+
+    if (proof.mapSize == 0)
+    {
+        return proof.hashes.size() == 0 && block_map_hash == Hash();
+    }
+
+    ProofChecker checker{proof};
+
+    Hash root = checker.compute(0, proof.mapSize, 0, proof.blockNumbers.size());
+
+    return checker.ok 
+        && checker.next_hash == proof.hashes.size()
+        && root == block_map_hash;
+}
+
+} // namespace speedex
@@ -0,0 +1,191 @@
+#pragma once
+
+/**
+ * SPEEDEX: A Scalable, Parallelizable, and Economically Efficient Decentralized Exchange
+ * Copyright (C) 2023 Geoffrey Ramseyer
+
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/*! \file header_merkle_tree.h
+
+Append-only merkle tree over block header hash values.
+
+Leaf i is the header of block i+1.  The tree over n leaves is the
+tree of RFC 6962 (certificate transparency): the left subtree
+covers the largest power of two strictly smaller than n leaves,
+and the right subtree covers the rest.  Every left subtree is a
+perfect, aligned subtree, and is never modified once complete.
+
+Node hashes are stored in a flat, in-order array.  Leaf i lives at
+index 2i, and the perfect subtree of height h covering leaves
+[j * 2^h, (j+1) * 2^h) lives at index j * 2^(h+1) + 2^h - 1.
+Appending a leaf writes only its own slot and the slots of the
+perfect subtrees that it completes.  So the root of any prefix of
+the tree (not just the latest) can be recomputed in O(log n).
+
+Readers never block the writer.  Storage is chunked so that it never
+moves, and a reader only reads slots below the published size.
+Truncation (rollback) is the only operation that needs exclusion
+from readers; it is the caller's job to provide it.
+*/
+
+#include "xdr/block.h"
+#include "xdr/types.h"
+
+#include <array>
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <stdexcept>
+#include <vector>
+
+namespace speedex
+{
+
+namespace detail
+{
+
+/*! Array that grows in fixed-size chunks.
+Elements never move, so a slot can be read concurrently with
+writes to other slots (and with the allocation of new chunks).
+*/
+template<typename T>
+class ChunkedArray
+{
+    constexpr static size_t CHUNK_SIZE_LOG = 12;
+    constexpr static size_t CHUNK_SIZE = static_cast<size_t>(1) << CHUNK_SIZE_LOG;
+    constexpr static size_t MAX_CHUNKS = static_cast<size_t>(1) << 16;
+
+    std::unique_ptr<std::atomic<T*>[]> chunks;
+
+public:
+
+    constexpr static size_t MAX_SIZE = CHUNK_SIZE * MAX_CHUNKS;
+
+    ChunkedArray()
+        : chunks(std::make_unique<std::atomic<T*>[]>(MAX_CHUNKS))
+    {
+        for (size_t i = 0; i < MAX_CHUNKS; i++)
+        {
+            chunks[i].store(nullptr, std::memory_order_relaxed);
+        }
+    }
+
+    ~ChunkedArray()
+    {
+        for (size_t i = 0; i < MAX_CHUNKS; i++)
+        {
+            delete[] chunks[i].load(std::memory_order_relaxed);
+        }
+    }
+
+    ChunkedArray(const ChunkedArray&) = delete;
+    ChunkedArray& operator=(const ChunkedArray&) = delete;
+
+    //! Not threadsafe with other writers.
+    T& get_for_write(size_t idx)
+    {
+        if (idx >= MAX_SIZE)
+        {
+            throw std::runtime_error("ChunkedArray overflow");
+        }
+        auto& chunk = chunks[idx >> CHUNK_SIZE_LOG];
+        T* ptr = chunk.load(std::memory_order_relaxed);
+        if (ptr == nullptr)
+        {
+            ptr = new T[CHUNK_SIZE];
+            chunk.store(ptr, std::memory_order_release);
+        }
+        return ptr[idx & (CHUNK_SIZE - 1)];
+    }
+
+    //! Caller must ensure that idx was written (and published).
+    const T& get(size_t idx) const
+    {
+        T const* ptr = chunks[idx >> CHUNK_SIZE_LOG].load(std::memory_order_acquire);
+        return ptr[idx & (CHUNK_SIZE - 1)];
+    }
+};
+
+} // namespace detail
+
+class BlockHeaderMerkleTree
+{
+    detail::ChunkedArray<BlockHeaderHashValue> values;
+    detail::ChunkedArray<Hash> nodes;
+
+    std::atomic<uint64_t> num_leaves;
+
+    const Hash& perfect_node(uint32_t height, uint64_t idx) const;
+
+    Hash subtree_hash(uint64_t lo, uint64_t hi) const;
+
+    void make_proof_recursive(
+        uint64_t lo, uint64_t hi,
+        const uint64_t* leaves_begin, const uint64_t* leaves_end,
+        BlockHeaderHashMapProof& proof) const;
+
+public:
+
+    BlockHeaderMerkleTree()
+        : values()
+        , nodes()
+        , num_leaves(0)
+    {}
+
+    //! Not threadsafe with other writers (append or truncate).
+    void append(const BlockHeaderHashValue& value);
+
+    //! Drop all leaves at index new_size or higher.
+    //! Caller must ensure that no readers are active.
+    void truncate(uint64_t new_size);
+
+    uint64_t size() const
+    {
+        return num_leaves.load(std::memory_order_acquire);
+    }
+
+    //! idx must be less than size().
+    const BlockHeaderHashValue& get(uint64_t idx) const
+    {
+        return values.get(idx);
+    }
+
+    //! Root of the tree over the first tree_size leaves.
+    //! tree_size must be at most size().
+    Hash root(uint64_t tree_size) const;
+
+    /*! Make a proof for a set of leaves, against the root
+    of the tree over the first tree_size leaves.
+    Leaf indices must be sorted, distinct, and less than tree_size.
+    Hashes of subtrees shared by the leaves appear only once.
+    */
+    void make_proof(
+        uint64_t tree_size,
+        std::vector<uint64_t> const& leaf_indices,
+        BlockHeaderHashMapProof& proof) const;
+
+    static Hash leaf_hash(const BlockHeaderHashValue& value);
+    static Hash node_hash(const Hash& left, const Hash& right);
+};
+
+//! Check a proof from BlockHeaderMerkleTree::make_proof against
+//! a block map hash (as in a block's InternalHashes).
+//! Block numbers in the proof must be sorted and distinct.
+bool check_block_header_proof(
+    const BlockHeaderHashMapProof& proof,
+    const Hash& block_map_hash);
+
+} // namespace speedex
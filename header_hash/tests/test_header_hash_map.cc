@@ -164,4 +164,93 @@ TEST_CASE("lmdb reload", "[header]")
 	REQUIRE_THROWS(map.insert(expected_block, true));
 }
 
+TEST_CASE("batched lookups and ranges", "[header]")
+{
+	test::speedex_dirs s;
+
+	BlockHeaderHashMap map;
+
+	for (uint64_t i = 1; i <= 100; i++)
+	{
+		map.insert(make_block(i, i), i % 3 != 0);
+	}
+
+	REQUIRE(map.get_map_size() == 100);
+
+	auto res = map.get_batch({0, 1, 50, 100, 101});
+
+	REQUIRE(res.size() == 5);
+	REQUIRE(!res[0]);
+	REQUIRE(res[1] -> hash == hash_xdr(make_block(1, 1)));
+	REQUIRE(res[2] -> hash == hash_xdr(make_block(50, 50)));
+	REQUIRE(res[2] -> validation_success == 1);
+	REQUIRE(res[3] -> validation_success == 0);
+	REQUIRE(!res[4]);
+
+	std::vector<uint64_t> seen;
+	map.for_each_in_range(95, 200, [&seen] (uint64_t round, BlockHeaderHashValue const& v) {
+		REQUIRE(v.hash == hash_xdr(make_block(round, round)));
+		seen.push_back(round);
+	});
+	REQUIRE(seen == std::vector<uint64_t>{95, 96, 97, 98, 99, 100});
+}
+
+TEST_CASE("header proofs", "[header]")
+{
+	test::speedex_dirs s;
+
+	BlockHeaderHashMap map;
+
+	// map hashes after each block
+	std::vector<Hash> map_hashes;
+
+	Hash h;
+	map.hash(h);
+	map_hashes.push_back(h);
+
+	for (uint64_t i = 1; i <= 300; i++)
+	{
+		map.insert(make_block(i, i), true);
+		map.hash(h);
+		map_hashes.push_back(h);
+	}
+
+	SECTION("range")
+	{
+		auto proof = map.make_range_proof(10, 110, 300);
+		REQUIRE(proof.values.size() == 101);
+		REQUIRE(check_block_header_proof(proof, map_hashes[300]));
+		REQUIRE(!check_block_header_proof(proof, map_hashes[299]));
+	}
+	SECTION("sparse, old map size")
+	{
+		auto proof = map.make_proof({1, 7, 64, 65, 129}, 150);
+		REQUIRE(check_block_header_proof(proof, map_hashes[150]));
+		REQUIRE(!check_block_header_proof(proof, map_hashes[300]));
+	}
+	SECTION("single")
+	{
+		auto proof = map.make_proof({300}, 300);
+		REQUIRE(check_block_header_proof(proof, map_hashes[300]));
+	}
+	SECTION("tampered value")
+	{
+		auto proof = map.make_proof({5, 6}, 300);
+		proof.values[1].validation_success = 0;
+		REQUIRE(!check_block_header_proof(proof, map_hashes[300]));
+	}
+	SECTION("tampered block number")
+	{
+		auto proof = map.make_proof({5, 6}, 300);
+		proof.blockNumbers[0] = 4;
+		REQUIRE(!check_block_header_proof(proof, map_hashes[300]));
+	}
+	SECTION("invalid request")
+	{
+		REQUIRE_THROWS(map.make_proof({6, 5}, 300));
+		REQUIRE_THROWS(map.make_proof({301}, 300));
+		REQUIRE_THROWS(map.make_proof({1}, 301));
+	}
+}
+
 } // speedex
@@ -0,0 +1,158 @@
+#include "memory_database/account_lmdb.h"
+#include "memory_database/memory_database.h"
+#include "memory_database/thunk.h"
+
+#include "utils/manage_data_dirs.h"
+
+#include <utils/time.h>
+
+#include <cinttypes>
+#include <cstdio>
+#include <random>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include <getopt.h>
+
+using namespace speedex;
+
+using utils::init_time_measurement;
+using utils::measure_time;
+
+[[noreturn]]
+static void usage() {
+	std::printf(R"(
+usage: account_db_shard_sweep
+        --shards=<comma separated shard counts, default 1,2,4,8,16,32>
+        --num_accounts=<default 10000000>
+        --accounts_per_block=<default 500000>
+        --num_blocks=<default 10>
+Measures account db persistence and fsync time for each shard count.
+Erases the account database in the configured ROOT_DB_DIRECTORY.
+)");
+	exit(1);
+}
+
+enum opttag {
+	OPT_SHARDS = 0x100,
+	OPT_NUM_ACCOUNTS,
+	OPT_ACCOUNTS_PER_BLOCK,
+	OPT_NUM_BLOCKS,
+};
+
+static const struct option opts[] = {
+	{"shards", required_argument, nullptr, OPT_SHARDS},
+	{"num_accounts", required_argument, nullptr, OPT_NUM_ACCOUNTS},
+	{"accounts_per_block", required_argument, nullptr, OPT_ACCOUNTS_PER_BLOCK},
+	{"num_blocks", required_argument, nullptr, OPT_NUM_BLOCKS},
+	{nullptr, 0, nullptr, 0}
+};
+
+static std::vector<uint32_t>
+parse_shard_counts(std::string const& str)
+{
+	std::vector<uint32_t> out;
+	std::stringstream ss(str);
+	std::string item;
+	while (std::getline(ss, item, ',')) {
+		out.push_back(std::stoi(item));
+		if (out.back() == 0) {
+			usage();
+		}
+	}
+	return out;
+}
+
+// Account values are opaque to the lmdb, so random bytes of roughly
+// the size of a serialized AccountCommitment suffice.
+static void
+make_block_thunk(DBPersistenceThunk& thunk, uint64_t num_accounts, uint64_t accounts_per_block, std::minstd_rand& gen)
+{
+	constexpr size_t value_size = 128;
+
+	std::uniform_int_distribution<uint64_t> account_dist(0, num_accounts - 1);
+	std::uniform_int_distribution<uint32_t> byte_dist(0, UINT8_MAX);
+
+	thunk.resize(accounts_per_block);
+	for (auto& kv : *thunk.kvs) {
+		kv.key = account_dist(gen);
+		kv.msg.resize(value_size);
+		for (auto& b : kv.msg) {
+			b = byte_dist(gen);
+		}
+	}
+}
+
+int main(int argc, char* const* argv)
+{
+	std::vector<uint32_t> shard_counts = {1, 2, 4, 8, 16, 32};
+	uint64_t num_accounts = 10'000'000;
+	uint64_t accounts_per_block = 500'000;
+	uint64_t num_blocks = 10;
+
+	int opt;
+
+	while ((opt = getopt_long_only(argc, argv, "",
+				 opts, nullptr)) != -1)
+	{
+		switch(opt) {
+			case OPT_SHARDS:
+				shard_counts = parse_shard_counts(optarg);
+				break;
+			case OPT_NUM_ACCOUNTS:
+				num_accounts = std::stoull(optarg);
+				break;
+			case OPT_ACCOUNTS_PER_BLOCK:
+				accounts_per_block = std::stoull(optarg);
+				break;
+			case OPT_NUM_BLOCKS:
+				num_blocks = std::stoull(optarg);
+				break;
+			default:
+				usage();
+		}
+	}
+
+	if (num_accounts == 0 || num_blocks == 0) {
+		usage();
+	}
+
+	// thunks need a MemoryDatabase reference, but only to build
+	// their values, which we do directly here.
+	MemoryDatabase unused_db;
+
+	std::printf("shards\tpersist_time\tfsync_time\n");
+
+	for (uint32_t num_shards : shard_counts)
+	{
+		clear_memory_database_lmdb_dir();
+
+		AccountLMDB lmdb(num_shards);
+		lmdb.open_env();
+		lmdb.create_db();
+
+		std::minstd_rand gen(0);
+
+		double persist_time = 0, fsync_time = 0;
+
+		for (uint64_t block = 1; block <= num_blocks; block++)
+		{
+			std::vector<DBPersistenceThunk> thunks;
+			thunks.emplace_back(unused_db, block);
+			make_block_thunk(thunks.back(), num_accounts, accounts_per_block, gen);
+
+			auto ts = init_time_measurement();
+			lmdb.persist_thunks(thunks, block);
+			persist_time += measure_time(ts);
+
+			lmdb.sync();
+			fsync_time += measure_time(ts);
+		}
+
+		std::printf("%" PRIu32 "\t%lf\t%lf\n", num_shards, persist_time / num_blocks, fsync_time / num_blocks);
+	}
+
+	clear_memory_database_lmdb_dir();
+	return 0;
+}
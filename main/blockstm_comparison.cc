@@ -197,6 +197,7 @@ run_blockstm_experiment(const uint32_t num_accounts, const uint32_t batch_size,
 	}
 
 	auto configs = get_runtime_configs(); 
+	configs.replica_id = self_id;
 
 	clear_all_data_dirs(config->get_info(self_id));
 	make_all_data_dirs(config->get_info(self_id));
@@ -130,6 +130,7 @@ int main(int argc, char* const* argv)
 	make_all_data_dirs(config->get_info(*args.self_id));
 
 	auto configs = get_runtime_configs();
+	configs.replica_id = *args.self_id;
 
 	size_t num_threads = get_num_threads();
 
@@ -0,0 +1,110 @@
+#include "block_processing/compact_tx_list.h"
+
+#include "utils/transaction_type_formatter.h"
+
+#include "xdr/block.h"
+
+#include <utils/time.h>
+
+#include <xdrpp/marshal.h>
+
+#include <algorithm>
+#include <cinttypes>
+#include <cstdio>
+#include <random>
+#include <stdexcept>
+#include <string>
+
+using namespace speedex;
+using namespace tx_formatter;
+
+using xdr::operator==;
+
+using utils::init_time_measurement;
+using utils::measure_time;
+
+// Synthetic payment-heavy block, in the account order that
+// the account modification log produces.
+static SignedTransactionList
+make_block(uint64_t num_txs, uint64_t num_accounts, double offer_fraction)
+{
+	std::minstd_rand gen(0);
+	std::uniform_int_distribution<uint64_t> account_dist(0, num_accounts - 1);
+	std::uniform_int_distribution<int64_t> amount_dist(1, 10'000);
+	std::uniform_real_distribution<double> type_dist(0, 1);
+	std::uniform_int_distribution<uint32_t> byte_dist(0, UINT8_MAX);
+
+	std::vector<AccountID> sources;
+	for (uint64_t i = 0; i < num_txs; i++) {
+		sources.push_back(account_dist(gen));
+	}
+	std::sort(sources.begin(), sources.end());
+
+	SignedTransactionList out;
+	out.reserve(num_txs);
+
+	uint64_t seq = 0;
+	for (uint64_t i = 0; i < num_txs; i++) {
+		seq = (i > 0 && sources[i] == sources[i-1]) ? seq + 1 : 1;
+
+		SignedTransaction tx;
+		tx.transaction.metadata.sourceAccount = sources[i];
+		tx.transaction.metadata.sequenceNumber = seq << 8;
+
+		if (type_dist(gen) < offer_fraction) {
+			tx.transaction.operations.push_back(make_operation(
+				CreateSellOfferOp(OfferCategory(0, 1, OfferType::SELL), amount_dist(gen), 1ull << 24)));
+		} else {
+			tx.transaction.operations.push_back(make_operation(
+				PaymentOp(account_dist(gen), 0, amount_dist(gen))));
+		}
+		tx.transaction.maxFee = compute_min_fee(tx);
+		for (auto& b : tx.signature) {
+			b = byte_dist(gen);
+		}
+		out.push_back(tx);
+	}
+	return out;
+}
+
+int main(int argc, char const* const* argv)
+{
+	if (argc > 4) {
+		std::printf("usage: compact_tx_list_bench [num_txs=500000] [num_accounts=10000000] [offer_fraction=0.1]\n");
+		return 1;
+	}
+
+	uint64_t num_txs = (argc > 1) ? std::stoull(argv[1]) : 500'000;
+	uint64_t num_accounts = (argc > 2) ? std::stoull(argv[2]) : 10'000'000;
+	double offer_fraction = (argc > 3) ? std::stod(argv[3]) : 0.1;
+
+	auto txs = make_block(num_txs, num_accounts, offer_fraction);
+
+	auto ts = init_time_measurement();
+
+	auto xdr_buf = xdr::xdr_to_opaque(txs);
+	double xdr_encode_time = measure_time(ts);
+
+	SignedTransactionList xdr_out;
+	xdr::xdr_from_opaque(xdr_buf, xdr_out);
+	double xdr_decode_time = measure_time(ts);
+
+	std::vector<uint8_t> compact_buf;
+	encode_compact_tx_list(txs, compact_buf);
+	double compact_encode_time = measure_time(ts);
+
+	SignedTransactionList compact_out;
+	decode_compact_tx_list(compact_buf.data(), compact_buf.size(), compact_out);
+	double compact_decode_time = measure_time(ts);
+
+	if (!(compact_out == txs) || !(xdr_out == txs)) {
+		throw std::runtime_error("round trip mismatch");
+	}
+
+	std::printf("format\tbytes/tx\tencode tx/s\tdecode tx/s\n");
+	std::printf("xdr\t%lf\t%lf\t%lf\n",
+		static_cast<double>(xdr_buf.size()) / num_txs, num_txs / xdr_encode_time, num_txs / xdr_decode_time);
+	std::printf("compact\t%lf\t%lf\t%lf\n",
+		static_cast<double>(compact_buf.size()) / num_txs, num_txs / compact_encode_time, num_txs / compact_decode_time);
+	return 0;
+}
@@ -0,0 +1,104 @@
+#include "crypto/crypto_utils.h"
+
+#include "memory_database/memory_database.h"
+#include "memory_database/memory_database_view.h"
+
+#include <utils/time.h>
+
+#include <atomic>
+#include <cinttypes>
+#include <cstdio>
+#include <cstdlib>
+#include <new>
+#include <string>
+#include <vector>
+
+using namespace speedex;
+
+/*
+Counts heap allocations made while building, using, and committing
+one BufferedMemoryDatabaseView per tx, as block production does.
+"payment" touches 2 accounts and 2 assets (fee + transfer);
+"wide" touches more accounts than fit inline, to show the spill path.
+*/
+
+static std::atomic<uint64_t> num_allocs = 0;
+
+void* operator new(std::size_t sz)
+{
+	num_allocs.fetch_add(1, std::memory_order_relaxed);
+	if (void* p = std::malloc(sz ? sz : 1)) {
+		return p;
+	}
+	throw std::bad_alloc();
+}
+
+void operator delete(void* p) noexcept
+{
+	std::free(p);
+}
+
+void operator delete(void* p, std::size_t) noexcept
+{
+	std::free(p);
+}
+
+static void
+run(MemoryDatabase& db, uint64_t num_accounts, uint64_t num_txs, uint64_t accounts_per_tx, const char* name)
+{
+	std::vector<UserAccount*> accounts;
+	for (AccountID i = 0; i < num_accounts; i++) {
+		accounts.push_back(db.lookup_user(i));
+	}
+
+	uint64_t allocs_before = num_allocs.load();
+	auto timestamp = utils::init_time_measurement();
+
+	for (uint64_t tx = 0; tx < num_txs; tx++) {
+		BufferedMemoryDatabaseView view(db);
+		for (uint64_t j = 0; j < accounts_per_tx; j += 2) {
+			auto* from = accounts[(tx + j) % num_accounts];
+			auto* to = accounts[(tx + j + 1) % num_accounts];
+			view.transfer_available(from, MemoryDatabase::NATIVE_ASSET, -1, "fee");
+			view.transfer_available(from, 1, -10, "send");
+			view.transfer_available(to, 1, 10, "recv");
+		}
+		view.commit();
+	}
+
+	double elapsed = utils::measure_time(timestamp);
+	uint64_t allocs = num_allocs.load() - allocs_before;
+
+	std::printf("%s: %" PRIu64 " txs, %lf allocs/tx, %lf ns/tx\n", 
+		name, num_txs, static_cast<double>(allocs) / num_txs, elapsed * 1e9 / num_txs);
+}
+
+int main(int argc, char const* const* argv)
+{
+	if (argc > 2) {
+		std::printf("usage: db_view_alloc_bench [num_txs=1000000]\n");
+		return 1;
+	}
+
+	uint64_t num_txs = (argc > 1) ? std::stoull(argv[1]) : 1'000'000;
+
+	constexpr uint64_t num_accounts = 1'000;
+
+	MemoryDatabase db;
+	MemoryDatabaseGenesisData memdb_genesis;
+	DeterministicKeyGenerator key_gen;
+	for (AccountID i = 0; i < num_accounts; i++) {
+		memdb_genesis.id_list.push_back(i);
+		memdb_genesis.pk_list.push_back(key_gen.deterministic_key_gen(i).second);
+	}
+
+	db.install_initial_accounts_and_commit(memdb_genesis, [&db] (UserAccount& user_account) {
+		db.transfer_available(&user_account, MemoryDatabase::NATIVE_ASSET, INT32_MAX);
+		db.transfer_available(&user_account, 1, INT32_MAX);
+		user_account.commit();
+	});
+
+	run(db, num_accounts, num_txs, 2, "payment");
+	run(db, num_accounts, num_txs / 10, 8, "wide");
+	return 0;
+}
@@ -0,0 +1,189 @@
+#include "block_processing/block_producer.h"
+
+#include "mempool/mempool.h"
+
+#include "memory_database/memory_database.h"
+
+#include "modlog/log_merge_worker.h"
+
+#include "speedex/speedex_management_structures.h"
+
+#include "stats/block_update_stats.h"
+
+#include "utils/transaction_type_formatter.h"
+
+#include <utils/time.h>
+
+#include <tbb/global_control.h>
+
+#include <algorithm>
+#include <cinttypes>
+#include <cstdio>
+#include <memory>
+#include <random>
+#include <string>
+#include <vector>
+
+using namespace speedex;
+
+/*
+Measures how many more txs per block the deferred retry wave includes
+on a bursty-account workload.
+
+Each bursty account starts with no native asset (so it cannot pay fees),
+is paid by some funder account, and sends a burst of burst_len
+sequential payments, all within the same block.  The txs are shuffled
+among num_background_txs independent payments between funded accounts
+(few enough per funder to stay inside the sequence number window).
+Without the retry wave, any burst tx that the (parallel) first wave
+reaches before the funding payment is dropped as INSUFFICIENT_BALANCE.
+*/
+
+constexpr static uint64_t FUNDER_ACCOUNTS = 10'000;
+constexpr static int64_t FUNDED_BALANCE = 1'000'000;
+
+static SignedTransaction
+make_bench_payment(AccountID src, uint64_t seqno, AccountID dst, AssetID asset, int64_t amount)
+{
+	PaymentOp op;
+	op.receiver = dst;
+	op.asset = asset;
+	op.amount = amount;
+
+	SignedTransaction tx;
+	tx.transaction.metadata.sourceAccount = src;
+	tx.transaction.metadata.sequenceNumber = seqno * MAX_OPS_PER_TX;
+	tx.transaction.operations.push_back(tx_formatter::make_operation(op));
+	tx.transaction.maxFee = tx_formatter::compute_min_fee(tx);
+	return tx;
+}
+
+struct TrialResult {
+	uint64_t block_size;
+	uint64_t deferred_retry_txs;
+	double build_time;
+	double retry_time;
+};
+
+static TrialResult
+run_trial(
+	bool deferred_retry_wave, 
+	uint64_t num_bursty_accounts, 
+	uint64_t burst_len, 
+	uint64_t num_background_txs, 
+	uint32_t seed)
+{
+	auto management_structures = std::make_unique<SpeedexManagementStructures>(
+		2,
+		ApproximationParameters{
+			.tax_rate = 10,
+			.smooth_mult = 10
+		},
+		SpeedexRuntimeConfigs{
+			.check_sigs = false,
+			.deferred_retry_wave = deferred_retry_wave
+		});
+
+	auto& db = management_structures->db;
+
+	// accounts [0, FUNDER_ACCOUNTS) are funded, the rest are bursty
+	MemoryDatabaseGenesisData data;
+	for (AccountID i = 0; i < FUNDER_ACCOUNTS + num_bursty_accounts; i++) {
+		data.id_list.push_back(i);
+	}
+	data.pk_list.resize(data.id_list.size());
+
+	db.install_initial_accounts_and_commit(data, [&db] (UserAccount& user) {
+		if (user.get_owner() < FUNDER_ACCOUNTS) {
+			db.transfer_available(&user, MemoryDatabase::NATIVE_ASSET, FUNDED_BALANCE);
+		}
+		db.transfer_available(&user, 1, FUNDED_BALANCE);
+		user.commit();
+	});
+
+	std::minstd_rand gen(seed);
+	std::uniform_int_distribution<AccountID> funder_dist(0, FUNDER_ACCOUNTS - 1);
+
+	std::vector<uint64_t> next_seqno(FUNDER_ACCOUNTS, 1);
+	std::vector<SignedTransaction> txs;
+
+	for (uint64_t i = 0; i < num_bursty_accounts; i++) {
+		AccountID bursty = FUNDER_ACCOUNTS + i;
+		AccountID funder = funder_dist(gen);
+
+		txs.push_back(make_bench_payment(
+			funder, next_seqno[funder]++, bursty, MemoryDatabase::NATIVE_ASSET, 100 * burst_len));
+		for (uint64_t j = 1; j <= burst_len; j++) {
+			txs.push_back(make_bench_payment(bursty, j, funder_dist(gen), 1, 10));
+		}
+	}
+
+	for (uint64_t i = 0; i < num_background_txs; i++) {
+		AccountID src = funder_dist(gen);
+		txs.push_back(make_bench_payment(src, next_seqno[src]++, funder_dist(gen), 1, 10));
+	}
+
+	std::shuffle(txs.begin(), txs.end(), gen);
+
+	uint64_t num_txs = txs.size();
+
+	Mempool mempool(1'000, num_txs);
+	mempool.chunkify_and_add_to_mempool_buffer(std::move(txs));
+	mempool.push_mempool_buffer_to_mempool();
+
+	LogMergeWorker worker(management_structures->account_modification_log);
+	BlockProducer producer(*management_structures, worker);
+
+	BlockCreationMeasurements measurements;
+	BlockStateUpdateStatsWrapper stats;
+
+	auto timestamp = utils::init_time_measurement();
+	uint64_t block_size = producer.build_block(mempool, num_txs, measurements, stats);
+	double build_time = utils::measure_time(timestamp);
+
+	return TrialResult {
+		.block_size = block_size,
+		.deferred_retry_txs = measurements.deferred_retry_txs,
+		.build_time = build_time,
+		.retry_time = measurements.deferred_retry_time
+	};
+}
+
+int main(int argc, char const* const* argv)
+{
+	if (argc > 6) {
+		std::printf("usage: deferred_retry_bench [num_bursty_accounts=10000] [burst_len=8] [num_background_txs=100000] [num_trials=5] [num_threads=0]\n");
+		return 1;
+	}
+
+	uint64_t num_bursty_accounts = (argc > 1) ? std::stoull(argv[1]) : 10'000;
+	uint64_t burst_len = (argc > 2) ? std::stoull(argv[2]) : 8;
+	uint64_t num_background_txs = (argc > 3) ? std::stoull(argv[3]) : 100'000;
+	uint64_t num_trials = (argc > 4) ? std::stoull(argv[4]) : 5;
+	uint64_t num_threads = (argc > 5) ? std::stoull(argv[5]) : 0;
+
+	std::unique_ptr<tbb::global_control> control;
+	if (num_threads > 0) {
+		control = std::make_unique<tbb::global_control>(
+			tbb::global_control::max_allowed_parallelism, num_threads);
+	}
+
+	for (bool deferred_retry_wave : {false, true}) {
+		double block_size = 0, retry_txs = 0, build_time = 0, retry_time = 0;
+		for (uint64_t trial = 0; trial < num_trials; trial++) {
+			auto res = run_trial(
+				deferred_retry_wave, num_bursty_accounts, burst_len, num_background_txs, trial);
+			block_size += res.block_size;
+			retry_txs += res.deferred_retry_txs;
+			build_time += res.build_time;
+			retry_time += res.retry_time;
+		}
+		std::printf("retry_wave=%d: txs/block %lf (retry wave added %lf) build time %lf (retry wave %lf)\n",
+			deferred_retry_wave, 
+			block_size / num_trials, 
+			retry_txs / num_trials, 
+			build_time / num_trials,
+			retry_time / num_trials);
+	}
+	return 0;
+}
@@ -152,9 +152,9 @@ double run_experiment(const size_t n_threads, std::string const& experiment_root
 			count++;
 		}
 
-		std::printf("duration: %lf\n", res);
+		std::printf("duration: %lf (%lf txs/sec)\n", res, block.size() / res);
 
-		size_t num_valid_with_txs = 0, num_bad_duplicates = 0, num_missing_requirements = 0;
+		size_t num_valid_with_txs = 0, num_bad_duplicates = 0, num_missing_requirements = 0, num_other_errors = 0;
 
 		for (auto const& acct : id_list)
 		{
@@ -179,15 +179,23 @@ double run_experiment(const size_t n_threads, std::string const& experiment_root
 					num_missing_requirements++;
 					break;
 				}
+				case FilterResult::ACCOUNT_NEXIST:
+				case FilterResult::OVERFLOW_REQ:
+				case FilterResult::DOUBLE_CANCEL:
+				{
+					num_other_errors++;
+					break;
+				}
 				default:
 					throw std::runtime_error("invalid filter result");
 			}
 		}
 		log.clear();
-		std::printf("stats: num_valid_with_txs %lu num_bad_duplicates %lu num_missing_requirements %lu total %lu\n", 
+		std::printf("stats: num_valid_with_txs %lu num_bad_duplicates %lu num_missing_requirements %lu num_other_errors %lu total %lu\n", 
 			num_valid_with_txs, num_bad_duplicates,
 			num_missing_requirements,
-			 num_valid_with_txs + num_bad_duplicates + num_missing_requirements);
+			num_other_errors,
+			 num_valid_with_txs + num_bad_duplicates + num_missing_requirements + num_other_errors);
 	}
 	return acc / count;
 }
@@ -0,0 +1,84 @@
+#include "header_hash/block_header_hash_map.h"
+
+#include "utils/hash.h"
+
+#include "xdr/block.h"
+
+#include <utils/time.h>
+
+#include <xdrpp/marshal.h>
+
+#include <cinttypes>
+#include <cstdio>
+#include <stdexcept>
+#include <string>
+
+using namespace speedex;
+
+using utils::init_time_measurement;
+using utils::measure_time;
+
+int main(int argc, char const* const* argv)
+{
+	if (argc > 3) {
+		std::printf("usage: header_proof_bench [num_blocks=1000000] [trials=100]\n");
+		return 1;
+	}
+
+	uint64_t num_blocks = (argc > 1) ? std::stoull(argv[1]) : 1'000'000;
+	uint64_t trials = (argc > 2) ? std::stoull(argv[2]) : 100;
+
+	if (sodium_init() < 0) {
+		throw std::runtime_error("failed to init sodium");
+	}
+
+	// no lmdb: map is only in memory
+	BlockHeaderHashMap map;
+
+	auto ts = init_time_measurement();
+	for (uint64_t i = 1; i <= num_blocks; i++) {
+		Block block;
+		block.blockNumber = i;
+		map.insert(block, true);
+	}
+	double insert_time = measure_time(ts);
+	std::printf("inserted %" PRIu64 " blocks in %lf (%lf blocks/sec)\n",
+		num_blocks, insert_time, num_blocks / insert_time);
+
+	Hash root;
+	map.hash(root);
+
+	for (uint64_t range : {1ull, 100ull, 10'000ull}) {
+		if (range > num_blocks) {
+			continue;
+		}
+
+		double gen_time = 0, check_time = 0;
+		size_t proof_bytes = 0, num_hashes = 0;
+
+		for (uint64_t t = 0; t < trials; t++) {
+			// spread ranges over the map
+			uint64_t first = 1 + ((t * 7919) % (num_blocks - range + 1));
+
+			ts = init_time_measurement();
+			auto proof = map.make_range_proof(first, first + range - 1, num_blocks);
+			gen_time += measure_time(ts);
+
+			if (!check_block_header_proof(proof, root)) {
+				throw std::runtime_error("proof check failed");
+			}
+			check_time += measure_time(ts);
+
+			proof_bytes += xdr::xdr_size(proof);
+			num_hashes += proof.hashes.size();
+		}
+
+		std::printf("range %" PRIu64 ": avg gen %lf us check %lf us proof %lf bytes (%lf hashes, %lf bytes/block)\n",
+			range,
+			1'000'000 * gen_time / trials,
+			1'000'000 * check_time / trials,
+			static_cast<double>(proof_bytes) / trials,
+			static_cast<double>(num_hashes) / trials,
+			static_cast<double>(proof_bytes) / (trials * range));
+	}
+}
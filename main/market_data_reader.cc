@@ -0,0 +1,119 @@
+#include "market_data/market_data_stream.h"
+
+#include "utils/price.h"
+
+#include <chrono>
+#include <cinttypes>
+#include <cstdio>
+#include <cstdlib>
+#include <string>
+#include <thread>
+
+using namespace speedex;
+
+/*
+Sample consumer of the market data stream (market_data/market_data_stream.h).
+Follows a node's shared memory ring and prints each block's clearing
+prices and the orderbooks that traded.
+*/
+
+[[noreturn]]
+static void usage() {
+	std::printf("usage: market_data_reader [--replica_id=<id> (default 0) | shm_name] [--from-latest]\n");
+	std::printf("Prints each block published by a node running with PUBLISH_MARKET_DATA.\n");
+	std::printf("By default, starts from the oldest record still in the ring.\n");
+	exit(1);
+}
+
+static const char* source_str(MarketDataSource source) {
+	switch(source) {
+		case MarketDataSource::PRODUCED:
+			return "produced";
+		case MarketDataSource::VALIDATED:
+			return "validated";
+		default:
+			return "unknown";
+	}
+}
+
+static void print_record(MarketDataRecord const& r) {
+	std::printf("block %" PRIu64 " (%s) fee rate %" PRIu32 "\n", 
+		r.block_number, source_str(r.source), r.fee_rate);
+	std::printf("\tnew offers %" PRIu32 " cancels %" PRIu32 " full clears %" PRIu32 
+		" partial clears %" PRIu32 " payments %" PRIu32 " new accounts %" PRIu32 "\n",
+		r.stats.new_offer_count, 
+		r.stats.cancel_offer_count, 
+		r.stats.fully_clear_offer_count,
+		r.stats.partial_clear_offer_count,
+		r.stats.payment_count,
+		r.stats.new_account_count);
+
+	for (size_t i = 0; i < r.prices.size(); i++) {
+		std::printf("\tprice[%lu] = %lf\n", i, price::to_double(r.prices[i]));
+	}
+
+	for (auto const& ob : r.orderbooks) {
+		double volume = ob.supply_activated_to_double();
+		if (volume == 0 && !ob.has_threshold) {
+			continue;
+		}
+		std::printf("\tsell %" PRIu32 " buy %" PRIu32 ": sold %lf", ob.sell_asset, ob.buy_asset, volume);
+		if (ob.has_threshold) {
+			std::printf(" threshold price %lf (owner %" PRIu64 " offer %" PRIu64 ", sold %lf)",
+				price::to_double(ob.threshold_min_price),
+				ob.threshold_owner,
+				ob.threshold_offer_id,
+				ob.partial_exec_amount_to_double());
+		}
+		std::printf("\n");
+	}
+	std::fflush(stdout);
+}
+
+int main(int argc, char const* const* argv)
+{
+	std::string shm_name = MarketDataPublisher::replica_shm_name(0);
+	bool from_latest = false;
+
+	const std::string replica_flag = "--replica_id=";
+
+	for (int i = 1; i < argc; i++) {
+		std::string arg = argv[i];
+		if (arg == "--from-latest") {
+			from_latest = true;
+		} else if (arg.starts_with(replica_flag)) {
+			shm_name = MarketDataPublisher::replica_shm_name(
+				std::stoul(arg.substr(replica_flag.size())));
+		} else if (arg.starts_with("/")) {
+			shm_name = arg;
+		} else {
+			usage();
+		}
+	}
+
+	MarketDataReader reader(shm_name);
+
+	std::printf("following %s: %" PRIu32 " assets, %" PRIu32 " orderbooks\n", 
+		shm_name.c_str(), reader.get_num_assets(), reader.get_num_orderbooks());
+
+	if (from_latest) {
+		reader.seek_to_latest();
+	}
+
+	MarketDataRecord record;
+	uint64_t missed = 0;
+
+	while (true) {
+		if (!reader.try_read_next(record)) {
+			std::this_thread::sleep_for(std::chrono::milliseconds(1));
+			continue;
+		}
+
+		if (reader.get_records_missed() != missed) {
+			std::printf("fell behind, skipped %" PRIu64 " records\n", reader.get_records_missed() - missed);
+			missed = reader.get_records_missed();
+		}
+
+		print_record(record);
+	}
+}
@@ -0,0 +1,270 @@
+#include "synthetic_data_generator/synthetic_data_gen.h"
+
+#include "automation/experiment_control.h"
+
+#include "memory_database/memory_database.h"
+
+#include "speedex/speedex_management_structures.h"
+#include "speedex/speedex_options.h"
+
+#include "speedex/vm/speedex_vm.h"
+
+#include "mempool/mempool.h"
+
+#include "utils/manage_data_dirs.h"
+
+#include <utils/mkdir.h>
+#include <utils/time.h>
+
+#include "automation/get_experiment_vars.h"
+
+#include "utils/yaml.h"
+
+#include <linux/perf_event.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+#include <tbb/global_control.h>
+#include <tbb/task_scheduler_observer.h>
+
+#include <cinttypes>
+#include <cstdint>
+#include <cstring>
+#include <mutex>
+#include <vector>
+
+using namespace speedex;
+
+/*
+Block production throughput and cache misses with and without
+account-affinity sharding of the mempool, for uniform and hot-spot
+(exponential, by account_dist_param) account distributions
+from the synthetic generator.
+
+Cache misses are counted per thread (every TBB worker and the main thread)
+with perf_event_open, and summed.  If perf events are unavailable
+(e.g. kernel.perf_event_paranoid), only throughput is reported.
+*/
+
+class ThreadCacheMissCounter : public tbb::task_scheduler_observer {
+
+	std::mutex mtx;
+	std::vector<int> fds;
+	bool failed = false;
+
+	void open_for_current_thread() {
+		static thread_local bool opened = false;
+		if (opened) {
+			return;
+		}
+		opened = true;
+
+		perf_event_attr attr;
+		std::memset(&attr, 0, sizeof(attr));
+		attr.size = sizeof(attr);
+		attr.type = PERF_TYPE_HARDWARE;
+		attr.config = PERF_COUNT_HW_CACHE_MISSES;
+		attr.exclude_kernel = 1;
+		attr.exclude_hv = 1;
+
+		int fd = syscall(SYS_perf_event_open, &attr, 0, -1, -1, 0);
+
+		std::lock_guard lock(mtx);
+		if (fd < 0) {
+			failed = true;
+			return;
+		}
+		fds.push_back(fd);
+	}
+
+public:
+
+	ThreadCacheMissCounter() {
+		open_for_current_thread();
+		observe(true);
+	}
+
+	~ThreadCacheMissCounter() {
+		observe(false);
+		for (int fd : fds) {
+			close(fd);
+		}
+	}
+
+	void on_scheduler_entry(bool) override final {
+		open_for_current_thread();
+	}
+
+	bool available() {
+		std::lock_guard lock(mtx);
+		return !failed;
+	}
+
+	uint64_t read_total() {
+		std::lock_guard lock(mtx);
+		uint64_t total = 0;
+		for (int fd : fds) {
+			uint64_t count = 0;
+			if (read(fd, &count, sizeof(count)) == sizeof(count)) {
+				total += count;
+			}
+		}
+		return total;
+	}
+};
+
+struct AffinityResult {
+	double txs_per_sec;
+	double cache_misses_per_tx;
+};
+
+constexpr static size_t NUM_ROUNDS = 10;
+constexpr static size_t WARMUP = 3;
+
+AffinityResult
+run_affinity_experiment(
+	ThreadCacheMissCounter& counter,
+	uint32_t num_accounts, 
+	uint32_t batch_size, 
+	double account_dist_param,
+	uint32_t num_shards)
+{
+	std::minstd_rand gen(0);
+	GenerationOptions options;
+
+	std::string experiment_options_file = "synthetic_data_config/blockstm_base.yaml";
+
+	if (!options.parse(experiment_options_file.c_str())) {
+		throw std::runtime_error("failed to parse experiment options file");
+	}
+
+	options.num_accounts = num_accounts;
+	options.block_size = batch_size;
+	options.account_dist_param = account_dist_param;
+
+	std::string speedex_options_file = "experiment_config/blockstm_params.yaml";
+
+	ReplicaID self_id = 0;
+	std::string config_file = "config/config_local.yaml";
+
+	yaml fyd(config_file);
+
+	if (!fyd) {
+		std::printf("Failed to build doc from file \"%s\"\n", config_file.c_str());
+		exit(1);
+	}
+
+	auto [config, sk] = parse_replica_config(fyd.get(), self_id);
+
+	ExperimentParameters params;
+
+	params.num_assets = 1;
+	params.default_amount = options.new_account_balance;
+	params.account_list_filename = "mempool_affinity_accounts";
+	params.num_blocks = NUM_ROUNDS + WARMUP;
+	params.n_replicas = config->nreplicas;
+
+	utils::mkdir_safe("experiment_data/mempool_affinity_data/");
+
+	GeneratorState generator (gen, options, "experiment_data/mempool_affinity_data/");
+
+	generator.dump_account_list(params.account_list_filename);
+
+	SpeedexOptions speedex_options;
+	speedex_options.parse_options(speedex_options_file.c_str());
+
+	speedex_options.block_size = batch_size;
+	speedex_options.mempool_chunk = 100;
+	speedex_options.mempool_account_shards = num_shards;
+
+	auto configs = get_runtime_configs(); 
+
+	clear_all_data_dirs(config->get_info(self_id));
+	make_all_data_dirs(config->get_info(self_id));
+
+	auto vm = std::make_shared<SpeedexVM>(params, speedex_options, "mempool_affinity_results/", configs);
+	vm -> init_clean();
+
+	std::vector<double> prices;
+	std::vector<ExperimentBlock> blocks;
+
+	for (size_t i = 0; i < params.num_blocks; i++)
+	{
+		blocks.push_back(generator.make_block(prices));
+	}
+
+	auto& mp = vm -> get_mempool();
+
+	double total_time = 0;
+	uint64_t total_misses = 0;
+
+	for (size_t i = 0; i < params.num_blocks; i++)
+	{
+		mp.chunkify_and_add_to_mempool_buffer(std::move(blocks[i]));
+		mp.push_mempool_buffer_to_mempool();
+
+		uint64_t misses_before = counter.read_total();
+		auto ts = utils::init_time_measurement();
+
+		auto blk = vm -> propose();
+
+		double t = utils::measure_time(ts);
+		uint64_t misses = counter.read_total() - misses_before;
+
+		vm -> log_commitment(blk->get_id());
+
+		if (i >= WARMUP) {
+			total_time += t;
+			total_misses += misses;
+		}
+	}
+
+	return AffinityResult {
+		.txs_per_sec = (static_cast<double>(batch_size) * NUM_ROUNDS) / total_time,
+		.cache_misses_per_tx = static_cast<double>(total_misses) / (static_cast<double>(batch_size) * NUM_ROUNDS)
+	};
+}
+
+int main(int argc, char const* const* argv)
+{
+	if (argc > 5) {
+		std::printf("usage: mempool_affinity_bench [num_accounts=1000000] [batch_size=100000] [num_shards=256] [num_threads=0]\n");
+		return 1;
+	}
+
+	uint32_t num_accounts = (argc > 1) ? std::stoul(argv[1]) : 1'000'000;
+	uint32_t batch_size = (argc > 2) ? std::stoul(argv[2]) : 100'000;
+	uint32_t num_shards = (argc > 3) ? std::stoul(argv[3]) : 256;
+	uint32_t num_threads = (argc > 4) ? std::stoul(argv[4]) : 0;
+
+	if (USE_TATONNEMENT_TIMEOUT_THREAD || !DISABLE_PRICE_COMPUTATION)
+	{
+		std::printf("warning: price computation is on; times include Tatonnement\n");
+	}
+
+	std::unique_ptr<tbb::global_control> control;
+	if (num_threads > 0) {
+		control = std::make_unique<tbb::global_control>(
+			tbb::global_control::max_allowed_parallelism, num_threads);
+	}
+
+	ThreadCacheMissCounter counter;
+
+	if (!counter.available()) {
+		std::printf("perf events unavailable, not counting cache misses\n");
+	}
+
+	// 0 is uniform; larger values concentrate txs on fewer accounts
+	std::vector<double> account_dists = {0, 0.0001, 0.001, 0.01};
+
+	for (auto dist : account_dists)
+	{
+		for (uint32_t shards : {0u, num_shards})
+		{
+			auto res = run_affinity_experiment(counter, num_accounts, batch_size, dist, shards);
+			std::printf("account_dist = %lf shards = %" PRIu32 " tps = %lf cache_misses/tx = %lf\n",
+				dist, shards, res.txs_per_sec, res.cache_misses_per_tx);
+		}
+	}
+}
@@ -0,0 +1,160 @@
+#include "orderbook/orderbook.h"
+#include "orderbook/orderbook_manager.h"
+#include "orderbook/orderbook_manager_view.h"
+#include "orderbook/typedefs.h"
+
+#include "utils/price.h"
+
+#include <utils/time.h>
+
+#include <cinttypes>
+#include <cmath>
+#include <cstdio>
+#include <random>
+#include <string>
+#include <vector>
+
+using namespace speedex;
+
+/*
+Measures OrderbookManager::commit_for_production() time on a large book
+with a small per-block churn (new offers plus cancellations), when the
+metadata indices are updated from the block's changes and when they are
+rebuilt from the orderbooks (forced via invalidate_metadata_indices()).
+Blocks alternate between the two modes, so both see the same book size.
+
+At the end, checks that the incrementally maintained indices agree
+with a full rebuild.
+*/
+
+struct LiveOffer {
+	int idx;
+	Offer offer;
+};
+
+static std::vector<EndowAccumulator>
+snapshot_totals(OrderbookManager& manager, std::vector<Price> const& probes)
+{
+	std::vector<EndowAccumulator> out;
+	for (auto const& orderbook : manager.get_orderbooks()) {
+		for (auto p : probes) {
+			out.push_back(orderbook.get_metadata(p));
+		}
+	}
+	return out;
+}
+
+int main(int argc, char const* const* argv)
+{
+	if (argc > 5) {
+		std::printf("usage: metadata_index_commit_bench [num_offers=1000000] [num_assets=20] [churn_per_block=1000] [num_blocks=20]\n");
+		return 1;
+	}
+
+	uint64_t num_offers = (argc > 1) ? std::stoull(argv[1]) : 1'000'000;
+	uint16_t num_assets = (argc > 2) ? std::stoul(argv[2]) : 20;
+	uint64_t churn = (argc > 3) ? std::stoull(argv[3]) : 1'000;
+	uint64_t num_blocks = (argc > 4) ? std::stoull(argv[4]) : 20;
+
+	if (num_blocks < 2) {
+		std::printf("need at least 2 blocks\n");
+		return 1;
+	}
+
+	OrderbookManager manager(num_assets);
+
+	std::minstd_rand gen(0);
+	std::normal_distribution<double> price_dist(0, 0.5);
+	std::uniform_int_distribution<int> idx_dist(0, manager.get_num_orderbooks() - 1);
+	std::uniform_int_distribution<int64_t> amount_dist(1, 1'000'000);
+
+	std::vector<LiveOffer> live_offers;
+	uint64_t next_offer_id = 0;
+
+	auto add_offers = [&] (uint64_t count) {
+		int x = 0;
+		ProcessingSerialManager serial_manager(manager);
+		for (uint64_t i = 0; i < count; i++) {
+			int idx = idx_dist(gen);
+
+			Offer offer;
+			offer.category = category_from_idx(idx, num_assets);
+			offer.offerId = next_offer_id;
+			offer.owner = next_offer_id;
+			offer.amount = amount_dist(gen);
+			offer.minPrice = price::impose_price_bounds(
+				price::from_double(std::exp(price_dist(gen))));
+			next_offer_id++;
+
+			serial_manager.add_offer(idx, offer, x, x);
+			live_offers.push_back(LiveOffer{idx, offer});
+		}
+		serial_manager.finish_merge();
+	};
+
+	add_offers(num_offers);
+	manager.commit_for_production(1);
+
+	double incremental_time = 0, rebuild_time = 0;
+	uint64_t incremental_blocks = 0, rebuild_blocks = 0;
+
+	for (uint64_t block = 2; block < num_blocks + 2; block++) {
+		for (uint64_t i = 0; i < churn && !live_offers.empty(); i++) {
+			std::uniform_int_distribution<size_t> live_dist(0, live_offers.size() - 1);
+			size_t j = live_dist(gen);
+
+			OrderbookTriePrefix key;
+			generate_orderbook_trie_key(live_offers[j].offer, key);
+			manager.mark_for_deletion(live_offers[j].idx, key);
+
+			live_offers[j] = live_offers.back();
+			live_offers.pop_back();
+		}
+		add_offers(churn);
+
+		bool rebuild = (block % 2 == 1);
+		if (rebuild) {
+			manager.invalidate_metadata_indices();
+		}
+
+		auto timestamp = utils::init_time_measurement();
+		manager.commit_for_production(block);
+		double elapsed = utils::measure_time(timestamp);
+
+		if (rebuild) {
+			rebuild_time += elapsed;
+			rebuild_blocks++;
+		} else {
+			incremental_time += elapsed;
+			incremental_blocks++;
+		}
+	}
+
+	std::vector<Price> probes;
+	for (int i = 0; i < 32; i++) {
+		probes.push_back(price::from_double(std::exp(price_dist(gen))));
+	}
+
+	// end on an incremental commit, then compare against a rebuild
+	add_offers(churn);
+	manager.commit_for_production(num_blocks + 2);
+	auto incremental_totals = snapshot_totals(manager, probes);
+
+	manager.invalidate_metadata_indices();
+	manager.generate_metadata_indices();
+	auto rebuilt_totals = snapshot_totals(manager, probes);
+
+	bool consistent = true;
+	for (size_t i = 0; i < incremental_totals.size(); i++) {
+		if (incremental_totals[i].endow != rebuilt_totals[i].endow
+			|| incremental_totals[i].endow_times_price != rebuilt_totals[i].endow_times_price) {
+			consistent = false;
+		}
+	}
+
+	std::printf("offers %" PRIu64 " churn/block %" PRIu64 "\n", num_offers, churn);
+	std::printf("incremental: avg commit %lf sec\n", incremental_time / incremental_blocks);
+	std::printf("rebuild:     avg commit %lf sec\n", rebuild_time / rebuild_blocks);
+	std::printf("incremental index %s rebuilt index\n", consistent ? "matches" : "DOES NOT MATCH");
+	return consistent ? 0 : 1;
+}
@@ -0,0 +1,141 @@
+#include "orderbook/orderbook.h"
+#include "orderbook/orderbook_manager.h"
+#include "orderbook/orderbook_manager_view.h"
+
+#include "utils/price.h"
+
+#include <utils/time.h>
+
+#include <algorithm>
+#include <cinttypes>
+#include <cmath>
+#include <cstdio>
+#include <random>
+#include <string>
+#include <vector>
+
+using namespace speedex;
+
+/*
+Measures Tatonnement demand query throughput (rounds per second,
+one round being a demand query on every orderbook) with the exact
+orderbook metadata index and with a quantized index
+(Orderbook::get_tatonnement_metadata()), along with the index sizes
+and the largest relative error in total demand observed.
+
+Offers are spread uniformly over orderbooks, with limit prices
+log-normally distributed around 1.
+*/
+
+static double
+run_rounds(
+	OrderbookManager& manager, 
+	const std::vector<std::vector<Price>>& round_prices, 
+	uint8_t smooth_mult, 
+	std::vector<uint128_t>& total_demands)
+{
+	auto& orderbooks = manager.get_orderbooks();
+	size_t num_assets = manager.get_num_assets();
+
+	std::vector<uint128_t> supplies(num_assets), demands(num_assets);
+
+	auto timestamp = utils::init_time_measurement();
+	for (auto const& prices : round_prices) {
+		std::fill(supplies.begin(), supplies.end(), 0);
+		std::fill(demands.begin(), demands.end(), 0);
+		for (auto& orderbook : orderbooks) {
+			orderbook.calculate_demands_and_supplies_times_prices(
+				prices.data(), demands.data(), supplies.data(), smooth_mult);
+		}
+		uint128_t total = 0;
+		for (auto d : demands) {
+			total += d;
+		}
+		total_demands.push_back(total);
+	}
+	return utils::measure_time(timestamp);
+}
+
+int main(int argc, char const* const* argv)
+{
+	if (argc > 6) {
+		std::printf("usage: metadata_quantization_bench [num_offers=1000000] [num_assets=20] [quantization_bits=12] [smooth_mult=10] [num_rounds=10000]\n");
+		return 1;
+	}
+
+	uint64_t num_offers = (argc > 1) ? std::stoull(argv[1]) : 1'000'000;
+	uint16_t num_assets = (argc > 2) ? std::stoul(argv[2]) : 20;
+	uint8_t bits = (argc > 3) ? std::stoul(argv[3]) : 12;
+	uint8_t smooth_mult = (argc > 4) ? std::stoul(argv[4]) : 10;
+	uint64_t num_rounds = (argc > 5) ? std::stoull(argv[5]) : 10'000;
+
+	OrderbookManager manager(num_assets);
+
+	std::minstd_rand gen(0);
+	std::normal_distribution<double> price_dist(0, 0.5);
+	std::uniform_int_distribution<int> idx_dist(0, manager.get_num_orderbooks() - 1);
+	std::uniform_int_distribution<int64_t> amount_dist(1, 1'000'000);
+
+	{
+		int x = 0;
+		ProcessingSerialManager serial_manager(manager);
+		for (uint64_t i = 0; i < num_offers; i++) {
+			int idx = idx_dist(gen);
+
+			Offer offer;
+			offer.category = category_from_idx(idx, num_assets);
+			offer.offerId = i;
+			offer.owner = i;
+			offer.amount = amount_dist(gen);
+			offer.minPrice = price::impose_price_bounds(
+				price::from_double(std::exp(price_dist(gen))));
+
+			serial_manager.add_offer(idx, offer, x, x);
+		}
+		serial_manager.finish_merge();
+	}
+	manager.commit_for_production(1);
+
+	std::vector<std::vector<Price>> round_prices;
+	for (uint64_t round = 0; round < num_rounds; round++) {
+		std::vector<Price> prices;
+		for (uint16_t i = 0; i < num_assets; i++) {
+			prices.push_back(price::from_double(std::exp(price_dist(gen) / 4)));
+		}
+		round_prices.push_back(prices);
+	}
+
+	auto index_size = [&manager] () {
+		size_t out = 0;
+		for (auto const& orderbook : manager.get_orderbooks()) {
+			out += orderbook.tatonnement_metadata_index_size();
+		}
+		return out;
+	};
+
+	size_t exact_size = index_size();
+	std::vector<uint128_t> exact_demands;
+	double exact_time = run_rounds(manager, round_prices, smooth_mult, exact_demands);
+
+	manager.set_metadata_quantization(bits);
+
+	size_t quantized_size = index_size();
+	std::vector<uint128_t> quantized_demands;
+	double quantized_time = run_rounds(manager, round_prices, smooth_mult, quantized_demands);
+
+	double max_rel_error = 0;
+	for (uint64_t round = 0; round < num_rounds; round++) {
+		double exact = price::amount_to_double(exact_demands[round]);
+		double quantized = price::amount_to_double(quantized_demands[round]);
+		if (exact > 0) {
+			max_rel_error = std::max(max_rel_error, std::abs(exact - quantized) / exact);
+		}
+	}
+
+	std::printf("offers %" PRIu64 " smooth_mult %u quantization_bits %u\n", num_offers, smooth_mult, bits);
+	std::printf("exact:     index entries %lu rounds/sec %lf\n", exact_size, num_rounds / exact_time);
+	std::printf("quantized: index entries %lu rounds/sec %lf (speedup %lfx)\n", 
+		quantized_size, num_rounds / quantized_time, exact_time / quantized_time);
+	std::printf("max relative demand error %lf\n", max_rel_error);
+	return 0;
+}
@@ -0,0 +1,114 @@
+#include "config/replica_config.h"
+
+#include "mempool/mempool.h"
+
+#include "overlay/overlay_client.h"
+#include "overlay/overlay_server.h"
+
+#include "synthetic_data_generator/data_stream.h"
+
+#include <utils/time.h>
+
+#include <chrono>
+#include <cinttypes>
+#include <cstdio>
+#include <memory>
+#include <string>
+#include <thread>
+#include <vector>
+
+using namespace speedex;
+
+using utils::init_time_measurement;
+
+/*
+Loopback benchmark of overlay ingest throughput.
+Replica 0 runs an OverlayServer; replicas 1..num_senders each
+open an OverlayClient to it and send their batches all at once.
+Reports txs per second until every tx reaches the mempool.
+
+Deduplication is off, since each sender resends the same batch.
+*/
+
+static std::shared_ptr<hotstuff::ReplicaConfig>
+make_loopback_config(uint32_t num_replicas, uint32_t base_port)
+{
+	auto config = std::make_shared<hotstuff::ReplicaConfig>();
+	for (ReplicaID i = 0; i < num_replicas; i++) {
+		std::string port = std::to_string(base_port + i);
+		config -> add_replica(std::make_unique<ReplicaInfo>(
+			i, PublicKey(), "localhost", port, port, "", port));
+	}
+	config -> finish_init();
+	return config;
+}
+
+int main(int argc, char const* const* argv)
+{
+	if (argc > 5) {
+		std::printf("usage: overlay_ingest_bench [num_senders=8] [num_ingest_threads=0] [batches_per_sender=20] [base_port=9300]\n");
+		return 1;
+	}
+
+	uint32_t num_senders = (argc > 1) ? std::stoul(argv[1]) : 8;
+	uint32_t num_ingest_threads = (argc > 2) ? std::stoul(argv[2]) : 0;
+	uint32_t batches_per_sender = (argc > 3) ? std::stoul(argv[3]) : 20;
+	uint32_t base_port = (argc > 4) ? std::stoul(argv[4]) : 9300;
+
+	auto config = make_loopback_config(num_senders + 1, base_port);
+	auto const& server_info = static_cast<ReplicaInfo const&>(config -> get_info(0));
+
+	Mempool mp(10'000, 2'000'000);
+	OverlayServer server(mp, *config, 0, OverlayTxCompressor::none(), 0, num_ingest_threads);
+
+	std::vector<DataBuffer> batches;
+	for (ReplicaID i = 1; i <= num_senders; i++) {
+		OverlappingMockDataStream stream(i, 0);
+		batches.push_back(stream.load_txs_unparsed());
+	}
+
+	std::vector<std::unique_ptr<OverlayClient>> clients;
+	for (ReplicaID i = 1; i <= num_senders; i++) {
+		clients.emplace_back(std::make_unique<OverlayClient>(
+			server_info, i, OverlayTxCompressor::none(), server_info.overlay_port));
+	}
+
+	uint64_t expected = 0;
+	for (auto const& batch : batches) {
+		expected += batch.num_txs * batches_per_sender;
+	}
+
+	std::printf("%u senders, %u ingest threads, %" PRIu64 " txs total\n", 
+		num_senders, num_ingest_threads, expected);
+
+	auto timestamp = init_time_measurement();
+
+	for (uint32_t round = 1; round <= batches_per_sender; round++) {
+		for (uint32_t i = 0; i < num_senders; i++) {
+			DataBuffer batch = batches[i];
+			batch.buffer_number = round;
+			clients[i] -> send_txs(OverlayForwardBatch{batch, nullptr, nullptr});
+		}
+	}
+
+	// drain the mempool as txs arrive, to keep memory bounded
+	uint64_t received = 0;
+	double last_report = 0;
+	while (received < expected) {
+		std::this_thread::sleep_for(std::chrono::milliseconds(10));
+		mp.push_mempool_buffer_to_mempool();
+		uint64_t sz = mp.size();
+		mp.drop_txs(sz);
+		received += sz;
+
+		double elapsed = utils::measure_time_from_basept(timestamp);
+		if (elapsed - last_report > 1) {
+			std::printf("%lf s: %" PRIu64 " txs (%lf tx/s)\n", elapsed, received, received / elapsed);
+			last_report = elapsed;
+		}
+	}
+
+	double elapsed = utils::measure_time_from_basept(timestamp);
+	std::printf("ingested %" PRIu64 " txs in %lf s: %lf tx/s\n", received, elapsed, received / elapsed);
+	return 0;
+}
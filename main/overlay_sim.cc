@@ -1,7 +1,9 @@
 #include "automation/get_experiment_vars.h"
 #include "automation/get_replica_id.h"
 
+#include "overlay/adaptive_flood_policy.h"
 #include "overlay/overlay_client_manager.h"
+#include "overlay/overlay_compression.h"
 #include "overlay/overlay_server.h"
 #include "overlay/overlay_flooder.h"
 
@@ -13,7 +15,9 @@
 
 #include <iostream>
 #include <cinttypes>
+#include <memory>
 #include <optional>
+#include <string>
 
 #include <getopt.h>
 #include <libfyaml.h>
@@ -26,25 +30,80 @@ using namespace hotstuff;
 static void usage() {
 	std::printf(R"(
 usage: overlay_sim --replica_id=<id> --config_file=<filename>
+		[--compression=<none|zstd|zstd_dict>] [--dictionary=<filename>]
+		[--adaptive] [--max_batch_buffers=<n>]
+		[--shared_fraction=<f>] [--dedup_capacity=<n>] [--inventory_threshold=<n>]
+		[--ingest_threads=<n>]
+       overlay_sim --train_dictionary=<filename>
+
+--train_dictionary trains a zstd dictionary on the mock data stream,
+writes it to the given file, and exits.  All replicas must use the
+same dictionary.
+
+--shared_fraction of each replica's txs are also submitted to every
+other replica (default 0).  --dedup_capacity=0 disables deduplication.
+Batches of at least --inventory_threshold txs are announced by digest
+first (default 0, never).  --ingest_threads decode received batches
+off the network thread (default 0, decode on the network thread).
 )");
 	exit(1);
 }
 
 enum opttag {
 	OPT_REPLICA_ID = 0x100,
-	OPT_CONFIG_FILE
+	OPT_CONFIG_FILE,
+	OPT_COMPRESSION,
+	OPT_DICTIONARY,
+	OPT_TRAIN_DICTIONARY,
+	OPT_ADAPTIVE,
+	OPT_MAX_BATCH_BUFFERS,
+	OPT_SHARED_FRACTION,
+	OPT_DEDUP_CAPACITY,
+	OPT_INVENTORY_THRESHOLD,
+	OPT_INGEST_THREADS
 };
 
 static const struct option opts[] = {
 	{"replica_id", required_argument, nullptr, OPT_REPLICA_ID},
 	{"config_file", required_argument, nullptr, OPT_CONFIG_FILE},
+	{"compression", required_argument, nullptr, OPT_COMPRESSION},
+	{"dictionary", required_argument, nullptr, OPT_DICTIONARY},
+	{"train_dictionary", required_argument, nullptr, OPT_TRAIN_DICTIONARY},
+	{"adaptive", no_argument, nullptr, OPT_ADAPTIVE},
+	{"max_batch_buffers", required_argument, nullptr, OPT_MAX_BATCH_BUFFERS},
+	{"shared_fraction", required_argument, nullptr, OPT_SHARED_FRACTION},
+	{"dedup_capacity", required_argument, nullptr, OPT_DEDUP_CAPACITY},
+	{"inventory_threshold", required_argument, nullptr, OPT_INVENTORY_THRESHOLD},
+	{"ingest_threads", required_argument, nullptr, OPT_INGEST_THREADS},
 	{nullptr, 0, nullptr, 0}
 };
 
+static void train_dictionary(std::string const& filename) {
+	MockDataStream data_stream;
+
+	std::vector<xdr::opaque_vec<>> samples;
+	for (size_t i = 0; i < 4; i++) {
+		samples.push_back(*data_stream.load_txs_unparsed().data);
+	}
+
+	auto dictionary = OverlayTxCompressor::train_dictionary(samples);
+	OverlayTxCompressor::save_dictionary(dictionary, filename);
+	std::printf("wrote %lu byte dictionary to %s\n", dictionary.size(), filename.c_str());
+}
+
 int main(int argc, char **argv)
 {
 	std::optional<ReplicaID> self_id;
 	std::string config_file;
+	std::string compression = "none";
+	std::string dictionary_file;
+	std::string train_dictionary_file;
+	bool adaptive = false;
+	uint32_t max_batch_buffers = 4;
+	double shared_fraction = 0;
+	uint64_t dedup_capacity = OverlayHandler::DEFAULT_DEDUP_CAPACITY;
+	uint64_t inventory_threshold = 0;
+	uint32_t ingest_threads = 0;
 	
 	int opt;
 
@@ -58,11 +117,60 @@ int main(int argc, char **argv)
 			case OPT_CONFIG_FILE:
 				config_file = optarg;
 				break;
+			case OPT_COMPRESSION:
+				compression = optarg;
+				break;
+			case OPT_DICTIONARY:
+				dictionary_file = optarg;
+				break;
+			case OPT_TRAIN_DICTIONARY:
+				train_dictionary_file = optarg;
+				break;
+			case OPT_ADAPTIVE:
+				adaptive = true;
+				break;
+			case OPT_MAX_BATCH_BUFFERS:
+				max_batch_buffers = std::stoul(optarg);
+				break;
+			case OPT_SHARED_FRACTION:
+				shared_fraction = std::stod(optarg);
+				break;
+			case OPT_DEDUP_CAPACITY:
+				dedup_capacity = std::stoull(optarg);
+				break;
+			case OPT_INVENTORY_THRESHOLD:
+				inventory_threshold = std::stoull(optarg);
+				break;
+			case OPT_INGEST_THREADS:
+				ingest_threads = std::stoul(optarg);
+				break;
 			default:
 				usage();
 		}
 	}
 
+	if (!train_dictionary_file.empty()) {
+		train_dictionary(train_dictionary_file);
+		return 0;
+	}
+
+	std::unique_ptr<OverlayTxCompressor> compressor;
+	if (compression == "none") {
+		compressor = std::make_unique<OverlayTxCompressor>();
+	} else if (compression == "zstd") {
+		compressor = std::make_unique<OverlayTxCompressor>(OVERLAY_ZSTD);
+	} else if (compression == "zstd_dict") {
+		if (dictionary_file.empty()) {
+			usage();
+		}
+		compressor = std::make_unique<OverlayTxCompressor>(
+			OVERLAY_ZSTD_DICT, 
+			OverlayTxCompressor::DEFAULT_LEVEL, 
+			OverlayTxCompressor::load_dictionary(dictionary_file));
+	} else {
+		usage();
+	}
+
 	if (!self_id) {
 		self_id = get_replica_id();
 	}
@@ -82,17 +190,47 @@ int main(int argc, char **argv)
 	//config.parse(fyd, *self_id);
 
 	Mempool mp(10'000, 2'000'000);
-	OverlayServer server(mp, *config, *self_id);
-
-	OverlayClientManager client_manager(*config, *self_id, mp, server.get_handler());
-
-	MockDataStream data_stream;
+	OverlayServer server(mp, *config, *self_id, *compressor, dedup_capacity, ingest_threads);
+
+	OverlayClientManager client_manager(*config, *self_id, mp, server.get_handler(), *compressor, inventory_threshold);
+
+	OverlappingMockDataStream data_stream(*self_id, shared_fraction);
+
+	auto flood_params = AdaptiveFloodParams::fixed(1'000'000);
+	if (adaptive) {
+		using namespace std::chrono_literals;
+		flood_params = AdaptiveFloodParams {
+			.min_threshold = 250'000,
+			.max_threshold = 2'000'000,
+			.max_buffers_per_send = max_batch_buffers,
+			.min_poll_interval = 5ms,
+			.max_poll_interval = 500ms
+		};
+	}
 
-	OverlayFlooder flooder(data_stream, client_manager, server, 1'000'000);
+	OverlayFlooder flooder(data_stream, client_manager, server, flood_params);
 
 	while (true) {
 		std::cin.get();
 		std::printf("mempool size: %" PRIu64 "\n", mp.total_size());
+		auto rtt = client_manager.get_max_rtt();
+		std::printf("max rtt: %lf ms, wire/raw bytes: %lf\n", 
+			rtt ? (*rtt * 1000) : 0.0,
+			client_manager.get_compression_ratio());
+
+		auto dedup = server.get_handler().get_dedup_stats();
+		std::printf("received %" PRIu64 " txs, dropped %" PRIu64 " duplicates (%lf), filter time %lf s (%lf ns/tx)\n",
+			dedup.txs_received,
+			dedup.duplicates_dropped,
+			dedup.txs_received ? static_cast<double>(dedup.duplicates_dropped) / dedup.txs_received : 0.0,
+			dedup.filter_seconds,
+			dedup.txs_received ? dedup.filter_seconds * 1e9 / dedup.txs_received : 0.0);
+		std::printf("inventory: peers wanted %" PRIu64 " of %" PRIu64 " offered txs, peers skipped %lf of ours\n",
+			dedup.inventory_wanted,
+			dedup.inventory_offered,
+			client_manager.get_inventory_skip_rate());
+		std::printf("backlogged ingest dropped %" PRIu64 " batches\n",
+			dedup.ingest_batches_dropped);
 		mp.push_mempool_buffer_to_mempool();
 		mp.drop_txs(550'000);
 	}
@@ -0,0 +1,262 @@
+#include "utils/price.h"
+
+#include <utils/time.h>
+
+#include <cinttypes>
+#include <cstdio>
+#include <random>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+using namespace speedex;
+
+/*
+Microbenchmarks for the price kernels in utils/price.h, against
+the byte-at-a-time and per-asset implementations they replaced
+(copied below).  Each kernel checks that both versions produce
+the same output before reporting times.
+*/
+
+namespace legacy {
+
+static void
+write_price_big_endian(unsigned char* buf, const Price& price) {
+	for (uint8_t loc = 0; loc < price::PRICE_BYTES; loc++) {
+		uint8_t offset = ((price::PRICE_BYTES - loc - 1) * 8);
+		buf[loc] = (price >> offset) & 0xFF;
+	}
+}
+
+static Price
+read_price_big_endian(const unsigned char* buf) {
+	Price p = 0;
+	for (uint8_t loc = 0; loc < price::PRICE_BYTES; loc++) {
+		p <<=8;
+		p += buf[loc];
+	}
+	return p;
+}
+
+static Price
+impose_price_bounds(const uint128_t& val) {
+	if (val > price::MAX_PRICE) {
+		return price::MAX_PRICE;
+	}
+	if (val == 0) {
+		return 1;
+	}
+	return val;
+}
+
+static Price 
+safe_multiply_and_drop_lowbits(
+	const uint128_t& first, 
+	const uint128_t& second, 
+	const uint64_t& lowbits_to_drop) {
+
+	if (lowbits_to_drop < 64 || lowbits_to_drop > 196) {
+		throw std::runtime_error("unimplemented");
+	}
+
+	uint128_t first_low = first & UINT64_MAX;
+	uint128_t first_high = (first >> 64) & UINT64_MAX;
+	uint128_t second_low = second & UINT64_MAX;
+	uint128_t second_high = (second >> 64) & UINT64_MAX;
+
+	uint128_t low_low = first_low * second_low;
+
+	uint128_t low_high = first_low * second_high;
+	uint128_t high_low = first_high * second_low;
+	uint128_t high_high = first_high * second_high;
+
+	uint128_t out = 0;
+
+	if (lowbits_to_drop < 128) {
+		out += (low_low >> lowbits_to_drop);
+	}
+	uint64_t lowhigh_offset = lowbits_to_drop - 64;
+
+	out += (low_high >> lowhigh_offset) + (high_low >> lowhigh_offset);
+
+	if (lowbits_to_drop <= 128) {
+
+		uint64_t used_lowbits = 128-lowbits_to_drop;
+		uint64_t used_highbits 
+			= (used_lowbits <= price::PRICE_BIT_LEN) ? price::PRICE_BIT_LEN - used_lowbits : 0;
+
+		uint64_t max_highbits = (((uint64_t)1) << used_highbits) - 1;
+		
+		if (high_high > max_highbits) {
+			high_high = max_highbits;
+		}
+
+		out += (high_high << (used_lowbits));
+
+		if (out > price::MAX_PRICE) {
+			out = price::MAX_PRICE;
+		}
+	} else {
+		uint64_t highbits_offset = lowbits_to_drop - 128;
+
+		out += (high_high >> highbits_offset);
+
+		if (out > price::MAX_PRICE) {
+			out = price::MAX_PRICE;
+		}
+
+	}
+	return out;
+}
+
+static Price 
+get_trial_price(const uint128_t& demand, const uint128_t& supply, const Price& old_price, const uint64_t& step, const uint16_t applied_relativizer, const uint8_t step_radix) {
+	if (demand > supply) {
+		uint128_t diff = demand - supply;
+		uint128_t p_times_step = ((uint128_t)step) * ((uint128_t) old_price);
+		uint128_t p_times_diff = (applied_relativizer) * diff;
+		Price delta = legacy::safe_multiply_and_drop_lowbits(p_times_step, p_times_diff, step_radix + price::PRICE_RADIX);
+		return legacy::impose_price_bounds(old_price + delta);
+	} else {
+		uint128_t diff = supply - demand;
+		uint128_t p_times_step = ((uint128_t)step) * ((uint128_t) old_price);
+		uint128_t p_times_diff = (applied_relativizer) * diff;
+		Price delta = legacy::safe_multiply_and_drop_lowbits(p_times_step, p_times_diff, step_radix + price::PRICE_RADIX);
+		if (delta >= old_price) {
+			return 1;
+		}
+		return old_price - delta;
+	}
+}
+
+static bool
+set_trial_prices(const Price* old_prices, Price* new_prices, uint64_t step, uint8_t step_radix, const uint128_t* demands, const uint128_t* supplies, const uint16_t* relativizers, size_t num_assets) {
+	bool changed = false;
+	for (size_t i = 0; i < num_assets; i++) {
+		new_prices[i] = get_trial_price(demands[i], supplies[i], old_prices[i], step, relativizers[i], step_radix);
+		if (new_prices[i] != old_prices[i]) {
+			changed = true;
+		}	
+	}
+	return changed;
+}
+
+} /* legacy */
+
+template<typename Fn>
+static double
+time_rounds(uint64_t num_rounds, Fn&& fn)
+{
+	auto timestamp = utils::init_time_measurement();
+	for (uint64_t round = 0; round < num_rounds; round++) {
+		fn();
+	}
+	return utils::measure_time(timestamp);
+}
+
+static void
+report(const char* name, double legacy_time, double kernel_time, uint64_t ops)
+{
+	std::printf("%-16s legacy %lf ns/op  kernel %lf ns/op  speedup %lfx\n",
+		name,
+		legacy_time * 1e9 / ops,
+		kernel_time * 1e9 / ops,
+		legacy_time / kernel_time);
+}
+
+int main(int argc, char const* const* argv)
+{
+	if (argc > 3) {
+		std::printf("usage: price_kernel_bench [num_assets=200] [num_rounds=100000]\n");
+		return 1;
+	}
+
+	size_t num_assets = (argc > 1) ? std::stoull(argv[1]) : 200;
+	uint64_t num_rounds = (argc > 2) ? std::stoull(argv[2]) : 100'000;
+
+	std::minstd_rand gen(0);
+	std::uniform_int_distribution<uint64_t> dist(0, UINT64_MAX);
+
+	std::vector<Price> prices(num_assets), legacy_out(num_assets), kernel_out(num_assets);
+	std::vector<uint128_t> demands(num_assets), supplies(num_assets), wide(num_assets);
+	std::vector<uint16_t> relativizers(num_assets, 1);
+	std::vector<unsigned char> buf(num_assets * price::PRICE_BYTES);
+
+	for (size_t i = 0; i < num_assets; i++) {
+		prices[i] = price::impose_price_bounds(dist(gen) >> 16);
+		demands[i] = ((uint128_t) dist(gen)) << 8;
+		supplies[i] = ((uint128_t) dist(gen)) << 8;
+		wide[i] = ((uint128_t) dist(gen)) >> (i % 32);
+	}
+
+	uint64_t ops = num_rounds * num_assets;
+
+	// keeps the compiler from discarding the read loops
+	uint64_t sink = 0;
+
+	double legacy_write = time_rounds(num_rounds, [&] {
+		for (size_t i = 0; i < num_assets; i++) {
+			legacy::write_price_big_endian(buf.data() + i * price::PRICE_BYTES, prices[i] + sink);
+		}
+		sink += buf[0];
+	});
+	double kernel_write = time_rounds(num_rounds, [&] {
+		for (size_t i = 0; i < num_assets; i++) {
+			price::write_price_big_endian(buf.data() + i * price::PRICE_BYTES, prices[i] + sink);
+		}
+		sink += buf[0];
+	});
+	report("encode", legacy_write, kernel_write, ops);
+
+	double legacy_read = time_rounds(num_rounds, [&] {
+		for (size_t i = 0; i < num_assets; i++) {
+			sink += legacy::read_price_big_endian(buf.data() + i * price::PRICE_BYTES);
+		}
+	});
+	double kernel_read = time_rounds(num_rounds, [&] {
+		for (size_t i = 0; i < num_assets; i++) {
+			sink += price::read_price_big_endian(buf.data() + i * price::PRICE_BYTES);
+		}
+	});
+	report("decode", legacy_read, kernel_read, ops);
+
+	for (size_t i = 0; i < num_assets; i++) {
+		if (legacy::impose_price_bounds(wide[i]) != price::impose_price_bounds(wide[i])) {
+			std::printf("mismatch in impose_price_bounds\n");
+			return 1;
+		}
+	}
+
+	double legacy_bounds = time_rounds(num_rounds, [&] {
+		for (size_t i = 0; i < num_assets; i++) {
+			legacy_out[i] = legacy::impose_price_bounds(wide[i] + sink);
+		}
+		sink += legacy_out[0];
+	});
+	double kernel_bounds = time_rounds(num_rounds, [&] {
+		price::batch_impose_price_bounds(wide.data(), kernel_out.data(), num_assets);
+		sink += kernel_out[0];
+	});
+	report("price bounds", legacy_bounds, kernel_bounds, ops);
+
+	const uint8_t step_radix = 55;
+	const uint64_t step = ((uint64_t)1) << 40;
+
+	legacy::set_trial_prices(prices.data(), legacy_out.data(), step, step_radix, demands.data(), supplies.data(), relativizers.data(), num_assets);
+	price::batch_update_trial_prices<false>(prices.data(), kernel_out.data(), demands.data(), supplies.data(), relativizers.data(), num_assets, step, step_radix + price::PRICE_RADIX);
+	if (legacy_out != kernel_out) {
+		std::printf("mismatch in trial prices\n");
+		return 1;
+	}
+
+	double legacy_trial = time_rounds(num_rounds, [&] {
+		sink += legacy::set_trial_prices(prices.data(), legacy_out.data(), step + (sink & 1), step_radix, demands.data(), supplies.data(), relativizers.data(), num_assets);
+	});
+	double kernel_trial = time_rounds(num_rounds, [&] {
+		sink += price::batch_update_trial_prices<false>(prices.data(), kernel_out.data(), demands.data(), supplies.data(), relativizers.data(), num_assets, step + (sink & 1), step_radix + price::PRICE_RADIX);
+	});
+	report("trial prices", legacy_trial, kernel_trial, ops);
+
+	std::printf("(sink %" PRIu64 ")\n", sink);
+	return 0;
+}
@@ -0,0 +1,75 @@
+#include "memory_database/account_lmdb.h"
+
+#include "utils/manage_data_dirs.h"
+
+#include <cinttypes>
+#include <cstdio>
+#include <optional>
+#include <string>
+
+#include <getopt.h>
+
+using namespace speedex;
+
+[[noreturn]]
+static void usage() {
+	std::printf(R"(
+usage: reshard_account_db
+        --num_shards=<new shard count>
+Migrates the account database (in the configured ROOT_DB_DIRECTORY)
+to a new number of shards.  The node must not be running.
+)");
+	exit(1);
+}
+
+enum opttag {
+	OPT_NUM_SHARDS = 0x100,
+};
+
+static const struct option opts[] = {
+	{"num_shards", required_argument, nullptr, OPT_NUM_SHARDS},
+	{nullptr, 0, nullptr, 0}
+};
+
+int main(int argc, char* const* argv)
+{
+	std::optional<uint32_t> num_shards;
+
+	int opt;
+
+	while ((opt = getopt_long_only(argc, argv, "",
+				 opts, nullptr)) != -1)
+	{
+		switch(opt) {
+			case OPT_NUM_SHARDS:
+				num_shards = std::stoi(optarg);
+				break;
+			default:
+				usage();
+		}
+	}
+
+	if (!num_shards || *num_shards == 0) {
+		usage();
+	}
+
+	if (!detail::read_stored_num_shards(memory_database_lmdb_dir())) {
+		std::printf("no account database in %s\n", memory_database_lmdb_dir().c_str());
+		return 1;
+	}
+
+	AccountLMDB lmdb;
+	lmdb.open_env();
+	lmdb.open_db();
+
+	std::printf("account db has %" PRIu32 " shards, persisted through round %" PRIu64 "\n",
+		lmdb.get_num_shards(), lmdb.assert_snapshot_and_get_persisted_round_number());
+
+	if (lmdb.get_num_shards() == *num_shards) {
+		std::printf("nothing to do\n");
+		return 0;
+	}
+
+	lmdb.reshard(*num_shards);
+	return 0;
+}
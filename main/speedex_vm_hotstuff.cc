@@ -168,6 +168,8 @@ int main(int argc, char* const* argv)
 	make_all_data_dirs(parsed_config->get_info(*args.self_id));
 
 	auto configs = get_runtime_configs();
+	configs.replica_id = *args.self_id;
+	configs.state_snapshot_block = args.state_snapshot_block;
 
 	auto vm = std::make_shared<SpeedexVM>(params, speedex_options, args.experiment_results_folder, configs);
 
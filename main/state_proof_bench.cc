@@ -0,0 +1,111 @@
+#include "state_proofs/state_proof_snapshot.h"
+#include "state_proofs/state_proof_verifier.h"
+
+#include "xdr/state_proof.h"
+
+#include <utils/time.h>
+
+#include <sodium.h>
+
+#include <xdrpp/marshal.h>
+
+#include <cinttypes>
+#include <cstdio>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+using namespace speedex;
+
+using utils::init_time_measurement;
+using utils::measure_time;
+
+int main(int argc, char const* const* argv)
+{
+	if (argc > 3) {
+		std::printf("usage: state_proof_bench [num_accounts=1000000] [batch_size=10000]\n");
+		return 1;
+	}
+
+	uint64_t num_accounts = (argc > 1) ? std::stoull(argv[1]) : 1'000'000;
+	uint64_t batch_size = (argc > 2) ? std::stoull(argv[2]) : 10'000;
+
+	if (sodium_init() < 0) {
+		throw std::runtime_error("failed to init sodium");
+	}
+
+	std::vector<AccountCommitment> accounts(num_accounts);
+	std::vector<std::vector<Offer>> offers(1);
+
+	for (uint64_t i = 0; i < num_accounts; i++) {
+		accounts[i].owner = 2 * i;
+		accounts[i].assets.push_back(AssetCommitment(0, i));
+
+		Offer offer;
+		offer.offerId = i;
+		offer.owner = 2 * i;
+		offer.amount = 100;
+		offer.minPrice = (i * 7919) % 1'000'000;
+		offers[0].push_back(offer);
+	}
+
+	HashedBlock header;
+	header.block.blockNumber = 1;
+
+	auto ts = init_time_measurement();
+	StateProofSnapshot snapshot(header, std::move(accounts), std::move(offers));
+	std::printf("built snapshot over %" PRIu64 " accounts and offers in %lf s\n",
+		num_accounts, measure_time(ts));
+
+	auto const& roots = snapshot.get_roots();
+
+	std::vector<AccountProof> account_proofs(batch_size);
+	for (uint64_t i = 0; i < batch_size; i++) {
+		// half present, half absent
+		account_proofs[i].owner = (i * 104729) % (2 * num_accounts);
+	}
+
+	ts = init_time_measurement();
+	snapshot.make_account_proofs(account_proofs);
+	double gen_time = measure_time(ts);
+
+	size_t proof_bytes = 0;
+	ts = init_time_measurement();
+	for (auto const& proof : account_proofs) {
+		if (check_account_proof(proof, roots) == StateProofResult::INVALID) {
+			throw std::runtime_error("account proof check failed");
+		}
+	}
+	double check_time = measure_time(ts);
+	for (auto const& proof : account_proofs) {
+		proof_bytes += xdr::xdr_size(proof);
+	}
+
+	std::printf("accounts: %" PRIu64 " proofs, gen %lf proofs/sec (parallel), check %lf proofs/sec (one thread), avg %lf bytes\n",
+		batch_size, batch_size / gen_time, batch_size / check_time,
+		static_cast<double>(proof_bytes) / batch_size);
+
+	std::vector<OfferProof> offer_proofs(batch_size);
+	for (uint64_t i = 0; i < batch_size; i++) {
+		uint64_t idx = (i * 104729) % num_accounts;
+		offer_proofs[i].orderbookIdx = 0;
+		offer_proofs[i].minPrice = (idx * 7919) % 1'000'000;
+		offer_proofs[i].owner = 2 * idx;
+		offer_proofs[i].offerId = idx + (i % 2);
+	}
+
+	ts = init_time_measurement();
+	snapshot.make_offer_proofs(offer_proofs);
+	gen_time = measure_time(ts);
+
+	ts = init_time_measurement();
+	for (auto const& proof : offer_proofs) {
+		if (check_offer_proof(proof, roots) == StateProofResult::INVALID) {
+			throw std::runtime_error("offer proof check failed");
+		}
+	}
+	check_time = measure_time(ts);
+
+	std::printf("offers: %" PRIu64 " proofs, gen %lf proofs/sec (parallel), check %lf proofs/sec (one thread)\n",
+		batch_size, batch_size / gen_time, batch_size / check_time);
+}
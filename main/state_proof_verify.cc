@@ -0,0 +1,83 @@
+#include "state_proofs/state_proof_verifier.h"
+
+#include "utils/save_load_xdr.h"
+
+#include "xdr/state_proof.h"
+
+#include <sodium.h>
+
+#include <cinttypes>
+#include <cstdio>
+#include <stdexcept>
+#include <string>
+
+using namespace speedex;
+
+[[noreturn]]
+static void usage() {
+	std::printf("usage: state_proof_verify <roots file> <account|offer> <proof file>\n");
+	std::printf("roots and proof files are xdr-serialized StateProofRoots and AccountProof/OfferProof.\n");
+	std::printf("The caller must separately check that the roots' block hash is a decided block.\n");
+	exit(1);
+}
+
+static const char* result_str(StateProofResult res) {
+	switch(res) {
+		case StateProofResult::PRESENT:
+			return "PRESENT";
+		case StateProofResult::ABSENT:
+			return "ABSENT";
+		default:
+			return "INVALID";
+	}
+}
+
+int main(int argc, char const* const* argv)
+{
+	if (argc != 4) {
+		usage();
+	}
+
+	if (sodium_init() < 0) {
+		throw std::runtime_error("failed to init sodium");
+	}
+
+	StateProofRoots roots;
+	if (load_xdr_from_file(roots, argv[1])) {
+		throw std::runtime_error(std::string("failed to load roots from ") + argv[1]);
+	}
+
+	std::string type = argv[2];
+
+	StateProofResult res;
+
+	if (type == "account") {
+		AccountProof proof;
+		if (load_xdr_from_file(proof, argv[3])) {
+			throw std::runtime_error(std::string("failed to load proof from ") + argv[3]);
+		}
+		res = check_account_proof(proof, roots);
+		std::printf("account %" PRIu64 " at block %" PRIu64 ": %s\n",
+			proof.owner, roots.blockNumber, result_str(res));
+		if (res == StateProofResult::PRESENT) {
+			for (auto const& asset : proof.leaves[0].assets) {
+				std::printf("  asset %" PRIu32 ": %" PRIu64 "\n", asset.asset, asset.amount_available);
+			}
+		}
+	} else if (type == "offer") {
+		OfferProof proof;
+		if (load_xdr_from_file(proof, argv[3])) {
+			throw std::runtime_error(std::string("failed to load proof from ") + argv[3]);
+		}
+		res = check_offer_proof(proof, roots);
+		std::printf("offer (orderbook %" PRIu32 ", owner %" PRIu64 ", id %" PRIu64 ") at block %" PRIu64 ": %s\n",
+			proof.orderbookIdx, proof.owner, proof.offerId, roots.blockNumber, result_str(res));
+		if (res == StateProofResult::PRESENT) {
+			std::printf("  amount: %" PRIu64 "\n", proof.leaves[0].amount);
+		}
+	} else {
+		usage();
+	}
+
+	return (res == StateProofResult::INVALID) ? 1 : 0;
+}
@@ -0,0 +1,82 @@
+#include "price_computation/tatonnement_objective.h"
+
+#include "utils/price.h"
+
+#include <utils/time.h>
+
+#include <cstdio>
+#include <random>
+#include <string>
+#include <vector>
+
+using namespace speedex;
+
+/*
+Per-round cost of evaluating the Tatonnement objective
+(MultifuncTatonnementObjective vs L2TatonnementObjective),
+at several asset counts.  Each round is one eval() over freshly
+perturbed supplies and demands, as in a Tatonnement round.
+*/
+
+template<typename Objective>
+static double
+time_objective(
+	uint64_t num_rounds,
+	std::vector<uint128_t>& supplies,
+	const std::vector<uint128_t>& demands,
+	const std::vector<Price>& prices,
+	const std::vector<uint16_t>& relativizers,
+	double& sink)
+{
+	const size_t num_assets = prices.size();
+
+	auto timestamp = utils::init_time_measurement();
+	for (uint64_t round = 0; round < num_rounds; round++) {
+		supplies[round % num_assets] += round;
+
+		Objective objective;
+		objective.eval(supplies.data(), demands.data(), prices.data(), relativizers.data(), num_assets);
+		sink += objective.l2norm_sq;
+	}
+	return utils::measure_time(timestamp);
+}
+
+int main(int argc, char const* const* argv)
+{
+	if (argc > 2) {
+		std::printf("usage: tatonnement_objective_bench [num_rounds=100000]\n");
+		return 1;
+	}
+
+	uint64_t num_rounds = (argc > 1) ? std::stoull(argv[1]) : 100'000;
+
+	std::minstd_rand gen(0);
+	std::uniform_int_distribution<uint64_t> dist(0, UINT64_MAX);
+
+	double sink = 0;
+
+	for (size_t num_assets : {20, 100, 200, 500, 1000}) {
+		std::vector<uint128_t> supplies(num_assets), demands(num_assets);
+		std::vector<Price> prices(num_assets);
+		std::vector<uint16_t> relativizers(num_assets, 1);
+
+		for (size_t i = 0; i < num_assets; i++) {
+			supplies[i] = ((uint128_t) dist(gen)) << 24;
+			demands[i] = ((uint128_t) dist(gen)) << 24;
+			prices[i] = price::impose_price_bounds(dist(gen) >> 16);
+		}
+
+		double full_time = time_objective<MultifuncTatonnementObjective>(
+			num_rounds, supplies, demands, prices, relativizers, sink);
+		double l2_time = time_objective<L2TatonnementObjective>(
+			num_rounds, supplies, demands, prices, relativizers, sink);
+
+		std::printf("num_assets %4lu: multifunc %lf us/round l2 %lf us/round (speedup %lfx)\n",
+			num_assets,
+			full_time * 1e6 / num_rounds,
+			l2_time * 1e6 / num_rounds,
+			full_time / l2_time);
+	}
+	std::printf("(sink %lf)\n", sink);
+	return 0;
+}
@@ -0,0 +1,231 @@
+#include "memory_database/memory_database.h"
+
+#include "modlog/account_modification_log.h"
+
+#include "orderbook/orderbook_manager.h"
+#include "orderbook/orderbook_manager_view.h"
+
+#include "price_computation/tatonnement_predictor.h"
+
+#include "speedex/approximation_parameters.h"
+#include "speedex/speedex_management_structures.h"
+
+#include "stats/block_update_stats.h"
+
+#include "utils/save_load_xdr.h"
+
+#include "xdr/experiments.h"
+
+#include <atomic>
+#include <chrono>
+#include <cinttypes>
+#include <cstdint>
+#include <cstdio>
+#include <string>
+#include <thread>
+#include <vector>
+
+using namespace speedex;
+
+/*
+Replays the blocks written by cryptocoin_dataset_gen (coingecko replay
+data: <experiment_root>/params and <experiment_root>/<n>.txs) through
+Tatonnement, and measures how many rounds the speculative price
+predictor (price_computation/tatonnement_predictor.h) saves per block.
+
+For each block:
+ - the predictor is started on the current orderbooks plus the offers
+   of the first pending_fraction of the block's transactions (the part
+   of the block already in the mempool), and runs for collection_ms;
+ - the block's offers and cancellations are applied and committed;
+ - Tatonnement runs twice: from the previous block's prices (baseline),
+   and from the predicted prices.
+The baseline prices are used to clear the block, so both runs
+see the same sequence of orderbooks.
+
+Account balances are not tracked; every well-formed offer and
+cancellation in the replay data is applied.
+*/
+
+struct TatonnementRun {
+	TatonnementMeasurements measurements;
+	bool timed_out;
+};
+
+static TatonnementRun
+run_tatonnement(
+	TatonnementManagementStructures& tatonnement, 
+	std::vector<Price>& prices, 
+	ApproximationParameters approx_params,
+	uint32_t timeout_ms)
+{
+	std::atomic<bool> cancel_timeout_thread = false;
+	std::atomic<bool> timeout_flag = false;
+
+	auto th = tatonnement.oracle.launch_timeout_thread(timeout_ms, timeout_flag, cancel_timeout_thread);
+
+	auto res = tatonnement.oracle.compute_prices_grid_search(
+		prices.data(), approx_params, tatonnement.rolling_averages.get_formatted_avgs());
+
+	cancel_timeout_thread = true;
+	if (th) {
+		th->join();
+	}
+	tatonnement.oracle.wait_for_all_tatonnement_threads();
+
+	return TatonnementRun{res, timeout_flag};
+}
+
+static void
+apply_block(OrderbookManager& manager, ExperimentBlock const& block)
+{
+	ProcessingSerialManager serial_manager(manager);
+	int dummyarg = 0;
+
+	std::vector<Offer> offers;
+	for (auto const& signed_tx : block) {
+		TatonnementPricePredictor::append_pending_offers(signed_tx, offers);
+
+		auto const& tx = signed_tx.transaction;
+		for (auto const& op : tx.operations) {
+			if (op.body.type() != CANCEL_SELL_OFFER) {
+				continue;
+			}
+			auto const& cancel = op.body.cancelSellOfferOp();
+			if (!manager.validate_category(cancel.category)) {
+				continue;
+			}
+			serial_manager.delete_offer(
+				manager.look_up_idx(cancel.category), 
+				cancel.minPrice, 
+				tx.metadata.sourceAccount, 
+				cancel.offerId);
+		}
+	}
+
+	for (auto const& offer : offers) {
+		if (!manager.validate_category(offer.category)) {
+			continue;
+		}
+		serial_manager.add_offer(manager.look_up_idx(offer.category), offer, dummyarg, dummyarg);
+	}
+	serial_manager.finish_merge();
+}
+
+int main(int argc, char const* const* argv)
+{
+	if (argc < 2 || argc > 6) {
+		std::printf("usage: tatonnement_prediction_bench <experiment_root> [collection_ms=500] [pending_fraction=0.5] [timeout_ms=2000] [max_blocks=1000]\n");
+		return 1;
+	}
+
+	std::string experiment_root = argv[1];
+	uint32_t collection_ms = (argc > 2) ? std::stoul(argv[2]) : 500;
+	double pending_fraction = (argc > 3) ? std::stod(argv[3]) : 0.5;
+	uint32_t timeout_ms = (argc > 4) ? std::stoul(argv[4]) : 2000;
+	uint64_t max_blocks = (argc > 5) ? std::stoull(argv[5]) : 1000;
+
+	ExperimentParameters params;
+	std::string params_filename = experiment_root + "/params";
+	if (load_xdr_from_file(params, params_filename.c_str())) {
+		throw std::runtime_error("failed to load " + params_filename);
+	}
+
+	uint16_t num_assets = params.num_assets;
+
+	OrderbookManager manager(num_assets);
+	TatonnementManagementStructures tatonnement(manager);
+	TatonnementPricePredictor predictor(num_assets);
+
+	ApproximationParameters approx_params {
+		.tax_rate = 10,
+		.smooth_mult = 15
+	};
+
+	std::vector<Price> prices(num_assets, price::from_double(1.0));
+
+	uint64_t num_blocks = 0;
+	uint64_t baseline_rounds = 0, predicted_rounds = 0;
+	uint32_t baseline_timeouts = 0, predicted_timeouts = 0, converged_predictions = 0;
+
+	for (uint64_t block_number = 1; block_number <= max_blocks; block_number++) {
+		xdr::opaque_vec<> vec;
+		ExperimentBlock block;
+		std::string filename = experiment_root + "/" + std::to_string(block_number) + ".txs";
+
+		if (load_xdr_from_file(vec, filename.c_str())) {
+			std::printf("no block %" PRIu64 ", stopping\n", block_number);
+			break;
+		}
+		xdr::xdr_from_opaque(vec, block);
+
+		std::vector<Offer> pending_offers;
+		size_t num_pending_txs = block.size() * pending_fraction;
+		for (size_t i = 0; i < num_pending_txs; i++) {
+			TatonnementPricePredictor::append_pending_offers(block[i], pending_offers);
+		}
+
+		predictor.start_prediction(
+			manager, pending_offers, prices, approx_params, 
+			tatonnement.rolling_averages.get_formatted_avgs());
+
+		// stand-in for the rest of transaction collection
+		std::this_thread::sleep_for(std::chrono::milliseconds(collection_ms));
+
+		apply_block(manager, block);
+
+		auto prediction = predictor.take_prediction();
+		if (!prediction) {
+			throw std::runtime_error("no prediction");
+		}
+
+		manager.commit_for_production(block_number);
+
+		std::vector<Price> predicted_prices = prediction->prices;
+
+		auto baseline = run_tatonnement(tatonnement, prices, approx_params, timeout_ms);
+		auto predicted = run_tatonnement(tatonnement, predicted_prices, approx_params, timeout_ms);
+
+		std::printf("block %" PRIu64 ": baseline rounds %" PRIu32 " (timeout %u) predicted rounds %" PRIu32 " (timeout %u) background rounds %" PRIu32 " (converged %u)\n",
+			block_number,
+			baseline.measurements.num_rounds, baseline.timed_out,
+			predicted.measurements.num_rounds, predicted.timed_out,
+			prediction->measurements.num_rounds, prediction->converged);
+
+		num_blocks++;
+		baseline_rounds += baseline.measurements.num_rounds;
+		predicted_rounds += predicted.measurements.num_rounds;
+		baseline_timeouts += baseline.timed_out;
+		predicted_timeouts += predicted.timed_out;
+		converged_predictions += prediction->converged;
+
+		auto lp_results = tatonnement.lp_solver.solve(prices.data(), approx_params, !baseline.timed_out);
+
+		tatonnement.rolling_averages.update_averages(lp_results, prices.data());
+
+		OrderbookStateCommitment clearing_details;
+		BlockStateUpdateStatsWrapper state_update_stats;
+		NullModificationLog null_log;
+		NullDB null_db;
+
+		manager.clear_offers_for_production(
+			lp_results, 
+			prices.data(), 
+			null_db, 
+			null_log, 
+			clearing_details, 
+			state_update_stats);
+	}
+
+	if (num_blocks == 0) {
+		std::printf("no blocks replayed\n");
+		return 1;
+	}
+
+	std::printf("blocks %" PRIu64 " collection_ms %" PRIu32 " pending_fraction %lf\n", num_blocks, collection_ms, pending_fraction);
+	std::printf("baseline:  avg rounds %lf timeouts %" PRIu32 "\n", ((double) baseline_rounds) / num_blocks, baseline_timeouts);
+	std::printf("predicted: avg rounds %lf timeouts %" PRIu32 "\n", ((double) predicted_rounds) / num_blocks, predicted_timeouts);
+	std::printf("avg rounds saved per block %lf, background runs converged %" PRIu32 "/%" PRIu64 "\n",
+		(((double) baseline_rounds) - ((double) predicted_rounds)) / num_blocks, converged_predictions, num_blocks);
+	return 0;
+}
@@ -0,0 +1,185 @@
+#include "block_processing/block_validator.h"
+
+#include "memory_database/memory_database.h"
+
+#include "modlog/log_merge_worker.h"
+
+#include "orderbook/commitment_checker.h"
+
+#include "speedex/speedex_management_structures.h"
+
+#include "stats/block_update_stats.h"
+
+#include "utils/transaction_type_formatter.h"
+
+#include <utils/time.h>
+
+#include <tbb/global_control.h>
+
+#include <algorithm>
+#include <cinttypes>
+#include <cstdio>
+#include <memory>
+#include <random>
+#include <string>
+#include <vector>
+
+using namespace speedex;
+
+/*
+Compares block validation with and without the FilterLog pre-pass.
+
+Valid blocks consist of num_txs payments from num_accounts accounts,
+each sending a run of consecutive sequence numbers.  Invalid blocks
+are the same block with one extra exact duplicate of a random tx
+appended at the end, so the conflict is only visible once the
+duplicate's account is processed.  With the pre-pass, invalid blocks 
+are rejected before any tx touches the database, and valid blocks are 
+applied account by account in sequence number order.
+*/
+
+constexpr static int64_t FUNDED_BALANCE = 1'000'000'000;
+
+static SignedTransaction
+make_bench_payment(AccountID src, uint64_t seqno, AccountID dst, int64_t amount)
+{
+	PaymentOp op;
+	op.receiver = dst;
+	op.asset = 1;
+	op.amount = amount;
+
+	SignedTransaction tx;
+	tx.transaction.metadata.sourceAccount = src;
+	tx.transaction.metadata.sequenceNumber = seqno * MAX_OPS_PER_TX;
+	tx.transaction.operations.push_back(tx_formatter::make_operation(op));
+	tx.transaction.maxFee = tx_formatter::compute_min_fee(tx);
+	return tx;
+}
+
+struct TrialResult {
+	bool res;
+	double validation_time;
+	double filter_time;
+};
+
+static TrialResult
+run_trial(bool use_precheck, bool make_invalid, uint64_t num_accounts, uint64_t num_txs, uint32_t seed)
+{
+	auto management_structures = std::make_unique<SpeedexManagementStructures>(
+		2,
+		ApproximationParameters{
+			.tax_rate = 10,
+			.smooth_mult = 10
+		},
+		SpeedexRuntimeConfigs{
+			.check_sigs = false
+		});
+
+	auto& db = management_structures->db;
+
+	MemoryDatabaseGenesisData data;
+	for (AccountID i = 0; i < num_accounts; i++) {
+		data.id_list.push_back(i);
+	}
+	data.pk_list.resize(data.id_list.size());
+
+	db.install_initial_accounts_and_commit(data, [&db] (UserAccount& user) {
+		db.transfer_available(&user, MemoryDatabase::NATIVE_ASSET, FUNDED_BALANCE);
+		db.transfer_available(&user, 1, FUNDED_BALANCE);
+		user.commit();
+	});
+
+	std::minstd_rand gen(seed);
+	std::uniform_int_distribution<AccountID> account_dist(0, num_accounts - 1);
+
+	std::vector<uint64_t> next_seqno(num_accounts, 1);
+	SignedTransactionList txs;
+
+	while (txs.size() < num_txs) {
+		AccountID src = account_dist(gen);
+		// stay inside the sequence number window
+		if (next_seqno[src] > MAX_SEQ_NUMS_PER_BLOCK) {
+			continue;
+		}
+		txs.push_back(make_bench_payment(src, next_seqno[src]++, account_dist(gen), 10));
+	}
+
+	std::shuffle(txs.begin(), txs.end(), gen);
+
+	if (make_invalid) {
+		std::uniform_int_distribution<size_t> idx_dist(0, txs.size() - 1);
+		SignedTransaction dup = txs[idx_dist(gen)];
+		txs.push_back(dup);
+	}
+
+	auto num_orderbooks = management_structures->orderbook_manager.get_num_orderbooks();
+
+	OrderbookStateCommitment clearing_details;
+	clearing_details.resize(num_orderbooks);
+
+	OrderbookStateCommitmentChecker commitment_checker(
+		clearing_details,
+		std::vector<Price>(2, 1),
+		management_structures->approx_params.tax_rate);
+
+	ThreadsafeValidationStatistics validation_stats(num_orderbooks);
+
+	LogMergeWorker worker(management_structures->account_modification_log);
+	BlockValidator validator(*management_structures, worker, use_precheck);
+
+	BlockValidationMeasurements measurements;
+	BlockStateUpdateStatsWrapper stats;
+
+	auto timestamp = utils::init_time_measurement();
+	bool res = validator.validate_transaction_block(
+		txs, commitment_checker, validation_stats, measurements, stats);
+	double validation_time = utils::measure_time(timestamp);
+
+	return TrialResult {
+		.res = res,
+		.validation_time = validation_time,
+		.filter_time = measurements.tx_validation_filter_time
+	};
+}
+
+int main(int argc, char const* const* argv)
+{
+	if (argc > 5) {
+		std::printf("usage: validation_precheck_bench [num_accounts=100000] [num_txs=500000] [num_trials=5] [num_threads=0]\n");
+		return 1;
+	}
+
+	uint64_t num_accounts = (argc > 1) ? std::stoull(argv[1]) : 100'000;
+	uint64_t num_txs = (argc > 2) ? std::stoull(argv[2]) : 500'000;
+	uint64_t num_trials = (argc > 3) ? std::stoull(argv[3]) : 5;
+	uint64_t num_threads = (argc > 4) ? std::stoull(argv[4]) : 0;
+
+	std::unique_ptr<tbb::global_control> control;
+	if (num_threads > 0) {
+		control = std::make_unique<tbb::global_control>(
+			tbb::global_control::max_allowed_parallelism, num_threads);
+	}
+
+	for (bool make_invalid : {false, true}) {
+		for (bool use_precheck : {false, true}) {
+			double validation_time = 0, filter_time = 0;
+			uint64_t num_accepted = 0;
+			for (uint64_t trial = 0; trial < num_trials; trial++) {
+				auto res = run_trial(use_precheck, make_invalid, num_accounts, num_txs, trial);
+				num_accepted += res.res;
+				validation_time += res.validation_time;
+				filter_time += res.filter_time;
+			}
+			double avg_time = validation_time / num_trials;
+			std::printf("%s block, precheck=%d: accepted %" PRIu64 "/%" PRIu64 " time %lf (filter %lf) txs/sec %lf\n",
+				make_invalid ? "invalid" : "valid",
+				use_precheck,
+				num_accepted,
+				num_trials,
+				avg_time,
+				filter_time / num_trials,
+				num_txs / avg_time);
+		}
+	}
+	return 0;
+}
@@ -0,0 +1,408 @@
+/**
+ * SPEEDEX: A Scalable, Parallelizable, and Economically Efficient Decentralized Exchange
+ * Copyright (C) 2023 Geoffrey Ramseyer
+
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "market_data/market_data_stream.h"
+
+#include "orderbook/utils.h"
+
+#include "utils/fixed_point_value.h"
+#include "utils/price.h"
+
+#include <utils/cleanup.h>
+
+#include <cstring>
+#include <stdexcept>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+namespace speedex {
+
+using detail::MarketDataRingHeader;
+using detail::MarketDataSlotHeader;
+
+namespace {
+
+constexpr static size_t SLOT_ALIGNMENT = 64;
+
+size_t
+round_up_to_alignment(size_t len) {
+	return ((len + SLOT_ALIGNMENT - 1) / SLOT_ALIGNMENT) * SLOT_ALIGNMENT;
+}
+
+size_t
+ring_offset() {
+	return round_up_to_alignment(sizeof(MarketDataRingHeader));
+}
+
+size_t
+compute_slot_size(uint32_t num_assets, uint32_t num_orderbooks) {
+	return round_up_to_alignment(
+		sizeof(MarketDataSlotHeader) 
+		+ num_assets * sizeof(Price) 
+		+ num_orderbooks * sizeof(MarketDataOrderbookRecord));
+}
+
+uint64_t
+read_uint64_big_endian(const unsigned char* buf) {
+	uint64_t out = 0;
+	for (size_t i = 0; i < sizeof(uint64_t); i++) {
+		out = (out << 8) | buf[i];
+	}
+	return out;
+}
+
+// FractionalSupply is a big endian FractionalAsset
+void
+split_fractional_supply(const FractionalSupply& supply, uint64_t& lo, uint64_t& hi) {
+	hi = read_uint64_big_endian(supply.data());
+	lo = read_uint64_big_endian(supply.data() + sizeof(uint64_t));
+}
+
+double
+fractional_to_double(uint64_t lo, uint64_t hi) {
+	FractionalAsset::value_t value = hi;
+	value = (value << 64) | lo;
+	return FractionalAsset::from_raw(value).to_double();
+}
+
+} /* anonymous namespace */
+
+static_assert(MarketDataOrderbookRecord::FRACTIONAL_RADIX == 10, 
+	"mismatch with FractionalAsset");
+
+double
+MarketDataOrderbookRecord::supply_activated_to_double() const {
+	return fractional_to_double(supply_activated_lo, supply_activated_hi);
+}
+
+double
+MarketDataOrderbookRecord::partial_exec_amount_to_double() const {
+	return fractional_to_double(partial_exec_amount_lo, partial_exec_amount_hi);
+}
+
+std::string
+MarketDataPublisher::replica_shm_name(uint32_t replica_id) {
+	return std::string(SHM_NAME_PREFIX) + std::to_string(replica_id);
+}
+
+MarketDataPublisher::MarketDataPublisher(
+	uint16_t num_assets, 
+	uint64_t num_slots,
+	std::string shm_name)
+	: utils::AsyncWorker()
+	, shm_name(shm_name)
+	, num_assets(num_assets)
+	, num_orderbooks(get_num_orderbooks_by_asset_count(num_assets))
+	, num_slots(num_slots)
+	, slot_size(compute_slot_size(num_assets, num_orderbooks))
+	, mapping_size(ring_offset() + num_slots * slot_size)
+	, mapping(nullptr)
+	, pending_records()
+	, write_in_progress(false)
+	, num_records(0)
+{
+	if (num_slots == 0) {
+		throw std::runtime_error("market data ring needs at least one slot");
+	}
+
+	// never reuse a segment from a previous run;
+	// readers still attached to it keep their mapping
+	shm_unlink(shm_name.c_str());
+
+	utils::unique_fd fd{shm_open(shm_name.c_str(), O_CREAT | O_EXCL | O_RDWR, S_IRUSR | S_IWUSR | S_IRGRP | S_IROTH)};
+	if (!fd) {
+		utils::threrror("failed to create market data segment");
+	}
+
+	// zero filled, so every slot starts at sequence 0
+	if (ftruncate(fd.get(), mapping_size)) {
+		utils::threrror("ftruncate");
+	}
+
+	void* addr = mmap(nullptr, mapping_size, PROT_READ | PROT_WRITE, MAP_SHARED, fd.get(), 0);
+	if (addr == MAP_FAILED) {
+		utils::threrror("mmap");
+	}
+	mapping = static_cast<unsigned char*>(addr);
+
+	auto& header = ring_header();
+	header.version = MarketDataRingHeader::VERSION;
+	header.num_assets = num_assets;
+	header.num_orderbooks = num_orderbooks;
+	header.num_slots = num_slots;
+	header.slot_size = slot_size;
+	header.num_records.store(0, std::memory_order_relaxed);
+	header.magic.store(MarketDataRingHeader::MAGIC, std::memory_order_release);
+
+	start_async_thread([this] {run();});
+}
+
+MarketDataPublisher::~MarketDataPublisher() {
+	flush();
+	terminate_worker();
+	munmap(mapping, mapping_size);
+	shm_unlink(shm_name.c_str());
+}
+
+MarketDataRingHeader&
+MarketDataPublisher::ring_header() {
+	return *reinterpret_cast<MarketDataRingHeader*>(mapping);
+}
+
+void
+MarketDataPublisher::publish(
+	HashedBlock const& block, 
+	BlockStateUpdateStats const& stats, 
+	MarketDataSource source) {
+
+	if (block.block.prices.size() != num_assets 
+		|| block.block.internalHashes.clearingDetails.size() != num_orderbooks) {
+		throw std::runtime_error("block does not match market data ring layout");
+	}
+
+	auto record = std::make_unique<PendingRecord>();
+	record -> block = block;
+	record -> stats = stats;
+	record -> source = source;
+
+	std::lock_guard lock(mtx);
+	pending_records.push_back(std::move(record));
+	cv.notify_all();
+}
+
+void
+MarketDataPublisher::flush() {
+	wait_for_async_task();
+}
+
+void
+MarketDataPublisher::run() {
+	while (true) {
+		std::unique_lock lock(mtx);
+		if ((!done_flag) && (!exists_work_to_do())) {
+			cv.wait(lock, [this] () {return done_flag || exists_work_to_do();});
+		}
+		if (done_flag) return;
+
+		auto records = std::move(pending_records);
+		pending_records.clear();
+		write_in_progress = true;
+		lock.unlock();
+
+		for (auto const& record : records) {
+			write_record(*record);
+		}
+
+		lock.lock();
+		write_in_progress = false;
+		cv.notify_all();
+	}
+}
+
+void
+MarketDataPublisher::write_record(PendingRecord const& record) {
+	unsigned char* slot = mapping + ring_offset() + (num_records % num_slots) * slot_size;
+
+	auto* header = reinterpret_cast<MarketDataSlotHeader*>(slot);
+	auto* prices = reinterpret_cast<Price*>(slot + sizeof(MarketDataSlotHeader));
+	auto* orderbooks = reinterpret_cast<MarketDataOrderbookRecord*>(
+		slot + sizeof(MarketDataSlotHeader) + num_assets * sizeof(Price));
+
+	header -> sequence.store(2 * num_records + 1, std::memory_order_relaxed);
+	std::atomic_thread_fence(std::memory_order_release);
+
+	auto const& block = record.block.block;
+
+	header -> block_number = block.blockNumber;
+	std::memcpy(header -> block_hash, record.block.hash.data(), sizeof(header -> block_hash));
+	header -> fee_rate = block.feeRate;
+	header -> source = record.source;
+	header -> new_offer_count = record.stats.new_offer_count;
+	header -> cancel_offer_count = record.stats.cancel_offer_count;
+	header -> fully_clear_offer_count = record.stats.fully_clear_offer_count;
+	header -> partial_clear_offer_count = record.stats.partial_clear_offer_count;
+	header -> payment_count = record.stats.payment_count;
+	header -> new_account_count = record.stats.new_account_count;
+
+	for (uint32_t i = 0; i < num_assets; i++) {
+		prices[i] = block.prices[i];
+	}
+
+	for (uint32_t i = 0; i < num_orderbooks; i++) {
+		auto const& commitment = block.internalHashes.clearingDetails[i];
+		auto category = category_from_idx(i, num_assets);
+
+		MarketDataOrderbookRecord out;
+		std::memset(&out, 0, sizeof(out));
+
+		out.sell_asset = category.sellAsset;
+		out.buy_asset = category.buyAsset;
+
+		split_fractional_supply(
+			commitment.fractionalSupplyActivated, out.supply_activated_lo, out.supply_activated_hi);
+		split_fractional_supply(
+			commitment.partialExecOfferActivationAmount, out.partial_exec_amount_lo, out.partial_exec_amount_hi);
+
+		out.has_threshold = !commitment.thresholdKeyIsNull;
+		if (out.has_threshold) {
+			const unsigned char* key = commitment.partialExecThresholdKey.data();
+			out.threshold_min_price = price::read_price_big_endian(key);
+			out.threshold_owner = read_uint64_big_endian(key + price::PRICE_BYTES);
+			out.threshold_offer_id = read_uint64_big_endian(key + price::PRICE_BYTES + sizeof(AccountID));
+		}
+
+		orderbooks[i] = out;
+	}
+
+	header -> sequence.store(2 * num_records + 2, std::memory_order_release);
+
+	num_records++;
+	ring_header().num_records.store(num_records, std::memory_order_release);
+}
+
+MarketDataReader::MarketDataReader(std::string shm_name)
+	: mapping_size(0)
+	, mapping(nullptr)
+	, num_assets(0)
+	, num_orderbooks(0)
+	, num_slots(0)
+	, slot_size(0)
+	, next_record(0)
+	, records_missed(0)
+{
+	utils::unique_fd fd{shm_open(shm_name.c_str(), O_RDONLY, 0)};
+	if (!fd) {
+		throw std::runtime_error("failed to open market data segment " + shm_name);
+	}
+
+	struct stat st;
+	if (fstat(fd.get(), &st)) {
+		utils::threrror("fstat");
+	}
+
+	mapping_size = st.st_size;
+	if (mapping_size < ring_offset()) {
+		throw std::runtime_error("market data segment too small");
+	}
+
+	void* addr = mmap(nullptr, mapping_size, PROT_READ, MAP_SHARED, fd.get(), 0);
+	if (addr == MAP_FAILED) {
+		utils::threrror("mmap");
+	}
+	mapping = static_cast<const unsigned char*>(addr);
+
+	auto const& header = ring_header();
+	if (header.magic.load(std::memory_order_acquire) != MarketDataRingHeader::MAGIC
+		|| header.version != MarketDataRingHeader::VERSION) {
+		munmap(addr, mapping_size);
+		throw std::runtime_error("not a market data segment");
+	}
+
+	num_assets = header.num_assets;
+	num_orderbooks = header.num_orderbooks;
+	num_slots = header.num_slots;
+	slot_size = header.slot_size;
+
+	if (num_slots == 0 
+		|| slot_size < compute_slot_size(num_assets, num_orderbooks)
+		|| ring_offset() + num_slots * slot_size > mapping_size) {
+		munmap(addr, mapping_size);
+		throw std::runtime_error("invalid market data segment layout");
+	}
+
+	uint64_t num_records = header.num_records.load(std::memory_order_acquire);
+	next_record = (num_records > num_slots) ? num_records - num_slots : 0;
+}
+
+MarketDataReader::~MarketDataReader() {
+	munmap(const_cast<unsigned char*>(mapping), mapping_size);
+}
+
+const MarketDataRingHeader&
+MarketDataReader::ring_header() const {
+	return *reinterpret_cast<const MarketDataRingHeader*>(mapping);
+}
+
+void
+MarketDataReader::seek_to_latest() {
+	uint64_t num_records = ring_header().num_records.load(std::memory_order_acquire);
+	next_record = (num_records > 0) ? num_records - 1 : 0;
+}
+
+bool
+MarketDataReader::try_read_next(MarketDataRecord& out) {
+	while (true) {
+		uint64_t num_records = ring_header().num_records.load(std::memory_order_acquire);
+
+		if (next_record >= num_records) {
+			return false;
+		}
+
+		if (num_records - next_record > num_slots) {
+			records_missed += (num_records - num_slots) - next_record;
+			next_record = num_records - num_slots;
+		}
+
+		const unsigned char* slot = mapping + ring_offset() + (next_record % num_slots) * slot_size;
+		auto const* header = reinterpret_cast<const MarketDataSlotHeader*>(slot);
+
+		const uint64_t expect = 2 * next_record + 2;
+
+		uint64_t seq_before = header -> sequence.load(std::memory_order_acquire);
+		if (seq_before < expect) {
+			return false;
+		}
+		if (seq_before != expect) {
+			// overwritten; the next pass skips ahead
+			continue;
+		}
+
+		out.block_number = header -> block_number;
+		std::memcpy(out.block_hash.data(), header -> block_hash, sizeof(header -> block_hash));
+		out.fee_rate = header -> fee_rate;
+		out.source = header -> source;
+		out.stats.new_offer_count = header -> new_offer_count;
+		out.stats.cancel_offer_count = header -> cancel_offer_count;
+		out.stats.fully_clear_offer_count = header -> fully_clear_offer_count;
+		out.stats.partial_clear_offer_count = header -> partial_clear_offer_count;
+		out.stats.payment_count = header -> payment_count;
+		out.stats.new_account_count = header -> new_account_count;
+
+		out.prices.resize(num_assets);
+		std::memcpy(out.prices.data(), slot + sizeof(MarketDataSlotHeader), num_assets * sizeof(Price));
+
+		out.orderbooks.resize(num_orderbooks);
+		std::memcpy(out.orderbooks.data(), 
+			slot + sizeof(MarketDataSlotHeader) + num_assets * sizeof(Price), 
+			num_orderbooks * sizeof(MarketDataOrderbookRecord));
+
+		std::atomic_thread_fence(std::memory_order_acquire);
+
+		if (header -> sequence.load(std::memory_order_relaxed) != seq_before) {
+			continue;
+		}
+
+		next_record++;
+		return true;
+	}
+}
+
+} /* speedex */
@@ -0,0 +1,274 @@
+/**
+ * SPEEDEX: A Scalable, Parallelizable, and Economically Efficient Decentralized Exchange
+ * Copyright (C) 2023 Geoffrey Ramseyer
+
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#pragma once
+
+/*! \file market_data_stream.h
+
+Shared-memory stream of per-block market data (clearing prices,
+per-orderbook trade volumes, partial execution thresholds, and
+block state update stats), for local consumers that would otherwise
+poll block headers.
+
+One producer (the node) writes into a ring of fixed-size slots in a POSIX
+shared memory segment; any number of local readers map the segment
+read-only and follow along.  Readers never block the producer.
+A reader that falls more than a ring's length behind skips ahead
+to the oldest record still in the ring.
+
+Block production and validation only copy the block header into
+a queue (MarketDataPublisher::publish()).  A background thread
+formats records into the ring.
+
+Layout of the segment:
+ - a MarketDataRingHeader,
+ - num_slots slots of slot_size bytes each.  Each slot is a
+   MarketDataSlotHeader, then num_assets Prices, then num_orderbooks
+   MarketDataOrderbookRecords (indexed as in orderbook/utils.h).
+
+Slots are guarded by a seqlock.  Record i lives in slot (i % num_slots).
+While being written its slot's sequence is 2i+1, and afterwards 2i+2.
+*/
+
+#include "xdr/block.h"
+
+#include <utils/async_worker.h>
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <vector>
+
+namespace speedex {
+
+enum class MarketDataSource : uint32_t {
+	PRODUCED = 0,
+	VALIDATED = 1
+};
+
+namespace detail {
+
+struct MarketDataRingHeader {
+	constexpr static uint32_t MAGIC = 0x4D4B5444; // "MKTD"
+	constexpr static uint32_t VERSION = 1;
+
+	//! Written last when the segment is created.
+	std::atomic<uint32_t> magic;
+	uint32_t version;
+	uint32_t num_assets;
+	uint32_t num_orderbooks;
+	uint64_t num_slots;
+	uint64_t slot_size;
+
+	//! Number of records fully written.
+	std::atomic<uint64_t> num_records;
+};
+
+struct MarketDataSlotHeader {
+	std::atomic<uint64_t> sequence;
+	uint64_t block_number;
+	uint8_t block_hash[32];
+	uint32_t fee_rate;
+	MarketDataSource source;
+
+	// BlockStateUpdateStats
+	uint32_t new_offer_count;
+	uint32_t cancel_offer_count;
+	uint32_t fully_clear_offer_count;
+	uint32_t partial_clear_offer_count;
+	uint32_t payment_count;
+	uint32_t new_account_count;
+};
+
+static_assert(std::atomic<uint64_t>::is_always_lock_free, 
+	"shared memory seqlock needs lock-free atomics");
+static_assert(sizeof(MarketDataRingHeader) == 40, "unexpected padding");
+static_assert(sizeof(MarketDataSlotHeader) == 80, "unexpected padding");
+
+} /* detail */
+
+/*! One orderbook's clearing in a block.
+
+Fixed point amounts are FractionalAsset raw values (radix 
+FRACTIONAL_RADIX), split into low and high 64 bit words.
+*/
+struct MarketDataOrderbookRecord {
+	constexpr static uint32_t FRACTIONAL_RADIX = 10;
+
+	uint32_t sell_asset;
+	uint32_t buy_asset;
+
+	//! Amount of the sell asset sold in this orderbook.
+	uint64_t supply_activated_lo;
+	uint64_t supply_activated_hi;
+
+	//! Amount of the partially executed offer's sell asset that was sold.
+	uint64_t partial_exec_amount_lo;
+	uint64_t partial_exec_amount_hi;
+
+	//! Offers strictly below the threshold (in key order) fully execute,
+	//! and the threshold offer partially executes.
+	//! Only meaningful if has_threshold.
+	uint64_t threshold_min_price;
+	uint64_t threshold_owner;
+	uint64_t threshold_offer_id;
+	uint32_t has_threshold;
+	uint32_t padding;
+
+	double supply_activated_to_double() const;
+	double partial_exec_amount_to_double() const;
+};
+
+static_assert(sizeof(MarketDataOrderbookRecord) == 72, "unexpected padding");
+
+//! A reader's copy of one block's record.
+struct MarketDataRecord {
+	uint64_t block_number;
+	Hash block_hash;
+	uint32_t fee_rate;
+	MarketDataSource source;
+	BlockStateUpdateStats stats;
+	std::vector<Price> prices;
+	std::vector<MarketDataOrderbookRecord> orderbooks;
+};
+
+/*! Writes block market data into the shared memory ring.
+
+Each replica publishes to its own segment (replica_shm_name()), so
+replicas sharing a host do not overwrite each other's rings.
+Creating a publisher replaces any existing segment of the same name
+(readers attached to the old segment must reopen).
+The segment is unlinked when the publisher is destroyed.
+*/
+class MarketDataPublisher : public utils::AsyncWorker {
+
+	using utils::AsyncWorker::mtx;
+	using utils::AsyncWorker::cv;
+
+	struct PendingRecord {
+		HashedBlock block;
+		BlockStateUpdateStats stats;
+		MarketDataSource source;
+	};
+
+	const std::string shm_name;
+	const uint32_t num_assets;
+	const uint32_t num_orderbooks;
+	const uint64_t num_slots;
+	const uint64_t slot_size;
+
+	size_t mapping_size;
+	unsigned char* mapping;
+
+	// shared with callers, protected by mtx
+	std::vector<std::unique_ptr<PendingRecord>> pending_records;
+	bool write_in_progress;
+
+	// owned by the background thread
+	uint64_t num_records;
+
+	bool exists_work_to_do() override final {
+		return pending_records.size() > 0 || write_in_progress;
+	}
+
+	void run();
+
+	void write_record(PendingRecord const& record);
+
+	detail::MarketDataRingHeader& ring_header();
+
+public:
+
+	constexpr static char SHM_NAME_PREFIX[] = "/speedex_market_data_";
+	constexpr static uint64_t DEFAULT_NUM_SLOTS = 1024;
+
+	//! Name of the segment that a replica publishes to.
+	static std::string replica_shm_name(uint32_t replica_id);
+
+	MarketDataPublisher(
+		uint16_t num_assets, 
+		uint64_t num_slots,
+		std::string shm_name);
+
+	//! Writes any records that are still queued.
+	~MarketDataPublisher();
+
+	/*! Queue a block's market data.  Copies the input and returns
+	immediately; records are written in the background.
+	Per-orderbook data comes from block.internalHashes.clearingDetails.
+	*/
+	void publish(
+		HashedBlock const& block, 
+		BlockStateUpdateStats const& stats, 
+		MarketDataSource source);
+
+	//! Wait until every queued record is visible to readers.
+	void flush();
+};
+
+/*! Follows a MarketDataPublisher's ring from another thread or process.
+*/
+class MarketDataReader {
+
+	size_t mapping_size;
+	const unsigned char* mapping;
+
+	uint32_t num_assets;
+	uint32_t num_orderbooks;
+	uint64_t num_slots;
+	uint64_t slot_size;
+
+	uint64_t next_record;
+	uint64_t records_missed;
+
+	const detail::MarketDataRingHeader& ring_header() const;
+
+public:
+
+	//! Throws if the segment does not exist or is not a market data ring.
+	//! Starts from the oldest record still in the ring.
+	MarketDataReader(std::string shm_name);
+
+	~MarketDataReader();
+
+	MarketDataReader(const MarketDataReader&) = delete;
+	MarketDataReader& operator=(const MarketDataReader&) = delete;
+
+	//! Skip to the newest record.
+	void seek_to_latest();
+
+	//! Read the next record.  Returns false if the reader is caught up.
+	bool try_read_next(MarketDataRecord& out);
+
+	uint32_t get_num_assets() const {
+		return num_assets;
+	}
+
+	uint32_t get_num_orderbooks() const {
+		return num_orderbooks;
+	}
+
+	//! Number of records overwritten before this reader could read them.
+	uint64_t get_records_missed() const {
+		return records_missed;
+	}
+};
+
+} /* speedex */
@@ -0,0 +1,225 @@
+#include <catch2/catch_test_macros.hpp>
+
+#include "market_data/market_data_stream.h"
+
+#include "orderbook/utils.h"
+
+#include "utils/price.h"
+
+#include <cstring>
+#include <thread>
+
+namespace speedex
+{
+
+static const std::string test_shm_name = "/speedex_market_data_test";
+
+void
+write_uint64_big_endian(unsigned char* buf, uint64_t value)
+{
+	for (size_t i = 0; i < sizeof(uint64_t); i++)
+	{
+		buf[i] = (value >> (8 * (sizeof(uint64_t) - i - 1))) & 0xFF;
+	}
+}
+
+HashedBlock
+make_block(uint64_t block_number, uint16_t num_assets)
+{
+	HashedBlock out;
+	out.block.blockNumber = block_number;
+	out.block.feeRate = 10;
+	out.hash[0] = block_number;
+
+	for (uint16_t i = 0; i < num_assets; i++)
+	{
+		out.block.prices.push_back(price::from_double(1.0 + i + block_number));
+	}
+
+	for (uint32_t i = 0; i < get_num_orderbooks_by_asset_count(num_assets); i++)
+	{
+		SingleOrderbookStateCommitment c;
+		std::memset(&c, 0, sizeof(c));
+
+		// 2^64 + block_number + i, radix 10
+		c.fractionalSupplyActivated[7] = 1;
+		write_uint64_big_endian(c.fractionalSupplyActivated.data() + 8, block_number + i);
+
+		c.thresholdKeyIsNull = (i % 2);
+		if (!c.thresholdKeyIsNull)
+		{
+			price::write_price_big_endian(c.partialExecThresholdKey.data(), price::from_double(2.0));
+			write_uint64_big_endian(c.partialExecThresholdKey.data() + price::PRICE_BYTES, i);
+			write_uint64_big_endian(c.partialExecThresholdKey.data() + price::PRICE_BYTES + 8, block_number);
+			write_uint64_big_endian(c.partialExecOfferActivationAmount.data() + 8, 3 << MarketDataOrderbookRecord::FRACTIONAL_RADIX);
+		}
+		out.block.internalHashes.clearingDetails.push_back(c);
+	}
+	return out;
+}
+
+void
+check_record(MarketDataRecord const& r, uint64_t block_number, uint16_t num_assets)
+{
+	auto expect = make_block(block_number, num_assets);
+
+	REQUIRE(r.block_number == block_number);
+	REQUIRE(r.block_hash == expect.hash);
+	REQUIRE(r.fee_rate == 10);
+	REQUIRE(r.source == MarketDataSource::PRODUCED);
+	REQUIRE(r.stats.new_offer_count == block_number);
+
+	REQUIRE(r.prices.size() == num_assets);
+	for (uint16_t i = 0; i < num_assets; i++)
+	{
+		REQUIRE(r.prices[i] == expect.block.prices[i]);
+	}
+
+	REQUIRE(r.orderbooks.size() == get_num_orderbooks_by_asset_count(num_assets));
+	for (uint32_t i = 0; i < r.orderbooks.size(); i++)
+	{
+		auto const& ob = r.orderbooks[i];
+		auto category = category_from_idx(i, num_assets);
+
+		REQUIRE(ob.sell_asset == category.sellAsset);
+		REQUIRE(ob.buy_asset == category.buyAsset);
+		REQUIRE(ob.supply_activated_hi == 1);
+		REQUIRE(ob.supply_activated_lo == block_number + i);
+		REQUIRE(ob.has_threshold == ((i % 2) == 0));
+		if (ob.has_threshold)
+		{
+			REQUIRE(ob.threshold_min_price == price::from_double(2.0));
+			REQUIRE(ob.threshold_owner == i);
+			REQUIRE(ob.threshold_offer_id == block_number);
+			REQUIRE(ob.partial_exec_amount_to_double() == 3.0);
+		}
+	}
+}
+
+TEST_CASE("market data stream roundtrip", "[market_data]")
+{
+	const uint16_t num_assets = 5;
+
+	BlockStateUpdateStats stats;
+	std::memset(&stats, 0, sizeof(stats));
+
+	auto publish = [&] (MarketDataPublisher& publisher, uint64_t block_number)
+	{
+		stats.new_offer_count = block_number;
+		publisher.publish(make_block(block_number, num_assets), stats, MarketDataSource::PRODUCED);
+	};
+
+	SECTION("in order")
+	{
+		MarketDataPublisher publisher(num_assets, 16, test_shm_name);
+		MarketDataReader reader(test_shm_name);
+
+		REQUIRE(reader.get_num_assets() == num_assets);
+
+		MarketDataRecord r;
+		REQUIRE(!reader.try_read_next(r));
+
+		for (uint64_t i = 1; i <= 10; i++)
+		{
+			publish(publisher, i);
+		}
+		publisher.flush();
+
+		for (uint64_t i = 1; i <= 10; i++)
+		{
+			REQUIRE(reader.try_read_next(r));
+			check_record(r, i, num_assets);
+		}
+		REQUIRE(!reader.try_read_next(r));
+		REQUIRE(reader.get_records_missed() == 0);
+	}
+
+	SECTION("lapped reader")
+	{
+		MarketDataPublisher publisher(num_assets, 4, test_shm_name);
+		MarketDataReader reader(test_shm_name);
+
+		for (uint64_t i = 1; i <= 10; i++)
+		{
+			publish(publisher, i);
+		}
+		publisher.flush();
+
+		MarketDataRecord r;
+		for (uint64_t i = 7; i <= 10; i++)
+		{
+			REQUIRE(reader.try_read_next(r));
+			check_record(r, i, num_assets);
+		}
+		REQUIRE(!reader.try_read_next(r));
+		REQUIRE(reader.get_records_missed() == 6);
+
+		MarketDataReader late_reader(test_shm_name);
+		late_reader.seek_to_latest();
+		REQUIRE(late_reader.try_read_next(r));
+		check_record(r, 10, num_assets);
+		REQUIRE(!late_reader.try_read_next(r));
+	}
+
+	SECTION("concurrent reader")
+	{
+		MarketDataPublisher publisher(num_assets, 8, test_shm_name);
+		MarketDataReader reader(test_shm_name);
+
+		const uint64_t num_blocks = 1000;
+
+		std::thread th([&] ()
+		{
+			for (uint64_t i = 1; i <= num_blocks; i++)
+			{
+				publish(publisher, i);
+			}
+		});
+
+		MarketDataRecord r;
+		uint64_t prev = 0;
+		while (prev < num_blocks)
+		{
+			if (!reader.try_read_next(r))
+			{
+				continue;
+			}
+			REQUIRE(r.block_number > prev);
+			check_record(r, r.block_number, num_assets);
+			prev = r.block_number;
+		}
+		th.join();
+
+		REQUIRE(reader.get_records_missed() + 1 <= num_blocks);
+	}
+
+	SECTION("segment removed with publisher")
+	{
+		{
+			MarketDataPublisher publisher(num_assets, 4, test_shm_name);
+		}
+		REQUIRE_THROWS(MarketDataReader(test_shm_name));
+	}
+
+	SECTION("replicas publish to separate segments")
+	{
+		REQUIRE(MarketDataPublisher::replica_shm_name(0) != MarketDataPublisher::replica_shm_name(1));
+
+		const auto name_a = std::string(test_shm_name) + "_a";
+		const auto name_b = std::string(test_shm_name) + "_b";
+
+		MarketDataPublisher publisher_a(num_assets, 4, name_a);
+		MarketDataPublisher publisher_b(num_assets, 4, name_b);
+		MarketDataReader reader_a(name_a);
+		MarketDataReader reader_b(name_b);
+
+		publish(publisher_a, 1);
+		publisher_a.flush();
+
+		MarketDataRecord r;
+		REQUIRE(reader_a.try_read_next(r));
+		REQUIRE(!reader_b.try_read_next(r));
+	}
+}
+
+} /* speedex */
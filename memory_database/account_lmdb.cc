@@ -22,10 +22,18 @@
 
 #include "speedex/speedex_static_configs.h"
 
+#include "utils/manage_data_dirs.h"
+
+#include <algorithm>
+#include <bit>
 #include <cinttypes>
+#include <filesystem>
+
+#include <tbb/parallel_for.h>
 
 #include "config.h"
 
+#include <utils/mkdir.h>
 #include <utils/time.h>
 
 using lmdb::dbval;
@@ -37,7 +45,7 @@ namespace detail
 {
 
 void
-AccountLMDBShard::load_hash_key()
+AccountLMDBShard::load_metadata()
 {
 	auto rtx = rbegin();
 
@@ -56,14 +64,38 @@ AccountLMDBShard::load_hash_key()
 	}
 
 	std::memcpy(HASH_KEY, bytes.data(), bytes.size());
+
+	auto num_shards_val = rtx.get(get_metadata_dbi(), dbval("num shards"));
+
+	if (!num_shards_val)
+	{
+		// databases from before the shard count was recorded
+		num_shards = NUM_ACCOUNT_DB_SHARDS;
+	}
+	else
+	{
+		auto num_shards_bytes = num_shards_val->bytes();
+		if (num_shards_bytes.size() != sizeof(uint32_t))
+		{
+			throw std::runtime_error("saved shard count has wrong length");
+		}
+		std::memcpy(&num_shards, num_shards_bytes.data(), sizeof(uint32_t));
+	}
+
+	if (idx >= num_shards)
+	{
+		throw std::runtime_error("shard idx exceeds saved shard count");
+	}
 }
 
-AccountLMDBShard::AccountLMDBShard(uint32_t idx) 
+AccountLMDBShard::AccountLMDBShard(uint32_t idx, uint32_t num_shards, std::string const& base_dir) 
 	: LMDBInstance(0x1'0000'0000)
 	, idx(idx)
 	, DB_NAME("account_db" + std::to_string(idx))
+	, base_dir(base_dir)
+	, num_shards(num_shards)
  {
- 	if (idx >= NUM_ACCOUNT_DB_SHARDS)
+ 	if (idx >= num_shards)
  	{
  		throw std::runtime_error("invalid shard idx");
  	}
@@ -71,8 +103,10 @@ AccountLMDBShard::AccountLMDBShard(uint32_t idx)
 
 void 
 AccountLMDBShard::open_env() {
-	LMDBInstance::open_env(
-		std::string(ROOT_DB_DIRECTORY) + std::string(ACCOUNT_DB) + std::to_string(idx) + "/");
+	std::string dir = base_dir + std::to_string(idx) + "/";
+	utils::mkdir_safe(base_dir.c_str());
+	utils::mkdir_safe(dir.c_str());
+	LMDBInstance::open_env(dir);
 }
 
 void 
@@ -80,15 +114,42 @@ AccountLMDBShard::create_db(const uint8_t* hash_key) {
 	LMDBInstance::create_db(DB_NAME.c_str());
 
 	std::memcpy(HASH_KEY, hash_key, crypto_shorthash_KEYBYTES);
+
+	auto wtx = wbegin();
+
+	dbval hash_key_name("hash key");
+	dbval hash_key_val{HASH_KEY, crypto_shorthash_KEYBYTES};
+	wtx.put(get_metadata_dbi(), &hash_key_name, &hash_key_val);
+
+	dbval num_shards_name("num shards");
+	dbval num_shards_val{&num_shards, sizeof(uint32_t)};
+	wtx.put(get_metadata_dbi(), &num_shards_name, &num_shards_val);
+
+	commit_wtxn(wtx, get_persisted_round_number());
 }
 
 void 
 AccountLMDBShard::open_db() {
 	LMDBInstance::open_db(DB_NAME.c_str());
-	load_hash_key();
+	load_metadata();
+}
+
+std::optional<uint32_t>
+read_stored_num_shards(std::string const& base_dir)
+{
+	if (!std::filesystem::exists(base_dir + "0/data.mdb"))
+	{
+		return std::nullopt;
+	}
+	// shard 0 exists in every database, so the placeholder count of 1 is
+	// valid until open_db() loads the real one.
+	AccountLMDBShard shard(0, 1, base_dir);
+	shard.open_env();
+	shard.open_db();
+	return shard.get_num_shards();
 }
 
-uint32_t get_shard(const AccountID& account, const uint8_t* HASH_KEY)
+uint32_t get_shard(const AccountID& account, const uint8_t* HASH_KEY, uint32_t num_shards)
 {
 	static_assert(crypto_shorthash_BYTES == 8);
 
@@ -104,14 +165,14 @@ uint32_t get_shard(const AccountID& account, const uint8_t* HASH_KEY)
 
     // https://lemire.me/blog/2016/06/27/a-fast-alternative-to-the-modulo-reduction
     return ((hash_out & 0xFFFF'FFFF) /* 32 bits */
-            * static_cast<uint64_t>(NUM_ACCOUNT_DB_SHARDS))
+            * static_cast<uint64_t>(num_shards))
            >> 32;
 }
 
 bool 
 AccountLMDBShard::owns_account(const AccountID account) const
 {
-    uint32_t account_idx = get_shard(account, HASH_KEY);
+    uint32_t account_idx = get_shard(account, HASH_KEY, num_shards);
 
     return account_idx == idx;
 }
@@ -164,6 +225,82 @@ AsyncAccountLMDBShardWorker::exec_one_thunk(
 	current_block_number = thunk.current_block_number;
 }
 
+namespace
+{
+
+//! lmdb compares keys with memcmp, and accounts are keyed by their
+//! native-endian bytes.
+uint64_t
+lmdb_key_order(AccountID const& account)
+{
+	if constexpr (std::endian::native == std::endian::little)
+	{
+		return __builtin_bswap64(account);
+	}
+	return account;
+}
+
+} /* anonymous namespace */
+
+void
+AsyncAccountLMDBShardWorker::batch_one_thunk(
+	const DBPersistenceThunk& thunk,
+	uint64_t& current_block_number)
+{
+	if (thunk.current_block_number < current_block_number + 1 && current_block_number != 0) {
+		throw std::runtime_error("can't persist blocks in wrong order!!!");
+	}
+
+	size_t thunk_sz = thunk.kvs ->size();
+	for (size_t i = 0; i < thunk_sz; i++) {
+
+		ThunkKVPair const& kv = (*thunk.kvs)[i];
+
+		if (!shard.owns_account(kv.key))
+		{
+			continue;
+		}
+
+		if (!(kv.msg.size())) {
+			std::printf("missing value for kv %" PRIu64 "\n", kv.key);
+			std::printf("thunk.kvs.size() = %" PRIu32 "\n", static_cast<uint32_t>(thunk.kvs->size()));
+			throw std::runtime_error("failed to accumulate value in persistence thunk");
+		}
+
+		batch.push_back(BatchedKV{lmdb_key_order(kv.key), &kv});
+	}
+	current_block_number = thunk.current_block_number;
+}
+
+void
+AsyncAccountLMDBShardWorker::write_batch(lmdb::dbenv::wtxn& wtx)
+{
+	// Thunks are gathered in block order, and a stable sort keeps that order
+	// among writes to the same key.  Mod log output is already nearly sorted
+	// (up to the byte order of the key), so this is cheap.
+	std::stable_sort(batch.begin(), batch.end(),
+		[] (BatchedKV const& a, BatchedKV const& b) {
+			return a.sort_key < b.sort_key;
+		});
+
+	for (size_t i = 0; i < batch.size(); i++)
+	{
+		if (i + 1 < batch.size() && batch[i+1].sort_key == batch[i].sort_key)
+		{
+			// overwritten by a later block
+			continue;
+		}
+
+		ThunkKVPair const& kv = *batch[i].kv;
+
+		dbval key = dbval{&kv.key, sizeof(AccountID)};
+		dbval val = dbval{kv.msg.data(), kv.msg.size()};
+
+		wtx.put(shard.get_data_dbi(), &key, &val);
+	}
+	batch.clear();
+}
+
 void
 AsyncAccountLMDBShardWorker::exec_thunks()
 {
@@ -190,7 +327,18 @@ AsyncAccountLMDBShardWorker::exec_thunks()
 				continue;
 			}
 		}
-		exec_one_thunk(thunk, wtx, current_block_number);
+		if (batch_writes)
+		{
+			batch_one_thunk(thunk, current_block_number);
+		} else
+		{
+			exec_one_thunk(thunk, wtx, current_block_number);
+		}
+	}
+
+	if (batch_writes)
+	{
+		write_batch(wtx);
 	}
 
 	if (current_block_number > max_round_number)
@@ -263,17 +411,45 @@ AsyncFsyncWorker::call_fsync()
 } /* detail */
 
 AccountLMDB::AccountLMDB()
-	: shards()
+	: AccountLMDB(NUM_ACCOUNT_DB_SHARDS)
+	{}
+
+AccountLMDB::AccountLMDB(uint32_t num_shards_if_new)
+	: AccountLMDB(num_shards_if_new, BATCH_LMDB_PERSISTENCE)
+	{}
+
+AccountLMDB::AccountLMDB(uint32_t num_shards_if_new, bool batch_writes)
+	: num_shards_if_new(num_shards_if_new)
+	, batch_writes(batch_writes)
+	, shards()
 	, workers()
 	{
-		for (uint32_t i = 0; i < NUM_ACCOUNT_DB_SHARDS; i++)
+		if (num_shards_if_new == 0)
 		{
-			shards.emplace_back(std::make_unique<detail::AccountLMDBShard>(i));
-			workers.emplace_back(std::make_unique<detail::AsyncAccountLMDBShardWorker>(*shards.back()));
-			syncers.emplace_back(std::make_unique<detail::AsyncFsyncWorker>(*shards.back()));
+			throw std::runtime_error("need at least one account db shard");
 		}
 	}
 
+void
+AccountLMDB::init_shards(uint32_t num_shards)
+{
+	for (uint32_t i = 0; i < num_shards; i++)
+	{
+		shards.emplace_back(std::make_unique<detail::AccountLMDBShard>(i, num_shards, memory_database_lmdb_dir()));
+		workers.emplace_back(std::make_unique<detail::AsyncAccountLMDBShardWorker>(*shards.back(), batch_writes));
+		syncers.emplace_back(std::make_unique<detail::AsyncFsyncWorker>(*shards.back()));
+	}
+}
+
+void
+AccountLMDB::clear_shards()
+{
+	// workers reference shards, so must go first
+	workers.clear();
+	syncers.clear();
+	shards.clear();
+}
+
 
 void
 AccountLMDB::wait_for_all_workers()
@@ -331,6 +507,27 @@ AccountLMDB::open_db()
 void
 AccountLMDB::open_env()
 {
+	std::lock_guard lock(mtx);
+
+	if (shards.size() > 0)
+	{
+		throw std::runtime_error("account lmdb env already opened");
+	}
+
+	recover_memory_database_lmdb_dirs();
+
+	auto stored_num_shards = detail::read_stored_num_shards(memory_database_lmdb_dir());
+
+	uint32_t num_shards = stored_num_shards.value_or(num_shards_if_new);
+
+	if (num_shards != num_shards_if_new)
+	{
+		std::printf("opening account db with its stored shard count %" PRIu32 " (not %" PRIu32 ")\n",
+			num_shards, num_shards_if_new);
+	}
+
+	init_shards(num_shards);
+
 	for (auto& shard : shards)
 	{
 		shard -> open_env();
@@ -378,7 +575,7 @@ AccountLMDB::sync()
 uint64_t 
 AccountLMDB::get_persisted_round_number_by_account(const AccountID& account) const
 {
-	uint32_t shard = detail::get_shard(account, HASH_KEY);
+	uint32_t shard = detail::get_shard(account, HASH_KEY, shards.size());
 
 	return shards.at(shard)->get_persisted_round_number();
 }
@@ -418,5 +615,115 @@ AccountLMDB::assert_snapshot_and_get_persisted_round_number() const
 	return min_persisted_round_number;
 } 
 
+void
+AccountLMDB::reshard(uint32_t new_num_shards)
+{
+	std::lock_guard lock(mtx);
+
+	if (!opened)
+	{
+		throw std::runtime_error("can't reshard unopened account db");
+	}
+	if (new_num_shards == 0)
+	{
+		throw std::runtime_error("need at least one account db shard");
+	}
+	if (min_persisted_round_number != max_persisted_round_number)
+	{
+		throw std::runtime_error("can't reshard db with shards at different rounds");
+	}
+
+	auto ts = utils::init_time_measurement();
+
+	const uint64_t round_number = max_persisted_round_number;
+	const uint32_t old_num_shards = shards.size();
+
+	wait_for_all_workers();
+	wait_for_all_syncers();
+
+	clear_memory_database_lmdb_staging_dir();
+
+	std::vector<std::unique_ptr<detail::AccountLMDBShard>> new_shards;
+	for (uint32_t i = 0; i < new_num_shards; i++)
+	{
+		new_shards.emplace_back(std::make_unique<detail::AccountLMDBShard>(
+			i, new_num_shards, memory_database_lmdb_staging_dir()));
+		new_shards.back()->open_env();
+		new_shards.back()->create_db(HASH_KEY);
+	}
+
+	// buckets[old][new] holds the records moving from one shard to another.
+	using record_t = std::pair<AccountID, xdr::opaque_vec<>>;
+	std::vector<std::vector<std::vector<record_t>>> buckets(old_num_shards);
+
+	tbb::parallel_for(
+		tbb::blocked_range<uint32_t>(0, old_num_shards),
+		[&] (auto r) {
+			for (auto i = r.begin(); i < r.end(); i++)
+			{
+				buckets[i].resize(new_num_shards);
+
+				auto rtx = shards[i]->rbegin();
+				auto cursor = rtx.cursor_open(shards[i]->get_data_dbi());
+
+				cursor.get(MDB_FIRST);
+				while (cursor) {
+					auto& kv = *cursor;
+
+					auto key_bytes = kv.first.bytes();
+					if (key_bytes.size() != sizeof(AccountID))
+					{
+						throw std::runtime_error("invalid account key length");
+					}
+					AccountID account;
+					std::memcpy(&account, key_bytes.data(), sizeof(AccountID));
+
+					auto val_bytes = kv.second.bytes();
+
+					buckets[i][detail::get_shard(account, HASH_KEY, new_num_shards)].emplace_back(
+						account, xdr::opaque_vec<>(val_bytes.data(), val_bytes.data() + val_bytes.size()));
+					++cursor;
+				}
+			}
+		});
+
+	tbb::parallel_for(
+		tbb::blocked_range<uint32_t>(0, new_num_shards),
+		[&] (auto r) {
+			for (auto j = r.begin(); j < r.end(); j++)
+			{
+				auto wtx = new_shards[j]->wbegin();
+				for (uint32_t i = 0; i < old_num_shards; i++)
+				{
+					for (auto const& [account, msg] : buckets[i][j])
+					{
+						dbval key = dbval{&account, sizeof(AccountID)};
+						dbval val = dbval{msg.data(), msg.size()};
+						wtx.put(new_shards[j]->get_data_dbi(), &key, &val);
+					}
+				}
+				new_shards[j]->commit_wtxn(wtx, round_number, true);
+			}
+		});
+
+	buckets.clear();
+	new_shards.clear();
+	clear_shards();
+
+	// A crash before the swap leaves the old db in place, and one after
+	// leaves the new db.  open_env() clears whatever is left in staging.
+	swap_in_memory_database_lmdb_staging_dir();
+
+	init_shards(new_num_shards);
+	for (auto& shard : shards)
+	{
+		shard->open_env();
+		shard->open_db();
+	}
+
+	std::printf("resharded account db from %" PRIu32 " to %" PRIu32 " shards in %lf s\n",
+		old_num_shards, new_num_shards, utils::measure_time(ts));
+}
+
 
 } /* speedex */
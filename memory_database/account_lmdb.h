@@ -23,6 +23,9 @@
 #include <cstdint>
 #include <memory>
 #include <mutex>
+#include <optional>
+#include <string>
+#include <vector>
 
 #include "lmdb/lmdb_wrapper.h"
 
@@ -36,11 +39,12 @@ namespace speedex
 {
 
 class DBPersistenceThunk;
+struct ThunkKVPair;
 
 namespace detail
 {
 
-uint32_t get_shard(AccountID const& account, const uint8_t* HASH_KEY);
+uint32_t get_shard(AccountID const& account, const uint8_t* HASH_KEY, uint32_t num_shards);
 
 class AccountLMDBShard : public lmdb::LMDBInstance, utils::NonMovableOrCopyable
 {
@@ -50,17 +54,24 @@ class AccountLMDBShard : public lmdb::LMDBInstance, utils::NonMovableOrCopyable
 	
 	private:
 	const std::string DB_NAME;
+	//! Directory holding all of the shards (shard i lives in base_dir + i)
+	const std::string base_dir;
+
+	//! Total number of shards in the database.
+	//! Set when creating the db, and read from its metadata when opening it.
+	uint32_t num_shards;
 
 	uint8_t HASH_KEY[crypto_shorthash_KEYBYTES];
 
-	void load_hash_key();
+	void load_metadata();
 
 public:
 
-	AccountLMDBShard(uint32_t idx);
+	AccountLMDBShard(uint32_t idx, uint32_t num_shards, std::string const& base_dir);
 
 	void open_env();
 
+	//! Writes hash key and shard count to the metadata db.
 	void create_db(const uint8_t* hash_key);
 
 	void open_db();
@@ -70,8 +81,17 @@ public:
 	bool owns_account(const AccountID account) const;
 
 	void export_hash_key(uint8_t* hash_key_out) const;
+
+	uint32_t get_num_shards() const {
+		return num_shards;
+	}
 };
 
+//! Returns the shard count recorded in the account database in base_dir,
+//! or std::nullopt if no database exists there.
+std::optional<uint32_t>
+read_stored_num_shards(std::string const& base_dir);
+
 class AsyncAccountLMDBShardWorker : public utils::AsyncWorker, utils::NonMovableOrCopyable
 {
 
@@ -79,6 +99,19 @@ class AsyncAccountLMDBShardWorker : public utils::AsyncWorker, utils::NonMovable
 	uint64_t max_round_number;
 	bool ignore_too_low;
 
+	const bool batch_writes;
+
+	//! One pending write in batched persistence mode.
+	//! sort_key orders entries the way lmdb orders their keys.
+	struct BatchedKV
+	{
+		uint64_t sort_key;
+		const ThunkKVPair* kv;
+	};
+
+	//! Reused across calls, so that large blocks don't reallocate each time.
+	std::vector<BatchedKV> batch;
+
 	AccountLMDBShard& shard;
 
 	bool exists_work_to_do() override final {
@@ -90,10 +123,17 @@ class AsyncAccountLMDBShardWorker : public utils::AsyncWorker, utils::NonMovable
 	void exec_thunks();
 	void exec_one_thunk(const DBPersistenceThunk& thunk, lmdb::dbenv::wtxn& wtx, uint64_t& current_block_number);
 
+	//! Batched mode: gather a thunk's writes into batch instead of writing.
+	void batch_one_thunk(const DBPersistenceThunk& thunk, uint64_t& current_block_number);
+	//! Batched mode: sort batch, drop all but the last write to each key,
+	//! and write the rest in key order.
+	void write_batch(lmdb::dbenv::wtxn& wtx);
+
 public:
-	AsyncAccountLMDBShardWorker(AccountLMDBShard& shard)
+	AsyncAccountLMDBShardWorker(AccountLMDBShard& shard, bool batch_writes)
 		: utils::AsyncWorker()
 		, thunks_to_process(nullptr)
+		, batch_writes(batch_writes)
 		, shard(shard)
 	{
 		start_async_thread([this] {run();});
@@ -137,8 +177,24 @@ public:
 
 } /* detail */
 
+/*!
+Account database, split across independent lmdb shards (each with its own
+persistence and fsync thread).
+
+The shard count is fixed when the database is created, and recorded in each
+shard's metadata.  Opening an existing database uses the recorded count,
+regardless of the count given to the constructor.  reshard() migrates
+an open database to a different count.
+*/
 class AccountLMDB
 {
+	//! Shard count used when creating a new database.
+	const uint32_t num_shards_if_new;
+
+	//! Gather each persistence call's writes, and apply them in
+	//! key order (keeping only the last write to each key).
+	const bool batch_writes;
+
 	std::vector<std::unique_ptr<detail::AccountLMDBShard>> shards;
 	std::vector<std::unique_ptr<detail::AsyncAccountLMDBShardWorker>> workers;
 	std::vector<std::unique_ptr<detail::AsyncFsyncWorker>> syncers;
@@ -157,9 +213,17 @@ class AccountLMDB
 
 	std::pair<uint64_t, uint64_t> get_min_max_persisted_round_numbers_direct() const;
 
+	//! Construct num_shards shards (and their workers) in the main
+	//! account database directory.
+	void init_shards(uint32_t num_shards);
+	void clear_shards();
+
 public:
 
+	//! Uses NUM_ACCOUNT_DB_SHARDS for new databases.
 	AccountLMDB();
+	AccountLMDB(uint32_t num_shards_if_new);
+	AccountLMDB(uint32_t num_shards_if_new, bool batch_writes);
 
 	void create_db();
 
@@ -182,6 +246,18 @@ public:
 	std::pair<uint64_t, uint64_t> get_min_max_persisted_round_numbers() const;
 	uint64_t assert_snapshot_and_get_persisted_round_number() const;
 
+	uint32_t get_num_shards() const {
+		return shards.size();
+	}
+
+	/*! Migrate the (open) database to new_num_shards shards.
+	Copies data, in parallel, into a staging directory, then atomically
+	swaps the staging directory in for the main one.
+	Blocks persistence while running.  All shards must be persisted
+	to the same round.
+	*/
+	void reshard(uint32_t new_num_shards);
+
 	struct rtxn {
 		using txn_t = std::pair<lmdb::dbenv::txn, MDB_dbi>;
 		std::vector<txn_t> rtxns;
@@ -202,7 +278,7 @@ public:
 
 		std::optional<lmdb::dbval> get(AccountID const& account)
 		{
-			uint32_t idx = detail::get_shard(account, HASH_KEY);
+			uint32_t idx = detail::get_shard(account, HASH_KEY, rtxns.size());
 			lmdb::dbval key{&account, sizeof(AccountID)};
 
 			auto& [rtx, dbi] = rtxns.at(idx);
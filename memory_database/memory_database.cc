@@ -40,6 +40,14 @@ namespace speedex {
 
 
 MemoryDatabase::MemoryDatabase()
+	: MemoryDatabase(NUM_ACCOUNT_DB_SHARDS)
+	{}
+
+MemoryDatabase::MemoryDatabase(uint32_t num_account_db_shards)
+	: MemoryDatabase(num_account_db_shards, BATCH_LMDB_PERSISTENCE)
+	{}
+
+MemoryDatabase::MemoryDatabase(uint32_t num_account_db_shards, bool batch_lmdb_writes)
 	: user_id_to_idx_map(),
 	reserved_account_ids(),
 	database(),
@@ -47,7 +55,7 @@ MemoryDatabase::MemoryDatabase()
 	committed_mtx(),
 	uncommitted_mtx(),
 	commitment_trie(),
-	account_lmdb_instance(),
+	account_lmdb_instance(num_account_db_shards, batch_lmdb_writes),
 	transfer_logs(std::nullopt)
 	, hash_log(std::nullopt)
 	{
@@ -857,6 +865,65 @@ void MemoryDatabase::load_lmdb_contents_to_memory() {
 	_produce_state_commitment(hash);
 }
 
+void
+MemoryDatabase::snapshot_accounts(std::vector<AccountCommitment>& out) {
+	std::shared_lock lock(committed_mtx);
+
+	out.resize(database.size());
+
+	tbb::parallel_for(
+		tbb::blocked_range<std::size_t>(0, database.size()),
+		[this, &out](auto r) {
+			for (auto i = r.begin(); i < r.end(); i++) {
+				out[i] = database.get(i) -> produce_commitment();
+			}
+		});
+}
+
+void
+MemoryDatabase::snapshot_persisted_accounts(
+	std::vector<AccountCommitment>& out, uint64_t round_number) {
+
+	if (account_lmdb_instance.assert_snapshot_and_get_persisted_round_number() != round_number) {
+		throw std::runtime_error("account lmdb is not persisted to the snapshot round");
+	}
+
+	out.clear();
+
+	auto rtx_main = account_lmdb_instance.rbegin();
+
+	for (auto& [rtx, data_dbi] : rtx_main.rtxns)
+	{
+		auto cursor = rtx.cursor_open(data_dbi);
+
+		cursor.get(MDB_FIRST);
+		while (cursor) {
+			auto& kv = *cursor;
+			dbval_to_xdr(kv.second, out.emplace_back());
+			++cursor;
+		}
+	}
+}
+
+void
+MemoryDatabase::load_snapshot_contents_to_memory(
+	std::vector<xdr::xvector<AccountCommitment>> const& chunks, Hash& hash) {
+	std::lock_guard lock(committed_mtx);
+
+	if (database.size() != 0) {
+		throw std::runtime_error("can only load a snapshot into an empty db");
+	}
+
+	for (auto const& chunk : chunks) {
+		for (auto const& commitment : chunk) {
+			UserAccount* acct = database.emplace_back(commitment);
+			user_id_to_idx_map.emplace(commitment.owner, acct);
+		}
+	}
+
+	_produce_state_commitment(hash);
+}
+
 void MemoryDatabase::log(FILE* out) {
 	commitment_trie._log("db: ", out);
 }
@@ -243,6 +243,11 @@ public:
 	}
 
 	MemoryDatabase();
+	//! num_account_db_shards is only used if the account lmdb
+	//! does not already exist.
+	MemoryDatabase(uint32_t num_account_db_shards);
+	//! batch_lmdb_writes: see AccountLMDB.
+	MemoryDatabase(uint32_t num_account_db_shards, bool batch_lmdb_writes);
 
 	uint64_t size() const {
 		return database.size();
@@ -327,8 +332,30 @@ public:
 		account_lmdb_instance.open_db();
 	}
 
+	//! Migrate the account lmdb to a new shard count.
+	//! Persistence is blocked while this runs.
+	void reshard_lmdb(uint32_t new_num_shards) {
+		account_lmdb_instance.reshard(new_num_shards);
+	}
+
 	void load_lmdb_contents_to_memory();
 
+	//! Copy out the committed state of every account.
+	//! Used to take a full state snapshot.  Transaction processing
+	//! should be stopped while the copy is made.
+	void snapshot_accounts(std::vector<AccountCommitment>& out);
+
+	//! Copy out every account as persisted in the lmdb.
+	//! Throws unless every shard is persisted to \a round_number.
+	//! Don't call concurrently with persistence.
+	void snapshot_persisted_accounts(
+		std::vector<AccountCommitment>& out, uint64_t round_number);
+
+	//! Load accounts from a full state snapshot into an empty database.
+	//! Writes the resulting state commitment to \a hash.
+	void load_snapshot_contents_to_memory(
+		std::vector<xdr::xvector<AccountCommitment>> const& chunks, Hash& hash);
+
 	UserAccount* lookup_user(AccountID account) const;
 
 	void transfer_available(
@@ -70,19 +70,15 @@ UserAccountView::lookup_available_balance(AssetID asset) {
 }
 
 void UserAccountView::commit() {
-	for (auto iter = available_buffer.begin(); 
-		iter != available_buffer.end(); 
-		iter++) {
-		main_db.transfer_available(main, iter->first, iter->second, "commit transaction");
-	}
+	available_buffer.for_each([this] (AssetID asset, int64_t amount) {
+		main_db.transfer_available(main, asset, amount, "commit transaction");
+	});
 }
 
 void UserAccountView::unwind() {
-	for (auto iter = available_side_effects.begin(); 
-		iter != available_side_effects.end(); 
-		iter++) {
-		main_db.transfer_available(main, iter->first, -iter->second, "unwind transaction");
-	}
+	available_side_effects.for_each([this] (AssetID asset, int64_t amount) {
+		main_db.transfer_available(main, asset, -amount, "unwind transaction");
+	});
 }
 
 TransactionProcessingStatus
@@ -182,37 +178,29 @@ BufferedMemoryDatabaseView::transfer_available(
 
 UserAccountView& 
 BufferedMemoryDatabaseView::get_existing_account(UserAccount* account) {
-	auto iter = accounts.find(account);
-	if (iter != accounts.end()) {
-		return iter->second;
+	auto* view = accounts.find(account);
+	if (view != nullptr) {
+		return *view;
 	}
 	if (account == nullptr) {
 		throw std::runtime_error("cant' deref null account ptr");
 	}
-	accounts.emplace(std::piecewise_construct,
-		std::forward_as_tuple(account),
-		std::forward_as_tuple(main_db, 
-		account));
-	return accounts.at(account);
+	return accounts.try_emplace(account, main_db, account);
 }
 
 void 
 BufferedMemoryDatabaseView::commit() {
-	for(auto iter = accounts.begin(); 
-		iter != accounts.end(); 
-		iter++) {
-		iter->second.commit();
-	}
+	accounts.for_each([] (UserAccount*, UserAccountView& view) {
+		view.commit();
+	});
 	AccountCreationView::commit();
 }
 
 void 
 BufferedMemoryDatabaseView::unwind() {
-	for(auto iter = accounts.begin(); 
-		iter != accounts.end(); 
-		iter++) {
-		iter->second.unwind();
-	}
+	accounts.for_each([] (UserAccount*, UserAccountView& view) {
+		view.unwind();
+	});
 
 	AccountCreationView::unwind();
 }
@@ -306,6 +294,10 @@ AccountCreationView::commit() {
 			iter->first, std::move(iter->second));
 	}
 
+	if (first_reservation)
+	{
+		main_db.commit_sequence_number(first_reservation -> account, first_reservation -> seqno);
+	}
 	for (auto const& res : reservations)
 	{
 		main_db.commit_sequence_number(res.account, res.seqno);
@@ -319,6 +311,10 @@ AccountCreationView::unwind()
 		main_db.release_account_creation(iter->first);
 	}
 
+	if (first_reservation)
+	{
+		main_db.release_sequence_number(first_reservation -> account, first_reservation -> seqno);
+	}
 	for (auto const& res : reservations)
 	{
 		main_db.release_sequence_number(res.account, res.seqno);
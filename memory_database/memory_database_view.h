@@ -32,11 +32,14 @@ takes care of this restriction.
 #include "memory_database/user_account.h"
 #include "memory_database/memory_database.h"
 
+#include "utils/inline_probing_map.h"
+
 #include "xdr/types.h"
 #include "xdr/transaction.h"
 
 #include <cstdint>
 #include <forward_list>
+#include <optional>
 #include <unordered_map>
 #include <vector>
 
@@ -48,19 +51,24 @@ Manages the distinction between negative and positive
 side effects.
 
 Call commit to persist positive side effects to db.
+
+Most txs touch one or two assets per account, so the buffers
+hold a few assets inline (see InlineProbingMap).
 */
 class UserAccountView {
+	constexpr static size_t INLINE_ASSETS = 4;
+
 	MemoryDatabase& main_db;
 	UserAccount* main;
 	//should be always positive.
 	//How much additional asset to add to escrow/available accounts
 	//if view is successfully committed.
-	std::unordered_map<AssetID, int64_t> available_buffer;
+	InlineProbingMap<AssetID, int64_t, INLINE_ASSETS> available_buffer;
 
 	//should be always negative.
 	//How much asset was taken out of accounts during view lifetime,
 	// should be returned to owner if view is unwound.
-	std::unordered_map<AssetID, int64_t> available_side_effects;
+	InlineProbingMap<AssetID, int64_t, INLINE_ASSETS> available_side_effects;
 
 public:
 
@@ -121,6 +129,9 @@ protected:
 
 	std::unordered_map<AccountID, UserAccount*> temporary_idxs;
 
+	// A tx reserves one sequence number, so keep the first
+	// out of the vector (which would otherwise allocate on every tx).
+	std::optional<SeqnoReservation> first_reservation;
 	std::vector<SeqnoReservation> reservations;
 
 	void commit();
@@ -130,6 +141,7 @@ protected:
 		: main_db(db)
 		, new_accounts()
 		, temporary_idxs()
+		, first_reservation()
 		, reservations() {}
 
 public:
@@ -148,7 +160,11 @@ public:
 
 		if (status == TransactionProcessingStatus::SUCCESS)
 		{
-			reservations.emplace_back(idx, sequence_number);
+			if (!first_reservation) {
+				first_reservation = SeqnoReservation{idx, sequence_number};
+			} else {
+				reservations.emplace_back(idx, sequence_number);
+			}
 		}
 		return status;
 	}
@@ -166,13 +182,16 @@ public:
 /*! View of the whole database that buffers negative 
 side effects before committing a transaction.
 
-Used for block production.
+Used for block production, one view per tx.
+Building and committing a view for a tx touching at most
+INLINE_ACCOUNTS accounts (and a few assets each) makes no heap allocations.
 */
 class BufferedMemoryDatabaseView : public AccountCreationView {
 
+	constexpr static size_t INLINE_ACCOUNTS = 4;
 
 protected:
-	std::unordered_map<UserAccount*, UserAccountView> accounts;
+	InlineProbingMap<UserAccount*, UserAccountView, INLINE_ACCOUNTS> accounts;
 
 	UserAccountView& get_existing_account(UserAccount* account);
 
@@ -256,7 +275,8 @@ public:
 	{
 		if (do_action(account))
 		{
-			return base_view.escrow(account, asset, amount, (std::string("loading from db:") + reason).c_str());
+			return base_view.escrow(account, asset, amount, 
+				LOG_TRANSFERS ? (std::string("loading from db:") + reason).c_str() : reason);
 		}
 		return TransactionProcessingStatus::SUCCESS;
 	}
@@ -265,7 +285,8 @@ public:
 	transfer_available(UserAccount* account, AssetID asset, int64_t amount, const char* reason) {
 		if (do_action(account))
 		{
-			return base_view.transfer_available(account, asset, amount, (std::string("loading from db:") + reason).c_str());
+			return base_view.transfer_available(account, asset, amount, 
+				LOG_TRANSFERS ? (std::string("loading from db:") + reason).c_str() : reason);
 		}
 		return TransactionProcessingStatus::SUCCESS;
 	}
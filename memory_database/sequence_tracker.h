@@ -120,6 +120,12 @@ template<uint64_t MAX_SEQ_GAP>
 class SequenceTracker : public std::conditional<MAX_SEQ_GAP <= 64, detail::UInt64SequenceTracker, detail::BoundedSequenceTracker<MAX_SEQ_GAP>>::type
 {};
 
+//! SequenceTracker<MAX_SEQ_GAP> can reserve a seq num iff its offset 
+//! (detail::array_get_seq_num_offset()) is below this value.
+template<uint64_t MAX_SEQ_GAP>
+constexpr static uint64_t SEQUENCE_TRACKER_WINDOW 
+	= (MAX_SEQ_GAP <= 64) ? 64 : MAX_SEQ_GAP;
+
 
 
 namespace detail
@@ -13,6 +13,7 @@
 
 #include <tbb/parallel_for.h>
 
+#include <filesystem>
 #include <vector>
 
 using xdr::operator==;
@@ -115,6 +116,63 @@ TEST_CASE("set big genesis", "[memdb]")
 	REQUIRE(idx == nullptr);
 }
 
+TEST_CASE("reshard account lmdb", "[memdb]")
+{
+	test::speedex_dirs s;
+
+	{
+		MemoryDatabase db(4);
+		init_memdb(db, 10000, 10, 15);
+		db.reshard_lmdb(7);
+	}
+
+	// an existing db keeps its own shard count
+	MemoryDatabase db(1);
+	db.open_lmdb_env();
+	db.open_lmdb();
+	db.load_lmdb_contents_to_memory();
+
+	REQUIRE(db.size() == 10000u);
+	for (AccountID i = 0; i < 10000; i += 100) {
+		assert_balance(db, i, 3, 15);
+	}
+	REQUIRE(db.get_persisted_round_number_by_account(0) == 0);
+}
+
+TEST_CASE("recover from interrupted reshard", "[memdb]")
+{
+	test::speedex_dirs s;
+
+	{
+		MemoryDatabase db(4);
+		init_memdb(db, 10000, 10, 15);
+	}
+
+	SECTION("crash before swap")
+	{
+		// an unfinished staging db
+		std::filesystem::create_directories(memory_database_lmdb_staging_dir() + "0/");
+	}
+
+	SECTION("crash between renames of an older reshard")
+	{
+		auto main_dir = memory_database_lmdb_dir();
+		main_dir.pop_back();
+		std::filesystem::rename(main_dir, main_dir + "_old");
+	}
+
+	MemoryDatabase db(1);
+	db.open_lmdb_env();
+	db.open_lmdb();
+	db.load_lmdb_contents_to_memory();
+
+	REQUIRE(!std::filesystem::exists(memory_database_lmdb_staging_dir()));
+	REQUIRE(db.size() == 10000u);
+	for (AccountID i = 0; i < 10000; i += 100) {
+		assert_balance(db, i, 3, 15);
+	}
+}
+
 TEST_CASE("rollback account values", "[memdb]")
 {	
 	test::speedex_dirs s;
@@ -211,4 +269,85 @@ TEST_CASE("rollback with gaps", "[memdb]")
 	assert_balance(db, 501, 1, 15);
 }
 
+// Persist 6 blocks (in two calls of 3, so writes to one account coalesce
+// within a call), then reload the lmdb.  Returns every balance, and the
+// persisted round number of every account.
+std::vector<int64_t>
+persist_and_reload(bool batch_writes, uint32_t num_shards)
+{
+	const uint64_t num_accounts = 1000;
+	const uint32_t num_assets = 3;
+
+	test::speedex_dirs s;
+
+	std::vector<int64_t> expect;
+	{
+		MemoryDatabase db(num_shards, batch_writes);
+		init_memdb(db, num_accounts, num_assets, 1000);
+
+		AccountModificationLog modlog;
+		for (uint64_t block = 1; block <= 6; block++)
+		{
+			{
+				SerialAccountModificationLog log(modlog);
+				// account 0 changes every block
+				modify_db_entry(log, db, 0, 0, block);
+				for (AccountID acct = block; acct < num_accounts; acct += 7 * block)
+				{
+					modify_db_entry(log, db, acct, acct % num_assets, -static_cast<int64_t>(block));
+				}
+				modlog.merge_in_log_batch();
+			}
+			db.commit_values(modlog);
+			db.add_persistence_thunk(block, modlog);
+			modlog.detached_clear();
+
+			if (block % 3 == 0)
+			{
+				db.commit_persistence_thunks(block);
+			}
+		}
+
+		for (AccountID acct = 0; acct < num_accounts; acct++)
+		{
+			for (uint32_t asset = 0; asset < num_assets; asset++)
+			{
+				expect.push_back(db.lookup_available_balance(db.lookup_user(acct), asset));
+			}
+		}
+	}
+
+	MemoryDatabase db(num_shards, batch_writes);
+	db.open_lmdb_env();
+	db.open_lmdb();
+	db.load_lmdb_contents_to_memory();
+
+	REQUIRE(db.size() == num_accounts);
+
+	std::vector<int64_t> out;
+	for (AccountID acct = 0; acct < num_accounts; acct++)
+	{
+		for (uint32_t asset = 0; asset < num_assets; asset++)
+		{
+			out.push_back(db.lookup_available_balance(db.lookup_user(acct), asset));
+		}
+	}
+	REQUIRE(out == expect);
+
+	for (AccountID acct = 0; acct < num_accounts; acct++)
+	{
+		out.push_back(db.get_persisted_round_number_by_account(acct));
+	}
+	return out;
+}
+
+TEST_CASE("batched account lmdb writes match unbatched", "[memdb]")
+{
+	for (uint32_t num_shards : {1u, 4u})
+	{
+		INFO("num_shards " << num_shards);
+		REQUIRE(persist_and_reload(true, num_shards) == persist_and_reload(false, num_shards));
+	}
+}
+
 }
@@ -0,0 +1,186 @@
+#include <catch2/catch_test_macros.hpp>
+
+#include "crypto/crypto_utils.h"
+
+#include "memory_database/memory_database.h"
+#include "memory_database/memory_database_view.h"
+
+#include "utils/inline_probing_map.h"
+
+#include "xdr/types.h"
+
+#include <memory>
+#include <vector>
+
+namespace speedex
+{
+
+namespace
+{
+
+struct CountedValue
+{
+	int* live;
+	int value;
+
+	CountedValue(int* live, int value)
+		: live(live)
+		, value(value)
+	{
+		(*live)++;
+	}
+
+	~CountedValue()
+	{
+		(*live)--;
+	}
+};
+
+void init_view_test_db(MemoryDatabase& db, std::vector<AccountID> const& ids)
+{
+	MemoryDatabaseGenesisData memdb_genesis;
+	DeterministicKeyGenerator key_gen;
+	for (auto id : ids) {
+		memdb_genesis.id_list.push_back(id);
+		memdb_genesis.pk_list.push_back(key_gen.deterministic_key_gen(id).second);
+	}
+
+	auto account_init_lambda = [&] (UserAccount& user_account) -> void {
+		db.transfer_available(&user_account, 0, 100);
+		db.transfer_available(&user_account, 1, 100);
+		user_account.commit();
+	};
+
+	db.install_initial_accounts_and_commit(memdb_genesis, account_init_lambda);
+}
+
+int64_t balance(MemoryDatabase& db, AccountID id, AssetID asset)
+{
+	return db.lookup_available_balance(db.lookup_user(id), asset);
+}
+
+} /* anonymous namespace */
+
+TEST_CASE("inline probing map", "[memdb]")
+{
+	int live = 0;
+	{
+		InlineProbingMap<uint64_t, CountedValue, 4> map;
+
+		for (uint64_t i = 0; i < 4; i++) {
+			map.try_emplace(i * 64, &live, static_cast<int>(i));
+		}
+		REQUIRE(!map.spilled());
+		REQUIRE(map.size() == 4);
+
+		CountedValue* first = map.find(0);
+		REQUIRE(first != nullptr);
+
+		for (uint64_t i = 4; i < 10; i++) {
+			map.try_emplace(i * 64, &live, static_cast<int>(i));
+		}
+		REQUIRE(map.spilled());
+		REQUIRE(map.size() == 10);
+		REQUIRE(live == 10);
+
+		// inline entries don't move on spill
+		REQUIRE(map.find(0) == first);
+
+		// existing entries aren't replaced
+		REQUIRE(map.try_emplace(64 * 7, &live, 100).value == 7);
+		REQUIRE(map.find(1) == nullptr);
+
+		int sum = 0;
+		map.for_each([&sum] (uint64_t, CountedValue& v) { sum += v.value; });
+		REQUIRE(sum == 45);
+
+		map.clear();
+		REQUIRE(live == 0);
+		REQUIRE(map.empty());
+
+		map.try_emplace(5, &live, 5);
+		REQUIRE(live == 1);
+	}
+	REQUIRE(live == 0);
+}
+
+TEST_CASE("buffered view commit and unwind", "[memdb]")
+{
+	const AccountID id_a = 0x1234, id_b = 0x5678;
+
+	MemoryDatabase db;
+	init_view_test_db(db, {id_a, id_b});
+
+	UserAccount* a = db.lookup_user(id_a);
+	UserAccount* b = db.lookup_user(id_b);
+
+	SECTION("commit")
+	{
+		BufferedMemoryDatabaseView view(db);
+		REQUIRE(view.transfer_available(a, 0, -30, "test") == TransactionProcessingStatus::SUCCESS);
+		REQUIRE(view.transfer_available(b, 0, 30, "test") == TransactionProcessingStatus::SUCCESS);
+
+		// credits are buffered until commit
+		REQUIRE(balance(db, id_a, 0) == 70);
+		REQUIRE(balance(db, id_b, 0) == 100);
+
+		view.commit();
+		REQUIRE(balance(db, id_a, 0) == 70);
+		REQUIRE(balance(db, id_b, 0) == 130);
+	}
+
+	SECTION("buffered credit funds a later debit")
+	{
+		BufferedMemoryDatabaseView view(db);
+		REQUIRE(view.transfer_available(a, 1, 50, "test") == TransactionProcessingStatus::SUCCESS);
+		REQUIRE(view.transfer_available(a, 1, -120, "test") == TransactionProcessingStatus::SUCCESS);
+		REQUIRE(balance(db, id_a, 1) == 30);
+
+		REQUIRE(view.transfer_available(a, 1, -31, "test") == TransactionProcessingStatus::INSUFFICIENT_BALANCE);
+
+		view.commit();
+		REQUIRE(balance(db, id_a, 1) == 30);
+	}
+
+	SECTION("unwind")
+	{
+		BufferedMemoryDatabaseView view(db);
+		REQUIRE(view.transfer_available(a, 0, -30, "test") == TransactionProcessingStatus::SUCCESS);
+		REQUIRE(view.escrow(a, 1, 20, "test") == TransactionProcessingStatus::SUCCESS);
+		REQUIRE(view.transfer_available(b, 0, 30, "test") == TransactionProcessingStatus::SUCCESS);
+		REQUIRE(balance(db, id_a, 0) == 70);
+		REQUIRE(balance(db, id_a, 1) == 80);
+
+		view.unwind();
+		REQUIRE(balance(db, id_a, 0) == 100);
+		REQUIRE(balance(db, id_a, 1) == 100);
+		REQUIRE(balance(db, id_b, 0) == 100);
+	}
+}
+
+TEST_CASE("buffered view spills past inline capacity", "[memdb]")
+{
+	std::vector<AccountID> ids;
+	for (AccountID i = 1; i <= 12; i++) {
+		ids.push_back(i * 1000);
+	}
+
+	MemoryDatabase db;
+	init_view_test_db(db, ids);
+
+	BufferedMemoryDatabaseView view(db);
+	for (size_t i = 0; i < ids.size(); i++) {
+		auto* from = db.lookup_user(ids[i]);
+		auto* to = db.lookup_user(ids[(i + 1) % ids.size()]);
+		REQUIRE(view.transfer_available(from, 0, -10, "test") == TransactionProcessingStatus::SUCCESS);
+		REQUIRE(view.transfer_available(to, 0, 10, "test") == TransactionProcessingStatus::SUCCESS);
+	}
+	view.commit();
+
+	for (size_t i = 0; i < ids.size(); i++) {
+		REQUIRE(balance(db, ids[i], 0) == 100);
+		REQUIRE(balance(db, ids[i], 1) == 100);
+	}
+}
+
+} /* speedex */
@@ -23,57 +23,104 @@
 #include <tbb/parallel_for.h>
 namespace speedex {
 
-uint64_t MempoolChunk::remove_confirmed_txs() {
-	uint64_t num_removed = 0;
-
-	for (size_t i = 0; i < confirmed_txs_to_remove.size();) {
-		if (confirmed_txs_to_remove[i]) {
-			confirmed_txs_to_remove[i] = confirmed_txs_to_remove.back();
-			txs[i] = txs.back();
-			txs.pop_back();
-			confirmed_txs_to_remove.pop_back();
-			num_removed ++;
-		} else {
-			i++;
+template<typename remove_fn>
+uint64_t 
+MempoolChunk::compact(remove_fn const& should_remove) {
+	// flags may cover only a prefix of the chunk (i.e. after a join)
+	const size_t bitmap_size = confirmed_txs_to_remove.size();
+
+	size_t out = 0, bitmap_out = 0;
+	for (size_t i = 0; i < txs.size(); i++) {
+		if (should_remove(i)) {
+			continue;
+		}
+		if (out != i) {
+			txs[out] = std::move(txs[i]);
+		}
+		if (i < bitmap_size) {
+			confirmed_txs_to_remove[bitmap_out] = confirmed_txs_to_remove[i];
+			bitmap_out++;
 		}
+		out++;
 	}
+
+	uint64_t num_removed = txs.size() - out;
+
+	// shrinking never reallocates
+	txs.erase(txs.begin() + out, txs.end());
+	confirmed_txs_to_remove.resize(bitmap_out);
 	return num_removed;
 }
 
+uint64_t MempoolChunk::remove_confirmed_txs() {
+	return compact(
+		[this] (size_t i) -> bool {
+			return i < confirmed_txs_to_remove.size() 
+				&& confirmed_txs_to_remove[i];
+		});
+}
+
 uint64_t
 MempoolChunk::filter(MempoolTransactionFilter const& filter) {
-	uint64_t num_removed = 0;
-
-	for (size_t i = 0; i < txs.size();) {
-		if (filter.check_transaction(txs[i])) {
-			txs[i] = std::move(txs.back());
-			txs.pop_back();
-			num_removed++;
-		} else {
-			i++;
-		}
-	}
-	return num_removed;
+	return compact(
+		[this, &filter] (size_t i) -> bool {
+			return filter.check_transaction(txs[i]);
+		});
 }
 
 void 
-Mempool::add_to_mempool_buffer_nolock(std::vector<SignedTransaction>&& chunk) {
+Mempool::add_to_mempool_buffer_nolock(MempoolChunk&& chunk) {
 	buffer_size.fetch_add(chunk.size(), std::memory_order_relaxed);
-	MempoolChunk to_add(std::move(chunk));
-	buffered_mempool.emplace_back(std::move(to_add));
+	buffered_mempool.emplace_back(std::move(chunk));
+}
+
+uint32_t
+Mempool::account_shard(AccountID account, uint32_t num_shards) {
+	// account ids are often sequential, so mix the bits first
+	uint64_t h = account + 0x9e3779b97f4a7c15;
+	h = (h ^ (h >> 30)) * 0xbf58476d1ce4e5b9;
+	h = (h ^ (h >> 27)) * 0x94d049bb133111eb;
+	h = h ^ (h >> 31);
+	return h % num_shards;
 }
 
 void 
 Mempool::chunkify_and_add_to_mempool_buffer(std::vector<SignedTransaction>&& txs) {
+	// chunk outside the lock, so concurrent callers only contend on the append
+	std::vector<MempoolChunk> chunks;
+
+	if (NUM_ACCOUNT_SHARDS == 0) {
+		for(size_t i = 0; i <= txs.size() / TARGET_CHUNK_SIZE; i++) {
+			std::vector<SignedTransaction> chunk;
+			size_t min_idx = i * TARGET_CHUNK_SIZE;
+			size_t max_idx = std::min(txs.size(), (i + 1) * TARGET_CHUNK_SIZE);
+			chunk.insert(
+				chunk.end(),
+				std::make_move_iterator(txs.begin() + min_idx),
+				std::make_move_iterator(txs.begin() + max_idx));
+			chunks.emplace_back(std::move(chunk));
+		}
+	} else {
+		std::vector<std::vector<SignedTransaction>> shard_txs(NUM_ACCOUNT_SHARDS);
+		for (auto& tx : txs) {
+			auto shard = account_shard(
+				tx.transaction.metadata.sourceAccount, NUM_ACCOUNT_SHARDS);
+			shard_txs[shard].emplace_back(std::move(tx));
+		}
+		for (uint32_t shard = 0; shard < NUM_ACCOUNT_SHARDS; shard++) {
+			auto& s_txs = shard_txs[shard];
+			for (size_t min_idx = 0; min_idx < s_txs.size(); min_idx += TARGET_CHUNK_SIZE) {
+				size_t max_idx = std::min(s_txs.size(), min_idx + TARGET_CHUNK_SIZE);
+				std::vector<SignedTransaction> chunk(
+					std::make_move_iterator(s_txs.begin() + min_idx),
+					std::make_move_iterator(s_txs.begin() + max_idx));
+				chunks.emplace_back(std::move(chunk), shard);
+			}
+		}
+	}
+
 	std::lock_guard lock(buffer_mtx);
-	for(size_t i = 0; i <= txs.size() / TARGET_CHUNK_SIZE; i++) {
-		std::vector<SignedTransaction> chunk;
-		size_t min_idx = i * TARGET_CHUNK_SIZE;
-		size_t max_idx = std::min(txs.size(), (i + 1) * TARGET_CHUNK_SIZE);
-		chunk.insert(
-			chunk.end(),
-			std::make_move_iterator(txs.begin() + min_idx),
-			std::make_move_iterator(txs.begin() + max_idx));
+	for (auto& chunk : chunks) {
 		add_to_mempool_buffer_nolock(std::move(chunk));
 	}
 }
@@ -96,6 +143,11 @@ void Mempool::push_mempool_buffer_to_mempool() {
 }
 
 void Mempool::join_small_chunks() {
+	if (NUM_ACCOUNT_SHARDS > 0) {
+		join_small_chunks_sharded();
+		return;
+	}
+
 	std::lock_guard lock(mtx);
 
 	if (mempool.size() == 0) {
@@ -114,6 +166,45 @@ void Mempool::join_small_chunks() {
 	}
 }
 
+void Mempool::join_small_chunks_sharded() {
+	std::lock_guard lock(mtx);
+
+	// the latest chunk of each shard that can still take more txs
+	constexpr size_t NO_CHUNK = UINT64_MAX;
+	std::vector<size_t> open_chunks(NUM_ACCOUNT_SHARDS, NO_CHUNK);
+
+	// join forward into the earlier chunk, so each shard keeps its tx order
+	size_t out = 0;
+	for (size_t i = 0; i < mempool.size(); i++) {
+		auto shard = mempool[i].shard;
+		size_t open = open_chunks.at(shard);
+		if (open != NO_CHUNK
+			&& mempool[open].size() + mempool[i].size() < TARGET_CHUNK_SIZE) {
+			mempool[open].join(std::move(mempool[i]));
+			continue;
+		}
+		if (out != i) {
+			mempool[out] = std::move(mempool[i]);
+		}
+		open_chunks[shard] = out;
+		out++;
+	}
+	mempool.erase(mempool.begin() + out, mempool.end());
+}
+
+std::vector<std::vector<size_t>>
+Mempool::get_shard_chunks() const {
+	std::vector<std::vector<size_t>> out;
+	if (NUM_ACCOUNT_SHARDS == 0) {
+		return out;
+	}
+	out.resize(NUM_ACCOUNT_SHARDS);
+	for (size_t i = 0; i < mempool.size(); i++) {
+		out[mempool[i].shard].push_back(i);
+	}
+	return out;
+}
+
 void Mempool::log_tx_removal(uint64_t removed_count) {
 	mempool_size.fetch_sub(removed_count, std::memory_order_relaxed);
 }
@@ -25,6 +25,10 @@ A mempool contains many mempool chunks.  These chunks are maintained at
 approximately a fixed size.  After building a block, committed and failed
 transactions are removed from the mempool and small chunks are merged into
 larger chunks.
+
+Optionally, chunks are formed per account-affinity shard (a hash of each
+tx's source account).  Block production can then give each shard to one
+worker at a time, so most updates to an account stay on one thread.
 */ 
 
 
@@ -55,14 +59,28 @@ struct MempoolChunk {
 	//! Transactions removed if they are confirmed or if they fail
 	//! in certain types of ways.
 	std::vector<bool> confirmed_txs_to_remove;
+	//! Account-affinity shard of every tx in the chunk
+	//! (always 0 if the mempool is not sharded).
+	uint32_t shard;
+
+	//! Drop txs for which should_remove(idx) is true, in place.
+	//! Keeps the relative order of the remaining txs
+	//! (and their confirmed flags, if present).
+	//! Returns the number of txs removed.
+	template<typename remove_fn>
+	uint64_t compact(remove_fn const& should_remove);
 
 
 	//! Initialize a mempool chunk with a given set of transactions
-	MempoolChunk(std::vector<SignedTransaction>&& txs_input) 
+	MempoolChunk(std::vector<SignedTransaction>&& txs_input, uint32_t shard = 0) 
 		: txs(std::move(txs_input))
 		, confirmed_txs_to_remove()
+		, shard(shard)
 		{}
 
+	//! Drop txs that the filter marks as uncommittable.
+	//! Operates in place (does not reallocate the chunk).
+	//! Returns the number of txs removed.
 	uint64_t filter(MempoolTransactionFilter const& filter);
 
 	//! Clear txs that were marked as finished.
@@ -84,6 +102,15 @@ struct MempoolChunk {
 		}
 	}
 
+	//! Mark one more transaction as removable,
+	//! after set_confirmed_txs() has installed the bitmap.
+	void mark_confirmed_tx(size_t idx) {
+		if (idx >= confirmed_txs_to_remove.size()) {
+			throw std::runtime_error("no confirmed bitmap for tx");
+		}
+		confirmed_txs_to_remove[idx] = true;
+	}
+
 	size_t size() const {
 		return txs.size();
 	}
@@ -95,6 +122,9 @@ struct MempoolChunk {
 
 	//! Join one mempool chunk with another.
 	void join(MempoolChunk&& other){
+		if (shard != other.shard) {
+			throw std::runtime_error("cannot join chunks of different shards");
+		}
 		txs.insert(txs.end(), 
 			std::make_move_iterator(other.txs.begin()),
 			std::make_move_iterator(other.txs.end()));
@@ -125,7 +155,9 @@ class Mempool {
 	//! update removed tx count
 	void log_tx_removal(uint64_t removed_count);
 
-	void add_to_mempool_buffer_nolock(std::vector<SignedTransaction>&& chunk);
+	void add_to_mempool_buffer_nolock(MempoolChunk&& chunk);
+
+	void join_small_chunks_sharded();
 
 public:
 
@@ -133,11 +165,15 @@ public:
 
 	const size_t MAX_MEMPOOL_SIZE;
 
+	//! Number of account-affinity shards.  0 means chunks are
+	//! formed in arrival order, with no regard to accounts.
+	const uint32_t NUM_ACCOUNT_SHARDS;
+
 	//! The number of the most recent batch of transactions added to the mempool
 	//! Used in experiments - txs are streamed in batches from disk.
 	std::atomic<uint64_t> latest_block_added_to_mempool = 0;
 
-	Mempool(size_t target_chunk_size, size_t max_mempool_size)
+	Mempool(size_t target_chunk_size, size_t max_mempool_size, uint32_t num_account_shards = 0)
 		: mempool()
 		, buffered_mempool()
 		, mempool_size(0)
@@ -145,12 +181,19 @@ public:
 		, mtx()
 		, buffer_mtx()
        	, TARGET_CHUNK_SIZE(target_chunk_size)
-       	, MAX_MEMPOOL_SIZE(max_mempool_size) {}
+       	, MAX_MEMPOOL_SIZE(max_mempool_size)
+       	, NUM_ACCOUNT_SHARDS(num_account_shards) {}
+
+	//! Shard of an account, in [0, num_shards).
+	static uint32_t account_shard(AccountID account, uint32_t num_shards);
 
     //! Add a set of transactions to the mempool
     //! These transactions do not go directly into the mempool, but instead
     //! into an internal buffer.  This buffer is merged into the main mempool
     //! by push_mempool_buffer_to_mempool().
+    //! Threadsafe; only the final append holds the buffer lock.
+    //! In a sharded mempool, txs are first grouped by account shard
+    //! (keeping their relative order), and chunks never mix shards.
 	void chunkify_and_add_to_mempool_buffer(std::vector<SignedTransaction>&& txs);
 
 	//! Pushes the internal tx buffer to the mempool.
@@ -159,6 +202,7 @@ public:
 
 	//! Defragment the mempool.
 	//! Threadsafe (can be done by background thread, no lock required).
+	//! In a sharded mempool, only chunks of the same shard are joined.
 	void join_small_chunks();
 
 	uint64_t size() const {
@@ -187,6 +231,11 @@ public:
 		return mempool.size();
 	}
 
+	//! Indices of the chunks of each shard, in mempool order.
+	//! Empty if the mempool is not sharded.
+	//! Mempool lock should be held.
+	std::vector<std::vector<size_t>> get_shard_chunks() const;
+
 	//! Access a mempool chunk.
 	//! References will be invalidated unless mempool is locked
 	MempoolChunk& operator[](size_t idx) {
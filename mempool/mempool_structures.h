@@ -36,8 +36,12 @@ private:
 	MempoolFilterExecutor filter;
 public:
 
-	MempoolStructures(const MemoryDatabase& db, size_t target_chunk_size, size_t max_mempool_size)
-		: mempool(target_chunk_size, max_mempool_size)
+	MempoolStructures(
+		const MemoryDatabase& db, 
+		size_t target_chunk_size, 
+		size_t max_mempool_size, 
+		uint32_t num_account_shards = 0)
+		: mempool(target_chunk_size, max_mempool_size, num_account_shards)
 		, background_cleaner(mempool)
 		, filter(db, mempool)
 		{}
@@ -21,10 +21,15 @@
 #include "mempool/mempool.h"
 
 #include "memory_database/memory_database.h"
+#include "utils/debug_macros.h"
 
 #include "xdr/types.h"
 #include "xdr/transaction.h"
 
+#include <utils/time.h>
+
+#include <tbb/parallel_for.h>
+
 namespace speedex {
 
 // return true to remove
@@ -41,17 +46,44 @@ MempoolTransactionFilter::check_transaction(const SignedTransaction& tx) const {
 	}
 
 	uint64_t last_committed_seq_num = db.get_last_committed_seq_number(idx);
+	uint64_t seqno = tx.transaction.metadata.sequenceNumber;
+
+	// remove if we've already committed a seq number higher than this one on this account.
+	if (last_committed_seq_num >= seqno) {
+		return true;
+	}
 
-	// return true IFF we've already committed a seq number higher than this one on this account.
-	return (last_committed_seq_num >= tx.transaction.metadata.sequenceNumber);
+	// Txs too far past the last committed seq num stay; they
+	// become includable once the account's window moves.
+
+	if (account_log == nullptr) {
+		return false;
+	}
+
+	// Only remove accounts whose txs can never all commit.
+	// Requirement shortfalls are not certain: the account may receive
+	// credits, and its txs may land across several blocks.
+	switch(account_log -> check_valid_account(source_account)) {
+		case FilterResult::INVALID_DUPLICATE:
+		case FilterResult::ACCOUNT_NEXIST:
+		case FilterResult::DOUBLE_CANCEL:
+			return true;
+		default:
+			return false;
+	}
 }
 
 MempoolFilterExecutor::MempoolFilterExecutor(MemoryDatabase const& db, Mempool& mempool)
 	: utils::AsyncWorker()
 	, cancel_background_filter(false)
 	, do_work(false)
-	, filter(db)
+	, db(db)
+	, account_log()
+	, filter(db, &account_log)
 	, mempool(mempool)
+	, last_num_checked(0)
+	, last_num_removed(0)
+	, last_duration(0)
 	{
 		start_async_thread(
 			[this] {run();}
@@ -75,6 +107,23 @@ MempoolFilterExecutor::stop_filter() {
 	wait_for_async_task();
 }
 
+double
+MempoolFilterExecutor::get_last_filter_rate() {
+	wait_for_async_task();
+	std::lock_guard lock(mtx);
+	if (last_duration == 0) {
+		return 0;
+	}
+	return last_num_checked / last_duration;
+}
+
+uint64_t
+MempoolFilterExecutor::get_last_num_removed() {
+	wait_for_async_task();
+	std::lock_guard lock(mtx);
+	return last_num_removed;
+}
+
 void
 MempoolFilterExecutor::run() {
 	std::unique_lock lock(mtx);
@@ -87,18 +136,50 @@ MempoolFilterExecutor::run() {
 
 		auto mempool_lock = mempool.lock_mempool();
 
+		auto timestamp = utils::init_time_measurement();
+
+		// Per-account pass.  Chunks skipped on cancellation only
+		// make the log more permissive.
+		account_log.clear();
+		account_log.add_tx_lists(
+			mempool.num_chunks(),
+			[this] (size_t i) -> std::vector<SignedTransaction> const* {
+				if (cancel_background_filter.load(std::memory_order_relaxed)) {
+					return nullptr;
+				}
+				return &(mempool[i].txs);
+			},
+			db);
+
+		std::atomic<uint64_t> num_checked = 0, num_removed = 0;
+
 		tbb::parallel_for(
 			tbb::blocked_range<size_t>(0, mempool.num_chunks()),
-			[this] (auto r) {
+			[this, &num_checked, &num_removed] (auto r) {
+				uint64_t local_checked = 0, local_removed = 0;
 				for (auto i = r.begin(); i < r.end(); i++) {
 					if (cancel_background_filter.load(std::memory_order_relaxed)) {
-						return;
+						break;
 					}
 					auto& chunk = mempool[i];
-					uint64_t num_removed = chunk.filter(filter);
-					mempool.log_tx_removal(num_removed);
+					local_checked += chunk.size();
+					local_removed += chunk.filter(filter);
 				}
+				mempool.log_tx_removal(local_removed);
+				num_checked.fetch_add(local_checked, std::memory_order_relaxed);
+				num_removed.fetch_add(local_removed, std::memory_order_relaxed);
 			});
+
+		last_duration = utils::measure_time(timestamp);
+		last_num_checked = num_checked.load(std::memory_order_relaxed);
+		last_num_removed = num_removed.load(std::memory_order_relaxed);
+
+		MEMPOOL_INFO("mempool filter: checked %lu removed %lu in %lf (%lf txs/sec)",
+			last_num_checked,
+			last_num_removed,
+			last_duration,
+			(last_duration > 0) ? last_num_checked / last_duration : 0.0);
+
 		do_work = false;
 		cv.notify_all();
 	}
@@ -24,10 +24,21 @@
 	confirmed, or who have had successors (by seq num) already
 	confirmed.  Main usage is in maintaining a reasonably
 	valid mempool in validators.
+
+	Optionally, the filter also consults a FilterLog built over the
+	whole mempool, which drops every tx from accounts that have
+	conflicting txs (same seq num, different contents), cancel
+	the same offer twice, or do not exist.  Accounts whose pending
+	txs overdraw their current balance are kept.
 */
 
+#include "filtering/filter_log.h"
+
 #include <utils/async_worker.h>
 
+#include <atomic>
+#include <cstdint>
+
 namespace speedex {
 
 class Mempool;
@@ -42,14 +53,20 @@ class MempoolTransactionFilter {
 
 	MemoryDatabase const& db;
 
+	//! Per-account conflict checks over the whole mempool.
+	//! Ignored if null.
+	FilterLog const* account_log;
+
 public:
 
-	MempoolTransactionFilter(MemoryDatabase const& db)
+	MempoolTransactionFilter(MemoryDatabase const& db, FilterLog const* account_log = nullptr)
 		: db(db) 
+		, account_log(account_log)
 		{}
 
 	//! return true if the transaction is definitely committed already or uncommittable
-	//! return false if tx should stay in mempool
+	//! return false if tx should stay in mempool (including txs whose seq num
+	//! is too far past the last committed seq num to be reserved in the next block)
 	bool check_transaction(const SignedTransaction& tx) const;
 };
 
@@ -65,9 +82,16 @@ class MempoolFilterExecutor : public utils::AsyncWorker {
 
 	void run();
 
+	MemoryDatabase const& db;
+	FilterLog account_log;
 	MempoolTransactionFilter filter;
 	Mempool& mempool;
 
+	//! Stats from the most recent filter pass
+	uint64_t last_num_checked;
+	uint64_t last_num_removed;
+	double last_duration;
+
 public:
 
 	MempoolFilterExecutor(MemoryDatabase const& db, Mempool& mempool);
@@ -76,6 +100,13 @@ public:
 
 	void stop_filter();
 
+	//! Txs checked per second by the most recent filter pass.
+	//! Waits for any running pass to complete.
+	double get_last_filter_rate();
+
+	//! Txs removed by the most recent filter pass.
+	uint64_t get_last_num_removed();
+
 	~MempoolFilterExecutor() {
 		stop_filter();
 		terminate_worker();
@@ -0,0 +1,89 @@
+#include <catch2/catch_test_macros.hpp>
+
+#include "crypto/crypto_utils.h"
+
+#include "filtering/filter_log.h"
+
+#include "memory_database/memory_database.h"
+
+#include "mempool/mempool_transaction_filter.h"
+
+#include "speedex/speedex_static_configs.h"
+
+namespace speedex
+{
+
+static SignedTransaction
+make_mempool_filter_payment(AccountID from, uint64_t seqno, AccountID to, int64_t amount)
+{
+	SignedTransaction out;
+	Operation op;
+	op.body.type(PAYMENT);
+	op.body.paymentOp().receiver = to;
+	op.body.paymentOp().asset = 1;
+	op.body.paymentOp().amount = amount;
+	out.transaction.operations.push_back(op);
+	out.transaction.metadata.sourceAccount = from;
+	out.transaction.metadata.sequenceNumber = seqno;
+	out.transaction.maxFee = 1;
+	return out;
+}
+
+TEST_CASE("mempool filter keeps txs that may commit later", "[mempool]")
+{
+	const AccountID id_a = 1, id_b = 2, id_c = 3;
+	const uint64_t initial_seqno = 50 * MAX_OPS_PER_TX;
+	const int64_t default_amount = 10;
+
+	MemoryDatabase db;
+	MemoryDatabaseGenesisData memdb_genesis;
+	memdb_genesis.id_list = {id_a, id_b, id_c};
+
+	DeterministicKeyGenerator key_gen;
+	for (auto id : memdb_genesis.id_list)
+	{
+		memdb_genesis.pk_list.push_back(key_gen.deterministic_key_gen(id).second);
+	}
+
+	db.install_initial_accounts_and_commit(memdb_genesis, 
+		[&] (UserAccount& user_account) -> void {
+			for (AssetID i = 0; i < 2; i++) {
+				db.transfer_available(&user_account, i, default_amount);
+			}
+			REQUIRE(user_account.reserve_sequence_number(initial_seqno) == TransactionProcessingStatus::SUCCESS);
+			user_account.commit_sequence_number(initial_seqno);
+			user_account.commit();
+		});
+
+	std::vector<SignedTransaction> txs;
+
+	// already committed
+	txs.push_back(make_mempool_filter_payment(id_a, initial_seqno, id_b, 1));
+	// includable now
+	txs.push_back(make_mempool_filter_payment(id_a, initial_seqno + MAX_OPS_PER_TX, id_b, 1));
+	// includable once a's window moves
+	txs.push_back(make_mempool_filter_payment(id_a, initial_seqno + (MAX_SEQ_NUMS_PER_BLOCK + 10) * MAX_OPS_PER_TX, id_b, 1));
+
+	// b's queued txs overdraw its current balance
+	txs.push_back(make_mempool_filter_payment(id_b, initial_seqno + MAX_OPS_PER_TX, id_a, 8));
+	txs.push_back(make_mempool_filter_payment(id_b, initial_seqno + 2 * MAX_OPS_PER_TX, id_a, 8));
+
+	// c has two different txs with the same seq num
+	txs.push_back(make_mempool_filter_payment(id_c, initial_seqno + MAX_OPS_PER_TX, id_a, 1));
+	txs.push_back(make_mempool_filter_payment(id_c, initial_seqno + MAX_OPS_PER_TX, id_a, 2));
+
+	FilterLog account_log;
+	account_log.add_txs(txs, db);
+
+	MempoolTransactionFilter filter(db, &account_log);
+
+	REQUIRE(filter.check_transaction(txs[0]));
+	REQUIRE(!filter.check_transaction(txs[1]));
+	REQUIRE(!filter.check_transaction(txs[2]));
+	REQUIRE(!filter.check_transaction(txs[3]));
+	REQUIRE(!filter.check_transaction(txs[4]));
+	REQUIRE(filter.check_transaction(txs[5]));
+	REQUIRE(filter.check_transaction(txs[6]));
+}
+
+} /* speedex */
@@ -0,0 +1,92 @@
+#include <catch2/catch_test_macros.hpp>
+
+#include "mempool/mempool.h"
+
+#include <map>
+
+namespace speedex
+{
+
+std::vector<SignedTransaction>
+make_shard_test_txs(uint64_t num_accounts, uint64_t txs_per_account)
+{
+	std::vector<SignedTransaction> out;
+	for (uint64_t seq = 1; seq <= txs_per_account; seq++) {
+		for (AccountID acc = 0; acc < num_accounts; acc++) {
+			SignedTransaction tx;
+			tx.transaction.metadata.sourceAccount = acc;
+			tx.transaction.metadata.sequenceNumber = seq;
+			out.push_back(tx);
+		}
+	}
+	return out;
+}
+
+void check_shards(Mempool& mempool, uint64_t expected_size)
+{
+	std::map<AccountID, uint32_t> account_shards;
+	std::map<AccountID, uint64_t> last_seqno;
+	uint64_t total = 0;
+
+	auto shard_chunks = mempool.get_shard_chunks();
+	REQUIRE(shard_chunks.size() == mempool.NUM_ACCOUNT_SHARDS);
+
+	for (uint32_t shard = 0; shard < shard_chunks.size(); shard++) {
+		for (size_t idx : shard_chunks[shard]) {
+			auto& chunk = mempool[idx];
+			REQUIRE(chunk.shard == shard);
+			REQUIRE(chunk.size() <= mempool.TARGET_CHUNK_SIZE);
+			for (size_t i = 0; i < chunk.size(); i++) {
+				auto const& metadata = chunk[i].transaction.metadata;
+				REQUIRE(Mempool::account_shard(metadata.sourceAccount, mempool.NUM_ACCOUNT_SHARDS) == shard);
+				// an account's txs keep their order within the shard
+				REQUIRE(last_seqno[metadata.sourceAccount] < metadata.sequenceNumber);
+				last_seqno[metadata.sourceAccount] = metadata.sequenceNumber;
+				total++;
+			}
+		}
+	}
+	REQUIRE(total == expected_size);
+	REQUIRE(mempool.size() == expected_size);
+}
+
+TEST_CASE("sharded mempool groups txs by account", "[mempool]")
+{
+	Mempool mempool(10, 100'000, 8);
+
+	mempool.chunkify_and_add_to_mempool_buffer(make_shard_test_txs(50, 4));
+	mempool.push_mempool_buffer_to_mempool();
+
+	check_shards(mempool, 200);
+
+	SECTION("join small chunks within shards")
+	{
+		// many tiny batches make many small chunks
+		for (AccountID acc = 100; acc < 150; acc++) {
+			SignedTransaction tx;
+			tx.transaction.metadata.sourceAccount = acc;
+			tx.transaction.metadata.sequenceNumber = 1;
+			mempool.chunkify_and_add_to_mempool_buffer({tx});
+		}
+		mempool.push_mempool_buffer_to_mempool();
+
+		size_t chunks_before = mempool.num_chunks();
+		mempool.join_small_chunks();
+		REQUIRE(mempool.num_chunks() < chunks_before);
+
+		check_shards(mempool, 250);
+	}
+}
+
+TEST_CASE("unsharded mempool has no shard schedule", "[mempool]")
+{
+	Mempool mempool(10, 100'000);
+
+	mempool.chunkify_and_add_to_mempool_buffer(make_shard_test_txs(5, 4));
+	mempool.push_mempool_buffer_to_mempool();
+
+	REQUIRE(mempool.get_shard_chunks().empty());
+	REQUIRE(mempool.size() == 20);
+}
+
+}
@@ -51,9 +51,43 @@ AccountModificationLog::AccountModificationLog()
     };
 
 
+void
+AccountModificationLog::wait_for_pending_merge() const
+{
+    if (!merge_pending.load(std::memory_order_acquire))
+    {
+        return;
+    }
+    std::unique_lock lock(merge_pending_mtx);
+    merge_pending_cv.wait(lock, [this]() {
+        return !merge_pending.load(std::memory_order_acquire);
+    });
+}
+
+void
+AccountModificationLog::mark_merge_pending()
+{
+    wait_for_pending_merge();
+    std::lock_guard lock(merge_pending_mtx);
+    merge_pending.store(true, std::memory_order_release);
+}
+
+void
+AccountModificationLog::merge_in_pending_log_batch()
+{
+    {
+        std::lock_guard lock(mtx);
+        modification_log.template batch_merge_in<LogMergeFn>(cache);
+    }
+    std::lock_guard lock(merge_pending_mtx);
+    merge_pending.store(false, std::memory_order_release);
+    merge_pending_cv.notify_all();
+}
+
 void
 AccountModificationLog::hash(Hash& hash, uint64_t block_number)
 {
+    wait_for_pending_merge();
     std::lock_guard lock(mtx);
 
     auto timestamp = utils::init_time_measurement();
@@ -83,6 +117,7 @@ AccountModificationLog::hash(Hash& hash, uint64_t block_number)
 void
 AccountModificationLog::merge_in_log_batch()
 {
+    wait_for_pending_merge();
     std::lock_guard lock(mtx);
 
     modification_log.template batch_merge_in<LogMergeFn>(cache);
@@ -91,7 +126,7 @@ AccountModificationLog::merge_in_log_batch()
 void
 AccountModificationLog::detached_clear()
 {
-
+    wait_for_pending_merge();
     std::lock_guard lock(mtx);
 
     deleter.call_delete(persistable_block.release());
@@ -107,7 +142,7 @@ AccountModificationLog::persist_block(uint64_t block_number,
                                       bool return_block,
                                       bool persist_block)
 {
-
+    wait_for_pending_merge();
     std::lock_guard lock(mtx);
 
     BLOCK_INFO("saving account log for block %lu", block_number);
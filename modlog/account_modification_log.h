@@ -24,8 +24,11 @@ Maintains a log of which accounts were modified while processing a block.
 Implicitly assembles a block of transactions during block production.
 */
 
+#include <atomic>
+#include <condition_variable>
 #include <cstdint>
 #include <cinttypes>
+#include <mutex>
 #include <thread>
 
 #include "modlog/account_modification_entry.h"
@@ -56,6 +59,11 @@ A reference to this local copy is stored within AccountModificationLog.
 When we are done processing a block, AccountModificationLog has a number of
 serial logs developed by different threads.  Call batch_merge_in_logs()
 to merge these logs into one main log.
+
+The merge can also be run in the background (see LogMergeWorker).
+While a background merge is pending, every access to the main log
+(or to the threadlocal cache) first waits for the merge to finish,
+so callers need not wait for it explicitly.
 */
 
 struct LogListInsertFn;
@@ -99,6 +107,18 @@ private:
 	unsigned char* write_buffer = new unsigned char[BUF_SIZE];
 	friend class SerialAccountModificationLog;
 
+	std::atomic<bool> merge_pending = false;
+	mutable std::mutex merge_pending_mtx;
+	mutable std::condition_variable merge_pending_cv;
+
+	//! Block until no background merge is pending.  Cheap when none is.
+	void wait_for_pending_merge() const;
+
+	serial_trie_t& get_serial_log() {
+		wait_for_pending_merge();
+		return cache.get(modification_log);
+	}
+
 public:
 
 	AccountModificationLog();
@@ -113,6 +133,7 @@ public:
 	}
 
 	size_t size() const {
+		wait_for_pending_merge();
 		std::shared_lock lock(mtx);
 		return modification_log.size();
 	}
@@ -120,6 +141,7 @@ public:
 	//! Apply some function to every value in the log trie.
 	template<typename ApplyFn>
 	void parallel_iterate_over_log(ApplyFn& fn) const {
+		wait_for_pending_merge();
 		std::shared_lock lock(mtx);
 		modification_log.parallel_batch_value_modify<ApplyFn, 1000>(fn);
 	}
@@ -128,6 +150,15 @@ public:
 	//! the main trie.
 	void merge_in_log_batch();
 
+	//! Mark that a background merge is about to start.  Until
+	//! merge_in_pending_log_batch() finishes, accessors block.
+	//! Must be called from the thread that filled the threadlocal logs,
+	//! before any subsequent access to this log.
+	void mark_merge_pending();
+
+	//! Run the merge announced by mark_merge_pending().
+	void merge_in_pending_log_batch();
+
 	//! Hash account modification log.  Also accumulates the block of
 	//! transactions from the mod log.
 	void hash(Hash& hash, uint64_t block_number);
@@ -146,6 +177,7 @@ public:
 
 	template<typename VectorType>
 	void parallel_accumulate_values(VectorType& vec) const {
+		wait_for_pending_merge();
 		std::shared_lock lock(mtx);
 		modification_log.template accumulate_values_parallel<VectorType, AccumulateFn>(vec);
 	}
@@ -155,6 +187,7 @@ public:
 	//! a nonstardard operator= into VectorType.
 	template<typename VectorType>
 	void parallel_accumulate_keys(VectorType& vec) const {
+		wait_for_pending_merge();
 		std::shared_lock lock(mtx);
 		modification_log.accumulate_keys_parallel(vec);
 	}
@@ -207,7 +240,7 @@ public:
 	SerialAccountModificationLog(const SerialAccountModificationLog& other) = delete;
 
 	SerialAccountModificationLog(AccountModificationLog& main_log) 
-		: modification_log(main_log.cache.get(main_log.modification_log))
+		: modification_log(main_log.get_serial_log())
 		, main_log(main_log) {}
 
 	//! Logs when some operation created by an account results in
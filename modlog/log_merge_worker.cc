@@ -39,7 +39,7 @@ LogMergeWorker::run() {
 		if (done_flag) return;
 		if (logs_ready_for_merge) {
 
-			modification_log.merge_in_log_batch();
+			modification_log.merge_in_pending_log_batch();
 			
 			logs_ready_for_merge = false;
 		}
@@ -50,6 +50,7 @@ LogMergeWorker::run() {
 void 
 LogMergeWorker::do_merge() {
 	wait_for_async_task();
+	modification_log.mark_merge_pending();
 	std::lock_guard lock(mtx);
 	logs_ready_for_merge = true;
 	cv.notify_all();
@@ -55,6 +55,8 @@ public:
 	}
 
 	//! Initiate a call to merge in modification logs in the background.
+	//! Any access to the modification log after this call blocks
+	//! until the merge finishes, so waiting explicitly is optional.
 	void do_merge();
 	
 	//! Wait for background merge to finish.
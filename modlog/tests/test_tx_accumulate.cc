@@ -2,6 +2,7 @@
 
 
 #include "modlog/account_modification_log.h"
+#include "modlog/log_merge_worker.h"
 
 #include "xdr/transaction.h"
 
@@ -85,4 +86,33 @@ TEST_CASE("tx accumulate", "[modlog]")
 	}
 }
 
+TEST_CASE("background merge", "[modlog]")
+{
+	AccountModificationLog log;
+	LogMergeWorker worker(log);
+
+	AccountModificationBlock expect;
+	for (uint64_t i = 0; i < 100; i++)
+	{
+		SerialAccountModificationLog s(log);
+
+		SignedTransaction tx;
+		tx.transaction.metadata.sourceAccount = i;
+		tx.transaction.metadata.sequenceNumber = 1llu << 8;
+
+		s.log_new_self_transaction(tx);
+		add_tx(expect, tx);
+	}
+
+	worker.do_merge();
+
+	// no explicit wait_for_merge_finish()
+	REQUIRE(log.size() == 100);
+
+	AccountModificationBlock result;
+	log.parallel_accumulate_values(result);
+
+	REQUIRE(result == expect);
+}
+
 }
\ No newline at end of file
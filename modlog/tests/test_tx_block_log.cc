@@ -0,0 +1,203 @@
+#include <catch2/catch_test_macros.hpp>
+
+#include "modlog/tx_block_log.h"
+
+#include "config.h"
+
+#include <filesystem>
+#include <fstream>
+#include <memory>
+
+namespace speedex
+{
+
+using xdr::operator==;
+
+struct tx_block_log_test_dir
+{
+	const std::string dir = std::string(ROOT_DB_DIRECTORY) + "tx_block_log_test/";
+
+	tx_block_log_test_dir()
+	{
+		std::filesystem::remove_all(dir);
+	}
+
+	~tx_block_log_test_dir()
+	{
+		std::filesystem::remove_all(dir);
+	}
+};
+
+HashedBlockTransactionListPair
+make_block(uint64_t block_number, size_t num_txs)
+{
+	HashedBlockTransactionListPair out;
+	out.hashedBlock.block.blockNumber = block_number;
+	out.hashedBlock.hash[0] = block_number;
+	for (size_t i = 0; i < num_txs; i++)
+	{
+		SignedTransaction tx;
+		tx.transaction.metadata.sourceAccount = i;
+		tx.transaction.metadata.sequenceNumber = block_number << 8;
+		out.txList.push_back(tx);
+	}
+	return out;
+}
+
+TEST_CASE("tx block log roundtrip", "[modlog]")
+{
+	tx_block_log_test_dir d;
+
+	std::vector<HashedBlockTransactionListPair> expect;
+
+	for (uint64_t i = 1; i <= 20; i++)
+	{
+		expect.push_back(make_block(i, i * 100));
+	}
+
+	SECTION("one segment")
+	{
+		{
+			TxBlockLog log(4, TxBlockLog::DEFAULT_SEGMENT_SIZE, d.dir);
+			for (auto const& b : expect)
+			{
+				log.log_block(std::make_shared<HashedBlockTransactionListPair>(b));
+			}
+			log.sync();
+		}
+
+		TxBlockLogReader reader(d.dir);
+		HashedBlockTransactionListPair b;
+		for (auto const& e : expect)
+		{
+			REQUIRE(reader.next(b));
+			REQUIRE(b == e);
+		}
+		REQUIRE(!reader.next(b));
+	}
+
+	SECTION("many segments")
+	{
+		{
+			TxBlockLog log(0, 100'000, d.dir);
+			for (auto const& b : expect)
+			{
+				log.log_block(std::make_shared<HashedBlockTransactionListPair>(b));
+			}
+		}
+
+		TxBlockLogReader reader(d.dir);
+		HashedBlockTransactionListPair b;
+		for (auto const& e : expect)
+		{
+			REQUIRE(reader.next(b));
+			REQUIRE(b == e);
+		}
+		REQUIRE(!reader.next(b));
+	}
+
+	SECTION("reopen appends")
+	{
+		{
+			TxBlockLog log(1, TxBlockLog::DEFAULT_SEGMENT_SIZE, d.dir);
+			log.log_block(std::make_shared<HashedBlockTransactionListPair>(expect[0]));
+		}
+		{
+			TxBlockLog log(1, TxBlockLog::DEFAULT_SEGMENT_SIZE, d.dir);
+			log.log_block(std::make_shared<HashedBlockTransactionListPair>(expect[1]));
+		}
+
+		TxBlockLogReader reader(d.dir);
+		HashedBlockTransactionListPair b;
+		REQUIRE(reader.next(b));
+		REQUIRE(b == expect[0]);
+		REQUIRE(reader.next(b));
+		REQUIRE(b == expect[1]);
+		REQUIRE(!reader.next(b));
+	}
+}
+
+TEST_CASE("tx block log corruption", "[modlog]")
+{
+	tx_block_log_test_dir d;
+
+	std::vector<HashedBlockTransactionListPair> expect;
+
+	for (uint64_t i = 1; i <= 3; i++)
+	{
+		expect.push_back(make_block(i, 100));
+	}
+
+	{
+		TxBlockLog log(0, TxBlockLog::DEFAULT_SEGMENT_SIZE, d.dir);
+		for (auto const& b : expect)
+		{
+			log.log_block(std::make_shared<HashedBlockTransactionListPair>(b));
+		}
+	}
+
+	std::filesystem::path segment;
+	for (auto const& entry : std::filesystem::directory_iterator(d.dir))
+	{
+		segment = entry.path();
+	}
+	auto segment_size = std::filesystem::file_size(segment);
+
+	HashedBlockTransactionListPair b;
+
+	SECTION("torn final record")
+	{
+		std::filesystem::resize_file(segment, segment_size - 100);
+
+		TxBlockLogReader reader(d.dir);
+		REQUIRE(reader.next(b));
+		REQUIRE(b == expect[0]);
+		REQUIRE(reader.next(b));
+		REQUIRE(b == expect[1]);
+		REQUIRE(!reader.next(b));
+	}
+
+	SECTION("zeroed preallocated tail")
+	{
+		std::filesystem::resize_file(segment, segment_size + 4096);
+
+		TxBlockLogReader reader(d.dir);
+		for (auto const& e : expect)
+		{
+			REQUIRE(reader.next(b));
+			REQUIRE(b == e);
+		}
+		REQUIRE(!reader.next(b));
+	}
+
+	SECTION("bad checksum mid segment")
+	{
+		{
+			std::fstream f(segment, std::ios::in | std::ios::out | std::ios::binary);
+			// inside the first record's payload
+			f.seekp(sizeof(detail::TxBlockLogRecordHeader) + 16);
+			f.put(0x55);
+		}
+
+		TxBlockLogReader reader(d.dir);
+		REQUIRE_THROWS_AS(reader.next(b), std::runtime_error);
+	}
+}
+
+TEST_CASE("tx block log write error", "[modlog]")
+{
+	tx_block_log_test_dir d;
+
+	auto block = make_block(1, 10);
+
+	TxBlockLog log(0, TxBlockLog::DEFAULT_SEGMENT_SIZE, d.dir);
+
+	// the first segment is opened on the first write
+	std::filesystem::remove_all(d.dir);
+
+	log.log_block(std::make_shared<HashedBlockTransactionListPair>(block));
+	REQUIRE_THROWS_AS(log.sync(), std::runtime_error);
+	REQUIRE_THROWS_AS(log.log_block(std::make_shared<HashedBlockTransactionListPair>(block)), std::runtime_error);
+}
+
+} /* speedex */
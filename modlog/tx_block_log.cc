@@ -0,0 +1,406 @@
+/**
+ * SPEEDEX: A Scalable, Parallelizable, and Economically Efficient Decentralized Exchange
+ * Copyright (C) 2023 Geoffrey Ramseyer
+
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "modlog/tx_block_log.h"
+
+#include "utils/debug_macros.h"
+#include "utils/save_load_xdr.h"
+
+#include "config.h"
+
+#include <utils/mkdir.h>
+
+#include <sodium.h>
+
+#include <xdrpp/marshal.h>
+
+#include <algorithm>
+#include <cinttypes>
+#include <cstdio>
+#include <cstring>
+#include <filesystem>
+#include <memory>
+
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+namespace speedex {
+
+using detail::TxBlockLogRecordHeader;
+using detail::TX_BLOCK_LOG_ALIGNMENT;
+
+namespace {
+
+constexpr static char SEGMENT_PREFIX[] = "segment_";
+constexpr static char SEGMENT_SUFFIX[] = ".wal";
+
+size_t
+round_up_to_alignment(size_t len) {
+	return ((len + TX_BLOCK_LOG_ALIGNMENT - 1) / TX_BLOCK_LOG_ALIGNMENT) * TX_BLOCK_LOG_ALIGNMENT;
+}
+
+std::string
+segment_filename(std::string const& dir, uint64_t segment_idx) {
+	// zero padded, so that lexicographic order is write order
+	char buf[21];
+	std::snprintf(buf, sizeof(buf), "%020" PRIu64, segment_idx);
+	return dir + std::string(SEGMENT_PREFIX) + std::string(buf) + std::string(SEGMENT_SUFFIX);
+}
+
+std::vector<std::string>
+list_segments(std::string const& dir) {
+	std::vector<std::string> out;
+	std::error_code ec;
+	for (auto const& entry : std::filesystem::directory_iterator(dir, ec)) {
+		auto name = entry.path().filename().string();
+		if (name.starts_with(SEGMENT_PREFIX) && name.ends_with(SEGMENT_SUFFIX)) {
+			out.push_back(entry.path().string());
+		}
+	}
+	std::sort(out.begin(), out.end());
+	return out;
+}
+
+void
+checksum(uint8_t* out, const unsigned char* data, size_t len) {
+	if (crypto_generichash(out, 32, data, len, NULL, 0) != 0) {
+		throw std::runtime_error("error in crypto_generichash");
+	}
+}
+
+} /* anonymous namespace */
+
+std::string
+tx_block_log_dir() {
+	return std::string(ROOT_DB_DIRECTORY) + std::string(TX_BLOCK_DB);
+}
+
+TxBlockLog::TxBlockLog(
+	uint32_t fsync_group_size,
+	size_t segment_size,
+	std::string dir)
+	: utils::AsyncWorker()
+	, dir(dir)
+	, fsync_group_size(fsync_group_size)
+	, segment_size(segment_size)
+	, pending_blocks()
+	, sync_requested(false)
+	, write_in_progress(false)
+	, write_error()
+	, segment_fd()
+	, next_segment_idx(0)
+	, segment_bytes_written(0)
+	, blocks_since_fsync(0)
+	, buffer(new unsigned char[BUF_SIZE + TX_BLOCK_LOG_ALIGNMENT])
+	, aligned_buf(nullptr)
+{
+	void* buf_head = static_cast<void*>(buffer.get());
+	size_t buf_size = BUF_SIZE + TX_BLOCK_LOG_ALIGNMENT;
+	aligned_buf = reinterpret_cast<unsigned char*>(
+		std::align(TX_BLOCK_LOG_ALIGNMENT, BUF_SIZE, buf_head, buf_size));
+
+	if (aligned_buf == nullptr) {
+		throw std::runtime_error("failed to align tx block log buffer");
+	}
+
+	utils::mkdir_safe(ROOT_DB_DIRECTORY);
+	utils::mkdir_safe(dir.c_str());
+
+	// never overwrite segments from a previous run
+	auto existing = list_segments(dir);
+	next_segment_idx = existing.size();
+	while (std::filesystem::exists(segment_filename(dir, next_segment_idx))) {
+		next_segment_idx++;
+	}
+
+	start_async_thread([this] {run();});
+}
+
+TxBlockLog::~TxBlockLog() {
+	try {
+		sync();
+	} catch (std::exception const& e) {
+		BLOCK_INFO("tx block log write failed: %s", e.what());
+	}
+	terminate_worker();
+	close_segment();
+}
+
+void
+TxBlockLog::rethrow_write_error() {
+	if (write_error) {
+		std::rethrow_exception(write_error);
+	}
+}
+
+void
+TxBlockLog::log_block(block_ptr block) {
+	std::lock_guard lock(mtx);
+	rethrow_write_error();
+	pending_blocks.push_back(std::move(block));
+	cv.notify_all();
+}
+
+void
+TxBlockLog::sync() {
+	{
+		std::lock_guard lock(mtx);
+		sync_requested = true;
+		cv.notify_all();
+	}
+	wait_for_async_task();
+
+	std::lock_guard lock(mtx);
+	rethrow_write_error();
+}
+
+void
+TxBlockLog::run() {
+	while (true) {
+		std::unique_lock lock(mtx);
+		if ((!done_flag) && (!exists_work_to_do())) {
+			cv.wait(lock, [this] () {return done_flag || exists_work_to_do();});
+		}
+		if (done_flag) return;
+
+		// callers can keep queueing blocks while this batch is written
+		auto blocks = std::move(pending_blocks);
+		pending_blocks.clear();
+		bool do_sync = sync_requested;
+		sync_requested = false;
+		// after a failed write, nothing more is appended
+		// (later records would follow a gap in the log)
+		bool failed = (write_error != nullptr);
+		write_in_progress = true;
+		lock.unlock();
+
+		std::exception_ptr error;
+		if (!failed) {
+			try {
+				for (auto const& block : blocks) {
+					write_block(*block);
+				}
+
+				if (do_sync || (fsync_group_size > 0 && blocks_since_fsync >= fsync_group_size)) {
+					fsync_segment();
+				}
+			} catch (...) {
+				error = std::current_exception();
+			}
+		}
+
+		lock.lock();
+		if (error) {
+			write_error = error;
+		}
+		write_in_progress = false;
+		cv.notify_all();
+	}
+}
+
+void
+TxBlockLog::write_block(block_t const& block) {
+	auto payload = xdr::xdr_to_opaque(block);
+
+	if (payload.size() > UINT32_MAX) {
+		throw std::runtime_error("tx block too large for log");
+	}
+
+	TxBlockLogRecordHeader header;
+	header.magic = TxBlockLogRecordHeader::MAGIC;
+	header.payload_len = payload.size();
+	header.block_number = block.hashedBlock.block.blockNumber;
+	checksum(header.checksum, payload.data(), payload.size());
+
+	size_t record_len = round_up_to_alignment(sizeof(header) + payload.size());
+
+	if ((!segment_fd) || (segment_bytes_written + record_len > segment_size)) {
+		close_segment();
+		open_segment(record_len);
+	}
+
+	size_t buf_idx = 0;
+
+	auto append = [&] (const unsigned char* data, size_t len) {
+		while (len > 0) {
+			size_t amount = std::min(len, BUF_SIZE - buf_idx);
+			std::memcpy(aligned_buf + buf_idx, data, amount);
+			buf_idx += amount;
+			data += amount;
+			len -= amount;
+			if (buf_idx == BUF_SIZE) {
+				flush_buffer(segment_fd, aligned_buf, BUF_SIZE);
+				buf_idx = 0;
+			}
+		}
+	};
+
+	append(reinterpret_cast<const unsigned char*>(&header), sizeof(header));
+	append(payload.data(), payload.size());
+
+	if (buf_idx > 0) {
+		size_t padded = round_up_to_alignment(buf_idx);
+		std::memset(aligned_buf + buf_idx, 0, padded - buf_idx);
+		flush_buffer(segment_fd, aligned_buf, padded);
+	}
+
+	segment_bytes_written += record_len;
+	blocks_since_fsync++;
+}
+
+void
+TxBlockLog::open_segment(size_t min_size) {
+	auto filename = segment_filename(dir, next_segment_idx);
+	next_segment_idx++;
+
+	int flags = O_CREAT | O_WRONLY | O_TRUNC;
+#ifndef __APPLE__
+	flags |= O_DIRECT;
+#endif
+
+	segment_fd = utils::unique_fd{open(filename.c_str(), flags, S_IRUSR | S_IWUSR | S_IRGRP | S_IROTH)};
+	if (!segment_fd) {
+		utils::threrror("failed to open tx block log segment");
+	}
+
+#ifndef __APPLE__
+	if (fallocate(segment_fd.get(), 0, 0, std::max(segment_size, min_size))) {
+		utils::threrror("fallocate");
+	}
+#endif
+
+	segment_bytes_written = 0;
+}
+
+void
+TxBlockLog::close_segment() {
+	if (!segment_fd) {
+		return;
+	}
+	// trim the unused preallocated tail
+	if (ftruncate(segment_fd.get(), segment_bytes_written)) {
+		utils::threrror("ftruncate");
+	}
+	fsync_segment();
+	segment_fd.clear();
+}
+
+void
+TxBlockLog::fsync_segment() {
+	if (segment_fd) {
+		if (fsync(segment_fd.get())) {
+			utils::threrror("fsync");
+		}
+	}
+	blocks_since_fsync = 0;
+}
+
+TxBlockLogReader::TxBlockLogReader(std::string dir)
+	: segment_filenames(list_segments(dir))
+	, next_segment(0)
+	, segment_contents()
+	, offset(0)
+	{}
+
+bool
+TxBlockLogReader::load_next_segment() {
+	segment_contents.clear();
+	offset = 0;
+
+	if (next_segment >= segment_filenames.size()) {
+		return false;
+	}
+
+	auto const& filename = segment_filenames[next_segment];
+	next_segment++;
+
+	FILE* f = std::fopen(filename.c_str(), "r");
+	if (f == nullptr) {
+		throw std::runtime_error("failed to open tx block log segment " + filename);
+	}
+
+	const size_t READ_SIZE = 1 << 20;
+	size_t count = 0;
+	do {
+		size_t cur_size = segment_contents.size();
+		segment_contents.resize(cur_size + READ_SIZE);
+		count = std::fread(segment_contents.data() + cur_size, 1, READ_SIZE, f);
+		segment_contents.resize(cur_size + count);
+	} while (count > 0);
+
+	std::fclose(f);
+	return true;
+}
+
+bool
+TxBlockLogReader::next(HashedBlockTransactionListPair& out) {
+	while (true) {
+		if (offset + sizeof(TxBlockLogRecordHeader) > segment_contents.size()) {
+			if (!load_next_segment()) {
+				return false;
+			}
+			continue;
+		}
+
+		TxBlockLogRecordHeader header;
+		std::memcpy(&header, segment_contents.data() + offset, sizeof(header));
+
+		const unsigned char* payload = segment_contents.data() + offset + sizeof(header);
+
+		bool valid = (header.magic == TxBlockLogRecordHeader::MAGIC)
+			&& (offset + sizeof(header) + header.payload_len <= segment_contents.size());
+
+		if (valid) {
+			uint8_t expect[32];
+			checksum(expect, payload, header.payload_len);
+			valid = (std::memcmp(expect, header.checksum, 32) == 0);
+		}
+
+		if (!valid) {
+			// The end of the written part of this segment, or a write torn
+			// by a crash.  Either way, nothing after it was written.
+			size_t record_end = offset;
+			if (header.magic == TxBlockLogRecordHeader::MAGIC) {
+				record_end = std::min(segment_contents.size(),
+					offset + round_up_to_alignment(sizeof(header) + header.payload_len));
+			}
+			bool rest_empty = std::all_of(
+				segment_contents.begin() + record_end,
+				segment_contents.end(),
+				[] (unsigned char c) { return c == 0; });
+
+			if (!rest_empty) {
+				throw std::runtime_error("corrupt tx block log record at offset "
+					+ std::to_string(offset) + " of " + segment_filenames[next_segment - 1]);
+			}
+
+			offset = segment_contents.size();
+			continue;
+		}
+
+		xdr::xdr_get g(payload, payload + header.payload_len);
+		xdr::xdr_argpack_archive(g, out);
+		g.done();
+
+		offset += round_up_to_alignment(sizeof(header) + header.payload_len);
+		return true;
+	}
+}
+
+} /* speedex */
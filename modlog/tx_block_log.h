@@ -0,0 +1,166 @@
+/**
+ * SPEEDEX: A Scalable, Parallelizable, and Economically Efficient Decentralized Exchange
+ * Copyright (C) 2023 Geoffrey Ramseyer
+
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#pragma once
+
+/*! \file tx_block_log.h
+
+Append-only, segment-based log of transaction blocks
+(header + transaction list), for audit and replay.
+
+Blocks are handed to a background thread, which serializes them and appends
+them to the current segment with O_DIRECT writes.  Segments are
+preallocated, and are numbered in the order they were written.
+The log is fsynced once every fsync_group_size blocks (group commit),
+or when sync() is called.
+
+Each record is a fixed-size record header (magic, payload length,
+block number, payload checksum) followed by the xdr-serialized
+HashedBlockTransactionListPair, padded to a 512 byte boundary.
+A torn record at the end of a segment (after a crash) fails its checksum
+and ends that segment.  Any other invalid record is reported as
+corruption.
+
+If a write fails on the background thread, the log stops appending,
+and the error is rethrown by the next log_block() or sync().
+
+Only committed blocks are logged (see SpeedexVM), in commit order.
+A block that failed validation is logged under its corrected header,
+with no transactions.
+*/
+
+#include "xdr/block.h"
+
+#include <utils/async_worker.h>
+#include <utils/cleanup.h>
+
+#include <cstdint>
+#include <exception>
+#include <memory>
+#include <string>
+#include <vector>
+
+namespace speedex {
+
+std::string tx_block_log_dir();
+
+namespace detail {
+
+struct TxBlockLogRecordHeader {
+	constexpr static uint32_t MAGIC = 0x5458424C; // "TXBL"
+
+	uint32_t magic;
+	uint32_t payload_len;
+	uint64_t block_number;
+	uint8_t checksum[32];
+};
+
+static_assert(sizeof(TxBlockLogRecordHeader) == 48, "unexpected padding");
+
+constexpr static size_t TX_BLOCK_LOG_ALIGNMENT = 512;
+
+} /* detail */
+
+class TxBlockLog : public utils::AsyncWorker {
+
+	using utils::AsyncWorker::mtx;
+	using utils::AsyncWorker::cv;
+
+	using block_t = HashedBlockTransactionListPair;
+	using block_ptr = std::shared_ptr<const block_t>;
+
+	const std::string dir;
+	const uint32_t fsync_group_size;
+	const size_t segment_size;
+
+	// shared with callers, protected by mtx
+	std::vector<block_ptr> pending_blocks;
+	bool sync_requested;
+	bool write_in_progress;
+	std::exception_ptr write_error;
+
+	// owned by the background thread
+	utils::unique_fd segment_fd;
+	uint64_t next_segment_idx;
+	size_t segment_bytes_written;
+	uint32_t blocks_since_fsync;
+
+	constexpr static size_t BUF_SIZE = 1 << 20;
+	std::unique_ptr<unsigned char[]> buffer;
+	unsigned char* aligned_buf;
+
+	bool exists_work_to_do() override final {
+		return pending_blocks.size() > 0 || sync_requested || write_in_progress;
+	}
+
+	void run();
+
+	// call with mtx held
+	void rethrow_write_error();
+
+	void write_block(block_t const& block);
+	void open_segment(size_t min_size);
+	void close_segment();
+	void fsync_segment();
+
+public:
+
+	constexpr static size_t DEFAULT_SEGMENT_SIZE = 256'000'000;
+
+	//! fsync_group_size = 0 means only fsync on sync() or segment rollover.
+	TxBlockLog(
+		uint32_t fsync_group_size,
+		size_t segment_size = DEFAULT_SEGMENT_SIZE,
+		std::string dir = tx_block_log_dir());
+
+	//! Flushes any blocks that are still queued.
+	~TxBlockLog();
+
+	//! Queue a block to be appended.  Returns immediately;
+	//! serialization and I/O happen in the background.
+	//! The block is shared, not copied, so the caller must not modify it.
+	void log_block(block_ptr block);
+
+	//! Wait until every queued block is written and fsynced.
+	//! Throws if a write failed.
+	void sync();
+};
+
+/*! Streams blocks back out of a tx block log, in the order
+they were written.
+*/
+class TxBlockLogReader {
+
+	std::vector<std::string> segment_filenames;
+	size_t next_segment;
+
+	std::vector<unsigned char> segment_contents;
+	size_t offset;
+
+	bool load_next_segment();
+
+public:
+
+	TxBlockLogReader(std::string dir = tx_block_log_dir());
+
+	//! Read the next block.  Returns false at the end of the log.
+	//! Throws if a record other than the last of its segment is invalid.
+	bool next(HashedBlockTransactionListPair& out);
+};
+
+} /* speedex */
@@ -46,6 +46,12 @@ struct EndowAccumulator {
 		endow_times_price += other.endow_times_price;
 		return *this;
 	}
+
+	EndowAccumulator& operator-=(const EndowAccumulator& other) {
+		endow -= other.endow;
+		endow_times_price -= other.endow_times_price;
+		return *this;
+	}
 };
 
 } /* speedex */
\ No newline at end of file
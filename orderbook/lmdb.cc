@@ -25,6 +25,7 @@
 
 #include "speedex/speedex_static_configs.h"
 
+#include <algorithm>
 #include <cinttypes>
 #include <set>
 
@@ -103,6 +104,10 @@ OrderbookLMDB::write_thunks(const uint64_t current_block_number,
 
         std::set<prefix_t> keys_that_will_be_later_deleted;
 
+        // In batched mode, deletes from every thunk are applied together,
+        // in key order, once the loop below finishes.
+        std::vector<prefix_t> batched_deletes;
+
         for (uint32_t i = 0; i < relevant_thunks.size(); i++)
         {
             auto& thunk = relevant_thunks[i];
@@ -122,6 +127,11 @@ OrderbookLMDB::write_thunks(const uint64_t current_block_number,
             for (auto& delete_kv : thunk.deleted_keys.deleted_keys)
             {
                 auto& delete_key = delete_kv.first;
+                if (batch_writes)
+                {
+                    batched_deletes.push_back(delete_key);
+                    continue;
+                }
                 auto bytes = delete_key.template get_bytes_array<get_bytes_array_t>();
                 dbval key = dbval{ bytes };
                 if (!wtx.del(get_data_dbi(), key))
@@ -145,6 +155,23 @@ OrderbookLMDB::write_thunks(const uint64_t current_block_number,
             }
         }
 
+        if (batch_writes)
+        {
+            // deletes are independent of one another, so order is free
+            std::sort(batched_deletes.begin(), batched_deletes.end());
+            for (auto const& delete_key : batched_deletes)
+            {
+                auto bytes = delete_key.template get_bytes_array<get_bytes_array_t>();
+                dbval key = dbval{ bytes };
+                if (!wtx.del(get_data_dbi(), key))
+                {
+                    // sorted input, so this is an amortized O(1) insert
+                    keys_that_will_be_later_deleted.insert(
+                        keys_that_will_be_later_deleted.end(), delete_key);
+                }
+            }
+        }
+
         INTEGRITY_CHECK(
             "final max key: %s",
             debug::array_to_str(key_buf, MerkleWorkUnit::WORKUNIT_KEY_LEN).c_str());
@@ -210,6 +237,15 @@ OrderbookLMDB::write_thunks(const uint64_t current_block_number,
         if (print)
             std::printf("phase 3\n");
 
+        // In batched mode, phase 3 puts are gathered here (in the order they
+        // would otherwise be written), then sorted and written in key order.
+        struct BatchedOfferPut
+        {
+            prefix_t key;
+            const Offer* offer;
+        };
+        std::vector<BatchedOfferPut> batched_puts;
+
         // signed int is important for this for loop
         for (int32_t i = relevant_thunks.size() - 1; i >= 0; i--)
         {
@@ -285,7 +321,11 @@ OrderbookLMDB::write_thunks(const uint64_t current_block_number,
                         db_put = false;
                     }
 
-                    if (db_put)
+                    if (db_put && batch_writes)
+                    {
+                        batched_puts.push_back(
+                            BatchedOfferPut{ offer_key_buf, &cur_offer });
+                    } else if (db_put)
                     {
 
                         auto offer_key_buf_bytes = offer_key_buf.template get_bytes_array<get_bytes_array_t>();
@@ -315,6 +355,42 @@ OrderbookLMDB::write_thunks(const uint64_t current_block_number,
                 std::printf("done phase 3 loop\n");
         }
 
+        if (batch_writes)
+        {
+            std::stable_sort(batched_puts.begin(),
+                             batched_puts.end(),
+                             [](BatchedOfferPut const& a, BatchedOfferPut const& b) {
+                                 return a.key < b.key;
+                             });
+
+            for (size_t j = 0; j < batched_puts.size(); j++)
+            {
+                // of several puts to one key, the last one gathered is the
+                // one that the unbatched path would leave in the db.
+                if (j + 1 < batched_puts.size()
+                    && !(batched_puts[j].key < batched_puts[j + 1].key))
+                {
+                    continue;
+                }
+
+                auto offer_key_bytes
+                    = batched_puts[j].key.template get_bytes_array<get_bytes_array_t>();
+                dbval db_key = dbval{ offer_key_bytes };
+
+                auto value_buf = xdr::xdr_to_opaque(*batched_puts[j].offer);
+                dbval value = dbval{ value_buf.data(), value_buf.size() };
+                try
+                {
+                    wtx.put(get_data_dbi(), &db_key, &value);
+                }
+                catch (...)
+                {
+                    std::printf("failed to insert offer to offer lmdb\n");
+                    throw;
+                }
+            }
+        }
+
         // insert the partial exec offers
 
         if (print)
@@ -506,10 +582,30 @@ OrderbookLMDB::write_thunks(const uint64_t current_block_number,
     return garbage;
 }
 
+void
+OrderbookLMDB::write_offers(std::vector<Offer> const& offers,
+                            lmdb::dbenv::wtxn& wtx)
+{
+    prefix_t offer_key_buf;
+
+    for (auto const& offer : offers)
+    {
+        generate_orderbook_trie_key(offer, offer_key_buf);
+
+        auto offer_key_bytes = offer_key_buf.template get_bytes_array<get_bytes_array_t>();
+        dbval db_key = dbval{ offer_key_bytes };
+
+        auto value_buf = xdr::xdr_to_opaque(offer);
+        dbval value = dbval{ value_buf.data(), value_buf.size() };
+        wtx.put(get_data_dbi(), &db_key, &value);
+    }
+}
+
 OrderbookLMDB::OrderbookLMDB(OfferCategory const& category,
                              OrderbookManagerLMDB& manager_lmdb)
     : SharedLMDBInstance(manager_lmdb.get_base_instance(category))
     , thunks()
+    , batch_writes(manager_lmdb.get_batch_writes())
     , mtx(std::make_unique<std::mutex>())
 {}
 
@@ -56,6 +56,10 @@ class OrderbookManagerLMDB {
 
 	const size_t num_orderbooks;
 
+	//! Whether orderbooks apply their writes in key order
+	//! (see OrderbookLMDB::write_thunks()).
+	const bool batch_writes;
+
 	std::string get_lmdb_env_name() {
 		return std::string(ROOT_DB_DIRECTORY) 
 		+ std::string(OFFER_DB);
@@ -65,11 +69,16 @@ public:
 
 	/*! Initialize lmdb with mapsize of 2^40 (somewhat arbitrary choice)
 	*/
-	OrderbookManagerLMDB(size_t num_orderbooks)
+	OrderbookManagerLMDB(size_t num_orderbooks, bool batch_writes)
 		: base_instance{0x100'0000'0000, num_orderbooks + 1}
 		, num_orderbooks(num_orderbooks)
+		, batch_writes(batch_writes)
 		{}
 
+	bool get_batch_writes() const {
+		return batch_writes;
+	}
+
 	lmdb::BaseLMDBInstance& get_base_instance(OfferCategory const& category) {
 		return base_instance;
 	}
@@ -111,6 +120,10 @@ class OrderbookLMDB : public lmdb::SharedLMDBInstance {
 
 	std::vector<thunk_t> thunks;
 
+	//! Gather the puts and deletes of all the thunks written together,
+	//! and apply them in key order.
+	bool batch_writes;
+
 	using trie_t = OrderbookTrie::TrieT;
 
 	//! Use lock to make sure that during normal processing/validation,
@@ -129,6 +142,9 @@ public:
 	/*! Persist accumulated thunks to disk, up to current_block_number.
 		Take care to not migrate wtx across threads.
 
+		With batch_writes, deletes and offer puts are sorted into key
+		order first.  The resulting db contents are the same.
+
 		Erases thunks that were committed to disk from memory.
 
 		Returns a list of pointers which the caller is responsible for deleting.
@@ -140,6 +156,11 @@ public:
 		lmdb::dbenv::wtxn& wtx,
 		bool debug = false);
 
+	/*! Put offers directly, bypassing thunks.
+		Used to fill an empty lmdb from a full state snapshot.
+	*/
+	void write_offers(std::vector<Offer> const& offers, lmdb::dbenv::wtxn& wtx);
+
 	//used for testing only, particularly wrt tatonnement_sim
 	void clear_() {
 		thunks.clear();
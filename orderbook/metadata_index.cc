@@ -0,0 +1,261 @@
+/**
+ * SPEEDEX: A Scalable, Parallelizable, and Economically Efficient Decentralized Exchange
+ * Copyright (C) 2023 Geoffrey Ramseyer
+
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "orderbook/metadata_index.h"
+
+#include <algorithm>
+#include <stdexcept>
+
+namespace speedex {
+
+void
+OrderbookMetadataIndex::Block::recompute_cumulative()
+{
+    cumulative.resize(values.size());
+    EndowAccumulator acc;
+    for (size_t i = 0; i < values.size(); i++) {
+        acc += values[i];
+        cumulative[i] = acc;
+    }
+}
+
+void
+OrderbookMetadataIndex::clear()
+{
+    blocks.clear();
+    block_first_keys.clear();
+    block_offsets.clear();
+    block_positions.clear();
+    num_keys = 0;
+}
+
+void
+OrderbookMetadataIndex::rebuild(std::vector<Entry> const& per_key_totals)
+{
+    clear();
+
+    constexpr size_t fill = MAX_BLOCK_SIZE / 2;
+
+    for (size_t i = 0; i < per_key_totals.size(); i++) {
+        if (i > 0 && per_key_totals[i].key <= per_key_totals[i - 1].key) {
+            throw std::runtime_error("metadata index input not sorted");
+        }
+        if (i % fill == 0) {
+            blocks.emplace_back();
+        }
+        blocks.back().keys.push_back(per_key_totals[i].key);
+        blocks.back().values.push_back(per_key_totals[i].metadata);
+    }
+    for (auto& block : blocks) {
+        block.recompute_cumulative();
+    }
+    num_keys = per_key_totals.size();
+    recompute_block_summaries(false);
+}
+
+size_t
+OrderbookMetadataIndex::find_block(Price p) const
+{
+    auto it = std::upper_bound(
+        block_first_keys.begin(), block_first_keys.end(), p);
+    if (it == block_first_keys.begin()) {
+        return blocks.size();
+    }
+    return (it - block_first_keys.begin()) - 1;
+}
+
+void
+OrderbookMetadataIndex::apply_deltas(std::vector<Entry>& deltas)
+{
+    if (deltas.empty()) {
+        return;
+    }
+
+    std::sort(deltas.begin(), deltas.end(), [](Entry const& a, Entry const& b) {
+        return a.key < b.key;
+    });
+
+    std::vector<bool> dirty(blocks.size(), false);
+
+    size_t i = 0;
+    while (i < deltas.size()) {
+        Price key = deltas[i].key;
+        EndowAccumulator delta = deltas[i].metadata;
+        i++;
+        while (i < deltas.size() && deltas[i].key == key) {
+            delta += deltas[i].metadata;
+            i++;
+        }
+
+        if (delta.endow == 0) {
+            // e.g. an offer added and cleared between two commits
+            continue;
+        }
+
+        if (blocks.empty()) {
+            blocks.emplace_back();
+            block_first_keys.push_back(key);
+            dirty.push_back(false);
+        }
+
+        size_t b = find_block(key);
+        if (b == blocks.size()) {
+            // below every key in the index
+            b = 0;
+        }
+        auto& block = blocks[b];
+
+        auto it = std::lower_bound(block.keys.begin(), block.keys.end(), key);
+        size_t j = it - block.keys.begin();
+
+        if (it != block.keys.end() && *it == key) {
+            block.values[j] += delta;
+            if (block.values[j].endow < 0) {
+                throw std::runtime_error(
+                    "metadata index delta removes more than present");
+            }
+            if (block.values[j].endow == 0) {
+                block.keys.erase(it);
+                block.values.erase(block.values.begin() + j);
+                num_keys--;
+            }
+        } else {
+            if (delta.endow < 0) {
+                throw std::runtime_error(
+                    "metadata index delta removes absent price");
+            }
+            block.keys.insert(it, key);
+            block.values.insert(block.values.begin() + j, delta);
+            num_keys++;
+        }
+        if (!block.keys.empty()) {
+            block_first_keys[b] = block.keys.front();
+        }
+        dirty[b] = true;
+    }
+
+    for (size_t b = 0; b < blocks.size(); b++) {
+        if (dirty[b]) {
+            blocks[b].recompute_cumulative();
+        }
+    }
+    recompute_block_summaries(true);
+}
+
+void
+OrderbookMetadataIndex::recompute_block_summaries(bool restructure)
+{
+    if (restructure) {
+        std::vector<Block> new_blocks;
+        new_blocks.reserve(blocks.size());
+
+        constexpr size_t fill = MAX_BLOCK_SIZE / 2;
+
+        for (auto& block : blocks) {
+            if (block.keys.empty()) {
+                continue;
+            }
+
+            // merge small neighbors, so that churn concentrated
+            // in one region does not fragment the index
+            if (!new_blocks.empty()
+                && new_blocks.back().keys.size() + block.keys.size() <= fill) {
+                auto& prev = new_blocks.back();
+                prev.keys.insert(
+                    prev.keys.end(), block.keys.begin(), block.keys.end());
+                prev.values.insert(
+                    prev.values.end(), block.values.begin(), block.values.end());
+                prev.recompute_cumulative();
+                continue;
+            }
+
+            if (block.keys.size() <= MAX_BLOCK_SIZE) {
+                new_blocks.push_back(std::move(block));
+                continue;
+            }
+
+            for (size_t start = 0; start < block.keys.size(); start += fill) {
+                size_t end = std::min(start + fill, block.keys.size());
+                Block split;
+                split.keys.assign(
+                    block.keys.begin() + start, block.keys.begin() + end);
+                split.values.assign(
+                    block.values.begin() + start, block.values.begin() + end);
+                split.recompute_cumulative();
+                new_blocks.push_back(std::move(split));
+            }
+        }
+        blocks = std::move(new_blocks);
+    }
+
+    block_first_keys.resize(blocks.size());
+    block_offsets.resize(blocks.size());
+    block_positions.resize(blocks.size());
+
+    EndowAccumulator acc;
+    size_t position = 0;
+    for (size_t b = 0; b < blocks.size(); b++) {
+        block_first_keys[b] = blocks[b].keys.front();
+        block_offsets[b] = acc;
+        block_positions[b] = position;
+        acc += blocks[b].cumulative.back();
+        position += blocks[b].keys.size();
+    }
+}
+
+EndowAccumulator
+OrderbookMetadataIndex::lookup(Price p) const
+{
+    size_t b = find_block(p);
+    if (b == blocks.size()) {
+        return EndowAccumulator{};
+    }
+    auto const& block = blocks[b];
+
+    // block's first key is <= p, so j >= 0
+    size_t j = (std::upper_bound(block.keys.begin(), block.keys.end(), p)
+                - block.keys.begin())
+               - 1;
+
+    EndowAccumulator out = block_offsets[b];
+    out += block.cumulative[j];
+    return out;
+}
+
+OrderbookMetadataIndex::Entry
+OrderbookMetadataIndex::operator[](size_t idx) const
+{
+    if (idx == 0) {
+        return Entry{0, EndowAccumulator{}};
+    }
+    if (idx > num_keys) {
+        throw std::runtime_error("metadata index access out of bounds");
+    }
+    size_t pos = idx - 1;
+    size_t b = (std::upper_bound(
+                    block_positions.begin(), block_positions.end(), pos)
+                - block_positions.begin())
+               - 1;
+    size_t j = pos - block_positions[b];
+
+    EndowAccumulator metadata = block_offsets[b];
+    metadata += blocks[b].cumulative[j];
+    return Entry{blocks[b].keys[j], metadata};
+}
+
+} // namespace speedex
@@ -0,0 +1,153 @@
+/**
+ * SPEEDEX: A Scalable, Parallelizable, and Economically Efficient Decentralized Exchange
+ * Copyright (C) 2023 Geoffrey Ramseyer
+
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#pragma once
+
+/*! \file metadata_index.h
+
+Index over the distinct limit prices of an orderbook, answering
+"total endowment (and endowment times price) of offers with limit price
+at most p".  Tatonnement's demand queries call this in their inner loop.
+
+Unlike rebuilding the index from the committed offer trie each block,
+this index can be updated from the per-block diff (offers added,
+deleted, and cleared), in time proportional to the number of changed
+price points (plus one pass over the block summaries), not the size of
+the book.
+*/
+
+#include "orderbook/helpers.h"
+
+#include "xdr/types.h"
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+namespace speedex {
+
+/*! Two-level sorted index of price points.
+
+Price points are kept in sorted blocks of at most MAX_BLOCK_SIZE keys.
+Each block stores per-key totals and their running sums within the block,
+and the index stores each block's first key and the cumulative totals
+of all preceding blocks.  A lookup is two binary searches, and an
+update touches only the blocks containing changed price points, plus one
+linear pass over the (num keys / block size) block summaries.
+
+Positions mirror the flat index produced by metadata_traversal:
+entry 0 is a zero sentinel below every key, and entry i (i >= 1)
+is the i-th smallest key, with cumulative totals up to and including it.
+*/
+class OrderbookMetadataIndex {
+
+public:
+
+	struct Entry {
+		Price key;
+		EndowAccumulator metadata;
+	};
+
+	constexpr static size_t MAX_BLOCK_SIZE = 512;
+
+private:
+
+	struct Block {
+		std::vector<Price> keys;
+		//! Totals of the offers at each key.
+		std::vector<EndowAccumulator> values;
+		//! Running sums of values within the block (inclusive).
+		std::vector<EndowAccumulator> cumulative;
+
+		void recompute_cumulative();
+	};
+
+	std::vector<Block> blocks;
+
+	//! First key of each block.
+	std::vector<Price> block_first_keys;
+	//! Totals of all blocks before each block.
+	std::vector<EndowAccumulator> block_offsets;
+	//! Number of keys in all blocks before each block.
+	std::vector<size_t> block_positions;
+
+	size_t num_keys = 0;
+
+	//! Index of the last block whose first key is <= p,
+	//! or blocks.size() if there is no such block.
+	size_t find_block(Price p) const;
+
+	//! Split oversized blocks, drop empty ones, and recompute
+	//! the block summaries.
+	void recompute_block_summaries(bool restructure);
+
+public:
+
+	//! Replace the index contents.  Input is per-key totals, 
+	//! sorted by key, with distinct keys.
+	void rebuild(std::vector<Entry> const& per_key_totals);
+
+	//! Replace the index contents from a flat cumulative index
+	//! (e.g. the output of metadata_traversal, sentinel at 0).
+	template<typename CumulativeEntry>
+	void rebuild_from_cumulative(std::vector<CumulativeEntry> const& index) {
+		std::vector<Entry> per_key_totals;
+		for (size_t i = 1; i < index.size(); i++) {
+			EndowAccumulator metadata = index[i].metadata;
+			metadata -= index[i-1].metadata;
+			per_key_totals.push_back(Entry{index[i].key, metadata});
+		}
+		rebuild(per_key_totals);
+	}
+
+	/*! Apply a set of changes to per-key totals.
+	
+	Deltas need not be sorted or distinct.  Keys whose total reaches 0
+	are removed.  Throws if a delta would remove more than a key holds
+	(i.e. the index has fallen out of sync with the offers).
+	*/
+	void apply_deltas(std::vector<Entry>& deltas);
+
+	//! Cumulative totals of all keys <= p.
+	EndowAccumulator lookup(Price p) const;
+
+	//! Number of entries, including the zero sentinel at position 0.
+	size_t size() const {
+		return num_keys + 1;
+	}
+
+	//! Entry at a position (see class doc).  O(log(num blocks)).
+	Entry operator[](size_t idx) const;
+
+	//! Visit every entry after the sentinel, in key order.
+	template<typename Fn>
+	void for_each_entry(Fn&& fn) const {
+		for (size_t b = 0; b < blocks.size(); b++) {
+			auto const& block = blocks[b];
+			for (size_t j = 0; j < block.keys.size(); j++) {
+				EndowAccumulator metadata = block_offsets[b];
+				metadata += block.cumulative[j];
+				fn(Entry{block.keys[j], metadata});
+			}
+		}
+	}
+
+	void clear();
+};
+
+} /* speedex */
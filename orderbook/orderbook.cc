@@ -104,6 +104,15 @@ Orderbook::tentative_commit_for_validation(uint64_t current_block_number)
             = uncommitted_offers.accumulate_values<std::vector<Offer>>();
         auto& accumulate_deleted_keys = thunk.deleted_keys;
         committed_offers.perform_marked_deletions(accumulate_deleted_keys);
+
+        if (metadata_index_valid) {
+            for (auto const& offer : thunk.uncommitted_offers_vec) {
+                record_metadata_delta(offer, true);
+            }
+            for (auto const& kv : accumulate_deleted_keys.deleted_keys) {
+                record_metadata_delta(kv.second, false);
+            }
+        }
     }
     committed_offers.merge_in(std::move(uncommitted_offers));
     uncommitted_offers.clear();
@@ -113,6 +122,7 @@ void
 Orderbook::undo_thunk(OrderbookLMDBCommitmentThunk& thunk)
 {
     std::printf("starting thunk undo\n");
+    invalidate_metadata_index();
     for (auto& kv : thunk.deleted_keys.deleted_keys) {
         committed_offers.insert(kv.first, OfferWrapper(kv.second));
     }
@@ -160,6 +170,7 @@ Orderbook::rollback_validation()
 {
 
     uncommitted_offers.clear();
+    invalidate_metadata_index();
     committed_offers
         .do_rollback(); // takes care of new round's uncommitted offers, so we
                         // can safely clear them from the thunk.
@@ -182,13 +193,74 @@ Orderbook::commit_for_production(uint64_t current_block_number)
     generate_metadata_index();
 }
 
+void
+Orderbook::record_metadata_delta(const Offer& offer, bool added)
+{
+    if (!metadata_index_valid) {
+        return;
+    }
+    EndowAccumulator delta(offer.minPrice, OrderbookMetadata(offer));
+    if (!added) {
+        EndowAccumulator negated;
+        negated -= delta;
+        delta = negated;
+    }
+    metadata_index_deltas.push_back(
+        OrderbookMetadataIndex::Entry{ offer.minPrice, delta });
+}
+
 void
 Orderbook::generate_metadata_index()
 {
-    indexed_metadata
-        = committed_offers
-              .metadata_traversal<EndowAccumulator, Price, FuncWrapper>(
-                  price::PRICE_BIT_LEN);
+    // Past roughly one change per price point, a rebuild is cheaper.
+    if (metadata_index_valid
+        && metadata_index_deltas.size() < indexed_metadata.size()) {
+        indexed_metadata.apply_deltas(metadata_index_deltas);
+    } else {
+        indexed_metadata.rebuild_from_cumulative(
+            committed_offers
+                .metadata_traversal<EndowAccumulator, Price, FuncWrapper>(
+                    price::PRICE_BIT_LEN));
+    }
+    metadata_index_deltas.clear();
+    metadata_index_valid = true;
+    generate_quantized_metadata_index();
+}
+
+void
+Orderbook::generate_quantized_metadata_index()
+{
+    quantized_metadata.clear();
+
+    if (metadata_quantization_bits == 0) {
+        return;
+    }
+
+    // entry 0 is the empty prefix (below every key)
+    quantized_metadata.push_back(indexed_metadata[0]);
+
+    Price bucket_end = 0;
+    bool bucket_open = false;
+
+    // metadata is cumulative, so the last entry covers the bucket
+    indexed_metadata.for_each_entry(
+        [&](OrderbookMetadataIndex::Entry const& entry) {
+            if (bucket_open && entry.key <= bucket_end) {
+                quantized_metadata.back() = entry;
+                return;
+            }
+            bucket_end
+                = entry.key + (entry.key >> metadata_quantization_bits);
+            bucket_open = true;
+            quantized_metadata.push_back(entry);
+        });
+}
+
+void
+Orderbook::set_metadata_quantization(uint8_t bits)
+{
+    metadata_quantization_bits = bits;
+    generate_quantized_metadata_index();
 }
 
 std::unique_ptr<ThunkGarbage<typename OrderbookTrie::TrieT>> __attribute__((
@@ -480,10 +552,26 @@ awaiter_t{&(indexed_metadata[mp].key), scheduler};
 
 EndowAccumulator
 Orderbook::get_metadata(Price p) const
+{
+    return indexed_metadata.lookup(p);
+}
+
+EndowAccumulator
+Orderbook::get_tatonnement_metadata(Price p) const
+{
+    if (metadata_quantization_bits) {
+        return lookup_metadata(quantized_metadata, p);
+    }
+    return indexed_metadata.lookup(p);
+}
+
+EndowAccumulator
+Orderbook::lookup_metadata(
+    const std::vector<OrderbookMetadataIndex::Entry>& indexed_metadata,
+    Price p)
 {
     int start = 1;
     int end = indexed_metadata.size() - 1;
-    DEMAND_CALC_INFO("committed_offers_sz:%d", committed_offers.size());
     DEMAND_CALC_INFO(
         "indexed_metadata_sz:%d, end:%d", indexed_metadata.size(), end);
     if (end <= 0) {
@@ -604,10 +692,10 @@ Orderbook::calculate_demands_and_supplies_times_prices(
     auto [full_exec_p, partial_exec_p]
         = get_execution_prices(prices, smooth_mult);
 
-    auto metadata_partial = get_metadata(partial_exec_p);
+    auto metadata_partial = get_tatonnement_metadata(partial_exec_p);
     auto metadata_full = metadata_partial;
     if (smooth_mult) /* partial_exec_p != full_exec_p */ {
-        metadata_full = get_metadata(full_exec_p);
+        metadata_full = get_tatonnement_metadata(full_exec_p);
     }
 
     calculate_demands_and_supplies_times_prices_from_metadata(
@@ -795,10 +883,10 @@ Orderbook::calculate_demands_and_supplies(const Price* prices,
     auto sell_price = prices[category.sellAsset];
     auto buy_price = prices[category.buyAsset];
 
-    auto metadata_partial = get_metadata(partial_exec_p);
+    auto metadata_partial = get_tatonnement_metadata(partial_exec_p);
     auto metadata_full = metadata_partial;
     if (smooth_mult) /* partial_exec_p != full_exec_p */ {
-        metadata_full = get_metadata(full_exec_p);
+        metadata_full = get_tatonnement_metadata(full_exec_p);
     }
 
     uint64_t full_exec_endow = metadata_full.endow;
@@ -890,6 +978,9 @@ Orderbook::tentative_clear_offers_for_validation(
     const OrderbookStateCommitmentChecker& clearing_commitment_log,
     BlockStateUpdateStatsWrapper& state_update_stats)
 {
+    // clearing here is not recorded as index deltas (and may be
+    // rolled back), so the next index generation rebuilds.
+    invalidate_metadata_index();
 
     prefix_t partialExecThresholdKey(
         local_clearing_log.partialExecThresholdKey);
@@ -1100,6 +1191,12 @@ Orderbook::process_clear_offers(
     }
     state_update_stats.fully_clear_offer_count += fully_cleared_trie.size();
 
+    if (metadata_index_valid) {
+        fully_cleared_trie.apply([this](const Offer& offer) {
+            record_metadata_delta(offer, false);
+        });
+    }
+
     auto remaining_to_clear = params.supply_activated
                               - FractionalAsset::from_integral(
                                   fully_cleared_trie.get_root_metadata().endow);
@@ -1147,6 +1244,8 @@ Orderbook::process_clear_offers(
 
     auto partial_exec_offer = *try_delete;
 
+    record_metadata_delta(partial_exec_offer, false);
+
     serial_account_log.log_self_modification(partial_exec_offer.owner,
                                              partial_exec_offer.offerId);
 
@@ -1191,6 +1290,7 @@ Orderbook::process_clear_offers(
     if (partial_exec_offer.amount > 0) {
         // std::printf("starting last committed offers insert\n");
         // committed_offers._log("committed offers ");
+        record_metadata_delta(partial_exec_offer, true);
         committed_offers.insert(*partial_exec_key, std::move(partial_exec_offer));
         // std::printf("ending last committed offers insert\n");
         state_update_stats.partial_clear_offer_count++;
@@ -1254,6 +1354,39 @@ Orderbook::load_lmdb_contents_to_memory()
         committed_offers.insert(key_buf, OfferWrapper(offer));
     }
 
+    invalidate_metadata_index();
+    generate_metadata_index();
+}
+
+std::vector<Offer>
+Orderbook::snapshot_persisted_offers()
+{
+    std::vector<Offer> out;
+
+    auto rtx = lmdb_instance.rbegin();
+    auto cursor = rtx.cursor_open(lmdb_instance.get_data_dbi());
+
+    for (auto kv : cursor) {
+        dbval_to_xdr(kv.second, out.emplace_back());
+    }
+    return out;
+}
+
+void
+Orderbook::load_snapshot_contents_to_memory(std::vector<Offer> const& offers)
+{
+    prefix_t key_buf;
+
+    for (auto const& offer : offers) {
+        if (offer.amount <= 0) {
+            throw std::runtime_error(
+                "invalid offer amount present in snapshot!");
+        }
+        generate_orderbook_trie_key(offer, key_buf);
+        committed_offers.insert(key_buf, OfferWrapper(offer));
+    }
+
+    invalidate_metadata_index();
     generate_metadata_index();
 }
 
@@ -33,8 +33,11 @@ Manage a set of offers trading one fixed asset for another fixed asset.
 
 #include "orderbook/helpers.h"
 #include "orderbook/lmdb.h"
+#include "orderbook/metadata_index.h"
 #include "orderbook/typedefs.h"
 
+#include "speedex/speedex_static_configs.h"
+
 namespace speedex {
 
 typedef __int128 int128_t;
@@ -49,7 +52,9 @@ Workflow when producing a block:
 on all those new offers.  These offers go into uncommitted_offers (no
 additional metadata).
 2. commit_for_production() merges uncommitted_offers into committed_offers.
-This also runs generate_metadata_index(), which does a pass over all the offers
+This also runs generate_metadata_index(), which updates the metadata index
+with the offers added, deleted, and cleared since the last index update
+(or rebuilds it with a pass over all the offers, if it is not valid).
 Also removes offers marked as deleted.
 (Internally, it's a tentative_commit_for_validation call and then
 a generate_metadata_index call).
@@ -102,14 +107,34 @@ class Orderbook {
 		}
 	};
 
-	using IndexType = trie::IndexedMetadata
-					<
-						EndowAccumulator,
-						Price,
-						FuncWrapper
-					>;
+	OrderbookMetadataIndex indexed_metadata;
+
+	/*! Changes to indexed_metadata since the last generate_metadata_index(),
+	recorded from the offers added, deleted, and cleared.  Only recorded
+	while metadata_index_valid; paths that change committed_offers 
+	without recording (validation, rollback, loading) invalidate
+	the index instead, and the next generate_metadata_index() rebuilds it.
+	*/
+	std::vector<OrderbookMetadataIndex::Entry> metadata_index_deltas;
+	bool metadata_index_valid = false;
+
+	void record_metadata_delta(const Offer& offer, bool added);
+
+	/*! Coarser copy of indexed_metadata, read only by Tatonnement's
+	demand queries (see get_tatonnement_metadata()).
+
+	Adjacent price points whose keys lie within a factor of
+	(1 + 2^-metadata_quantization_bits) of the first key in their
+	bucket are merged into one entry, keyed by the last price in the
+	bucket.  Empty when metadata_quantization_bits is 0.
+	*/
+	std::vector<OrderbookMetadataIndex::Entry> quantized_metadata;
+	uint8_t metadata_quantization_bits = METADATA_QUANTIZATION_BITS;
 
-	std::vector<IndexType> indexed_metadata;
+	void generate_quantized_metadata_index();
+
+	static EndowAccumulator lookup_metadata(
+		const std::vector<OrderbookMetadataIndex::Entry>& index, Price p);
 
 	uint64_t get_persisted_round_number() const {
 		return lmdb_instance.get_persisted_round_number();
@@ -120,6 +145,12 @@ class Orderbook {
 
 	void generate_metadata_index();
 
+	//! Force the next generate_metadata_index() to do a full rebuild.
+	void invalidate_metadata_index() {
+		metadata_index_valid = false;
+		metadata_index_deltas.clear();
+	}
+
 	void undo_thunk(OrderbookLMDBCommitmentThunk& thunk);
 
 	std::unique_ptr<ThunkGarbage<OrderbookTrie::TrieT>>
@@ -156,6 +187,20 @@ class Orderbook {
 
 	void load_lmdb_contents_to_memory();
 
+	std::vector<Offer> snapshot_offers() {
+		return committed_offers.accumulate_values<std::vector<Offer>>();
+	}
+
+	//! Read every offer out of the lmdb.
+	std::vector<Offer> snapshot_persisted_offers();
+
+	//! Write every committed offer to the (empty) lmdb.
+	void persist_lmdb_after_snapshot(lmdb::dbenv::wtxn& wtx) {
+		lmdb_instance.write_offers(snapshot_offers(), wtx);
+	}
+
+	void load_snapshot_contents_to_memory(std::vector<Offer> const& offers);
+
 public:
 	Orderbook(OfferCategory category, OrderbookManagerLMDB& manager_lmdb)
 	: category(category), 
@@ -220,11 +265,37 @@ public:
 	get_execution_prices(
 		Price sell_price, Price buy_price, const uint8_t smooth_mult) const;
 
+	//! Exact cumulative endowment of offers with limit price <= p.
 	EndowAccumulator get_metadata(Price p) const;
+
+	/*! Cumulative endowment used for Tatonnement's demand queries.
+
+	When metadata quantization is off, this is get_metadata(p).
+	Otherwise, with b = metadata_quantization_bits, the result is
+	get_metadata(p') for some p' with p - (p >> b) - 1 <= p' <= p.
+	That is, it may omit the offers whose limit prices lie in a band of
+	relative width 2^-b just below p.  Choosing b > smooth_mult keeps
+	this band narrower than the smoothing band, where offers are
+	already only partially executed.
+
+	LP bounds (get_supply_bounds) and clearing use only the exact index.
+	*/
+	EndowAccumulator get_tatonnement_metadata(Price p) const;
+
+	//! Set the quantization used by get_tatonnement_metadata()
+	//! (0 disables it).  Rebuilds the quantized index.
+	void set_metadata_quantization(uint8_t bits);
+
+	size_t tatonnement_metadata_index_size() const {
+		return metadata_quantization_bits 
+			? quantized_metadata.size() 
+			: indexed_metadata.size();
+	}
 	//GetMetadataTask coro_get_metadata(Price p, EndowAccumulator& endow_out, DemandCalcScheduler& scheduler) const;
 
 	//! Calculate demand and supply at a given set of prices and a given
-	//! smooth mult.
+	//! smooth mult.  Used by Tatonnement, so reads
+	//! get_tatonnement_metadata().
 	void calculate_demands_and_supplies(
 		const Price* prices, 
 		uint128_t* demands_workspace, 
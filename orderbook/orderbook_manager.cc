@@ -35,9 +35,15 @@ class NullDB;
 
 OrderbookManager::OrderbookManager(
 		uint16_t num_new_assets)
+		: OrderbookManager(num_new_assets, BATCH_LMDB_PERSISTENCE)
+	{}
+
+OrderbookManager::OrderbookManager(
+		uint16_t num_new_assets,
+		bool batch_lmdb_writes)
 		: orderbooks()
 		, num_assets(0)
-		, lmdb(get_num_orderbooks_by_asset_count(num_new_assets))
+		, lmdb(get_num_orderbooks_by_asset_count(num_new_assets), batch_lmdb_writes)
 	{	
 		increase_num_traded_assets(num_new_assets);
 		num_assets = num_new_assets;
@@ -60,6 +66,8 @@ void OrderbookManager::increase_num_traded_assets(
 			new_orderbooks.push_back(std::move(orderbooks[old_idx]));
 		} else {
 			new_orderbooks.emplace_back(category, lmdb);
+			new_orderbooks.back().set_metadata_quantization(
+				metadata_quantization_bits);
 		}
 	}
 	orderbooks = std::move(new_orderbooks);
@@ -157,6 +165,14 @@ void OrderbookManager::commit_for_production(uint64_t current_block_number) {
 	generic_map<&Orderbook::commit_for_production>(current_block_number);
 }
 
+void OrderbookManager::set_metadata_quantization(uint8_t bits) {
+	std::lock_guard lock(mtx);
+	metadata_quantization_bits = bits;
+	for (auto& orderbook : orderbooks) {
+		orderbook.set_metadata_quantization(bits);
+	}
+}
+
 void OrderbookManager::commit_for_validation(
 	uint64_t current_block_number) {
 	std::lock_guard lock(mtx);
@@ -170,6 +186,23 @@ void OrderbookManager::rollback_thunks(uint64_t current_block_number) {
 	generic_map<&Orderbook::rollback_thunks>(current_block_number);
 }
 
+void OrderbookManager::persist_lmdb_after_snapshot(uint64_t current_block_number) {
+	std::lock_guard lock(mtx);
+
+	for (auto i = 0u; i < lmdb.get_num_base_instances(); i++) {
+		auto [start, end] = lmdb.get_base_instance_range(i);
+		auto& local_lmdb = lmdb.get_base_instance_by_index(i);
+
+		auto wtx = local_lmdb.wbegin();
+
+		for (auto j = start; j < end; j++) {
+			orderbooks[j].persist_lmdb_after_snapshot(wtx);
+		}
+
+		local_lmdb.commit_wtxn(wtx, current_block_number);
+	}
+}
+
 void OrderbookManager::persist_lmdb(uint64_t current_block_number) {
 	//orderbooks manage their own thunk threadsafety for persistence thunks
 
@@ -235,11 +268,59 @@ void OrderbookManager::load_lmdb_contents_to_memory() {
 	generic_map<&Orderbook::load_lmdb_contents_to_memory>();
 }
 
+void OrderbookManager::snapshot_offers(std::vector<std::vector<Offer>>& out) {
+	std::lock_guard lock(mtx);
+	out.resize(orderbooks.size());
+	tbb::parallel_for(
+		tbb::blocked_range<size_t>(0, orderbooks.size()),
+		[&out, this] (auto r) {
+			for (unsigned int i = r.begin(); i < r.end(); i++) {
+				out[i] = orderbooks[i].snapshot_offers();
+			}
+	});
+}
+
+void OrderbookManager::snapshot_persisted_offers(
+	std::vector<std::vector<Offer>>& out, uint64_t round_number) {
+	if (get_min_persisted_round_number() != round_number
+		|| get_max_persisted_round_number() != round_number) {
+		throw std::runtime_error("orderbook lmdb is not persisted to the snapshot round");
+	}
+	out.resize(orderbooks.size());
+	tbb::parallel_for(
+		tbb::blocked_range<size_t>(0, orderbooks.size()),
+		[&out, this] (auto r) {
+			for (unsigned int i = r.begin(); i < r.end(); i++) {
+				out[i] = orderbooks[i].snapshot_persisted_offers();
+			}
+	});
+}
+
+void OrderbookManager::load_snapshot_contents_to_memory(
+	std::vector<std::vector<Offer>> const& offers) {
+	std::lock_guard lock(mtx);
+	if (offers.size() != orderbooks.size()) {
+		throw std::runtime_error("snapshot orderbook count mismatch");
+	}
+	tbb::parallel_for(
+		tbb::blocked_range<size_t>(0, orderbooks.size()),
+		[&offers, this] (auto r) {
+			for (unsigned int i = r.begin(); i < r.end(); i++) {
+				orderbooks[i].load_snapshot_contents_to_memory(offers[i]);
+			}
+	});
+}
+
 void OrderbookManager::generate_metadata_indices() {
 	std::lock_guard lock(mtx);
 	generic_map<&Orderbook::generate_metadata_index>();
 }
 
+void OrderbookManager::invalidate_metadata_indices() {
+	std::lock_guard lock(mtx);
+	generic_map<&Orderbook::invalidate_metadata_index>();
+}
+
 void OrderbookManager::hash(OrderbookStateCommitment& clearing_details) {
 	std::lock_guard lock(mtx);
 	tbb::parallel_for(
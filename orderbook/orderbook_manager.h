@@ -83,6 +83,9 @@ class OrderbookManager {
 	std::vector<Orderbook> orderbooks;
 
 	uint16_t num_assets;
+
+	//! Applied to every orderbook, including those added later.
+	uint8_t metadata_quantization_bits = METADATA_QUANTIZATION_BITS;
 	
 	template<auto func, typename... Args>
 	void generic_map(Args... args);
@@ -107,6 +110,8 @@ public:
 	using prefix_t = OrderbookTriePrefix;
 
 	OrderbookManager(uint16_t num_new_assets);
+	//! batch_lmdb_writes: see OrderbookLMDB::write_thunks().
+	OrderbookManager(uint16_t num_new_assets, bool batch_lmdb_writes);
 
 	OrderbookManager(const OrderbookManager& other) = delete;
 	OrderbookManager(OrderbookManager&& other) = delete;
@@ -201,6 +206,10 @@ public:
 	//! Commit orderbooks when operating in block production mode.
 	void commit_for_production(uint64_t current_block_number);
 
+	//! Set the metadata quantization used by Tatonnement's demand
+	//! queries on every orderbook (see Orderbook::get_tatonnement_metadata()).
+	void set_metadata_quantization(uint8_t bits);
+
 	//! Tentatively commit when operating in block validation mode.
 	//! Only difference from commit_for_production() is that this
 	//! does not generate a metadata index for each orderbook.
@@ -225,6 +234,20 @@ public:
 	//! Load persisted data contents to memory.
 	void load_lmdb_contents_to_memory();
 
+	//! Copy out the committed offers of every orderbook
+	//! (one list per orderbook), for a full state snapshot.
+	void snapshot_offers(std::vector<std::vector<Offer>>& out);
+
+	//! Copy out the offers of every orderbook as persisted in the lmdb.
+	//! Throws unless every orderbook is persisted to \a round_number.
+	//! Don't call concurrently with persistence.
+	void snapshot_persisted_offers(
+		std::vector<std::vector<Offer>>& out, uint64_t round_number);
+
+	//! Load offers from a full state snapshot (one list per orderbook).
+	void load_snapshot_contents_to_memory(
+		std::vector<std::vector<Offer>> const& offers);
+
 	//! Rollback many persistence thunks.  Cannot rollback thunks that
 	//! were persisted to disks.
 	//! Only relevant if there were a block reorganization.
@@ -234,6 +257,11 @@ public:
 	//! sums.  A tatonnement preprocessing step.
 	void generate_metadata_indices();
 
+	//! Make the next metadata index generation rebuild each
+	//! index from its orderbook, instead of applying the changes
+	//! since the last generation.
+	void invalidate_metadata_indices();
+
 	void create_lmdb();
 	//! Persist lmdb thunks up to \a current_block_humber
 	void persist_lmdb(uint64_t current_block_number);
@@ -241,6 +269,11 @@ public:
 	//! Persist lmdb thunks, when operating in data loading mode.
 	//! (i.e. is a no-op if lmdb already reflects current_block_number).
 	void persist_lmdb_for_loading(uint64_t current_block_number);
+
+	//! Write every committed offer to an empty lmdb, marking it
+	//! as persisted at \a current_block_number.
+	//! Used after loading a full state snapshot.
+	void persist_lmdb_after_snapshot(uint64_t current_block_number);
 	void open_lmdb_env();
 	void open_lmdb();
 
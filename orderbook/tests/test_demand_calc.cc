@@ -395,4 +395,54 @@ TEST_CASE("utility", "[orderbook]")
 	//TS_ASSERT_EQUALS(orderbooks[0].max_feasible_smooth_mult(699, prices), 3);
 }
 
+TEST_CASE("quantized metadata error bound", "[orderbook]")
+{
+	OrderbookManager manager(2);
+
+	OfferCategory category = make_default_category();
+	auto const unit_idx = manager.look_up_idx(category);
+	auto& orderbooks = manager.get_orderbooks();
+
+	int x = 0;
+	ProcessingSerialManager serial_manager(manager);
+
+	// 1000 distinct limit prices, about 2^-17 apart
+	for (int i = 0; i < 1000; i++) {
+		Offer offer;
+		offer.category = category;
+		offer.offerId = i;
+		offer.owner = 1;
+		offer.amount = 100 + i;
+		offer.minPrice = price::PRICE_ONE + 128 * i;
+
+		serial_manager.add_offer(unit_idx, offer, x, x);
+	}
+	serial_manager.finish_merge();
+	manager.commit_for_production(1);
+
+	auto& orderbook = orderbooks[unit_idx];
+	size_t exact_size = orderbook.tatonnement_metadata_index_size();
+
+	const uint8_t bits = 10;
+	manager.set_metadata_quantization(bits);
+
+	REQUIRE(orderbook.tatonnement_metadata_index_size() < exact_size / 4);
+
+	for (Price p = price::PRICE_ONE - 1000; p < price::PRICE_ONE + 130'000; p += 77) {
+		auto quantized = orderbook.get_tatonnement_metadata(p);
+		auto upper = orderbook.get_metadata(p);
+		auto lower = orderbook.get_metadata(p - (p >> bits) - 1);
+
+		REQUIRE(quantized.endow <= upper.endow);
+		REQUIRE(quantized.endow >= lower.endow);
+	}
+
+	// the exact index is untouched
+	REQUIRE(orderbook.get_metadata(price::PRICE_ONE).endow == 100);
+
+	manager.set_metadata_quantization(0);
+	REQUIRE(orderbook.tatonnement_metadata_index_size() == exact_size);
+	REQUIRE(orderbook.get_tatonnement_metadata(price::PRICE_ONE + 128).endow == 201);
+}
+
 } // speedex 
@@ -0,0 +1,125 @@
+#include <catch2/catch_test_macros.hpp>
+
+#include "orderbook/metadata_index.h"
+
+#include <cstdint>
+#include <map>
+#include <random>
+#include <vector>
+
+namespace speedex {
+
+using Entry = OrderbookMetadataIndex::Entry;
+
+Entry make_metadata_entry(Price p, int64_t endow) {
+	EndowAccumulator metadata;
+	metadata.endow = endow;
+	metadata.endow_times_price = ((__int128) endow) * ((__int128) p);
+	return Entry{p, metadata};
+}
+
+void check_index_against(
+	OrderbookMetadataIndex const& index, 
+	std::map<Price, int64_t> const& reference) {
+
+	REQUIRE(index.size() == reference.size() + 1);
+	REQUIRE(index[0].metadata.endow == 0);
+
+	int64_t acc = 0;
+	size_t i = 1;
+	for (auto const& [p, endow] : reference) {
+		acc += endow;
+		auto entry = index[i];
+		REQUIRE(entry.key == p);
+		REQUIRE(entry.metadata.endow == acc);
+
+		REQUIRE(index.lookup(p).endow == acc);
+		REQUIRE(index.lookup(p - 1).endow == acc - endow);
+		i++;
+	}
+	REQUIRE(index.lookup(UINT64_MAX).endow == acc);
+}
+
+TEST_CASE("metadata index rebuild", "[orderbook]")
+{
+	OrderbookMetadataIndex index;
+	std::map<Price, int64_t> reference;
+
+	std::vector<Entry> cumulative;
+	cumulative.push_back(make_metadata_entry(0, 0));
+
+	int64_t acc = 0;
+	for (Price p = 10; p < 20000; p += 7) {
+		int64_t endow = (p % 13) + 1;
+		reference[p] = endow;
+		acc += endow;
+		cumulative.push_back(make_metadata_entry(p, acc));
+	}
+	index.rebuild_from_cumulative(cumulative);
+
+	check_index_against(index, reference);
+	REQUIRE(index.lookup(5).endow == 0);
+}
+
+TEST_CASE("metadata index incremental updates", "[orderbook]")
+{
+	OrderbookMetadataIndex index;
+	std::map<Price, int64_t> reference;
+
+	std::minstd_rand gen(0);
+	// narrow key range, so that keys are often reused
+	std::uniform_int_distribution<Price> key_dist(1, 5000);
+	std::uniform_int_distribution<int64_t> amount_dist(1, 100);
+
+	for (size_t round = 0; round < 50; round++) {
+		std::vector<Entry> deltas;
+
+		size_t num_adds = (round % 10 == 0) ? 3000 : 200;
+		for (size_t i = 0; i < num_adds; i++) {
+			Price p = key_dist(gen);
+			int64_t amount = amount_dist(gen);
+			reference[p] += amount;
+			deltas.push_back(make_metadata_entry(p, amount));
+		}
+
+		// remove some price points fully, and others partially
+		size_t i = 0;
+		for (auto it = reference.begin(); it != reference.end(); i++) {
+			if (i % 3 == round % 3) {
+				deltas.push_back(make_metadata_entry(it->first, -it->second));
+				it = reference.erase(it);
+			} else {
+				if (i % 5 == 0 && it->second > 1) {
+					deltas.push_back(make_metadata_entry(it->first, -1));
+					it->second--;
+				}
+				it++;
+			}
+		}
+
+		index.apply_deltas(deltas);
+		check_index_against(index, reference);
+	}
+}
+
+TEST_CASE("metadata index rejects inconsistent deltas", "[orderbook]")
+{
+	OrderbookMetadataIndex index;
+
+	std::vector<Entry> deltas = {make_metadata_entry(100, 5)};
+	index.apply_deltas(deltas);
+
+	deltas = {make_metadata_entry(200, -1)};
+	REQUIRE_THROWS(index.apply_deltas(deltas));
+
+	deltas = {make_metadata_entry(100, -6)};
+	REQUIRE_THROWS(index.apply_deltas(deltas));
+
+	// an add and matching remove of one price cancel out
+	OrderbookMetadataIndex index2;
+	deltas = {make_metadata_entry(300, 4), make_metadata_entry(300, -4)};
+	index2.apply_deltas(deltas);
+	REQUIRE(index2.size() == 1);
+}
+
+} /* speedex */
@@ -0,0 +1,152 @@
+#include <catch2/catch_test_macros.hpp>
+
+#include "lmdb/lmdb_loading.h"
+
+#include "orderbook/lmdb.h"
+#include "orderbook/typedefs.h"
+
+#include "utils/manage_data_dirs.h"
+
+#include "xdr/types.h"
+
+#include <vector>
+
+using xdr::operator==;
+
+namespace speedex
+{
+
+static Offer
+make_lmdb_test_offer(Price min_price, AccountID owner, int64_t amount)
+{
+	Offer offer;
+	offer.category.sellAsset = 0;
+	offer.category.buyAsset = 1;
+	offer.owner = owner;
+	offer.offerId = owner;
+	offer.amount = amount;
+	offer.minPrice = min_price;
+	return offer;
+}
+
+static OrderbookTriePrefix
+lmdb_test_key(Offer const& offer)
+{
+	OrderbookTriePrefix out;
+	generate_orderbook_trie_key(offer, out);
+	return out;
+}
+
+/*
+A hand-built sequence of orderbook thunks, as Orderbook would make them.
+Offers A1..A6 have prices 10..60.
+ 1: A1..A6 created; A1 partially executes 30.
+ 2: B1 (price 5) and B2 (price 35) created, A5 cancelled;
+    B1 and A1 fully clear, A2 partially executes 40.
+ 3: C1 (price 45) created; A2 fully clears, A3 partially executes 10.
+ 4: D1 (price 1) created and fully clears; A3 is the threshold, but
+    does not trade.
+Afterwards, the db holds A3 (90 left), A4, A6, B2, and C1.
+*/
+static void
+add_lmdb_test_thunks(OrderbookLMDB& lmdb)
+{
+	std::vector<Offer> a;
+	for (AccountID i = 1; i <= 6; i++)
+	{
+		a.push_back(make_lmdb_test_offer(10 * i, i, 100));
+	}
+	Offer b1 = make_lmdb_test_offer(5, 11, 50);
+	Offer b2 = make_lmdb_test_offer(35, 12, 50);
+	Offer c1 = make_lmdb_test_offer(45, 13, 100);
+	Offer d1 = make_lmdb_test_offer(1, 14, 10);
+
+	auto lock = lmdb.lock();
+	{
+		auto& thunk = lmdb.add_new_thunk_nolock(1);
+		// in key order, as accumulated from the uncommitted offer trie
+		thunk.uncommitted_offers_vec = a;
+		thunk.set_partial_exec(lmdb_test_key(a[0]), 30, a[0]);
+	}
+	{
+		auto& thunk = lmdb.add_new_thunk_nolock(2);
+		thunk.uncommitted_offers_vec = { b1, b2 };
+		thunk.deleted_keys(lmdb_test_key(a[4]), a[4]);
+		thunk.set_partial_exec(lmdb_test_key(a[1]), 40, a[1]);
+	}
+	{
+		auto& thunk = lmdb.add_new_thunk_nolock(3);
+		thunk.uncommitted_offers_vec = { c1 };
+		thunk.set_partial_exec(lmdb_test_key(a[2]), 10, a[2]);
+	}
+	{
+		auto& thunk = lmdb.add_new_thunk_nolock(4);
+		thunk.uncommitted_offers_vec = { d1 };
+		thunk.set_partial_exec(lmdb_test_key(a[2]), 0, a[2]);
+	}
+}
+
+//! Persist the thunks (in one call per entry of persist_rounds),
+//! and return the offers in the db, in key order.
+static std::vector<Offer>
+persist_lmdb_test_thunks(bool batch_writes, std::vector<uint64_t> const& persist_rounds)
+{
+	test::speedex_dirs s;
+
+	OfferCategory category;
+	category.sellAsset = 0;
+	category.buyAsset = 1;
+
+	OrderbookManagerLMDB manager_lmdb(1, batch_writes);
+	manager_lmdb.open_lmdb_env();
+	manager_lmdb.create_db();
+
+	OrderbookLMDB lmdb(category, manager_lmdb);
+	lmdb.create_db("0 1");
+
+	add_lmdb_test_thunks(lmdb);
+
+	auto& base_lmdb = manager_lmdb.get_base_instance(category);
+	for (auto round : persist_rounds)
+	{
+		auto wtx = base_lmdb.wbegin();
+		auto garbage = lmdb.write_thunks(round, wtx);
+		base_lmdb.commit_wtxn(wtx, round);
+	}
+
+	std::vector<Offer> out;
+
+	auto rtx = lmdb.rbegin();
+	auto cursor = rtx.cursor_open(lmdb.get_data_dbi());
+	for (auto kv : cursor)
+	{
+		Offer offer;
+		dbval_to_xdr(kv.second, offer);
+		out.push_back(offer);
+	}
+	return out;
+}
+
+TEST_CASE("batched orderbook lmdb writes match unbatched", "[orderbook]")
+{
+	std::vector<Offer> expect = {
+		make_lmdb_test_offer(30, 3, 90),
+		make_lmdb_test_offer(35, 12, 50),
+		make_lmdb_test_offer(40, 4, 100),
+		make_lmdb_test_offer(45, 13, 100),
+		make_lmdb_test_offer(60, 6, 100)
+	};
+
+	for (auto const& persist_rounds : std::vector<std::vector<uint64_t>>{ { 4 }, { 2, 4 }, { 1, 2, 3, 4 } })
+	{
+		INFO("persisted in " << persist_rounds.size() << " calls");
+
+		auto unbatched = persist_lmdb_test_thunks(false, persist_rounds);
+		auto batched = persist_lmdb_test_thunks(true, persist_rounds);
+
+		REQUIRE(unbatched == expect);
+		REQUIRE(batched == expect);
+	}
+}
+
+} /* speedex */
@@ -0,0 +1,130 @@
+/**
+ * SPEEDEX: A Scalable, Parallelizable, and Economically Efficient Decentralized Exchange
+ * Copyright (C) 2023 Geoffrey Ramseyer
+
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "overlay/adaptive_flood_policy.h"
+
+#include <algorithm>
+#include <cmath>
+#include <stdexcept>
+
+namespace speedex {
+
+using namespace std::chrono_literals;
+
+AdaptiveFloodParams
+AdaptiveFloodParams::fixed(uint64_t threshold) {
+	return AdaptiveFloodParams {
+		.min_threshold = threshold,
+		.max_threshold = threshold,
+		.max_buffers_per_send = 1,
+		.min_poll_interval = 500ms,
+		.max_poll_interval = 500ms
+	};
+}
+
+AdaptiveFloodPolicy::AdaptiveFloodPolicy(AdaptiveFloodParams const& params)
+	: params(params)
+	, rtt_seconds(0)
+	, drain_rate(0)
+	, txs_per_buffer(0)
+	, sent_since_last_observation(0)
+	, last_size(std::nullopt)
+	, last_observation_time(0)
+	{
+		if (params.max_buffers_per_send == 0) {
+			throw std::runtime_error("must send at least one buffer at a time");
+		}
+		if (params.min_threshold > params.max_threshold 
+			|| params.min_poll_interval > params.max_poll_interval) {
+			throw std::runtime_error("invalid flood policy range");
+		}
+	}
+
+void
+AdaptiveFloodPolicy::observe_rtt(double seconds) {
+	rtt_seconds = std::max(0.0, seconds);
+}
+
+void
+AdaptiveFloodPolicy::observe_mempool_size(uint64_t size, double now_seconds) {
+	if (last_size) {
+		double elapsed = now_seconds - last_observation_time;
+		if (elapsed <= 0) {
+			return;
+		}
+
+		// sent txs are counted in size as soon as they are sent,
+		// so whatever else went missing was drained
+		double drained = static_cast<double>(*last_size) 
+			+ static_cast<double>(sent_since_last_observation)
+			- static_cast<double>(size);
+		double rate = std::max(0.0, drained / elapsed);
+
+		drain_rate = (1 - EWMA_WEIGHT) * drain_rate + EWMA_WEIGHT * rate;
+	}
+	last_size = size;
+	last_observation_time = now_seconds;
+	sent_since_last_observation = 0;
+}
+
+void
+AdaptiveFloodPolicy::observe_send(uint64_t num_txs, uint32_t num_buffers) {
+	sent_since_last_observation += num_txs;
+	if (num_buffers == 0) {
+		return;
+	}
+	double per_buffer = static_cast<double>(num_txs) / num_buffers;
+	if (txs_per_buffer == 0) {
+		txs_per_buffer = per_buffer;
+	} else {
+		txs_per_buffer = (1 - EWMA_WEIGHT) * txs_per_buffer + EWMA_WEIGHT * per_buffer;
+	}
+}
+
+uint64_t
+AdaptiveFloodPolicy::get_flood_threshold() const {
+	double poll_seconds = std::chrono::duration<double>(get_poll_interval()).count();
+	double target = drain_rate * (rtt_seconds + poll_seconds) * HEADROOM;
+
+	return std::clamp(
+		static_cast<uint64_t>(target), 
+		params.min_threshold, 
+		params.max_threshold);
+}
+
+uint32_t
+AdaptiveFloodPolicy::get_buffers_per_send(uint64_t size) const {
+	uint64_t threshold = get_flood_threshold();
+	if (size >= threshold || txs_per_buffer == 0) {
+		return 1;
+	}
+	double buffers = std::ceil((threshold - size) / txs_per_buffer);
+
+	return std::clamp<uint32_t>(
+		static_cast<uint32_t>(std::min<double>(buffers, params.max_buffers_per_send)),
+		1,
+		params.max_buffers_per_send);
+}
+
+std::chrono::milliseconds
+AdaptiveFloodPolicy::get_poll_interval() const {
+	auto interval = std::chrono::milliseconds(static_cast<int64_t>(2000 * rtt_seconds));
+	return std::clamp(interval, params.min_poll_interval, params.max_poll_interval);
+}
+
+} /* speedex */
@@ -0,0 +1,102 @@
+/**
+ * SPEEDEX: A Scalable, Parallelizable, and Economically Efficient Decentralized Exchange
+ * Copyright (C) 2023 Geoffrey Ramseyer
+
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#pragma once
+
+/*! \file adaptive_flood_policy.h
+
+Decides when, and how much, the overlay flooder sends.
+
+Each replica's mempool drains as blocks are proposed.  A sent batch
+only lands in a foreign mempool about one RTT later, and the flooder
+only notices a shortfall at its next poll.  So to keep every mempool
+from running dry, the flooder has to keep roughly
+	drain rate * (RTT + poll interval)
+txs ahead of what is already there.  The flood threshold tracks that
+quantity (with some headroom), clamped to a configured range.
+
+When the shortfall is large, the flooder coalesces several input
+buffers into one send: fewer, larger RPCs cost fewer round trips and
+compress better.  When the shortfall is small, it sends one buffer
+at a time, so that txs reach the mempools sooner.
+
+With min_threshold == max_threshold and max_buffers_per_send == 1,
+this is a fixed threshold (the flooder's original behavior).
+*/
+
+#include <chrono>
+#include <cstdint>
+#include <optional>
+
+namespace speedex {
+
+struct AdaptiveFloodParams {
+	uint64_t min_threshold;
+	uint64_t max_threshold;
+	uint32_t max_buffers_per_send;
+	std::chrono::milliseconds min_poll_interval;
+	std::chrono::milliseconds max_poll_interval;
+
+	//! Fixed threshold, one buffer per send, 500ms polls.
+	static AdaptiveFloodParams fixed(uint64_t threshold);
+};
+
+class AdaptiveFloodPolicy {
+
+	const AdaptiveFloodParams params;
+
+	// Keep this many times the expected in-flight deficit.
+	constexpr static double HEADROOM = 2.0;
+	// Weight of a new sample in moving averages.
+	constexpr static double EWMA_WEIGHT = 0.25;
+
+	double rtt_seconds;
+	double drain_rate;
+	double txs_per_buffer;
+
+	uint64_t sent_since_last_observation;
+	std::optional<uint64_t> last_size;
+	double last_observation_time;
+
+public:
+
+	AdaptiveFloodPolicy(AdaptiveFloodParams const& params);
+
+	//! Latest round trip time estimate (to the slowest replica).
+	void observe_rtt(double seconds);
+
+	//! Minimum mempool size over all replicas (including txs
+	//! already sent but not yet acknowledged), at time \a now_seconds.
+	void observe_mempool_size(uint64_t size, double now_seconds);
+
+	void observe_send(uint64_t num_txs, uint32_t num_buffers);
+
+	uint64_t get_flood_threshold() const;
+
+	//! How many input buffers to coalesce into the next send,
+	//! given the current minimum mempool size.
+	uint32_t get_buffers_per_send(uint64_t size) const;
+
+	std::chrono::milliseconds get_poll_interval() const;
+
+	double get_drain_rate() const {
+		return drain_rate;
+	}
+};
+
+} /* speedex */
@@ -18,8 +18,21 @@
 
 #include "overlay/overlay_client.h"
 
+#include <utils/time.h>
+
+#include <stdexcept>
+
+#include <xdrpp/marshal.h>
+
 namespace speedex {
 
+namespace {
+
+// weight of a new sample in the rtt moving average
+constexpr static double RTT_EWMA_WEIGHT = 0.25;
+
+} /* anonymous namespace */
+
 std::optional<uint64_t> 
 OverlayClient::get_cached_foreign_mempool_size() const {
 	uint64_t sz = foreign_mempool_size.load(std::memory_order_relaxed);
@@ -31,6 +44,25 @@ OverlayClient::get_cached_foreign_mempool_size() const {
 	return std::nullopt;
 }
 
+std::optional<double>
+OverlayClient::get_rtt_estimate() const {
+	double rtt = rtt_estimate.load(std::memory_order_relaxed);
+	if (rtt == 0 || !connected_to_foreign_mempool.load(std::memory_order_relaxed)) {
+		return std::nullopt;
+	}
+	return rtt;
+}
+
+void
+OverlayClient::record_rtt(double seconds) {
+	double prev = rtt_estimate.load(std::memory_order_relaxed);
+	if (prev == 0) {
+		rtt_estimate = seconds;
+	} else {
+		rtt_estimate = (1 - RTT_EWMA_WEIGHT) * prev + RTT_EWMA_WEIGHT * seconds;
+	}
+}
+
 void
 OverlayClient::poll_foreign_mempool_size() {
 	force_repoll = true;
@@ -40,8 +72,8 @@ OverlayClient::poll_foreign_mempool_size() {
 void 
 OverlayClient::send_txs(forward_t txs) {
 	std::lock_guard lock(mtx);
-	txs_to_forward.push_back(txs);
-	local_buffer_size.fetch_add(txs.num_txs, std::memory_order_relaxed);
+	local_buffer_size.fetch_add(txs.raw.num_txs, std::memory_order_relaxed);
+	txs_to_forward.push_back(std::move(txs));
 	cv.notify_all();
 }
 
@@ -50,6 +82,46 @@ OverlayClient::exists_work_to_do() {
 	return force_repoll || (txs_to_forward.size() > 0);
 }
 
+void
+OverlayClient::forward_batch(forward_t const& batch) {
+	if (batch.inventory) {
+		auto const& txs = batch.inventory -> txs;
+		auto wants = client -> offer_inventory(batch.inventory -> inventory, self_id);
+		if ((!wants) || (wants -> size() != (txs.size() + 7) / 8)) {
+			throw std::runtime_error("malformed inventory reply");
+		}
+
+		xdr::xvector<SignedTransaction> wanted;
+		for (size_t i = 0; i < txs.size(); i++) {
+			if ((*wants)[i / 8] & (1 << (i % 8))) {
+				wanted.push_back(txs[i]);
+			}
+		}
+
+		inventory_txs_offered.fetch_add(txs.size(), std::memory_order_relaxed);
+		inventory_txs_sent.fetch_add(wanted.size(), std::memory_order_relaxed);
+
+		if (wanted.size() < txs.size()) {
+			// always send, even if empty, so the peer logs the batch number
+			auto subset = xdr::xdr_to_opaque(wanted);
+			if (compressor.get_mode() != OVERLAY_UNCOMPRESSED) {
+				CompressedTxBatch compressed;
+				compressor.compress(subset, compressed);
+				client -> forward_compressed_txs(compressed, batch.raw.buffer_number, self_id);
+			} else {
+				client -> forward_txs(subset, batch.raw.buffer_number, self_id);
+			}
+			return;
+		}
+	}
+
+	if (batch.compressed) {
+		client -> forward_compressed_txs(*(batch.compressed), batch.raw.buffer_number, self_id);
+	} else {
+		client -> forward_txs(*(batch.raw.data), batch.raw.buffer_number, self_id);
+	}
+}
+
 void
 OverlayClient::run()
 {
@@ -68,15 +140,16 @@ OverlayClient::run()
 
 
 			to_forward = std::move(txs_to_forward);
+			force_repoll = false;
 		}
 
 		while (to_forward.size() > 0) {
 			bool success = try_action_void(
 				[this, &to_forward] {
-					auto front = to_forward.front();
-					client -> forward_txs(*(front.data), front.buffer_number, self_id);
-					local_buffer_size.fetch_sub(front.num_txs);
-					foreign_mempool_size.fetch_add(front.num_txs);
+					auto const& front = to_forward.front();
+					forward_batch(front);
+					local_buffer_size.fetch_sub(front.raw.num_txs);
+					foreign_mempool_size.fetch_add(front.raw.num_txs);
 				});
 
 			if (success) {
@@ -88,13 +161,17 @@ OverlayClient::run()
 			}
 		}
 		
-		try_action_void(
+		auto timestamp = utils::init_time_measurement();
+		bool polled = try_action_void(
 			[this] {
 				auto res = client -> mempool_size();
 				if (res) {
 					foreign_mempool_size = *res;
 				}
 			});
+		if (polled) {
+			record_rtt(utils::measure_time(timestamp));
+		}
 	}
 }
 
@@ -18,6 +18,8 @@
 
 #pragma once
 
+#include "overlay/overlay_compression.h"
+
 #include "synthetic_data_generator/data_stream.h"
 
 #include "hotstuff/config/replica_config.h"
@@ -27,15 +29,33 @@
 #include "rpc/rpcconfig.h"
 
 #include "xdr/overlay.h"
+#include "xdr/transaction.h"
 
 #include <atomic>
 #include <cstdint>
+#include <memory>
 #include <optional>
 
 #include <xdrpp/srpc.h>
 
 namespace speedex {
 
+//! A batch announced by digest before it is sent.
+struct OverlayInventoryBatch {
+	TxInventory inventory;
+	// parsed from the batch, in the same order as inventory.digests
+	xdr::xvector<SignedTransaction> txs;
+};
+
+//! One batch of txs to forward to other replicas.
+struct OverlayForwardBatch {
+	DataBuffer raw;
+	// Shared by all clients.  Null if sent uncompressed.
+	std::shared_ptr<const CompressedTxBatch> compressed;
+	// Shared by all clients.  Null if sent without an inventory.
+	std::shared_ptr<const OverlayInventoryBatch> inventory;
+};
+
 class OverlayClient : public NonblockingRpcClient<xdr::srpc_client<OverlayV1>> {
 
 	using client_t = xdr::srpc_client<OverlayV1>;
@@ -44,16 +64,30 @@ class OverlayClient : public NonblockingRpcClient<xdr::srpc_client<OverlayV1>> {
 	std::atomic<uint64_t> local_buffer_size;
 	std::atomic<bool> connected_to_foreign_mempool;
 
-	using forward_t = DataBuffer;
+	// moving average of mempool_size() round trips, in seconds (0 if none yet)
+	std::atomic<double> rtt_estimate;
+
+	using forward_t = OverlayForwardBatch;
 
 	std::vector<forward_t> txs_to_forward;
 
 	std::atomic<bool> force_repoll;
 
+	// used to recompress batches trimmed by an inventory reply
+	OverlayTxCompressor const& compressor;
+
+	std::atomic<uint64_t> inventory_txs_offered;
+	std::atomic<uint64_t> inventory_txs_sent;
+
 	bool exists_work_to_do() override final;
 
 	void run();
 
+	// not threadsafe, call within try_action
+	void forward_batch(forward_t const& batch);
+
+	void record_rtt(double seconds);
+
 	void on_connection_clear() override {
 		connected_to_foreign_mempool = false;
 	}
@@ -68,11 +102,19 @@ class OverlayClient : public NonblockingRpcClient<xdr::srpc_client<OverlayV1>> {
 
 public:
 
-	OverlayClient(const hotstuff::ReplicaInfo& info, ReplicaID self_id, const std::string& target_port = std::string(OVERLAY_PORT))
+	OverlayClient(
+		const hotstuff::ReplicaInfo& info, 
+		ReplicaID self_id, 
+		OverlayTxCompressor const& compressor = OverlayTxCompressor::none(), 
+		const std::string& target_port = std::string(OVERLAY_PORT))
 		: NonblockingRpcClient<client_t>(info)
 		, foreign_mempool_size(0)
 		, connected_to_foreign_mempool(false)
+		, rtt_estimate(0)
 		, force_repoll(false)
+		, compressor(compressor)
+		, inventory_txs_offered(0)
+		, inventory_txs_sent(0)
 		, self_id(self_id)
 		, port(target_port)
 		{
@@ -81,10 +123,21 @@ public:
 
 	std::optional<uint64_t> get_cached_foreign_mempool_size() const;
 
+	//! nullopt if not connected or not yet measured.
+	std::optional<double> get_rtt_estimate() const;
+
 	void poll_foreign_mempool_size();
 
 	void send_txs(forward_t txs);
 
+	//! Txs announced by inventory, and how many of those the peer wanted.
+	uint64_t get_inventory_txs_offered() const {
+		return inventory_txs_offered.load(std::memory_order_relaxed);
+	}
+	uint64_t get_inventory_txs_sent() const {
+		return inventory_txs_sent.load(std::memory_order_relaxed);
+	}
+
 	const char* get_service() const override final {
 		return port.c_str();
 	}
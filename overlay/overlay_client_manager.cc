@@ -20,6 +20,10 @@
 
 #include "mempool/mempool.h"
 
+#include "overlay/tx_digest_filter.h"
+
+#include <stdexcept>
+
 namespace speedex {
 
 using hotstuff::ReplicaConfig;
@@ -39,23 +43,84 @@ SelfOverlayClient::send_txs(DataBuffer data) {
 		return;
 	}
 
-	OVERLAY_INFO("(self) got %lu new txs for mempool, cur size %lu", blk.size(), mempool.total_size());
-
 	handler.log_batch_receipt(self_id, data.buffer_number);
 
+	// remembered, so copies arriving from other replicas are dropped
+	size_t dups = handler.drop_seen_txs(blk);
+
+	OVERLAY_INFO("(self) got %lu new txs (%lu duplicates) for mempool, cur size %lu", blk.size(), dups, mempool.total_size());
+
 	mempool.chunkify_and_add_to_mempool_buffer(std::move(blk));
 }
 
-OverlayClientManager::OverlayClientManager(ReplicaConfig const& config, ReplicaID self_id, Mempool& mempool, OverlayHandler& handler)
+DataBuffer
+coalesce_tx_buffers(std::vector<DataBuffer> const& buffers) {
+	if (buffers.empty()) {
+		throw std::runtime_error("nothing to coalesce");
+	}
+	if (buffers.size() == 1) {
+		return buffers[0];
+	}
+
+	// xdr list: 4-byte big-endian length, then the entries
+	constexpr static size_t LEN_BYTES = 4;
+
+	uint64_t num_entries = 0;
+	size_t total_bytes = LEN_BYTES;
+
+	DataBuffer out {0, std::make_shared<xdr::opaque_vec<>>(), buffers.back().buffer_number, false};
+
+	for (auto const& buffer : buffers) {
+		if (!buffer.data || buffer.data -> size() < LEN_BYTES) {
+			throw std::runtime_error("malformed tx buffer");
+		}
+		auto const& bytes = *buffer.data;
+		num_entries += (static_cast<uint32_t>(bytes[0]) << 24)
+			| (static_cast<uint32_t>(bytes[1]) << 16)
+			| (static_cast<uint32_t>(bytes[2]) << 8)
+			| static_cast<uint32_t>(bytes[3]);
+		total_bytes += buffer.data -> size() - LEN_BYTES;
+		out.num_txs += buffer.num_txs;
+		out.finished |= buffer.finished;
+	}
+
+	if (num_entries > UINT32_MAX) {
+		throw std::runtime_error("too many txs to coalesce");
+	}
+
+	auto& data = *out.data;
+	data.resize(LEN_BYTES);
+	data.reserve(total_bytes);
+	for (size_t i = 0; i < LEN_BYTES; i++) {
+		data[i] = (num_entries >> (8 * (LEN_BYTES - 1 - i))) & 0xFF;
+	}
+
+	for (auto const& buffer : buffers) {
+		data.insert(data.end(), buffer.data -> begin() + LEN_BYTES, buffer.data -> end());
+	}
+	return out;
+}
+
+OverlayClientManager::OverlayClientManager(
+	ReplicaConfig const& config, 
+	ReplicaID self_id, 
+	Mempool& mempool, 
+	OverlayHandler& handler,
+	OverlayTxCompressor const& compressor,
+	uint64_t inventory_threshold)
 	: self_client(mempool, handler, self_id)
 	, other_clients()
+	, compressor(compressor)
+	, inventory_threshold(inventory_threshold)
+	, raw_bytes_sent(0)
+	, wire_bytes_sent(0)
 	{
 		auto infos = config.list_info();
 		for (auto const& info : infos)
 		{
 			if (info->id != self_id)
 			{
-				other_clients.emplace_back(std::make_unique<OverlayClient>(*info, self_id));
+				other_clients.emplace_back(std::make_unique<OverlayClient>(*info, self_id, compressor));
 			}
 		}
 	}
@@ -86,9 +151,82 @@ OverlayClientManager::send_txs(DataBuffer data)
 {
 	self_client.send_txs(data);
 
+	OverlayForwardBatch batch{data, nullptr, nullptr};
+
+	if (inventory_threshold > 0 && data.num_txs >= inventory_threshold) {
+		// digest once, share among all clients
+		auto inventory = std::make_shared<OverlayInventoryBatch>();
+		try {
+			xdr::xdr_from_opaque(*data.data, inventory -> txs);
+			inventory -> inventory.digests.reserve(inventory -> txs.size());
+			for (auto const& tx : inventory -> txs) {
+				inventory -> inventory.digests.push_back(tx_digest(tx));
+			}
+			batch.inventory = std::move(inventory);
+		} catch (...) {
+			// unparseable, so forward as-is
+		}
+	}
+
+	if (compressor.get_mode() != OVERLAY_UNCOMPRESSED) {
+		// compress once, share among all clients
+		auto compressed = std::make_shared<CompressedTxBatch>();
+		compressor.compress(*data.data, *compressed);
+		wire_bytes_sent.fetch_add(compressed -> data.size(), std::memory_order_relaxed);
+		batch.compressed = std::move(compressed);
+	} else {
+		wire_bytes_sent.fetch_add(data.data -> size(), std::memory_order_relaxed);
+	}
+	raw_bytes_sent.fetch_add(data.data -> size(), std::memory_order_relaxed);
+
+	OVERLAY_INFO("sending %lu txs (%lu bytes, %lu on wire)", 
+		data.num_txs, 
+		data.data -> size(), 
+		batch.compressed ? batch.compressed -> data.size() : data.data -> size());
+
 	for (auto& other_client : other_clients) {
-		other_client->send_txs(data);
+		other_client->send_txs(batch);
+	}
+}
+
+void
+OverlayClientManager::send_txs(std::vector<DataBuffer> const& buffers)
+{
+	send_txs(coalesce_tx_buffers(buffers));
+}
+
+std::optional<double>
+OverlayClientManager::get_max_rtt() const {
+	std::optional<double> out;
+	for (auto const& other_client : other_clients) {
+		auto rtt = other_client -> get_rtt_estimate();
+		if (rtt && ((!out) || (*rtt > *out))) {
+			out = rtt;
+		}
+	}
+	return out;
+}
+
+double
+OverlayClientManager::get_compression_ratio() const {
+	uint64_t raw = raw_bytes_sent.load(std::memory_order_relaxed);
+	if (raw == 0) {
+		return 1;
+	}
+	return static_cast<double>(wire_bytes_sent.load(std::memory_order_relaxed)) / raw;
+}
+
+double
+OverlayClientManager::get_inventory_skip_rate() const {
+	uint64_t offered = 0, sent = 0;
+	for (auto const& other_client : other_clients) {
+		offered += other_client -> get_inventory_txs_offered();
+		sent += other_client -> get_inventory_txs_sent();
+	}
+	if (offered == 0) {
+		return 0;
 	}
+	return 1 - static_cast<double>(sent) / offered;
 }
 
 } /* speedex */
@@ -19,11 +19,14 @@
 #pragma once
 
 #include "overlay/overlay_client.h"
+#include "overlay/overlay_compression.h"
 #include "overlay/overlay_server.h"
 
 #include "synthetic_data_generator/data_stream.h"
 
+#include <atomic>
 #include <cstdint>
+#include <optional>
 #include <vector>
 
 namespace speedex {
@@ -48,14 +51,36 @@ public:
 	void send_txs(DataBuffer data);
 };
 
+/*! Concatenate several serialized tx lists into one.
+The result carries the last buffer's number.
+Does not parse the txs, only the list length prefixes.
+*/
+DataBuffer 
+coalesce_tx_buffers(std::vector<DataBuffer> const& buffers);
+
 class OverlayClientManager {
 
 	SelfOverlayClient self_client;
 	std::vector<std::unique_ptr<OverlayClient>> other_clients;
 
+	OverlayTxCompressor const& compressor;
+
+	// announce batches with at least this many txs by inventory (0 = never)
+	const uint64_t inventory_threshold;
+
+	// bytes per batch, before and after compression (not per replica)
+	std::atomic<uint64_t> raw_bytes_sent;
+	std::atomic<uint64_t> wire_bytes_sent;
+
 public:
 	
-	OverlayClientManager(hotstuff::ReplicaConfig const& config, hotstuff::ReplicaID self_id, Mempool& mempool, OverlayHandler& handler);
+	OverlayClientManager(
+		hotstuff::ReplicaConfig const& config, 
+		hotstuff::ReplicaID self_id, 
+		Mempool& mempool, 
+		OverlayHandler& handler,
+		OverlayTxCompressor const& compressor = OverlayTxCompressor::none(),
+		uint64_t inventory_threshold = 0);
 
 	uint64_t get_min_mempool_size() const;
 
@@ -63,6 +88,17 @@ public:
 
 	void send_txs(DataBuffer data);
 
+	//! Send several buffers as one batch (one rpc per replica).
+	void send_txs(std::vector<DataBuffer> const& buffers);
+
+	//! Largest rtt estimate over connected replicas.
+	std::optional<double> get_max_rtt() const;
+
+	//! Wire bytes / raw bytes over all batches sent so far.
+	double get_compression_ratio() const;
+
+	//! Fraction of txs announced by inventory that peers already had.
+	double get_inventory_skip_rate() const;
 };
 
 
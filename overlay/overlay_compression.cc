@@ -0,0 +1,281 @@
+/**
+ * SPEEDEX: A Scalable, Parallelizable, and Economically Efficient Decentralized Exchange
+ * Copyright (C) 2023 Geoffrey Ramseyer
+
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "overlay/overlay_compression.h"
+
+#include "xdr/experiments.h"
+
+#include "config.h"
+
+#include <xdrpp/marshal.h>
+
+#include <cstdio>
+#include <stdexcept>
+
+#if HAVE_ZSTD == 1
+
+#include <zstd.h>
+#include <zdict.h>
+
+#endif
+
+namespace speedex {
+
+namespace {
+
+//! Refuse to allocate more than this for one decompressed batch.
+constexpr static uint32_t MAX_UNCOMPRESSED_SIZE = 1u << 30;
+
+//! Enough single-tx samples for a dictionary; more only slows training.
+constexpr static size_t MAX_DICT_SAMPLES = 100'000;
+
+#if HAVE_ZSTD == 1
+
+void 
+check_zstd(size_t res, const char* where) {
+	if (ZSTD_isError(res)) {
+		throw std::runtime_error(std::string(where) + ": " + ZSTD_getErrorName(res));
+	}
+}
+
+// zstd contexts are not threadsafe, but are expensive to create per batch.
+ZSTD_CCtx*
+thread_cctx() {
+	struct deleter {
+		void operator()(ZSTD_CCtx* ctx) { ZSTD_freeCCtx(ctx); }
+	};
+	thread_local std::unique_ptr<ZSTD_CCtx, deleter> ctx(ZSTD_createCCtx());
+	return ctx.get();
+}
+
+ZSTD_DCtx*
+thread_dctx() {
+	struct deleter {
+		void operator()(ZSTD_DCtx* ctx) { ZSTD_freeDCtx(ctx); }
+	};
+	thread_local std::unique_ptr<ZSTD_DCtx, deleter> ctx(ZSTD_createDCtx());
+	return ctx.get();
+}
+
+#endif
+
+} /* anonymous namespace */
+
+struct OverlayTxCompressor::DictState {
+#if HAVE_ZSTD == 1
+	ZSTD_CDict* cdict;
+	ZSTD_DDict* ddict;
+
+	DictState(std::vector<uint8_t> const& dictionary, int level)
+		: cdict(ZSTD_createCDict(dictionary.data(), dictionary.size(), level))
+		, ddict(ZSTD_createDDict(dictionary.data(), dictionary.size()))
+		{
+			if (cdict == nullptr || ddict == nullptr) {
+				ZSTD_freeCDict(cdict);
+				ZSTD_freeDDict(ddict);
+				throw std::runtime_error("failed to load zstd dictionary");
+			}
+		}
+
+	~DictState() {
+		ZSTD_freeCDict(cdict);
+		ZSTD_freeDDict(ddict);
+	}
+#endif
+};
+
+OverlayTxCompressor::OverlayTxCompressor()
+	: mode(OVERLAY_UNCOMPRESSED)
+	, level(0)
+	, dict(nullptr)
+	{}
+
+OverlayTxCompressor::OverlayTxCompressor(
+	OverlayCompression mode, 
+	int level, 
+	std::vector<uint8_t> const& dictionary)
+	: mode(mode)
+	, level(level)
+	, dict(nullptr)
+	{
+		if (mode == OVERLAY_UNCOMPRESSED) {
+			return;
+		}
+#if HAVE_ZSTD == 1
+		if (mode == OVERLAY_ZSTD_DICT) {
+			if (dictionary.empty()) {
+				throw std::runtime_error("zstd dictionary compression needs a dictionary");
+			}
+			dict = std::make_unique<DictState>(dictionary, level);
+		}
+#else
+		throw std::runtime_error("overlay compression requires zstd");
+#endif
+	}
+
+OverlayTxCompressor::~OverlayTxCompressor() {}
+
+OverlayTxCompressor const&
+OverlayTxCompressor::none() {
+	static OverlayTxCompressor uncompressed;
+	return uncompressed;
+}
+
+void
+OverlayTxCompressor::compress(xdr::opaque_vec<> const& txs, CompressedTxBatch& out) const {
+	if (txs.size() > MAX_UNCOMPRESSED_SIZE) {
+		throw std::runtime_error("tx batch too large to forward");
+	}
+
+	out.compression = mode;
+	out.uncompressedSize = txs.size();
+
+	if (mode == OVERLAY_UNCOMPRESSED) {
+		out.data = txs;
+		return;
+	}
+
+#if HAVE_ZSTD == 1
+	out.data.resize(ZSTD_compressBound(txs.size()));
+
+	size_t res;
+	if (mode == OVERLAY_ZSTD_DICT) {
+		res = ZSTD_compress_usingCDict(
+			thread_cctx(), out.data.data(), out.data.size(), txs.data(), txs.size(), dict -> cdict);
+	} else {
+		res = ZSTD_compressCCtx(
+			thread_cctx(), out.data.data(), out.data.size(), txs.data(), txs.size(), level);
+	}
+	check_zstd(res, "zstd compress");
+	out.data.resize(res);
+#endif
+}
+
+void
+OverlayTxCompressor::decompress(CompressedTxBatch const& batch, xdr::opaque_vec<>& out) const {
+	if (batch.compression == OVERLAY_UNCOMPRESSED) {
+		if (batch.data.size() != batch.uncompressedSize) {
+			throw std::runtime_error("uncompressed batch size mismatch");
+		}
+		out = batch.data;
+		return;
+	}
+
+	if (batch.uncompressedSize > MAX_UNCOMPRESSED_SIZE) {
+		throw std::runtime_error("compressed batch too large");
+	}
+
+#if HAVE_ZSTD == 1
+	out.resize(batch.uncompressedSize);
+
+	size_t res;
+	if (batch.compression == OVERLAY_ZSTD_DICT) {
+		if (!dict) {
+			throw std::runtime_error("got dictionary-compressed batch without a dictionary");
+		}
+		res = ZSTD_decompress_usingDDict(
+			thread_dctx(), out.data(), out.size(), batch.data.data(), batch.data.size(), dict -> ddict);
+	} else if (batch.compression == OVERLAY_ZSTD) {
+		res = ZSTD_decompressDCtx(
+			thread_dctx(), out.data(), out.size(), batch.data.data(), batch.data.size());
+	} else {
+		throw std::runtime_error("unknown overlay compression");
+	}
+	check_zstd(res, "zstd decompress");
+
+	if (res != batch.uncompressedSize) {
+		throw std::runtime_error("decompressed batch size mismatch");
+	}
+#else
+	throw std::runtime_error("overlay compression requires zstd");
+#endif
+}
+
+std::vector<uint8_t>
+OverlayTxCompressor::train_dictionary(
+	std::vector<xdr::opaque_vec<>> const& tx_lists, 
+	size_t dict_size) {
+
+#if HAVE_ZSTD == 1
+	std::vector<uint8_t> samples;
+	std::vector<size_t> sample_sizes;
+
+	for (auto const& list : tx_lists) {
+		ExperimentBlock txs;
+		xdr::xdr_from_opaque(list, txs);
+
+		for (auto const& tx : txs) {
+			if (sample_sizes.size() >= MAX_DICT_SAMPLES) {
+				break;
+			}
+			auto bytes = xdr::xdr_to_opaque(tx);
+			samples.insert(samples.end(), bytes.begin(), bytes.end());
+			sample_sizes.push_back(bytes.size());
+		}
+	}
+
+	std::vector<uint8_t> dictionary(dict_size);
+	size_t res = ZDICT_trainFromBuffer(
+		dictionary.data(), dictionary.size(), 
+		samples.data(), sample_sizes.data(), sample_sizes.size());
+
+	if (ZDICT_isError(res)) {
+		throw std::runtime_error(std::string("zstd dictionary training failed: ") + ZDICT_getErrorName(res));
+	}
+	dictionary.resize(res);
+	return dictionary;
+#else
+	throw std::runtime_error("overlay compression requires zstd");
+#endif
+}
+
+void
+OverlayTxCompressor::save_dictionary(std::vector<uint8_t> const& dictionary, std::string const& filename) {
+	FILE* f = std::fopen(filename.c_str(), "w");
+	if (f == nullptr) {
+		throw std::runtime_error("failed to open dictionary file " + filename);
+	}
+	size_t written = std::fwrite(dictionary.data(), 1, dictionary.size(), f);
+	std::fclose(f);
+	if (written != dictionary.size()) {
+		throw std::runtime_error("failed to write dictionary file " + filename);
+	}
+}
+
+std::vector<uint8_t>
+OverlayTxCompressor::load_dictionary(std::string const& filename) {
+	FILE* f = std::fopen(filename.c_str(), "r");
+	if (f == nullptr) {
+		throw std::runtime_error("failed to open dictionary file " + filename);
+	}
+
+	std::vector<uint8_t> out;
+	uint8_t buf[4096];
+	size_t len;
+	while ((len = std::fread(buf, 1, sizeof(buf), f)) > 0) {
+		out.insert(out.end(), buf, buf + len);
+	}
+	std::fclose(f);
+
+	if (out.empty()) {
+		throw std::runtime_error("empty dictionary file " + filename);
+	}
+	return out;
+}
+
+} /* speedex */
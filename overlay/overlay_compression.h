@@ -0,0 +1,106 @@
+/**
+ * SPEEDEX: A Scalable, Parallelizable, and Economically Efficient Decentralized Exchange
+ * Copyright (C) 2023 Geoffrey Ramseyer
+
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#pragma once
+
+/*! \file overlay_compression.h
+
+Compression of transaction batches sent between overlay replicas.
+
+Batches are xdr-serialized lists of SignedTransactions.  Consecutive
+transactions share most of their structure, so plain zstd already helps;
+a dictionary trained on individual SignedTransactions helps more,
+since it captures the shared structure before the first tx of a batch.
+
+Requires zstd (HAVE_ZSTD).  Without it, only OVERLAY_UNCOMPRESSED works,
+and constructing a compressor for any other mode throws.
+*/
+
+#include "xdr/overlay.h"
+
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include <xdrpp/types.h>
+
+namespace speedex {
+
+class OverlayTxCompressor {
+
+	struct DictState;
+
+	OverlayCompression mode;
+	int level;
+
+	// null unless mode is OVERLAY_ZSTD_DICT
+	std::unique_ptr<DictState> dict;
+
+public:
+
+	constexpr static int DEFAULT_LEVEL = 3;
+	constexpr static size_t DEFAULT_DICT_SIZE = 64 * 1024;
+
+	//! No compression.
+	OverlayTxCompressor();
+
+	//! Throws if zstd is unavailable, or if mode is OVERLAY_ZSTD_DICT
+	//! and the dictionary is empty.
+	OverlayTxCompressor(
+		OverlayCompression mode, 
+		int level = DEFAULT_LEVEL, 
+		std::vector<uint8_t> const& dictionary = {});
+
+	~OverlayTxCompressor();
+
+	//! Shared instance that does no compression.
+	static OverlayTxCompressor const& none();
+
+	OverlayTxCompressor(const OverlayTxCompressor&) = delete;
+	OverlayTxCompressor& operator=(const OverlayTxCompressor&) = delete;
+
+	OverlayCompression get_mode() const {
+		return mode;
+	}
+
+	//! Threadsafe.
+	void compress(xdr::opaque_vec<> const& txs, CompressedTxBatch& out) const;
+
+	/*! Threadsafe.  Accepts any mode that this compressor can
+	decompress (a dictionary batch needs the same dictionary).
+	Throws std::runtime_error on a malformed batch.
+	*/
+	void decompress(CompressedTxBatch const& batch, xdr::opaque_vec<>& out) const;
+
+	/*! Train a dictionary on the individual transactions in a set of
+	serialized tx lists (as in DataBuffer::data).
+	*/
+	static std::vector<uint8_t> 
+	train_dictionary(
+		std::vector<xdr::opaque_vec<>> const& tx_lists, 
+		size_t dict_size = DEFAULT_DICT_SIZE);
+
+	static void 
+	save_dictionary(std::vector<uint8_t> const& dictionary, std::string const& filename);
+
+	static std::vector<uint8_t> 
+	load_dictionary(std::string const& filename);
+};
+
+} /* speedex */
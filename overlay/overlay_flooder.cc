@@ -20,54 +20,115 @@
 
 #include "utils/debug_macros.h"
 
+#include <utils/time.h>
+
 #include <thread>
 
 using namespace std::chrono_literals;
 
 namespace speedex {
 
+std::chrono::milliseconds
+OverlayFlooder::get_poll_interval() const {
+	std::lock_guard lock(policy_mtx);
+	return policy.get_poll_interval();
+}
+
 void 
 OverlayFlooder::background_poll_thread() {
 	while(!is_done()) {
 		client_manager.poll_foreign_mempool_size();
-		std::this_thread::sleep_for(500ms);
+		std::this_thread::sleep_for(get_poll_interval());
 	}
 }
 
 void
 OverlayFlooder::background_flood_thread() {
 
+	auto start_time = utils::init_time_measurement();
+
 	std::optional<DataBuffer> buffer;
+	std::vector<DataBuffer> batch;
+
 	while(!is_done()) {
 		size_t sz = client_manager.get_min_mempool_size();
-		if (sz < FLOOD_THRESHOLD) {
+		auto rtt = client_manager.get_max_rtt();
+
+		uint64_t threshold;
+		uint32_t buffers_per_send;
+		std::chrono::milliseconds poll_interval;
+		{
+			std::lock_guard lock(policy_mtx);
+			if (rtt) {
+				policy.observe_rtt(*rtt);
+			}
+			policy.observe_mempool_size(sz, utils::measure_time_from_basept(start_time));
+			threshold = policy.get_flood_threshold();
+			buffers_per_send = policy.get_buffers_per_send(sz);
+			poll_interval = policy.get_poll_interval();
+		}
+
+		if (sz >= threshold) {
+			std::this_thread::sleep_for(poll_interval);
+			continue;
+		}
+
+		bool finished = false;
+		batch.clear();
+
+		while (batch.size() < buffers_per_send) {
 			if (!buffer) {
 				buffer = data_stream.load_txs_unparsed();
 			}
-			if (buffer->buffer_number <= server.tx_batch_limit()) {
-				if (buffer -> data) {
-					OVERLAY_INFO("forwarding tx input buffer number %lu", buffer -> buffer_number);
-					client_manager.send_txs(*buffer);
-				}
-				buffer = std::nullopt;
-
+			// don't get too far ahead of the slowest replica.
+			// Later buffers in a batch ride along with the first.
+			if (batch.empty() && buffer -> buffer_number > server.tx_batch_limit()) {
+				break;
+			}
+			finished = buffer -> finished;
+			if (buffer -> data) {
+				batch.push_back(*buffer);
 			}
-			if (buffer -> finished) {
-				OVERLAY_INFO("done loading txs, terminating overlay flooder");
-				return;
+			buffer = std::nullopt;
+			if (finished) {
+				break;
+			}
+		}
+
+		if (batch.size() > 0) {
+			OVERLAY_INFO("forwarding %lu tx input buffers (last number %lu), threshold %lu, min mempool %lu",
+				batch.size(), batch.back().buffer_number, threshold, sz);
+			client_manager.send_txs(batch);
+
+			uint64_t num_txs = 0;
+			for (auto const& b : batch) {
+				num_txs += b.num_txs;
 			}
-		} else {
-			std::this_thread::sleep_for(500ms);
+			std::lock_guard lock(policy_mtx);
+			policy.observe_send(num_txs, batch.size());
+		} else if (!finished) {
+			// waiting on other replicas
+			std::this_thread::sleep_for(poll_interval / 10);
+		}
+
+		if (finished) {
+			OVERLAY_INFO("done loading txs, terminating overlay flooder");
+			return;
 		}
 	}
 }
 
 OverlayFlooder::OverlayFlooder(DataStream& data_stream, OverlayClientManager& client_manager, OverlayServer& server, size_t flood_threshold)
+	: OverlayFlooder(data_stream, client_manager, server, AdaptiveFloodParams::fixed(flood_threshold))
+	{}
+
+OverlayFlooder::OverlayFlooder(DataStream& data_stream, OverlayClientManager& client_manager, OverlayServer& server, AdaptiveFloodParams const& params)
 	: data_stream(data_stream)
 	, client_manager(client_manager)
 	, server(server)
 	, done_flag(false)
-	, FLOOD_THRESHOLD(flood_threshold)
+	, policy_mtx()
+	, policy(params)
 	{
 		std::thread([this] {
 			background_poll_thread();
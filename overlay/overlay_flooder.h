@@ -18,6 +18,7 @@
 
 #pragma once
 
+#include "overlay/adaptive_flood_policy.h"
 #include "overlay/overlay_client_manager.h"
 #include "overlay/overlay_server.h"
 
@@ -25,6 +26,7 @@
 
 #include <atomic>
 #include <cstdint>
+#include <mutex>
 
 namespace speedex {
 
@@ -42,12 +44,19 @@ class OverlayFlooder {
 	bool is_done() const;
 	void set_done();
 
-	const size_t FLOOD_THRESHOLD;
+	// guards policy (shared between the poll and flood threads)
+	mutable std::mutex policy_mtx;
+	AdaptiveFloodPolicy policy;
+
+	std::chrono::milliseconds get_poll_interval() const;
 
 public:
 
+	//! Fixed flood threshold (see AdaptiveFloodParams::fixed).
 	OverlayFlooder(DataStream& data_stream, OverlayClientManager& client_manager, OverlayServer& server, size_t flood_threshold);
 
+	OverlayFlooder(DataStream& data_stream, OverlayClientManager& client_manager, OverlayServer& server, AdaptiveFloodParams const& params);
+
 	~OverlayFlooder()
 	{
 		set_done();
@@ -0,0 +1,61 @@
+/**
+ * SPEEDEX: A Scalable, Parallelizable, and Economically Efficient Decentralized Exchange
+ * Copyright (C) 2023 Geoffrey Ramseyer
+
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "overlay/overlay_ingest_worker.h"
+
+namespace speedex {
+
+bool
+OverlayIngestWorker::try_submit(OverlayIngestTask& task) {
+	std::lock_guard lock(mtx);
+	if (done_flag || (tasks.size() >= max_pending)) {
+		return false;
+	}
+
+	tasks.push_back(std::move(task));
+	cv.notify_all();
+	return true;
+}
+
+void
+OverlayIngestWorker::run() {
+	while(true) {
+		OverlayIngestTask task;
+		{
+			std::unique_lock lock(mtx);
+			if ((!done_flag) && (!exists_work_to_do())) {
+				cv.wait(lock, 
+					[this] () { return done_flag || exists_work_to_do();});
+			}
+			if (done_flag) return;
+
+			task = std::move(tasks.front());
+			// processed outside the lock, so not yet popped:
+			// wait_for_idle() must not return while it runs
+		}
+
+		process(task);
+
+		std::lock_guard lock(mtx);
+		tasks.pop_front();
+		// wakes wait_for_idle()
+		cv.notify_all();
+	}
+}
+
+} /* speedex */
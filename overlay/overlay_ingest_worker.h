@@ -0,0 +1,100 @@
+/**
+ * SPEEDEX: A Scalable, Parallelizable, and Economically Efficient Decentralized Exchange
+ * Copyright (C) 2023 Geoffrey Ramseyer
+
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#pragma once
+
+/*! \file overlay_ingest_worker.h
+
+Background decoding of tx batches received by the overlay server.
+
+The server's pollset thread reads every peer's stream.  Parsing,
+decompressing, and deduplicating a batch and splitting it into mempool
+chunks costs far more than reading it, so with many peers the pollset
+thread becomes the bottleneck.  Instead, the rpc handler hands each
+batch to a worker.  The pollset thread never waits on a worker:
+if a worker's queue is full, the batch is dropped (tx flooding is
+best effort; the batch's txs stay in their origin's mempool).
+
+Batches from one peer always go to the same worker, so they are
+processed in the order received.
+*/
+
+#include "xdr/overlay.h"
+
+#include <utils/async_worker.h>
+
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <memory>
+
+namespace speedex {
+
+//! A received batch.  Exactly one of raw/compressed is set.
+struct OverlayIngestTask {
+	std::unique_ptr<ForwardingTxs> raw;
+	std::unique_ptr<CompressedTxBatch> compressed;
+	uint32_t batch_num;
+	ReplicaID sender;
+};
+
+class OverlayIngestWorker : public utils::AsyncWorker {
+
+public:
+	using process_fn = std::function<void(OverlayIngestTask&)>;
+
+private:
+
+	const process_fn process;
+	const size_t max_pending;
+
+	std::deque<OverlayIngestTask> tasks;
+
+	bool exists_work_to_do() override final {
+		return tasks.size() > 0;
+	}
+
+	void run();
+
+public:
+
+	//! \a process is called on the worker thread, one task at a time.
+	OverlayIngestWorker(process_fn process, size_t max_pending)
+		: utils::AsyncWorker()
+		, process(process)
+		, max_pending(max_pending)
+		, tasks()
+		{
+			start_async_thread([this] () {run();});
+		}
+
+	~OverlayIngestWorker() {
+		terminate_worker();
+	}
+
+	//! Queues a task, unless max_pending tasks are already queued.
+	//! Never blocks.  Returns false if the task was not queued.
+	bool try_submit(OverlayIngestTask& task);
+
+	//! Wait for all queued tasks to finish.
+	void wait_for_idle() {
+		wait_for_async_task();
+	}
+};
+
+} /* speedex */
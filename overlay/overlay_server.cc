@@ -26,6 +26,8 @@
 
 #include "utils/debug_macros.h"
 
+#include <utils/time.h>
+
 namespace speedex
 {
 
@@ -55,15 +57,112 @@ OverlayHandler::forward_txs(std::unique_ptr<ForwardingTxs> txs,
                             std::unique_ptr<uint32_t> tx_batch_num,
                             std::unique_ptr<ReplicaID> sender)
 {
+    if (ingest_workers.empty())
+    {
+        add_forwarded_txs(*txs, *tx_batch_num, *sender);
+        return;
+    }
+    submit_ingest_task(OverlayIngestTask{
+        .raw = std::move(txs),
+        .compressed = nullptr,
+        .batch_num = *tx_batch_num,
+        .sender = *sender });
+}
+
+void
+OverlayHandler::forward_compressed_txs(std::unique_ptr<CompressedTxBatch> txs,
+                                       std::unique_ptr<uint32_t> tx_batch_num,
+                                       std::unique_ptr<ReplicaID> sender)
+{
+    if (ingest_workers.empty())
+    {
+        add_compressed_txs(*txs, *tx_batch_num, *sender);
+        return;
+    }
+    submit_ingest_task(OverlayIngestTask{
+        .raw = nullptr,
+        .compressed = std::move(txs),
+        .batch_num = *tx_batch_num,
+        .sender = *sender });
+}
+
+void
+OverlayHandler::submit_ingest_task(OverlayIngestTask task)
+{
+    // same worker for every batch from a sender, to keep them in order
+    auto& worker = ingest_workers[task.sender % ingest_workers.size()];
+    if (!worker->try_submit(task))
+    {
+        // never stall the pollset thread (and so every other peer)
+        // on one backlogged worker
+        OVERLAY_INFO("ingest backlogged, dropping batch %u from %u",
+                     task.batch_num,
+                     task.sender);
+        ingest_batches_dropped.fetch_add(1, std::memory_order_relaxed);
+        // as for an unparseable batch
+        log_batch_receipt(task.sender, task.batch_num);
+    }
+}
+
+void
+OverlayHandler::process_ingest_task(OverlayIngestTask& task)
+{
+    if (task.compressed)
+    {
+        add_compressed_txs(*task.compressed, task.batch_num, task.sender);
+    }
+    else if (task.raw)
+    {
+        add_forwarded_txs(*task.raw, task.batch_num, task.sender);
+    }
+}
+
+void
+OverlayHandler::wait_for_ingest()
+{
+    for (auto& worker : ingest_workers)
+    {
+        worker->wait_for_idle();
+    }
+}
+
+void
+OverlayHandler::add_compressed_txs(CompressedTxBatch const& txs,
+                                   uint32_t tx_batch_num,
+                                   ReplicaID sender)
+{
+    ForwardingTxs decompressed;
+    try
+    {
+        compressor.decompress(txs, decompressed);
+    }
+    catch (std::exception const& e)
+    {
+        OVERLAY_INFO("dropping batch from %u: %s", sender, e.what());
+        // as for an unparseable uncompressed batch
+        log_batch_receipt(sender, tx_batch_num);
+        return;
+    }
+    add_forwarded_txs(decompressed, tx_batch_num, sender);
+}
+
+void
+OverlayHandler::add_forwarded_txs(ForwardingTxs const& txs,
+                                  uint32_t tx_batch_num,
+                                  ReplicaID sender)
+{
 
     try
     {
-        log_batch_receipt(*sender, *tx_batch_num);
+        log_batch_receipt(sender, tx_batch_num);
         xdr::xvector<SignedTransaction> blk;
-        xdr::xdr_from_opaque(*txs, blk);
+        xdr::xdr_from_opaque(txs, blk);
+
+        size_t dups = drop_seen_txs(blk);
 
-        OVERLAY_INFO("got %lu new txs for mempool, cur size %lu",
+        OVERLAY_INFO("got %lu new txs (%lu duplicates) for mempool, cur size %lu",
                      blk.size(),
+                     dups,
                      mempool.total_size());
 
         mempool.chunkify_and_add_to_mempool_buffer(std::move(blk));
@@ -74,6 +173,69 @@ OverlayHandler::forward_txs(std::unique_ptr<ForwardingTxs> txs,
     }
 }
 
+std::unique_ptr<TxInventoryWants>
+OverlayHandler::offer_inventory(std::unique_ptr<TxInventory> inventory,
+                                std::unique_ptr<ReplicaID> sender)
+{
+    auto const& digests = inventory->digests;
+    auto out = std::make_unique<TxInventoryWants>();
+    out->resize((digests.size() + 7) / 8, 0);
+
+    size_t num_wanted = 0;
+    for (size_t i = 0; i < digests.size(); i++)
+    {
+        // not inserted until the tx itself arrives,
+        // in case the sender fails before sending it
+        if (!seen_txs || !seen_txs->contains(digests[i]))
+        {
+            (*out)[i / 8] |= (1 << (i % 8));
+            num_wanted++;
+        }
+    }
+
+    inventory_offered.fetch_add(digests.size(), std::memory_order_relaxed);
+    inventory_wanted.fetch_add(num_wanted, std::memory_order_relaxed);
+
+    OVERLAY_INFO("inventory from %u: want %lu of %lu txs",
+                 *sender,
+                 num_wanted,
+                 digests.size());
+    return out;
+}
+
+size_t
+OverlayHandler::drop_seen_txs(xdr::xvector<SignedTransaction>& txs)
+{
+    txs_received.fetch_add(txs.size(), std::memory_order_relaxed);
+    if (!seen_txs)
+    {
+        return 0;
+    }
+
+    auto timestamp = utils::init_time_measurement();
+    size_t dups = seen_txs->filter_seen(txs);
+    filter_nanoseconds.fetch_add(utils::measure_time(timestamp) * 1'000'000'000,
+                                 std::memory_order_relaxed);
+
+    duplicates_dropped.fetch_add(dups, std::memory_order_relaxed);
+    return dups;
+}
+
+OverlayDedupStats
+OverlayHandler::get_dedup_stats() const
+{
+    return OverlayDedupStats{
+        .txs_received = txs_received.load(std::memory_order_relaxed),
+        .duplicates_dropped = duplicates_dropped.load(std::memory_order_relaxed),
+        .inventory_offered = inventory_offered.load(std::memory_order_relaxed),
+        .inventory_wanted = inventory_wanted.load(std::memory_order_relaxed),
+        .filter_seconds
+        = filter_nanoseconds.load(std::memory_order_relaxed) / 1'000'000'000.0,
+        .ingest_batches_dropped
+        = ingest_batches_dropped.load(std::memory_order_relaxed)
+    };
+}
+
 uint32_t
 OverlayHandler::get_min_max_seen_batch_nums() const
 {
@@ -87,8 +249,11 @@ OverlayHandler::get_min_max_seen_batch_nums() const
 
 OverlayServer::OverlayServer(Mempool& mempool,
                              const ReplicaConfig& config,
-                             ReplicaID self_id)
-    : handler(mempool, config)
+                             ReplicaID self_id,
+                             OverlayTxCompressor const& compressor,
+                             uint64_t dedup_capacity,
+                             uint32_t num_ingest_threads)
+    : handler(mempool, config, compressor, dedup_capacity, num_ingest_threads)
     , ps()
     , overlay_listener(ps,
                        xdr::tcp_listen(static_cast<const ReplicaInfo&>(
@@ -20,11 +20,17 @@
 
 #include "hotstuff/config/replica_config.h"
 
+#include "overlay/overlay_compression.h"
+#include "overlay/overlay_ingest_worker.h"
+#include "overlay/tx_digest_filter.h"
+
 #include "xdr/overlay.h"
 
 #include <atomic>
 #include <condition_variable>
+#include <memory>
 #include <mutex>
+#include <vector>
 
 #include <xdrpp/pollset.h>
 #include <xdrpp/srpc.h>
@@ -33,33 +39,112 @@ namespace speedex {
 
 class Mempool;
 
+struct OverlayDedupStats {
+	uint64_t txs_received = 0;
+	uint64_t duplicates_dropped = 0;
+	// txs announced by inventory, and how many of those were requested
+	uint64_t inventory_offered = 0;
+	uint64_t inventory_wanted = 0;
+	// time spent computing digests and checking the filter
+	double filter_seconds = 0;
+	// batches dropped because their ingest thread was backlogged
+	uint64_t ingest_batches_dropped = 0;
+};
+
 class OverlayHandler {
 
 	Mempool& mempool;
 
 	std::unordered_map<hotstuff::ReplicaID, std::atomic<uint32_t>> max_seen_batch_nums;
 
+	OverlayTxCompressor const& compressor;
+
+	// null if deduplication is disabled
+	std::unique_ptr<RotatingTxDigestFilter> seen_txs;
+
+	std::atomic<uint64_t> txs_received;
+	std::atomic<uint64_t> duplicates_dropped;
+	std::atomic<uint64_t> inventory_offered;
+	std::atomic<uint64_t> inventory_wanted;
+	std::atomic<uint64_t> filter_nanoseconds;
+	std::atomic<uint64_t> ingest_batches_dropped;
+
+	// empty if batches are processed on the pollset thread.
+	// Declared last, so workers stop before what they use is destroyed.
+	std::vector<std::unique_ptr<OverlayIngestWorker>> ingest_workers;
+
+	void add_forwarded_txs(ForwardingTxs const& txs, uint32_t tx_batch_num, hotstuff::ReplicaID sender);
+	void add_compressed_txs(CompressedTxBatch const& txs, uint32_t tx_batch_num, hotstuff::ReplicaID sender);
+
+	void process_ingest_task(OverlayIngestTask& task);
+	void submit_ingest_task(OverlayIngestTask task);
+
 public:
 
-	OverlayHandler(Mempool& mempool, const hotstuff::ReplicaConfig& config)
+	//! Remembers between 1x and 2x this many txs for deduplication
+	//! (about 2 bytes of filter per tx).
+	constexpr static uint64_t DEFAULT_DEDUP_CAPACITY = 1 << 22;
+
+	//! Batches queued per ingest thread.  Further batches for that
+	//! thread are dropped until it catches up.
+	constexpr static size_t MAX_PENDING_INGEST_BATCHES = 4;
+
+	/*! \a dedup_capacity = 0 disables deduplication.
+	With \a num_ingest_threads = 0, received batches are decoded on the
+	pollset thread.  Otherwise, on a pool of that many threads
+	(at most one per replica is useful).
+	*/
+	OverlayHandler(
+		Mempool& mempool, 
+		const hotstuff::ReplicaConfig& config, 
+		OverlayTxCompressor const& compressor = OverlayTxCompressor::none(),
+		uint64_t dedup_capacity = DEFAULT_DEDUP_CAPACITY,
+		uint32_t num_ingest_threads = 0)
 		: mempool(mempool)
 		, max_seen_batch_nums()
+		, compressor(compressor)
+		, seen_txs(dedup_capacity > 0 ? std::make_unique<RotatingTxDigestFilter>(dedup_capacity) : nullptr)
+		, txs_received(0)
+		, duplicates_dropped(0)
+		, inventory_offered(0)
+		, inventory_wanted(0)
+		, filter_nanoseconds(0)
+		, ingest_batches_dropped(0)
+		, ingest_workers()
 		{
 			auto infos = config.list_info();
 			for(auto& info : infos) {
 				max_seen_batch_nums[info->id] = 0;
 			}
+			for (uint32_t i = 0; i < num_ingest_threads; i++) {
+				ingest_workers.emplace_back(std::make_unique<OverlayIngestWorker>(
+					[this] (OverlayIngestTask& task) {
+						process_ingest_task(task);
+					}, 
+					MAX_PENDING_INGEST_BATCHES));
+			}
 		}
 
 	using rpc_interface_type = OverlayV1;
 
 	std::unique_ptr<uint64_t> mempool_size();
 	void forward_txs(std::unique_ptr<ForwardingTxs> txs, std::unique_ptr<uint32_t> tx_batch_num, std::unique_ptr<hotstuff::ReplicaID> sender);
+	void forward_compressed_txs(std::unique_ptr<CompressedTxBatch> txs, std::unique_ptr<uint32_t> tx_batch_num, std::unique_ptr<hotstuff::ReplicaID> sender);
+	std::unique_ptr<TxInventoryWants> offer_inventory(std::unique_ptr<TxInventory> inventory, std::unique_ptr<hotstuff::ReplicaID> sender);
 
 	//non-rpc methods
 	uint32_t get_min_max_seen_batch_nums() const;
 	void log_batch_receipt(ReplicaID source, uint32_t batch_num);
 
+	//! Remove txs seen recently (by any path) and remember the rest.
+	//! Returns the number removed.
+	size_t drop_seen_txs(xdr::xvector<SignedTransaction>& txs);
+
+	OverlayDedupStats get_dedup_stats() const;
+
+	//! Wait until all received batches are in the mempool buffer.
+	void wait_for_ingest();
+
 };
 
 class OverlayServer {
@@ -77,7 +162,14 @@ class OverlayServer {
 
 public:
 
-	OverlayServer(Mempool& mempool, const hotstuff::ReplicaConfig& config, hotstuff::ReplicaID self_id);
+	//! \a compressor must be able to decompress what other replicas send.
+	OverlayServer(
+		Mempool& mempool, 
+		const hotstuff::ReplicaConfig& config, 
+		hotstuff::ReplicaID self_id,
+		OverlayTxCompressor const& compressor = OverlayTxCompressor::none(),
+		uint64_t dedup_capacity = OverlayHandler::DEFAULT_DEDUP_CAPACITY,
+		uint32_t num_ingest_threads = 0);
 
 	uint32_t tx_batch_limit() const {
 		return handler.get_min_max_seen_batch_nums() + 1;
@@ -0,0 +1,176 @@
+#include <catch2/catch_test_macros.hpp>
+
+#include "overlay/adaptive_flood_policy.h"
+#include "overlay/overlay_client_manager.h"
+#include "overlay/overlay_compression.h"
+
+#include "xdr/experiments.h"
+#include "xdr/overlay.h"
+
+#include "config.h"
+
+#include <xdrpp/marshal.h>
+
+#include <chrono>
+#include <memory>
+
+namespace speedex {
+
+using namespace std::chrono_literals;
+
+namespace {
+
+DataBuffer make_buffer(size_t num_txs, size_t buffer_number) {
+	ExperimentBlock block;
+	block.resize(num_txs);
+	for (size_t i = 0; i < num_txs; i++) {
+		block[i].transaction.metadata.sourceAccount = buffer_number;
+		block[i].transaction.metadata.sequenceNumber = i;
+	}
+	auto data = std::make_shared<xdr::opaque_vec<>>(xdr::xdr_to_opaque(block));
+	return DataBuffer{num_txs, data, buffer_number, false};
+}
+
+AdaptiveFloodParams test_params() {
+	return AdaptiveFloodParams {
+		.min_threshold = 1'000,
+		.max_threshold = 100'000,
+		.max_buffers_per_send = 4,
+		.min_poll_interval = 10ms,
+		.max_poll_interval = 500ms
+	};
+}
+
+} /* anonymous namespace */
+
+TEST_CASE("fixed flood policy", "[overlay]")
+{
+	AdaptiveFloodPolicy policy(AdaptiveFloodParams::fixed(5'000));
+
+	policy.observe_rtt(0.1);
+	policy.observe_mempool_size(10'000, 0);
+	policy.observe_mempool_size(0, 1);
+
+	REQUIRE(policy.get_flood_threshold() == 5'000);
+	REQUIRE(policy.get_buffers_per_send(0) == 1);
+	REQUIRE(policy.get_poll_interval() == 500ms);
+}
+
+TEST_CASE("adaptive flood policy", "[overlay]")
+{
+	AdaptiveFloodPolicy policy(test_params());
+
+	REQUIRE(policy.get_flood_threshold() == 1'000);
+	REQUIRE(policy.get_poll_interval() == 10ms);
+
+	policy.observe_rtt(0.05);
+	REQUIRE(policy.get_poll_interval() == 100ms);
+
+	// drains 20k txs per second, once sends are accounted for
+	uint64_t size = 50'000;
+	policy.observe_mempool_size(size, 0);
+	for (size_t i = 1; i <= 20; i++) {
+		policy.observe_send(1'000, 1);
+		size = size + 1'000 - 2'000;
+		policy.observe_mempool_size(size, 0.1 * i);
+	}
+
+	REQUIRE(policy.get_drain_rate() > 10'000);
+	REQUIRE(policy.get_drain_rate() < 40'000);
+
+	uint64_t threshold = policy.get_flood_threshold();
+	REQUIRE(threshold > 1'000);
+	REQUIRE(threshold < 100'000);
+
+	SECTION("batch size grows with deficit")
+	{
+		REQUIRE(policy.get_buffers_per_send(threshold) == 1);
+		REQUIRE(policy.get_buffers_per_send(threshold - 1) == 1);
+		REQUIRE(policy.get_buffers_per_send(0) > 1);
+		REQUIRE(policy.get_buffers_per_send(0) <= 4);
+	}
+
+	SECTION("threshold grows with rtt")
+	{
+		policy.observe_rtt(0.2);
+		REQUIRE(policy.get_flood_threshold() > threshold);
+	}
+}
+
+TEST_CASE("coalesce tx buffers", "[overlay]")
+{
+	std::vector<DataBuffer> buffers = {make_buffer(3, 1), make_buffer(0, 2), make_buffer(5, 3)};
+
+	auto merged = coalesce_tx_buffers(buffers);
+
+	REQUIRE(merged.num_txs == 8);
+	REQUIRE(merged.buffer_number == 3);
+
+	ExperimentBlock out;
+	xdr::xdr_from_opaque(*merged.data, out);
+
+	REQUIRE(out.size() == 8);
+	REQUIRE(out[2].transaction.metadata.sourceAccount == 1);
+	REQUIRE(out[2].transaction.metadata.sequenceNumber == 2);
+	REQUIRE(out[3].transaction.metadata.sourceAccount == 3);
+	REQUIRE(out[7].transaction.metadata.sequenceNumber == 4);
+}
+
+TEST_CASE("overlay compression roundtrip", "[overlay]")
+{
+	auto buffer = make_buffer(1'000, 1);
+
+	auto roundtrip = [&buffer] (OverlayTxCompressor const& compressor) {
+		CompressedTxBatch batch;
+		compressor.compress(*buffer.data, batch);
+
+		REQUIRE(batch.compression == compressor.get_mode());
+		REQUIRE(batch.uncompressedSize == buffer.data -> size());
+
+		xdr::opaque_vec<> out;
+		compressor.decompress(batch, out);
+		REQUIRE(out == *buffer.data);
+		return batch.data.size();
+	};
+
+	REQUIRE(roundtrip(OverlayTxCompressor::none()) == buffer.data -> size());
+
+#if HAVE_ZSTD == 1
+	SECTION("zstd")
+	{
+		OverlayTxCompressor compressor(OVERLAY_ZSTD);
+		REQUIRE(roundtrip(compressor) < buffer.data -> size());
+	}
+
+	SECTION("zstd with dictionary")
+	{
+		std::vector<xdr::opaque_vec<>> samples;
+		for (size_t i = 0; i < 10; i++) {
+			samples.push_back(*make_buffer(1'000, i + 10).data);
+		}
+		auto dictionary = OverlayTxCompressor::train_dictionary(samples, 4096);
+		OverlayTxCompressor compressor(OVERLAY_ZSTD_DICT, OverlayTxCompressor::DEFAULT_LEVEL, dictionary);
+		REQUIRE(roundtrip(compressor) < buffer.data -> size());
+
+		// no dictionary, no decompression
+		CompressedTxBatch batch;
+		compressor.compress(*buffer.data, batch);
+		xdr::opaque_vec<> out;
+		REQUIRE_THROWS(OverlayTxCompressor(OVERLAY_ZSTD).decompress(batch, out));
+	}
+
+	SECTION("corrupt batch")
+	{
+		OverlayTxCompressor compressor(OVERLAY_ZSTD);
+		CompressedTxBatch batch;
+		compressor.compress(*buffer.data, batch);
+		batch.uncompressedSize += 1;
+		xdr::opaque_vec<> out;
+		REQUIRE_THROWS(compressor.decompress(batch, out));
+	}
+#else
+	REQUIRE_THROWS(OverlayTxCompressor(OVERLAY_ZSTD));
+#endif
+}
+
+} /* speedex */
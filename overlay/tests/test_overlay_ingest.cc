@@ -0,0 +1,80 @@
+#include <catch2/catch_test_macros.hpp>
+
+#include "overlay/overlay_ingest_worker.h"
+
+#include <atomic>
+#include <mutex>
+#include <vector>
+
+namespace speedex {
+
+TEST_CASE("ingest worker keeps order", "[overlay]")
+{
+	std::mutex mtx;
+	std::vector<uint32_t> processed;
+
+	OverlayIngestWorker worker(
+		[&] (OverlayIngestTask& task) {
+			std::lock_guard lock(mtx);
+			if (task.raw) {
+				processed.push_back(task.batch_num);
+			}
+		},
+		100);
+
+	std::vector<uint32_t> accepted;
+	for (uint32_t i = 0; i < 100; i++) {
+		OverlayIngestTask task{
+			.raw = std::make_unique<ForwardingTxs>(),
+			.compressed = nullptr,
+			.batch_num = i,
+			.sender = 1};
+		if (worker.try_submit(task)) {
+			accepted.push_back(i);
+		}
+	}
+	worker.wait_for_idle();
+
+	std::lock_guard lock(mtx);
+	REQUIRE(accepted.size() == 100);
+	REQUIRE(processed == accepted);
+}
+
+TEST_CASE("ingest worker bounds pending batches", "[overlay]")
+{
+	std::mutex block_mtx;
+	std::unique_lock block(block_mtx);
+
+	std::atomic<uint32_t> num_processed = 0;
+
+	OverlayIngestWorker worker(
+		[&] (OverlayIngestTask&) {
+			std::lock_guard lock(block_mtx);
+			num_processed++;
+		},
+		2);
+
+	// the worker is stuck on the first task (which stays queued
+	// until processed), so only one more fits, and the
+	// rest are refused without blocking
+	uint32_t num_accepted = 0;
+	for (uint32_t i = 0; i < 4; i++) {
+		OverlayIngestTask task{};
+		if (worker.try_submit(task)) {
+			num_accepted++;
+		}
+	}
+	REQUIRE(num_accepted == 2);
+
+	block.unlock();
+	worker.wait_for_idle();
+	REQUIRE(num_processed == 2);
+
+	// room again once the worker catches up
+	OverlayIngestTask task{};
+	REQUIRE(worker.try_submit(task));
+	worker.wait_for_idle();
+	REQUIRE(num_processed == 3);
+}
+
+} /* speedex */
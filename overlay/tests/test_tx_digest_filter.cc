@@ -0,0 +1,130 @@
+#include <catch2/catch_test_macros.hpp>
+
+#include "overlay/tx_digest_filter.h"
+
+#include "synthetic_data_generator/data_stream.h"
+
+#include <xdrpp/marshal.h>
+
+namespace speedex {
+
+namespace {
+
+SignedTransaction make_tx(AccountID account, uint64_t seq_num) {
+	SignedTransaction tx;
+	tx.transaction.metadata.sourceAccount = account;
+	tx.transaction.metadata.sequenceNumber = seq_num;
+	return tx;
+}
+
+} /* anonymous namespace */
+
+TEST_CASE("tx digests", "[overlay]")
+{
+	auto tx = make_tx(1, 2);
+	uint64_t digest = tx_digest(tx);
+
+	SECTION("other fields ignored")
+	{
+		tx.transaction.maxFee = 100;
+		REQUIRE(tx_digest(tx) == digest);
+	}
+	SECTION("signature")
+	{
+		tx.signature[0] = 1;
+		REQUIRE(tx_digest(tx) != digest);
+	}
+	SECTION("metadata")
+	{
+		REQUIRE(tx_digest(make_tx(2, 2)) != digest);
+		REQUIRE(tx_digest(make_tx(1, 3)) != digest);
+	}
+}
+
+TEST_CASE("digest filter no false negatives", "[overlay]")
+{
+	RotatingTxDigestFilter filter(10'000);
+
+	for (uint64_t i = 0; i < 10'000; i++) {
+		REQUIRE(!filter.contains(i * 7919));
+		filter.test_and_insert(i * 7919);
+	}
+	for (uint64_t i = 0; i < 10'000; i++) {
+		REQUIRE(filter.contains(i * 7919));
+		REQUIRE(filter.test_and_insert(i * 7919));
+	}
+}
+
+TEST_CASE("digest filter false positive rate", "[overlay]")
+{
+	RotatingTxDigestFilter filter(100'000, 0.01);
+
+	for (uint64_t i = 0; i < 100'000; i++) {
+		filter.test_and_insert(i);
+	}
+
+	size_t false_positives = 0;
+	for (uint64_t i = 100'000; i < 200'000; i++) {
+		if (filter.contains(i)) {
+			false_positives++;
+		}
+	}
+	// one generation holds 100k, and the other is empty
+	REQUIRE(false_positives < 2'000);
+}
+
+TEST_CASE("digest filter rotation", "[overlay]")
+{
+	RotatingTxDigestFilter filter(1'000);
+
+	for (uint64_t i = 0; i < 1'000; i++) {
+		filter.test_and_insert(i);
+	}
+
+	// one rotation: still remembered
+	for (uint64_t i = 1'000; i < 1'500; i++) {
+		filter.test_and_insert(i);
+	}
+	REQUIRE(filter.contains(0));
+
+	// after the second, forgotten
+	for (uint64_t i = 1'500; i < 2'100; i++) {
+		filter.test_and_insert(i);
+	}
+	size_t remembered = 0;
+	for (uint64_t i = 0; i < 1'000; i++) {
+		if (filter.contains(i)) {
+			remembered++;
+		}
+	}
+	REQUIRE(remembered < 50);
+	REQUIRE(filter.contains(2'099));
+}
+
+TEST_CASE("filter seen txs", "[overlay]")
+{
+	RotatingTxDigestFilter filter(1'000'000);
+
+	OverlappingMockDataStream stream1(1, 0.3), stream2(2, 0.3);
+
+	xdr::xvector<SignedTransaction> txs1, txs2;
+	xdr::xdr_from_opaque(*stream1.load_txs_unparsed().data, txs1);
+	xdr::xdr_from_opaque(*stream2.load_txs_unparsed().data, txs2);
+
+	REQUIRE(filter.filter_seen(txs1) == 0);
+	REQUIRE(txs1.size() == 100'000);
+
+	size_t removed = filter.filter_seen(txs2);
+	// shared txs, plus a few false positives
+	REQUIRE(removed >= 30'000);
+	REQUIRE(removed < 30'500);
+	REQUIRE(txs2.size() == 100'000 - removed);
+	REQUIRE(txs2.back().transaction.metadata.sourceAccount == 3);
+
+	// order preserved
+	for (size_t i = 1; i < txs2.size(); i++) {
+		REQUIRE(txs2[i-1].transaction.metadata.sequenceNumber < txs2[i].transaction.metadata.sequenceNumber);
+	}
+}
+
+} /* speedex */
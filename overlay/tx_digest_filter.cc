@@ -0,0 +1,221 @@
+/**
+ * SPEEDEX: A Scalable, Parallelizable, and Economically Efficient Decentralized Exchange
+ * Copyright (C) 2023 Geoffrey Ramseyer
+
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "overlay/tx_digest_filter.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <mutex>
+#include <random>
+#include <stdexcept>
+
+#include <sodium.h>
+
+namespace speedex {
+
+namespace {
+
+// Fixed so that all replicas compute the same digests.
+// Collisions only merge txs that conflict anyway (see header).
+constexpr uint8_t TX_DIGEST_KEY[crypto_shorthash_KEYBYTES] = {};
+
+constexpr uint32_t MAX_HASHES = 16;
+
+uint64_t splitmix64(uint64_t x) {
+	x += 0x9E37'79B9'7F4A'7C15;
+	x = (x ^ (x >> 30)) * 0xBF58'476D'1CE4'E5B9;
+	x = (x ^ (x >> 27)) * 0x94D0'49BB'1331'11EB;
+	return x ^ (x >> 31);
+}
+
+uint64_t random_salt() {
+	std::random_device rd;
+	return (static_cast<uint64_t>(rd()) << 32) | rd();
+}
+
+uint64_t num_words_for(uint64_t capacity, double false_positive_rate) {
+	if (capacity == 0) {
+		throw std::runtime_error("filter capacity must be nonzero");
+	}
+	if (!(false_positive_rate > 0 && false_positive_rate < 1)) {
+		throw std::runtime_error("invalid false positive rate");
+	}
+	double bits = -static_cast<double>(capacity) * std::log(false_positive_rate) 
+		/ (std::log(2) * std::log(2));
+	uint64_t words = 1;
+	while (words * 64 < bits) {
+		words <<= 1;
+	}
+	return words;
+}
+
+uint32_t num_hashes_for(uint64_t capacity, uint64_t num_words) {
+	double k = std::round(static_cast<double>(num_words * 64) / capacity * std::log(2));
+	return std::clamp<uint32_t>(static_cast<uint32_t>(k), 1, MAX_HASHES);
+}
+
+} /* anonymous namespace */
+
+uint64_t
+tx_digest(SignedTransaction const& tx) {
+	static_assert(crypto_shorthash_BYTES == 8);
+
+	auto const& metadata = tx.transaction.metadata;
+
+	uint8_t buf[sizeof(AccountID) + sizeof(uint64_t) + std::tuple_size<Signature>::value];
+	std::memcpy(buf, &metadata.sourceAccount, sizeof(AccountID));
+	std::memcpy(buf + sizeof(AccountID), &metadata.sequenceNumber, sizeof(uint64_t));
+	std::memcpy(buf + sizeof(AccountID) + sizeof(uint64_t), tx.signature.data(), tx.signature.size());
+
+	uint64_t out;
+	if (crypto_shorthash(reinterpret_cast<uint8_t*>(&out), buf, sizeof(buf), TX_DIGEST_KEY) != 0) {
+		throw std::runtime_error("shorthash fail");
+	}
+	return out;
+}
+
+RotatingTxDigestFilter::RotatingTxDigestFilter(uint64_t generation_capacity, double false_positive_rate)
+	: generation_capacity(generation_capacity)
+	, num_words(num_words_for(generation_capacity, false_positive_rate))
+	, bit_mask(num_words * 64 - 1)
+	, num_hashes(num_hashes_for(generation_capacity, num_words))
+	, generations()
+	, current(0)
+	, rotate_mtx()
+	, salt(random_salt())
+	{
+		for (auto& gen : generations) {
+			gen.words = std::make_unique<std::atomic<uint64_t>[]>(num_words);
+			gen.num_inserted = 0;
+		}
+		clear();
+	}
+
+bool
+RotatingTxDigestFilter::generation_contains(Generation const& gen, uint64_t digest) const {
+	uint64_t h1 = splitmix64(digest ^ salt);
+	uint64_t h2 = splitmix64(h1) | 1;
+	for (uint32_t i = 0; i < num_hashes; i++) {
+		uint64_t bit = (h1 + i * h2) & bit_mask;
+		if (!(gen.words[bit / 64].load(std::memory_order_relaxed) & (UINT64_C(1) << (bit % 64)))) {
+			return false;
+		}
+	}
+	return true;
+}
+
+bool
+RotatingTxDigestFilter::generation_insert(Generation& gen, uint64_t digest) {
+	uint64_t h1 = splitmix64(digest ^ salt);
+	uint64_t h2 = splitmix64(h1) | 1;
+	bool present = true;
+	for (uint32_t i = 0; i < num_hashes; i++) {
+		uint64_t bit = (h1 + i * h2) & bit_mask;
+		uint64_t mask = UINT64_C(1) << (bit % 64);
+		uint64_t prev = gen.words[bit / 64].fetch_or(mask, std::memory_order_relaxed);
+		present &= ((prev & mask) != 0);
+	}
+	if (!present) {
+		gen.num_inserted.fetch_add(1, std::memory_order_relaxed);
+	}
+	return present;
+}
+
+bool
+RotatingTxDigestFilter::contains(uint64_t digest) const {
+	std::shared_lock lock(rotate_mtx);
+	return generation_contains(generations[0], digest) 
+		|| generation_contains(generations[1], digest);
+}
+
+bool
+RotatingTxDigestFilter::test_and_insert(uint64_t digest) {
+	bool present;
+	{
+		std::shared_lock lock(rotate_mtx);
+		uint8_t cur = current.load(std::memory_order_relaxed);
+		// reinsert even if in the old generation, to remember it for longer
+		present = generation_insert(generations[cur], digest)
+			| generation_contains(generations[1 - cur], digest);
+	}
+	maybe_rotate();
+	return present;
+}
+
+size_t
+RotatingTxDigestFilter::filter_seen(xdr::xvector<SignedTransaction>& txs) {
+	size_t out = 0;
+	{
+		std::shared_lock lock(rotate_mtx);
+		uint8_t cur = current.load(std::memory_order_relaxed);
+		for (size_t i = 0; i < txs.size(); i++) {
+			uint64_t digest = tx_digest(txs[i]);
+			bool present = generation_insert(generations[cur], digest)
+				| generation_contains(generations[1 - cur], digest);
+			if (!present) {
+				if (out != i) {
+					txs[out] = std::move(txs[i]);
+				}
+				out++;
+			}
+		}
+	}
+	size_t removed = txs.size() - out;
+	txs.resize(out);
+	// a large batch can overfill the current generation, 
+	// which only raises the false positive rate until the next rotation
+	maybe_rotate();
+	return removed;
+}
+
+void
+RotatingTxDigestFilter::maybe_rotate() {
+	auto full = [this] () -> bool {
+		uint8_t cur = current.load(std::memory_order_relaxed);
+		return generations[cur].num_inserted.load(std::memory_order_relaxed) >= generation_capacity;
+	};
+	if (!full()) {
+		return;
+	}
+	std::unique_lock lock(rotate_mtx);
+	if (!full()) {
+		// another thread rotated first
+		return;
+	}
+	uint8_t next = 1 - current.load(std::memory_order_relaxed);
+	auto& gen = generations[next];
+	for (uint64_t i = 0; i < num_words; i++) {
+		gen.words[i].store(0, std::memory_order_relaxed);
+	}
+	gen.num_inserted = 0;
+	current = next;
+}
+
+void
+RotatingTxDigestFilter::clear() {
+	std::unique_lock lock(rotate_mtx);
+	for (auto& gen : generations) {
+		for (uint64_t i = 0; i < num_words; i++) {
+			gen.words[i].store(0, std::memory_order_relaxed);
+		}
+		gen.num_inserted = 0;
+	}
+}
+
+} /* speedex */
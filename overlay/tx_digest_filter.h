@@ -0,0 +1,117 @@
+/**
+ * SPEEDEX: A Scalable, Parallelizable, and Economically Efficient Decentralized Exchange
+ * Copyright (C) 2023 Geoffrey Ramseyer
+
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#pragma once
+
+/*! \file tx_digest_filter.h
+
+Probabilistic filter of recently seen transactions, so that a tx
+reaching a replica along several overlay paths enters the mempool once.
+
+A tx is identified by a 64-bit digest of its source account, sequence
+number, and signature.  Two txs with the same digest but different
+bodies cannot both have valid signatures, and would conflict on
+sequence number anyway, so dropping all but the first loses nothing.
+
+The filter is a pair of Bloom filters.  Inserts go to the current
+generation; lookups check both.  When the current generation fills up,
+the older one is cleared and becomes current.  The filter therefore
+remembers at least the last generation_capacity txs, and a tx is
+forgotten after at most 2 * generation_capacity later inserts.
+
+False positives drop a tx that was never seen.  The default rate
+(0.1%) is well under the rate at which txs are dropped for other
+reasons, and the tx still reaches other replicas directly.
+*/
+
+#include "xdr/transaction.h"
+
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <shared_mutex>
+
+namespace speedex {
+
+//! Network-wide tx digest (the same on every replica).
+uint64_t
+tx_digest(SignedTransaction const& tx);
+
+class RotatingTxDigestFilter {
+
+	struct Generation {
+		std::unique_ptr<std::atomic<uint64_t>[]> words;
+		std::atomic<uint64_t> num_inserted;
+	};
+
+	const uint64_t generation_capacity;
+	const uint64_t num_words;
+	const uint64_t bit_mask;
+	const uint32_t num_hashes;
+
+	Generation generations[2];
+	// index of the current generation
+	std::atomic<uint8_t> current;
+
+	// shared for inserts/lookups, exclusive for rotation
+	mutable std::shared_mutex rotate_mtx;
+
+	// per-replica, so that bit positions are not predictable from digests
+	const uint64_t salt;
+
+	bool generation_contains(Generation const& gen, uint64_t digest) const;
+
+	//! Returns true iff all bits were already set.
+	bool generation_insert(Generation& gen, uint64_t digest);
+
+	void maybe_rotate();
+
+public:
+
+	constexpr static double DEFAULT_FALSE_POSITIVE_RATE = 0.001;
+
+	RotatingTxDigestFilter(
+		uint64_t generation_capacity, 
+		double false_positive_rate = DEFAULT_FALSE_POSITIVE_RATE);
+
+	//! Whether digest was (probably) seen recently.  Does not insert.
+	bool contains(uint64_t digest) const;
+
+	/*! Insert digest.  Returns true if it was (probably) already present.
+	Two concurrent inserts of the same digest may both return false.
+	*/
+	bool test_and_insert(uint64_t digest);
+
+	//! Remove from txs (in place, order preserved) any tx already seen,
+	//! and insert the rest.  Returns the number removed.
+	size_t filter_seen(xdr::xvector<SignedTransaction>& txs);
+
+	uint32_t get_num_hashes() const {
+		return num_hashes;
+	}
+
+	//! Bits per generation.
+	uint64_t get_num_bits() const {
+		return num_words * 64;
+	}
+
+	//! Forget everything.
+	void clear();
+};
+
+} /* speedex */
@@ -0,0 +1,121 @@
+#pragma once
+
+/**
+ * SPEEDEX: A Scalable, Parallelizable, and Economically Efficient Decentralized Exchange
+ * Copyright (C) 2023 Geoffrey Ramseyer
+
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/*! \file tatonnement_objective.h
+
+Objective functions guiding Tatonnement's step size.
+
+Tatonnement evaluates its objective once per round on every
+query thread, so the objective used is a compile-time policy
+(TatonnementObjective).  Each policy provides eval(), which reads
+the supply/demand results of a round, and is_better_than(), which
+the step rule uses to decide whether to accept a trial step.
+*/
+
+#include "price_computation/demand_oracle.h"
+
+#include "speedex/speedex_static_configs.h"
+
+#include "utils/price.h"
+
+#include "xdr/types.h"
+
+#include <cmath>
+#include <cstdint>
+#include <type_traits>
+
+namespace speedex {
+
+//! Computes several norms of the excess supply vector.
+//! Only l2norm_sq guides the step rule; the rest are diagnostics.
+struct MultifuncTatonnementObjective {
+	double l2norm_sq = 0;
+	double l8norm = 0;
+
+	double p_dot_l1 = 0;
+
+	void eval(const uint128_t* supplies, const uint128_t* demands, const Price* prices, const uint16_t* volume_relativizers, size_t num_assets) {
+		double acc_l2 = 0;
+		double acc_l8 = 0;
+		p_dot_l1 = 0;
+		for (size_t i = 0; i < num_assets; i++) {
+			double diff = price::amount_to_double(supplies[i], price::PRICE_RADIX) - price::amount_to_double(demands[i], price::PRICE_RADIX);
+			
+			#ifndef USE_DEMAND_MULT_PRICES
+				diff *= price::to_double(prices[i]);
+			#endif
+
+			//diff *= volume_relativizers[i];
+			
+			double diff_sq = diff * diff;
+			acc_l2 += diff_sq;
+			acc_l8 += diff_sq * diff_sq * diff_sq * diff_sq;
+			p_dot_l1 -= price::to_double(prices[i]) * diff;
+		}
+		l2norm_sq = acc_l2;
+		l8norm = std::pow(acc_l8, 1.0/8.0);
+	}
+
+	bool
+	is_better_than(const MultifuncTatonnementObjective& reference_objective) const {
+		//return (p_dot_l1 <= reference_objective.p_dot_l1 * 1.01);
+		return (l2norm_sq <= reference_objective.l2norm_sq * 1.01);
+	//	return (l8norm <= reference_objective.l8norm * 1.1); 
+	}
+};
+
+/*! Computes only the (squared) l2 norm of the excess supply vector,
+which is all that the step rule reads.
+
+One pass over the assets, with no transcendental calls.
+Each asset's excess is computed exactly as in
+MultifuncTatonnementObjective, so l2norm_sq (and hence every
+step decision) is identical under either policy.
+*/
+struct L2TatonnementObjective {
+	double l2norm_sq = 0;
+
+	void eval(const uint128_t* supplies, const uint128_t* demands, const Price* prices, const uint16_t* volume_relativizers, size_t num_assets) {
+		double acc_l2 = 0;
+		for (size_t i = 0; i < num_assets; i++) {
+			double diff = price::amount_to_double(supplies[i], price::PRICE_RADIX) - price::amount_to_double(demands[i], price::PRICE_RADIX);
+
+			#ifndef USE_DEMAND_MULT_PRICES
+				diff *= price::to_double(prices[i]);
+			#endif
+
+			acc_l2 += diff * diff;
+		}
+		l2norm_sq = acc_l2;
+	}
+
+	bool
+	is_better_than(const L2TatonnementObjective& reference_objective) const {
+		return (l2norm_sq <= reference_objective.l2norm_sq * 1.01);
+	}
+};
+
+//! The objective used by Tatonnement query threads.
+using TatonnementObjective = std::conditional_t<
+	TATONNEMENT_FULL_OBJECTIVE,
+	MultifuncTatonnementObjective,
+	L2TatonnementObjective>;
+
+} /* speedex */
@@ -61,44 +61,6 @@ TatonnementOracle::check_clearing(
 
 
 
-Price get_trial_price(const uint128_t& demand, const uint128_t& supply, const Price& old_price, const uint64_t& step, const uint16_t volume_relativizer, const TatonnementControlParameters& control_params) {
-
-	uint16_t applied_relativizer = volume_relativizer;//control_params.use_volume_relativizer ? volume_relativizer : 1;
-
-	if (demand > supply) {
-		uint128_t diff = demand - supply; // 64 + 24 bits
-
-		uint128_t p_times_step = ((uint128_t)step) * ((uint128_t) old_price);
-
-		#ifdef USE_DEMAND_MULT_PRICES
-		uint128_t p_times_diff = (applied_relativizer) * diff;
-		#else
-		uint128_t p_times_diff = ((uint128_t) old_price * applied_relativizer) * diff;
-		#endif
-
-		Price delta = price::safe_multiply_and_drop_lowbits(p_times_step, p_times_diff, control_params.step_radix + price::PRICE_RADIX);
-
-		return price::impose_price_bounds(old_price + delta);
-	} else {
-		uint128_t diff = supply - demand;
-
-		uint128_t p_times_step = ((uint128_t)step) * ((uint128_t) old_price);
-		
-		#ifdef USE_DEMAND_MULT_PRICES
-		uint128_t p_times_diff = (applied_relativizer) * diff;
-		#else
-		uint128_t p_times_diff = ((uint128_t) old_price * applied_relativizer) * diff;
-		#endif
-		
-		Price delta = price::safe_multiply_and_drop_lowbits(p_times_step, p_times_diff, control_params.step_radix + price::PRICE_RADIX);
-
-		if (delta >= old_price) {
-			return 1;
-		}
-		return old_price - delta;
-	}
-}
-
 //To not overflow, need step_radix < 128-price_bits=80
 bool TatonnementOracle::set_trial_prices(
 	const Price* old_prices,
@@ -109,15 +71,21 @@ bool TatonnementOracle::set_trial_prices(
 	uint128_t* supplies,
 	uint16_t* relativizers) {
 
-	//uint8_t step_radix = control_params.step_radix;
-	bool changed = false;
-	for (size_t i = 0; i < num_assets; i++) {
-		new_prices[i] = get_trial_price(demands[i], supplies[i], old_prices[i], step, relativizers[i], control_params);
-		if (new_prices[i] != old_prices[i]) {
-			changed = true;
-		}	
-	}
-	return changed;
+	#ifdef USE_DEMAND_MULT_PRICES
+	constexpr bool scale_diff_by_price = false;
+	#else
+	constexpr bool scale_diff_by_price = true;
+	#endif
+
+	return price::batch_update_trial_prices<scale_diff_by_price>(
+		old_prices,
+		new_prices,
+		demands,
+		supplies,
+		relativizers,
+		num_assets,
+		step,
+		control_params.step_radix + price::PRICE_RADIX);
 }
 
 
@@ -163,7 +131,7 @@ void TatonnementOracle::run_tatonnement_thread(TatonnementControlParameters* con
 		lock.unlock();
 
 		#ifdef USE_DEMAND_MULT_PRICES
-			auto success = better_grid_search_tatonnement_query(control_params, local_price_workspace.data(), instance);
+			auto success = better_grid_search_tatonnement_query<TatonnementObjective>(control_params, local_price_workspace.data(), instance);
 		#else 
 			auto success = grid_search_tatonnement_query(control_params, local_price_workspace.data(), instance);
 		#endif
@@ -454,6 +422,7 @@ void set_relativizers(
 	}
 }
 
+template<typename Objective>
 bool
 TatonnementOracle::better_grid_search_tatonnement_query(
 	TatonnementControlParameters& control_params,
@@ -500,7 +469,7 @@ TatonnementOracle::better_grid_search_tatonnement_query(
 	demand_oracle.
 		get_supply_demand(prices_workspace, supplies_search, demands_search, work_units, active_approx_params.smooth_mult);//, function_inputs);
 
-	MultifuncTatonnementObjective prev_objective;
+	Objective prev_objective;
 	prev_objective.eval(supplies_search, demands_search, prices_workspace, relativizers, num_assets);
 
 	int round_number = 0;
@@ -581,7 +550,7 @@ TatonnementOracle::better_grid_search_tatonnement_query(
 
 		clearing = check_clearing(demands_workspace, supplies_workspace, active_approx_params.tax_rate, num_assets);
 
-		MultifuncTatonnementObjective new_objective;
+		Objective new_objective;
 		new_objective.eval(supplies_workspace, demands_workspace, prices_workspace, relativizers, num_assets);
 
 		if (round_number % 10000 == 9999) {
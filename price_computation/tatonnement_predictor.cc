@@ -0,0 +1,262 @@
+/**
+ * SPEEDEX: A Scalable, Parallelizable, and Economically Efficient Decentralized Exchange
+ * Copyright (C) 2023 Geoffrey Ramseyer
+
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "price_computation/tatonnement_predictor.h"
+
+#include "speedex/speedex_static_configs.h"
+
+#include "utils/debug_macros.h"
+
+#include <sys/resource.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+#include <tbb/task_arena.h>
+
+#include <thread>
+
+namespace speedex {
+
+TatonnementPricePredictor::TatonnementPricePredictor(
+	uint16_t num_assets, std::chrono::milliseconds max_prediction_time)
+	: utils::AsyncWorker()
+	, num_assets(num_assets)
+	, max_prediction_time(max_prediction_time)
+{
+	start_async_thread([this] {run();});
+}
+
+void
+TatonnementPricePredictor::append_pending_offers(
+	SignedTransaction const& signed_tx, std::vector<Offer>& out)
+{
+	auto const& tx = signed_tx.transaction;
+	for (size_t i = 0; i < tx.operations.size(); i++) {
+		auto const& op = tx.operations[i];
+		if (op.body.type() != CREATE_SELL_OFFER) {
+			continue;
+		}
+		auto const& create_op = op.body.createSellOfferOp();
+
+		Offer offer;
+		offer.category = create_op.category;
+		offer.offerId = tx.metadata.sequenceNumber + i;
+		offer.owner = tx.metadata.sourceAccount;
+		offer.amount = create_op.amount;
+		offer.minPrice = create_op.minPrice;
+
+		// invalid offers are rejected when the block is built,
+		// so they should not move the prediction
+		if (offer.amount <= 0) {
+			continue;
+		}
+		out.push_back(offer);
+	}
+}
+
+void
+TatonnementPricePredictor::start_prediction(
+	OrderbookManager& orderbooks,
+	pending_offers_fn collect_pending_offers,
+	std::vector<Price> const& start_prices,
+	ApproximationParameters approx_params,
+	const uint16_t* volume_relativizers)
+{
+	if constexpr (DISABLE_PRICE_COMPUTATION) {
+		return;
+	}
+
+	if (orderbooks.get_num_assets() != num_assets 
+		|| start_prices.size() != num_assets) {
+		throw std::runtime_error("predictor asset count mismatch");
+	}
+
+	PredictionInput new_input;
+	new_input.orderbooks = &orderbooks;
+	new_input.collect_pending_offers = std::move(collect_pending_offers);
+	new_input.start_prices = start_prices;
+	new_input.approx_params = approx_params;
+	new_input.volume_relativizers.resize(num_assets, 1);
+	if (volume_relativizers != nullptr) {
+		new_input.volume_relativizers.assign(
+			volume_relativizers, volume_relativizers + num_assets);
+	}
+
+	// discard any run still in progress
+	take_prediction();
+
+	std::lock_guard lock(mtx);
+	input = std::move(new_input);
+	cv.notify_all();
+}
+
+void
+TatonnementPricePredictor::request_stop()
+{
+	std::lock_guard lock(mtx);
+	stop_requested = true;
+	cv.notify_all();
+}
+
+std::optional<TatonnementPricePredictor::Prediction>
+TatonnementPricePredictor::take_prediction()
+{
+	request_stop();
+	wait_for_async_task();
+
+	std::lock_guard lock(mtx);
+	stop_requested = false;
+
+	if (prediction_error) {
+		auto err = prediction_error;
+		prediction_error = nullptr;
+		std::rethrow_exception(err);
+	}
+
+	auto out = std::move(prediction);
+	prediction = std::nullopt;
+	return out;
+}
+
+std::vector<std::vector<Offer>>
+TatonnementPricePredictor::collect_offers(PredictionInput& current_input)
+{
+	auto& orderbooks = *current_input.orderbooks;
+
+	std::vector<std::vector<Offer>> offers;
+	orderbooks.snapshot_offers(offers);
+
+	std::vector<Offer> pending_offers;
+	if (current_input.collect_pending_offers) {
+		current_input.collect_pending_offers(pending_offers);
+	}
+
+	for (auto const& offer : pending_offers) {
+		if (!orderbooks.validate_category(offer.category)) {
+			continue;
+		}
+		offers.at(orderbooks.look_up_idx(offer.category)).push_back(offer);
+	}
+	return offers;
+}
+
+void
+TatonnementPricePredictor::run()
+{
+	while (true) {
+		std::unique_lock lock(mtx);
+
+		if ((!done_flag) && (!exists_work_to_do())) {
+			cv.wait(
+				lock, [this] () {return done_flag || exists_work_to_do();});
+		}
+
+		if (done_flag) return;
+
+		PredictionInput current_input = std::move(*input);
+		input = std::nullopt;
+		running = true;
+		lock.unlock();
+
+		std::optional<Prediction> result;
+		std::exception_ptr error;
+		try {
+			auto offers = collect_offers(current_input);
+
+			std::thread background([&] {
+				// Threads inherit the nice value of the thread that creates
+				// them, so the Tatonnement threads run at this priority too.
+				setpriority(PRIO_PROCESS, static_cast<id_t>(syscall(SYS_gettid)), BACKGROUND_NICE);
+
+				tbb::task_arena arena(1, 1);
+				try {
+					arena.execute([&] {
+						result = run_prediction(offers, current_input);
+					});
+				} catch (...) {
+					error = std::current_exception();
+				}
+			});
+			background.join();
+		} catch (...) {
+			error = std::current_exception();
+		}
+
+		lock.lock();
+		prediction = std::move(result);
+		prediction_error = error;
+		running = false;
+		cv.notify_all();
+	}
+}
+
+TatonnementPricePredictor::Prediction
+TatonnementPricePredictor::run_prediction(
+	std::vector<std::vector<Offer>>& offers, PredictionInput& current_input)
+{
+	// The oracle binds to one OrderbookManager, so each prediction
+	// gets fresh structures.
+	OrderbookManager speculative_orderbooks(num_assets);
+	speculative_orderbooks.load_snapshot_contents_to_memory(offers);
+	offers.clear();
+
+	LPSolver solver(speculative_orderbooks);
+	TatonnementOracle oracle(speculative_orderbooks, solver);
+
+	Prediction out;
+	out.prices = std::move(current_input.start_prices);
+	out.converged = true;
+
+	bool query_finished = false;
+
+	// Signalling a timeout before the query starts has no effect,
+	// so keep signalling until the query returns.
+	std::thread stopper([&] {
+		auto deadline = std::chrono::steady_clock::now() + max_prediction_time;
+		std::unique_lock lock(mtx);
+		while (!query_finished) {
+			if (stop_requested || done_flag 
+				|| std::chrono::steady_clock::now() >= deadline) {
+				if (oracle.signal_grid_search_timeout()) {
+					out.converged = false;
+				}
+			}
+			cv.wait_for(lock, std::chrono::milliseconds(1));
+		}
+	});
+
+	out.measurements = oracle.compute_prices_grid_search(
+		out.prices.data(),
+		current_input.approx_params,
+		current_input.volume_relativizers.data());
+
+	{
+		std::lock_guard lock(mtx);
+		query_finished = true;
+		cv.notify_all();
+	}
+	stopper.join();
+
+	oracle.wait_for_all_tatonnement_threads();
+
+	TAT_INFO("speculative tatonnement: %u rounds, converged %u",
+		out.measurements.num_rounds, out.converged);
+	return out;
+}
+
+} /* speedex */
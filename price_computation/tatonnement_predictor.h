@@ -0,0 +1,182 @@
+/**
+ * SPEEDEX: A Scalable, Parallelizable, and Economically Efficient Decentralized Exchange
+ * Copyright (C) 2023 Geoffrey Ramseyer
+
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#pragma once
+
+/*! \file tatonnement_predictor.h
+
+Speculative price computation for the next block.
+
+Most of a block's production time goes to Tatonnement.  While the
+transactions of block N are still being collected, a background
+predictor runs Tatonnement on a copy of the orderbooks (as left by
+block N-1) plus the offers pending in the mempool.  When block N's
+price computation starts, the foreground Tatonnement starts from the
+predicted prices instead of from block N-1's prices.
+
+The prediction only changes Tatonnement's starting point, so it has no
+effect on block validity; a bad prediction costs rounds, not correctness.
+*/
+
+#include "orderbook/orderbook_manager.h"
+
+#include "price_computation/lp_solver.h"
+#include "price_computation/tatonnement_oracle.h"
+
+#include "speedex/approximation_parameters.h"
+
+#include "xdr/block.h"
+#include "xdr/transaction.h"
+#include "xdr/types.h"
+
+#include <utils/async_worker.h>
+
+#include <chrono>
+#include <cstdint>
+#include <exception>
+#include <functional>
+#include <memory>
+#include <optional>
+#include <vector>
+
+namespace speedex {
+
+/*! Runs Tatonnement on a speculative copy of the orderbooks in a
+low-priority background thread.
+
+Usage: after a block is produced, call start_prediction() with the
+orderbooks, a callback that lists the offers pending in the mempool,
+and that block's prices.  When the next block's price computation
+begins, call take_prediction().  This stops the background run if it
+has not finished, and returns the best prices it found.
+
+The predictor thread copies its inputs (the open offers, under the
+orderbook manager's lock, and the pending offers) itself, so the caller
+does no linear work.  This copy runs at normal priority, as the next
+block's clearing waits on the same lock.  Tatonnement then runs in a
+thread at nice value BACKGROUND_NICE (as do the Tatonnement and demand
+query threads it creates, which inherit its priority), confined to a
+single-thread TBB arena, so that it competes as little as possible with
+block assembly.
+*/
+class TatonnementPricePredictor : public utils::AsyncWorker {
+
+	using utils::AsyncWorker::mtx;
+	using utils::AsyncWorker::cv;
+
+	constexpr static int BACKGROUND_NICE = 19;
+
+	const uint16_t num_assets;
+
+	//! Upper bound on one background run.
+	const std::chrono::milliseconds max_prediction_time;
+
+public:
+
+	//! Appends the offers pending in the mempool to its argument.
+	//! Called from the predictor thread.
+	using pending_offers_fn = std::function<void(std::vector<Offer>&)>;
+
+private:
+
+	struct PredictionInput {
+		OrderbookManager* orderbooks;
+		pending_offers_fn collect_pending_offers;
+		std::vector<Price> start_prices;
+		ApproximationParameters approx_params;
+		std::vector<uint16_t> volume_relativizers;
+	};
+
+public:
+
+	struct Prediction {
+		std::vector<Price> prices;
+		//! Rounds and runtime of the background Tatonnement.
+		TatonnementMeasurements measurements;
+		//! False if the background run was stopped (by take_prediction()
+		//! or the time limit) before finding an approximate equilibrium
+		//! on the speculative orderbooks.
+		bool converged;
+	};
+
+private:
+
+	std::optional<PredictionInput> input;
+	bool running = false;
+	bool stop_requested = false;
+
+	std::optional<Prediction> prediction;
+	std::exception_ptr prediction_error;
+
+	bool exists_work_to_do() override final {
+		return input.has_value() || running;
+	}
+
+	void run();
+
+	//! The open and pending offers, by orderbook.
+	std::vector<std::vector<Offer>> collect_offers(PredictionInput& input);
+
+	Prediction run_prediction(
+		std::vector<std::vector<Offer>>& offers, PredictionInput& input);
+
+public:
+
+	TatonnementPricePredictor(
+		uint16_t num_assets, 
+		std::chrono::milliseconds max_prediction_time 
+			= std::chrono::milliseconds(10'000));
+
+	~TatonnementPricePredictor() {
+		request_stop();
+		terminate_worker();
+	}
+
+	/*! Start a background prediction, discarding any previous one.
+
+	In the background, snapshots the open offers of \a orderbooks, adds
+	the offers from \a collect_pending_offers, and runs Tatonnement from
+	\a start_prices.  Pending offers need unique (owner, offerId) pairs,
+	as they would have once committed.  \a orderbooks and anything
+	\a collect_pending_offers uses must outlive the predictor.
+	*/
+	void start_prediction(
+		OrderbookManager& orderbooks,
+		pending_offers_fn collect_pending_offers,
+		std::vector<Price> const& start_prices,
+		ApproximationParameters approx_params,
+		const uint16_t* volume_relativizers = nullptr);
+
+	/*! Stop the background run and take its result.
+
+	Returns nullopt if no prediction was started since the last call.
+	Rethrows any error from the background run.
+	*/
+	std::optional<Prediction> take_prediction();
+
+	//! Append the offers that \a tx would create if committed 
+	//! (offer ids as assigned by SerialTransactionProcessor).
+	static void 
+	append_pending_offers(
+		SignedTransaction const& tx, std::vector<Offer>& out);
+
+private:
+	void request_stop();
+};
+
+} /* speedex */
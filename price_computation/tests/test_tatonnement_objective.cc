@@ -0,0 +1,63 @@
+#include <catch2/catch_test_macros.hpp>
+
+#include "price_computation/tatonnement_objective.h"
+
+#include "utils/price.h"
+
+#include <cstdint>
+#include <random>
+#include <vector>
+
+namespace speedex {
+
+TEST_CASE("l2 objective matches multifunc objective", "[tatonnement]")
+{
+	std::minstd_rand gen(0);
+	std::uniform_int_distribution<uint64_t> dist(0, UINT64_MAX);
+
+	const size_t num_assets = 150;
+
+	std::vector<uint128_t> supplies(num_assets), demands(num_assets);
+	std::vector<Price> prices(num_assets);
+	std::vector<uint16_t> relativizers(num_assets, 1);
+
+	for (int trial = 0; trial < 100; trial++) {
+		for (size_t i = 0; i < num_assets; i++) {
+			supplies[i] = ((uint128_t) dist(gen)) << (trial % 40);
+			demands[i] = ((uint128_t) dist(gen)) << (trial % 40);
+			prices[i] = price::impose_price_bounds(dist(gen) >> 16);
+		}
+
+		MultifuncTatonnementObjective full;
+		full.eval(supplies.data(), demands.data(), prices.data(), relativizers.data(), num_assets);
+
+		L2TatonnementObjective l2;
+		l2.eval(supplies.data(), demands.data(), prices.data(), relativizers.data(), num_assets);
+
+		// same arithmetic, so step decisions cannot differ
+		REQUIRE(full.l2norm_sq == l2.l2norm_sq);
+	}
+}
+
+TEST_CASE("l2 objective step decisions", "[tatonnement]")
+{
+	std::vector<uint128_t> supplies = {((uint128_t)1) << 40};
+	std::vector<uint128_t> demands = {(((uint128_t)1) << 40) + (((uint128_t)1) << 30)};
+	std::vector<Price> prices = {price::PRICE_ONE};
+	std::vector<uint16_t> relativizers = {1};
+
+	L2TatonnementObjective l2;
+	l2.eval(supplies.data(), demands.data(), prices.data(), relativizers.data(), 1);
+
+	// excess is 2^30 / 2^24 = 64
+	REQUIRE(l2.l2norm_sq == 64.0 * 64.0);
+
+	L2TatonnementObjective zero;
+	zero.eval(supplies.data(), supplies.data(), prices.data(), relativizers.data(), 1);
+	REQUIRE(zero.l2norm_sq == 0);
+
+	REQUIRE(zero.is_better_than(l2));
+	REQUIRE(!l2.is_better_than(zero));
+}
+
+} /* speedex */
@@ -0,0 +1,165 @@
+#include <catch2/catch_test_macros.hpp>
+
+#include "orderbook/orderbook_manager.h"
+#include "orderbook/utils.h"
+
+#include "price_computation/tatonnement_predictor.h"
+
+#include <chrono>
+#include <stdexcept>
+#include <vector>
+
+namespace speedex
+{
+
+constexpr static uint16_t PREDICTOR_TEST_NUM_ASSETS = 2;
+
+static ApproximationParameters
+predictor_test_approx_params()
+{
+	return ApproximationParameters{
+		.tax_rate = 10,
+		.smooth_mult = 10
+	};
+}
+
+//! Offers in both directions between the two assets,
+//! with one offer id per (owner, offerId) pair.
+static void
+append_predictor_test_offers(std::vector<Offer>& out)
+{
+	for (int idx = 0; idx < 2; idx++)
+	{
+		for (uint64_t j = 0; j < 100; j++)
+		{
+			Offer offer;
+			offer.category = category_from_idx(idx, PREDICTOR_TEST_NUM_ASSETS);
+			offer.offerId = j;
+			offer.owner = idx;
+			offer.amount = 100 + 10 * j * (idx + 1);
+			offer.minPrice = price::from_double(0.5 + 0.01 * j);
+			out.push_back(offer);
+		}
+	}
+}
+
+static std::vector<Price>
+predictor_test_start_prices()
+{
+	return std::vector<Price>(PREDICTOR_TEST_NUM_ASSETS, price::from_double(1.0));
+}
+
+TEST_CASE("predictor take without start", "[tatonnement][predictor]")
+{
+	TatonnementPricePredictor predictor(PREDICTOR_TEST_NUM_ASSETS);
+
+	REQUIRE(!predictor.take_prediction().has_value());
+}
+
+TEST_CASE("predictor take stops the run", "[tatonnement][predictor]")
+{
+	const auto max_prediction_time = std::chrono::milliseconds(60'000);
+
+	TatonnementPricePredictor predictor(PREDICTOR_TEST_NUM_ASSETS, max_prediction_time);
+	OrderbookManager orderbooks(PREDICTOR_TEST_NUM_ASSETS);
+
+	std::vector<Offer> offers;
+	append_predictor_test_offers(offers);
+	std::vector<std::vector<Offer>> open_offers(orderbooks.get_num_orderbooks());
+	for (auto const& offer : offers)
+	{
+		open_offers.at(orderbooks.look_up_idx(offer.category)).push_back(offer);
+	}
+	orderbooks.load_snapshot_contents_to_memory(open_offers);
+
+	bool collected = false;
+	predictor.start_prediction(
+		orderbooks,
+		[&collected] (std::vector<Offer>& pending) {
+			// other owners than the open offers, so (owner, offerId) pairs stay unique
+			size_t start = pending.size();
+			append_predictor_test_offers(pending);
+			for (size_t i = start; i < pending.size(); i++)
+			{
+				pending[i].owner += 2;
+			}
+			collected = true;
+		},
+		predictor_test_start_prices(),
+		predictor_test_approx_params());
+
+	auto start = std::chrono::steady_clock::now();
+	auto prediction = predictor.take_prediction();
+
+	REQUIRE(std::chrono::steady_clock::now() - start < max_prediction_time / 2);
+	REQUIRE(collected);
+	REQUIRE(prediction.has_value());
+	REQUIRE(prediction->prices.size() == PREDICTOR_TEST_NUM_ASSETS);
+
+	// a prediction is taken only once
+	REQUIRE(!predictor.take_prediction().has_value());
+}
+
+TEST_CASE("predictor time limit", "[tatonnement][predictor]")
+{
+	TatonnementPricePredictor predictor(
+		PREDICTOR_TEST_NUM_ASSETS, std::chrono::milliseconds(0));
+	OrderbookManager orderbooks(PREDICTOR_TEST_NUM_ASSETS);
+
+	predictor.start_prediction(
+		orderbooks,
+		append_predictor_test_offers,
+		predictor_test_start_prices(),
+		predictor_test_approx_params());
+
+	auto prediction = predictor.take_prediction();
+	REQUIRE(prediction.has_value());
+	REQUIRE(!prediction->converged);
+	REQUIRE(prediction->prices.size() == PREDICTOR_TEST_NUM_ASSETS);
+}
+
+TEST_CASE("predictor errors", "[tatonnement][predictor]")
+{
+	TatonnementPricePredictor predictor(PREDICTOR_TEST_NUM_ASSETS);
+
+	SECTION("asset count mismatch")
+	{
+		OrderbookManager orderbooks(PREDICTOR_TEST_NUM_ASSETS + 1);
+
+		REQUIRE_THROWS_AS(
+			predictor.start_prediction(
+				orderbooks,
+				nullptr,
+				predictor_test_start_prices(),
+				predictor_test_approx_params()),
+			std::runtime_error);
+	}
+
+	SECTION("background error is rethrown once")
+	{
+		OrderbookManager orderbooks(PREDICTOR_TEST_NUM_ASSETS);
+
+		predictor.start_prediction(
+			orderbooks,
+			[] (std::vector<Offer>&) {
+				throw std::runtime_error("mempool read failed");
+			},
+			predictor_test_start_prices(),
+			predictor_test_approx_params());
+
+		REQUIRE_THROWS_AS(predictor.take_prediction(), std::runtime_error);
+		REQUIRE(!predictor.take_prediction().has_value());
+
+		// the predictor still works after an error
+		predictor.start_prediction(
+			orderbooks,
+			append_predictor_test_offers,
+			predictor_test_start_prices(),
+			predictor_test_approx_params());
+		auto prediction = predictor.take_prediction();
+		REQUIRE(prediction.has_value());
+		REQUIRE(prediction->prices.size() == PREDICTOR_TEST_NUM_ASSETS);
+	}
+}
+
+}
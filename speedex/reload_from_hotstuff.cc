@@ -26,7 +26,9 @@
 
 #include "speedex/speedex_management_structures.h"
 #include "speedex/speedex_operation.h"
+#include "speedex/replay_block_prefetcher.h"
 #include "speedex/speedex_persistence.h"
+#include "speedex/state_snapshot.h"
 #include "speedex/vm/speedex_vm.h"
 
 #include "utils/debug_macros.h"
@@ -34,6 +36,16 @@
 
 #include "xdr/block.h"
 
+#include <utils/time.h>
+
+#include <algorithm>
+#include <cinttypes>
+#include <string>
+#include <tuple>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
 namespace speedex {
 
 using xdr::operator==;
@@ -124,7 +136,8 @@ try_replay_saved_block(
 		measurements,
 		prev_block,
 		replay_data.hashedBlock,
-		replay_data.txList);
+		replay_data.txList,
+		false); // replayed blocks were published when first applied
 
 	if (validation_res) {
 
@@ -142,6 +155,109 @@ try_replay_saved_block(
 	return {corrected_next_block, false};
 }
 
+namespace {
+
+using hs_hash_t = std::remove_cvref_t<
+	decltype(std::get<0>(
+		std::declval<hotstuff::LogAccessWrapper const&>().begin().get_hs_hash_and_vm_data()))>;
+
+//! Walking the decided block index only touches hotstuff's lmdb,
+//! so gather the hashes of all speedex (nonempty) blocks up front.
+//! Entry i is the hotstuff hash of speedex block i + 1.
+std::vector<hs_hash_t>
+get_nonempty_block_hashes(hotstuff::LogAccessWrapper const& decided_block_cache)
+{
+	std::vector<hs_hash_t> out;
+
+	for (auto iter = decided_block_cache.begin(); iter != decided_block_cache.end(); ++iter) {
+		auto [hs_hash, block_id] = iter.get_hs_hash_and_vm_data();
+		if (block_id) {
+			out.push_back(hs_hash);
+		}
+	}
+	return out;
+}
+
+/*! Replay decided blocks from first_block through the end of the log,
+on top of top_block.  Blocks up to trusted_end are replayed as trusted
+(their effects are already partially persisted), the rest are validated.
+*/
+void
+replay_decided_blocks(
+	SpeedexManagementStructures& management_structures,
+	BlockValidator& validator,
+	hotstuff::LogAccessWrapper const& decided_block_cache,
+	std::vector<hs_hash_t> const& nonempty_block_hashes,
+	uint64_t first_block,
+	uint64_t trusted_end,
+	HashedBlock& top_block)
+{
+	auto replay_start_ts = utils::init_time_measurement();
+
+	ReplayBlockPrefetcher<hs_hash_t> prefetcher(
+		[&decided_block_cache] (hs_hash_t const& hs_hash) {
+			return std::move(*decided_block_cache.load_vm_block<SpeedexVMBlock>(hs_hash).data);
+		});
+
+	uint64_t num_blocks = nonempty_block_hashes.size();
+
+	if (first_block <= num_blocks) {
+		prefetcher.prefetch(nonempty_block_hashes[first_block - 1]);
+	}
+
+	trusted_end = std::min(trusted_end, num_blocks);
+
+	for (uint64_t cur_block = first_block; cur_block <= num_blocks; cur_block++) {
+
+		// TODO check whether block_id matches loaded block header? unnecessary unless disk tampered with or something unrecoverable happened
+		// begs the question of whether hotstuff even needs to store block ids in lmdb (still needs them in speculative execution gadget).
+
+		HashedBlockTransactionListPair speedex_data = prefetcher.get();
+
+		// deserialize the next block while this one is applied
+		if (cur_block < num_blocks) {
+			prefetcher.prefetch(nonempty_block_hashes[cur_block]);
+		}
+
+		if (cur_block <= trusted_end) {
+
+			auto correct_header = management_structures.block_header_hash_map.get(cur_block);
+			if (!correct_header) {
+				throw std::runtime_error("failed to load expected hash from header hash map");
+			}
+
+			if (correct_header->validation_success) {
+				speedex_replay_trusted_round_success(management_structures, speedex_data);
+
+				top_block = speedex_data.hashedBlock;	
+			} else {
+				speedex_replay_trusted_round_failed(management_structures, top_block, speedex_data.hashedBlock);
+
+				auto new_block = ensure_sequential_block_numbers(top_block, speedex_data.hashedBlock);
+				top_block.block = new_block;
+				top_block.hash = hash_xdr(new_block);
+			}
+		} else {
+			//replay remaining blocks, untrusted
+			auto [corrected_next_block, _] = try_replay_saved_block(management_structures, validator, top_block, speedex_data);
+			top_block.block = corrected_next_block;
+			top_block.hash = hash_xdr(corrected_next_block);
+		}
+	}
+
+	float replay_time = utils::measure_time(replay_start_ts);
+
+	uint64_t num_replayed = (num_blocks >= first_block) ? num_blocks - first_block + 1 : 0;
+
+	BLOCK_INFO("replayed %" PRIu64 " blocks (history depth %" PRIu64 ") in %f s (%f s/block)",
+		num_replayed,
+		num_blocks,
+		replay_time,
+		num_replayed > 0 ? replay_time / num_replayed : 0.0);
+}
+
+} /* anonymous namespace */
+
 HashedBlock
 speedex_load_persisted_data(
 	SpeedexManagementStructures& management_structures,
@@ -150,6 +266,8 @@ speedex_load_persisted_data(
 
 	auto [min_db_round, max_db_round] = management_structures.db.get_min_max_persisted_round_numbers();
 
+	// Replay over lmdbs persisted at different rounds is untested.
+	// Restart from a state snapshot (state_snapshot_block) instead.
 	throw std::runtime_error("sync db to a consistent snapshot: unimp");
 
 	management_structures.db.load_lmdb_contents_to_memory();
@@ -189,70 +307,82 @@ speedex_load_persisted_data(
 
 	//auto cursor = decided_block_cache.forward_cursor();
 
-	uint64_t cur_block = start_round;
+	auto nonempty_block_hashes = get_nonempty_block_hashes(decided_block_cache);
 
 	HashedBlock top_block;
 
-	auto iter = decided_block_cache.begin();
-
-	uint64_t nonempty_block_index = 0; // speedex vm height
+	// speedex vm heights start at 1
+	replay_decided_blocks(
+		management_structures,
+		validator,
+		decided_block_cache,
+		nonempty_block_hashes,
+		std::max<uint64_t>(start_round, 1),
+		end_round,
+		top_block);
 
-	for (; iter != decided_block_cache.end(); ++iter) {
-		auto [hs_hash, block_id] = iter.get_hs_hash_and_vm_data();
+	persist_after_loading(management_structures, top_block.block.blockNumber);
 
-		if (block_id) {
-			nonempty_block_index ++;
+	return top_block;
+}
 
-			if (nonempty_block_index != cur_block) {
-				continue;
-			}
+HashedBlock
+speedex_load_state_snapshot(
+	SpeedexManagementStructures& management_structures,
+	hotstuff::LogAccessWrapper const& decided_block_cache,
+	uint64_t snapshot_block) {
 
-			// TODO check whether block_id matches loaded block header? unnecessary unless disk tampered with or something unrecoverable happened
-			// begs the question of whether hotstuff even needs to store block ids in lmdb (still needs them in speculative execution gadget).
+	if (!check_if_state_snapshot_exists(snapshot_block)) {
+		throw std::runtime_error("no complete state snapshot for block " + std::to_string(snapshot_block));
+	}
 
-			auto correct_header = management_structures.block_header_hash_map.get(nonempty_block_index);
-			if (!correct_header) {
-				throw std::runtime_error("failed to load expected hash from header hash map");
-			}
+	HashedBlock top_block = load_state_snapshot(management_structures, snapshot_block);
 
-			HashedBlockTransactionListPair speedex_data = decided_block_cache.template load_vm_block<SpeedexVMBlock>(hs_hash).data;
+	auto nonempty_block_hashes = get_nonempty_block_hashes(decided_block_cache);
 
-			if (correct_header->validation_success) {
-				speedex_replay_trusted_round_success(management_structures, speedex_data);
+	// The snapshot's header was not checked against the decided chain
+	// when the snapshot was taken.  A block that failed validation is
+	// committed under a corrected header, so its snapshot is rejected here.
+	if (nonempty_block_hashes.size() < snapshot_block) {
+		throw std::runtime_error("state snapshot block was not decided");
+	}
+	auto decided_block = decided_block_cache.load_vm_block<SpeedexVMBlock>(
+		nonempty_block_hashes[snapshot_block - 1]).data;
+	if (decided_block->hashedBlock.hash != top_block.hash) {
+		throw std::runtime_error("state snapshot header does not match the decided block");
+	}
 
-				top_block = speedex_data.hashedBlock;	
-			} else {
-				speedex_replay_trusted_round_failed(management_structures, top_block, speedex_data.hashedBlock);
+	return top_block;
+}
 
-				auto new_block = ensure_sequential_block_numbers(top_block, speedex_data.hashedBlock);
-				top_block.block = new_block;
-				top_block.hash = hash_xdr(new_block);
-			}
-			cur_block++;
+void
+speedex_replay_after_state_snapshot(
+	SpeedexManagementStructures& management_structures,
+	BlockValidator& validator,
+	hotstuff::LogAccessWrapper const& decided_block_cache,
+	HashedBlock& top_block) {
 
-			if (cur_block > end_round) {
-				break;
-			}
-		}
-	}
+	uint64_t snapshot_block = top_block.block.blockNumber;
 
-	//replay remaining blocks, untrusted
+	auto nonempty_block_hashes = get_nonempty_block_hashes(decided_block_cache);
 
-	for (;iter != decided_block_cache.end(); ++iter) {
-		auto [hs_hash, block_id] = iter.get_hs_hash_and_vm_data();
+	// the lmdbs are empty, so write out the whole loaded state
+	management_structures.db.persist_lmdb(snapshot_block);
+	management_structures.orderbook_manager.persist_lmdb_after_snapshot(snapshot_block);
+	management_structures.block_header_hash_map.persist_lmdb(snapshot_block);
 
-		if (block_id) {
-			auto speedex_data = decided_block_cache.template load_vm_block<SpeedexVMBlock>(hs_hash).data;
+	BLOCK_INFO("loaded state snapshot of block %" PRIu64 ", replaying later blocks", snapshot_block);
 
-			auto [corrected_next_block, _] = try_replay_saved_block(management_structures, validator, top_block, speedex_data);
-			top_block.block = corrected_next_block;
-			top_block.hash = hash_xdr(corrected_next_block);
-		}
-	}
+	replay_decided_blocks(
+		management_structures,
+		validator,
+		decided_block_cache,
+		nonempty_block_hashes,
+		snapshot_block + 1,
+		snapshot_block, // nothing past the snapshot is persisted
+		top_block);
 
 	persist_after_loading(management_structures, top_block.block.blockNumber);
-
-	return top_block;
 }
 
 
@@ -18,6 +18,8 @@
 
 #pragma once
 
+#include <cstdint>
+
 namespace hotstuff {
 	class LogAccessWrapper;
 }
@@ -36,4 +38,25 @@ speedex_load_persisted_data(
 	BlockValidator& validator,
 	hotstuff::LogAccessWrapper const& decided_block_cache);
 
+//! Loads the state snapshot of snapshot_block into memory and checks it,
+//! without touching the lmdbs.  Throws if the snapshot is missing or
+//! corrupt, or if snapshot_block is not on the decided chain.
+//! Returns the header of snapshot_block.
+HashedBlock
+speedex_load_state_snapshot(
+	SpeedexManagementStructures& management_structures,
+	hotstuff::LogAccessWrapper const& decided_block_cache,
+	uint64_t snapshot_block);
+
+//! After speedex_load_state_snapshot(), writes the loaded state to the
+//! lmdbs (which should be newly created and empty) and replays the
+//! decided blocks after the snapshot.  Updates top_block to the last
+//! replayed block.
+void
+speedex_replay_after_state_snapshot(
+	SpeedexManagementStructures& management_structures,
+	BlockValidator& validator,
+	hotstuff::LogAccessWrapper const& decided_block_cache,
+	HashedBlock& top_block);
+
 } /* speedex */
@@ -0,0 +1,146 @@
+/**
+ * SPEEDEX: A Scalable, Parallelizable, and Economically Efficient Decentralized Exchange
+ * Copyright (C) 2023 Geoffrey Ramseyer
+
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#pragma once
+
+/*! \file replay_block_prefetcher.h
+
+When replaying decided blocks on startup, block N+1 is
+read out of the hotstuff log and deserialized in the background
+while block N is being applied to the in-memory state.
+*/
+
+#include "xdr/block.h"
+
+#include <utils/async_worker.h>
+
+#include <exception>
+#include <functional>
+#include <optional>
+#include <stdexcept>
+
+namespace speedex {
+
+/*! Loads one decided block at a time in a background thread.
+
+Usage: call prefetch() with the hotstuff hash of the next
+block to replay, apply the current block, then call get()
+to take the prefetched block.  get() blocks until the load finishes.
+
+Errors thrown while loading are rethrown from get().
+*/
+template<typename hs_hash_t>
+class ReplayBlockPrefetcher : public utils::AsyncWorker {
+
+public:
+	//! Reads one block (e.g. out of the hotstuff decided block log).
+	using load_fn = std::function<HashedBlockTransactionListPair(hs_hash_t const&)>;
+
+private:
+
+	using utils::AsyncWorker::mtx;
+	using utils::AsyncWorker::cv;
+
+	const load_fn load;
+
+	std::optional<hs_hash_t> to_load;
+	std::optional<HashedBlockTransactionListPair> loaded;
+	std::exception_ptr load_error;
+
+	bool exists_work_to_do() override final {
+		return to_load.has_value();
+	}
+
+	void run() {
+		while(true) {
+			std::unique_lock lock(mtx);
+
+			if ((!done_flag) && (!exists_work_to_do())) {
+				cv.wait(
+					lock, [this] () {return done_flag || exists_work_to_do();});
+			}
+
+			if (done_flag) return;
+
+			// to_load stays set until the load finishes,
+			// so that prefetch() and get() wait for it
+			hs_hash_t hs_hash = *to_load;
+			lock.unlock();
+
+			std::optional<HashedBlockTransactionListPair> block;
+			std::exception_ptr error;
+			try {
+				block = load(hs_hash);
+			} catch (...) {
+				error = std::current_exception();
+			}
+
+			lock.lock();
+			loaded = std::move(block);
+			load_error = error;
+			to_load = std::nullopt;
+			cv.notify_all();
+		}
+	}
+
+public:
+
+	ReplayBlockPrefetcher(load_fn load)
+		: utils::AsyncWorker()
+		, load(load)
+		, to_load(std::nullopt)
+		, loaded(std::nullopt)
+		, load_error(nullptr)
+		{
+			start_async_thread([this] {run();});
+		}
+
+	~ReplayBlockPrefetcher() {
+		terminate_worker();
+	}
+
+	//! Start loading a block.  Any previously prefetched but
+	//! unclaimed block is discarded.
+	void prefetch(hs_hash_t const& hs_hash) {
+		wait_for_async_task();
+		std::lock_guard lock(mtx);
+		loaded = std::nullopt;
+		load_error = nullptr;
+		to_load = hs_hash;
+		cv.notify_all();
+	}
+
+	//! Wait for the prefetched block and take ownership of it.
+	HashedBlockTransactionListPair get() {
+		wait_for_async_task();
+		std::lock_guard lock(mtx);
+		if (load_error) {
+			auto err = load_error;
+			load_error = nullptr;
+			std::rethrow_exception(err);
+		}
+		if (!loaded) {
+			throw std::runtime_error("no block was prefetched");
+		}
+		HashedBlockTransactionListPair out = std::move(*loaded);
+		loaded = std::nullopt;
+		return out;
+	}
+};
+
+} /* speedex */
@@ -26,9 +26,12 @@ wrapper class.
 
 #include "header_hash/block_header_hash_map.h"
 
+#include "market_data/market_data_stream.h"
+
 #include "memory_database/memory_database.h"
 
 #include "modlog/account_modification_log.h"
+#include "modlog/tx_block_log.h"
 
 #include "orderbook/orderbook_manager.h"
 
@@ -38,6 +41,9 @@ wrapper class.
 
 #include "speedex/approximation_parameters.h"
 #include "speedex/speedex_runtime_configs.h"
+#include "speedex/speedex_static_configs.h"
+
+#include <memory>
 
 namespace speedex {
 
@@ -49,6 +55,12 @@ struct SpeedexManagementStructures {
 	BlockHeaderHashMap block_header_hash_map;
 	ApproximationParameters approx_params;
 
+	//! Null unless LOG_TX_BLOCKS is set.
+	std::unique_ptr<TxBlockLog> tx_block_log;
+
+	//! Null unless PUBLISH_MARKET_DATA is set.
+	std::unique_ptr<MarketDataPublisher> market_data_publisher;
+
 	const SpeedexRuntimeConfigs configs;
 
 	//! Open all of the lmdb environment instances in Speedex.
@@ -68,11 +80,20 @@ struct SpeedexManagementStructures {
 		uint16_t num_assets, 
 		ApproximationParameters approx_params,
 		SpeedexRuntimeConfigs configs)
-		: db()
-		, orderbook_manager(num_assets)
+		: db(configs.num_account_db_shards, configs.batch_lmdb_persistence)
+		, orderbook_manager(num_assets, configs.batch_lmdb_persistence)
 		, account_modification_log()
 		, block_header_hash_map()
 		, approx_params(approx_params)
+		, tx_block_log(LOG_TX_BLOCKS
+			? std::make_unique<TxBlockLog>(TX_BLOCK_LOG_FSYNC_GROUP)
+			: nullptr)
+		, market_data_publisher(PUBLISH_MARKET_DATA
+			? std::make_unique<MarketDataPublisher>(
+				num_assets, 
+				MARKET_DATA_RING_SLOTS, 
+				MarketDataPublisher::replica_shm_name(configs.replica_id))
+			: nullptr)
 		, configs(configs) {}
 };
 
@@ -27,6 +27,7 @@ SpeedexMeasurements::SpeedexMeasurements(const ExperimentParameters& params)
 	, measurements()
 	, mtx()
 	, uncled_measurements()
+	, restart_time(0)
 	{
 	}
 
@@ -89,6 +90,13 @@ SpeedexMeasurements::insert_async_persistence_measurement(
 	db_measurements.wait_for_persist_time = data_persistence_measurements.wait_for_persist_time;
 }
 
+void
+SpeedexMeasurements::set_restart_time(float time)
+{
+	std::lock_guard lock(mtx);
+	restart_time = time;
+}
+
 ExperimentResultsUnion
 SpeedexMeasurements::get_measurements() const
 {
@@ -99,6 +107,7 @@ SpeedexMeasurements::get_measurements() const
 		out.block_results.push_back(val);
 	}
 	out.params = params;
+	out.restart_time = restart_time;
 
 	return out;
 }
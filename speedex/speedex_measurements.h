@@ -36,6 +36,8 @@ class SpeedexMeasurements {
 
 	std::vector<TaggedSingleBlockResults> uncled_measurements;
 
+	float restart_time;
+
 
 public:
 
@@ -45,6 +47,9 @@ public:
 
 	void insert_async_persistence_measurement(BlockDataPersistenceMeasurements const& data_persistence_measurements, uint64_t block_number);
 
+	//! Time to reload state from disk and replay decided blocks.
+	void set_restart_time(float time);
+
 	ExperimentResultsUnion get_measurements() const;
 };
 
@@ -324,6 +324,11 @@ speedex_block_creation_logic(
 
 	management_structures.block_header_hash_map.insert(new_block.block, true);//new_block.block.blockNumber, new_block.hash);
 
+	if (management_structures.market_data_publisher) {
+		management_structures.market_data_publisher->publish(
+			new_block, state_update_stats, MarketDataSource::PRODUCED);
+	}
+
 	return new_block;
 }
 
@@ -626,7 +631,8 @@ speedex_block_validation_logic(
 	OverallBlockValidationMeasurements& overall_validation_stats,
 	const HashedBlock& prev_block,
 	const HashedBlock& expected_next_block,
-	const SignedTransactionList& transactions) {
+	const SignedTransactionList& transactions,
+	bool publish_market_data) {
 
 	bool res = _speedex_block_validation_logic(
 		management_structures,
@@ -640,6 +646,13 @@ speedex_block_validation_logic(
 
 	management_structures.block_header_hash_map.insert(corrected_block, res);
 
+	if (res && publish_market_data && management_structures.market_data_publisher) {
+		management_structures.market_data_publisher->publish(
+			expected_next_block, 
+			overall_validation_stats.state_update_stats, 
+			MarketDataSource::VALIDATED);
+	}
+
 	return {corrected_block, res};
 } 
 
@@ -53,6 +53,9 @@ Runs block validation logic.
 Call sodium_init() before usage.
 
 Does set overall_validation_stats.state_update_stats
+
+Publishes the block's market data (if enabled) unless publish_market_data
+is false (e.g. when replaying blocks that were already published).
 */
 std::pair<Block, bool>
 speedex_block_validation_logic( 
@@ -61,7 +64,8 @@ speedex_block_validation_logic(
 	OverallBlockValidationMeasurements& overall_validation_stats,
 	const HashedBlock& prev_block,
 	const HashedBlock& expected_next_block,
-	const SignedTransactionList& transactions);
+	const SignedTransactionList& transactions,
+	bool publish_market_data = true);
 
 
 Block 
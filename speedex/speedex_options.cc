@@ -55,6 +55,12 @@ void SpeedexOptions::parse_options(const char* filename) {
 	if (count != 7) {
 		throw std::runtime_error("failed to parse options yaml");
 	}
+
+	// optional
+	fy_document_scanf(
+		fyd.get(),
+		"/speedex-node/mempool_account_shards %u",
+		&mempool_account_shards);
 }
 
 
@@ -66,6 +72,7 @@ void SpeedexOptions::print_options() {
 	std::printf("block size  %" PRIu32 "\n", block_size);
 	std::printf("mp target   %u\n", mempool_target);
 	std::printf("mp chunk sz %u\n", mempool_chunk);
+	std::printf("mp shards   %" PRIu32 "\n", mempool_account_shards);
 }
 
 } /* speedex */
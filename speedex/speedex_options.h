@@ -37,6 +37,8 @@ struct SpeedexOptions {
 	size_t persistence_frequency;
 	size_t mempool_target;
 	size_t mempool_chunk;
+	//! Optional; 0 (the default) forms mempool chunks in arrival order.
+	uint32_t mempool_account_shards = 0;
 
 	void parse_options(const char* configfile);
 
@@ -119,13 +119,36 @@ AsyncPersister::run() {
 		phase2_persist.do_async_persist_phase2(
 			std::move(persistence_callback));
 
+		auto hook = std::move(after_persist);
+		after_persist = nullptr;
+
+		if (hook) {
+			after_persist_running = true;
+			// do_async_persist() can queue the next block while the
+			// hook runs.  That block starts persisting only afterwards.
+			lock.unlock();
+
+			phase2_persist.wait_for_async_task();
+			phase2_persist.phase3_persist.wait_for_async_task();
+			// a failed callback should not stop persistence
+			try {
+				hook();
+			} catch (std::exception const& e) {
+				BLOCK_INFO("after persist callback failed: %s", e.what());
+			}
+
+			lock.lock();
+			after_persist_running = false;
+		}
+
 		cv.notify_all();
 	}
 }
 
 void 
 AsyncPersister::do_async_persist(
-	std::unique_ptr<PersistenceMeasurementLogCallback> callback)
+	std::unique_ptr<PersistenceMeasurementLogCallback> callback,
+	std::function<void()> after_persist_)
 {
 	auto timestamp = utils::init_time_measurement();
 
@@ -139,6 +162,7 @@ AsyncPersister::do_async_persist(
 				"can't start persist before last one finishes!");
 		}
 		persistence_callback = std::move(callback);
+		after_persist = std::move(after_persist_);
 	}
 	cv.notify_all();
 }
@@ -32,6 +32,7 @@ Phase 3: Everything else (orderbooks, header hash)
 */
 
 #include <cstdint>
+#include <functional>
 
 #include "speedex/speedex_measurements.h"
 
@@ -162,6 +163,9 @@ struct AsyncPersister : public utils::AsyncWorker {
 	std::unique_ptr<PersistenceMeasurementLogCallback> persistence_callback;
 	//std::optional<uint64_t> block_number_to_persist;
 
+	std::function<void()> after_persist;
+	bool after_persist_running;
+
 	//BlockDataPersistenceMeasurements* latest_measurements;
 
 	SpeedexManagementStructures& management_structures;
@@ -181,6 +185,8 @@ public:
 	AsyncPersister(SpeedexManagementStructures& management_structures)
 		: utils::AsyncWorker()
 		, persistence_callback(nullptr)
+		, after_persist(nullptr)
+		, after_persist_running(false)
 		, management_structures(management_structures)
 		, phase2_persist(management_structures) {
 			start_async_thread([this] {run();});
@@ -195,8 +201,13 @@ public:
 	//! Begin persisting a block to disk 
 	//! (all blocks up to persist_block_number).
 	//! When phase 1 finishes, phase 2 is automatically called.
+	//! If set, after_persist runs (in the phase 1 thread) once every
+	//! phase has finished, before the next block starts persisting,
+	//! so it sees every lmdb at this block.  It runs without the
+	//! persister's lock, so the next call here need not wait for it.
 	void do_async_persist(
-		std::unique_ptr<PersistenceMeasurementLogCallback> callback);
+		std::unique_ptr<PersistenceMeasurementLogCallback> callback,
+		std::function<void()> after_persist = nullptr);
 
 	//! Wait for all async persistence phases to complete.
 	//! Clears up all uses of measurements object reference.
@@ -205,6 +216,10 @@ public:
 	void wait_for_async_persist() {
 		//clears up all uses of measurements reference
 		wait_for_async_task();
+		{
+			std::unique_lock lock(mtx);
+			cv.wait(lock, [this] {return !after_persist_running;});
+		}
 		phase2_persist.wait_for_async_task();
 		phase2_persist.phase3_persist.wait_for_async_task();
 	}
@@ -18,12 +18,35 @@
 
 #pragma once
 
+#include "speedex/speedex_static_configs.h"
+
+#include <cstdint>
+
 namespace speedex
 {
 
 struct SpeedexRuntimeConfigs
 {
 	bool check_sigs;
+	//! Shard count for a newly created account database
+	//! (an existing database keeps the count it was created with).
+	uint32_t num_account_db_shards = NUM_ACCOUNT_DB_SHARDS;
+	//! Run the deferred retry wave during block production
+	//! (see block_processing/block_producer.h).
+	bool deferred_retry_wave = DEFERRED_RETRY_WAVE;
+	//! Predict each block's prices in the background while its
+	//! transactions are collected (see price_computation/tatonnement_predictor.h).
+	bool speculative_price_prediction = SPECULATIVE_PRICE_PREDICTION;
+	//! Write account and offer lmdb updates in key order, coalesced
+	//! across the blocks persisted together.  The resulting databases
+	//! are the same either way.
+	bool batch_lmdb_persistence = BATCH_LMDB_PERSISTENCE;
+	//! Keeps per-host resources (e.g. the market data segment)
+	//! of replicas on the same host apart.
+	uint32_t replica_id = 0;
+	//! When loading from disk, start from the state snapshot
+	//! of this block instead of the lmdbs (0 = don't).
+	uint64_t state_snapshot_block = 0;
 };
 
 } /* speedex */
@@ -36,6 +36,19 @@ log_static_configs()
 	std::printf("MAX_SEQ_NUMS_PER_BLOCK         = %lu\n", MAX_SEQ_NUMS_PER_BLOCK);
 	std::printf("LOG_TRANSFERS                  = %u\n", LOG_TRANSFERS);
 	std::printf("NUM_ACCOUNT_DB_SHARDS          = %u\n", NUM_ACCOUNT_DB_SHARDS);
+	std::printf("BATCH_LMDB_PERSISTENCE         = %u\n", BATCH_LMDB_PERSISTENCE);
+	std::printf("COMPACT_BLOCK_ENCODING         = %u\n", COMPACT_BLOCK_ENCODING);
+	std::printf("LOG_TX_BLOCKS                  = %u\n", LOG_TX_BLOCKS);
+	std::printf("TX_BLOCK_LOG_FSYNC_GROUP       = %u\n", TX_BLOCK_LOG_FSYNC_GROUP);
+	std::printf("STATE_SNAPSHOT_FREQUENCY       = %lu\n", STATE_SNAPSHOT_FREQUENCY);
+	std::printf("STATE_PROOF_FREQUENCY          = %lu\n", STATE_PROOF_FREQUENCY);
+	std::printf("FILTER_LOG_VALIDATION_PRECHECK = %u\n", FILTER_LOG_VALIDATION_PRECHECK);
+	std::printf("DEFERRED_RETRY_WAVE            = %u\n", DEFERRED_RETRY_WAVE);
+	std::printf("TATONNEMENT_FULL_OBJECTIVE     = %u\n", TATONNEMENT_FULL_OBJECTIVE);
+	std::printf("METADATA_QUANTIZATION_BITS     = %u\n", METADATA_QUANTIZATION_BITS);
+	std::printf("SPECULATIVE_PRICE_PREDICTION   = %u\n", SPECULATIVE_PRICE_PREDICTION);
+	std::printf("PUBLISH_MARKET_DATA            = %u\n", PUBLISH_MARKET_DATA);
+	std::printf("MARKET_DATA_RING_SLOTS         = %lu\n", MARKET_DATA_RING_SLOTS);
 	std::printf("====================================\n");
 }
 
@@ -70,6 +70,120 @@ constexpr static bool PREALLOC_BLOCK_FILES = true;
 	constexpr static uint32_t NUM_ACCOUNT_DB_SHARDS = _NUM_ACCOUNT_DB_SHARDS;
 #endif
 
+// Default for SpeedexRuntimeConfigs::batch_lmdb_persistence:
+// sort (and coalesce, across all blocks persisted in one call) account and
+// offer writes into lmdb key order before applying them.
+#ifdef _BATCH_LMDB_PERSISTENCE
+	constexpr static bool BATCH_LMDB_PERSISTENCE = true;
+#else
+	constexpr static bool BATCH_LMDB_PERSISTENCE = false;
+#endif
+
+// Serialize proposed blocks' tx lists with the columnar encoding
+// in block_processing/compact_tx_list.h instead of plain XDR.
+// All replicas must agree on this setting.
+#ifdef _COMPACT_BLOCK_ENCODING
+	constexpr static bool COMPACT_BLOCK_ENCODING = true;
+#else
+	constexpr static bool COMPACT_BLOCK_ENCODING = false;
+#endif
+
+// Append every committed block's tx list to the tx block log (modlog/tx_block_log.h).
+#ifdef _LOG_TX_BLOCKS
+	constexpr static bool LOG_TX_BLOCKS = true;
+#else
+	constexpr static bool LOG_TX_BLOCKS = false;
+#endif
+
+// The tx block log is fsynced once per this many blocks
+// (0 means only on segment rollover or explicit sync).
+#ifndef _TX_BLOCK_LOG_FSYNC_GROUP
+	constexpr static uint32_t TX_BLOCK_LOG_FSYNC_GROUP = 8;
+#else
+	constexpr static uint32_t TX_BLOCK_LOG_FSYNC_GROUP = _TX_BLOCK_LOG_FSYNC_GROUP;
+#endif
+
+// Run filtering/filter_log.h over each block before validating its txs.
+// Rejects blocks with conflicting txs without modifying the database,
+// and skips the final balance check when the filter proves it redundant.
+#ifdef _FILTER_LOG_VALIDATION_PRECHECK
+	constexpr static bool FILTER_LOG_VALIDATION_PRECHECK = true;
+#else
+	constexpr static bool FILTER_LOG_VALIDATION_PRECHECK = false;
+#endif
+
+// Take a full state snapshot every this many blocks (0 disables snapshots).
+#ifndef _STATE_SNAPSHOT_FREQUENCY
+	constexpr static uint64_t STATE_SNAPSHOT_FREQUENCY = 0;
+#else
+	constexpr static uint64_t STATE_SNAPSHOT_FREQUENCY = _STATE_SNAPSHOT_FREQUENCY;
+#endif
+
+// Rebuild the account/offer proof snapshot (state_proofs/) from each
+// committed block that is a multiple of this (0 disables proof serving).
+// Such blocks are always persisted on commit, whatever the persistence
+// batch size.  Headers do not commit to the proof roots.
+#ifndef _STATE_PROOF_FREQUENCY
+	constexpr static uint64_t STATE_PROOF_FREQUENCY = 0;
+#else
+	constexpr static uint64_t STATE_PROOF_FREQUENCY = _STATE_PROOF_FREQUENCY;
+#endif
+
+// Re-run txs that failed only because of intra-block ordering
+// in a second, per-account-serial wave before closing the block.
+// Retried: SEQ_NUM_TEMP_IN_USE, NEW_ACCOUNT_TEMP_RESERVED, and
+// INSUFFICIENT_BALANCE (which a later tx in the block may fund,
+// so the wave can include txs that the first wave alone never would).
+#ifdef _DEFERRED_RETRY_WAVE
+	constexpr static bool DEFERRED_RETRY_WAVE = true;
+#else
+	constexpr static bool DEFERRED_RETRY_WAVE = false;
+#endif
+
+// Evaluate every norm of MultifuncTatonnementObjective each Tatonnement
+// round, instead of only the l2 norm that the step rule reads.
+// Prices computed are the same either way.
+#ifdef _TATONNEMENT_FULL_OBJECTIVE
+	constexpr static bool TATONNEMENT_FULL_OBJECTIVE = true;
+#else
+	constexpr static bool TATONNEMENT_FULL_OBJECTIVE = false;
+#endif
+
+// Tatonnement's demand queries read an orderbook metadata index whose
+// adjacent price points are merged into buckets of relative width
+// 2^-METADATA_QUANTIZATION_BITS (0 uses the exact index).
+// See Orderbook::get_tatonnement_metadata() for the error bound.
+#ifndef _METADATA_QUANTIZATION_BITS
+	constexpr static uint8_t METADATA_QUANTIZATION_BITS = 0;
+#else
+	constexpr static uint8_t METADATA_QUANTIZATION_BITS = _METADATA_QUANTIZATION_BITS;
+#endif
+
+// Default for SpeedexRuntimeConfigs::speculative_price_prediction:
+// between blocks, run Tatonnement in the background on the orderbooks
+// plus the mempool's pending offers, and start the next block's
+// Tatonnement from its prices (see price_computation/tatonnement_predictor.h).
+#ifdef _SPECULATIVE_PRICE_PREDICTION
+	constexpr static bool SPECULATIVE_PRICE_PREDICTION = true;
+#else
+	constexpr static bool SPECULATIVE_PRICE_PREDICTION = false;
+#endif
+
+// Publish each produced or validated block's prices and clearing
+// details to a shared memory ring (market_data/market_data_stream.h).
+#ifdef _PUBLISH_MARKET_DATA
+	constexpr static bool PUBLISH_MARKET_DATA = true;
+#else
+	constexpr static bool PUBLISH_MARKET_DATA = false;
+#endif
+
+// Number of blocks the market data ring holds.
+#ifndef _MARKET_DATA_RING_SLOTS
+	constexpr static uint64_t MARKET_DATA_RING_SLOTS = 1024;
+#else
+	constexpr static uint64_t MARKET_DATA_RING_SLOTS = _MARKET_DATA_RING_SLOTS;
+#endif
+
 #if 0
 // setup for blockstm replication
 constexpr static uint32_t MAX_SEQ_NUMS_PER_BLOCK = 16'000;
@@ -0,0 +1,406 @@
+/**
+ * SPEEDEX: A Scalable, Parallelizable, and Economically Efficient Decentralized Exchange
+ * Copyright (C) 2023 Geoffrey Ramseyer
+
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "speedex/state_snapshot.h"
+
+#include "speedex/speedex_management_structures.h"
+
+#include "utils/debug_macros.h"
+#include "utils/hash.h"
+#include "utils/manage_data_dirs.h"
+#include "utils/save_load_xdr.h"
+
+#include <utils/time.h>
+
+#include <sodium.h>
+
+#include <tbb/parallel_for.h>
+
+#include <xdrpp/marshal.h>
+
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <cinttypes>
+#include <cstdio>
+#include <stdexcept>
+
+namespace speedex {
+
+namespace {
+
+std::string
+manifest_filename(uint64_t block_number) {
+	return state_snapshot_dir(block_number) + "manifest";
+}
+
+std::string
+chunk_filename(uint64_t block_number, uint32_t chunk_idx) {
+	return state_snapshot_dir(block_number) + std::to_string(chunk_idx) + ".chunk";
+}
+
+Hash
+checksum(const uint8_t* data, size_t len) {
+	Hash out;
+	if (crypto_generichash(out.data(), out.size(), data, len, NULL, 0) != 0) {
+		throw std::runtime_error("error in crypto_generichash");
+	}
+	return out;
+}
+
+void
+write_chunk_file(std::string const& filename, xdr::opaque_vec<> const& bytes) {
+	FILE* f = std::fopen(filename.c_str(), "w");
+	if (f == nullptr) {
+		throw std::runtime_error("failed to open snapshot chunk " + filename);
+	}
+	if (std::fwrite(bytes.data(), sizeof(bytes.data()[0]), bytes.size(), f) != bytes.size()) {
+		std::fclose(f);
+		throw std::runtime_error("failed to write snapshot chunk " + filename);
+	}
+	if (std::fflush(f) != 0 || fsync(fileno(f)) != 0) {
+		std::fclose(f);
+		throw std::runtime_error("failed to sync snapshot chunk " + filename);
+	}
+	if (std::fclose(f) != 0) {
+		throw std::runtime_error("failed to close snapshot chunk " + filename);
+	}
+}
+
+//! Read a chunk file through mmap, check its checksum, and deserialize it.
+void
+load_chunk(
+	std::string const& filename,
+	StateSnapshotChunkDescriptor const& descriptor,
+	StateSnapshotChunk& out) {
+
+	utils::unique_fd fd{open(filename.c_str(), O_RDONLY)};
+	if (!fd) {
+		throw std::runtime_error("missing snapshot chunk " + filename);
+	}
+
+	struct stat file_stat;
+	if (fstat(fd.get(), &file_stat) != 0) {
+		utils::threrror("fstat");
+	}
+	size_t len = file_stat.st_size;
+	if (len == 0) {
+		throw std::runtime_error("empty snapshot chunk " + filename);
+	}
+
+	void* mapped = mmap(nullptr, len, PROT_READ, MAP_PRIVATE, fd.get(), 0);
+	if (mapped == MAP_FAILED) {
+		utils::threrror("mmap");
+	}
+	madvise(mapped, len, MADV_SEQUENTIAL);
+
+	const uint8_t* bytes = static_cast<const uint8_t*>(mapped);
+
+	try {
+		if (checksum(bytes, len) != descriptor.checksum) {
+			throw std::runtime_error("checksum mismatch in snapshot chunk " + filename);
+		}
+		xdr::xdr_get g(bytes, bytes + len);
+		xdr::xdr_argpack_archive(g, out);
+		g.done();
+	} catch (...) {
+		munmap(mapped, len);
+		throw;
+	}
+	munmap(mapped, len);
+
+	if (out.type() != descriptor.type) {
+		throw std::runtime_error("chunk type mismatch in snapshot chunk " + filename);
+	}
+
+	size_t num_entries = (out.type() == SNAPSHOT_ACCOUNTS)
+		? out.accounts().size()
+		: out.offerChunk().offers.size();
+
+	if (num_entries != descriptor.numEntries) {
+		throw std::runtime_error("entry count mismatch in snapshot chunk " + filename);
+	}
+}
+
+//! Which range of the copied state goes into one chunk.
+struct ChunkPlan {
+	StateSnapshotChunkType type;
+	uint32_t orderbook_idx;
+	size_t start;
+	size_t end;
+};
+
+} /* anonymous namespace */
+
+void
+StateSnapshotWriter::run() {
+	while(true) {
+		std::unique_lock lock(mtx);
+
+		if ((!done_flag) && (!exists_work_to_do())) {
+			cv.wait(
+				lock, [this] () {return done_flag || exists_work_to_do();});
+		}
+
+		if (done_flag) return;
+
+		// a failed snapshot should not take down the node
+		try {
+			write_snapshot(*pending);
+		} catch (std::exception const& e) {
+			BLOCK_INFO("state snapshot for block %" PRIu64 " failed: %s",
+				pending -> header.block.blockNumber,
+				e.what());
+		}
+		pending = nullptr;
+		cv.notify_all();
+	}
+}
+
+void
+StateSnapshotWriter::write_snapshot(SnapshotData const& data) {
+	auto timestamp = utils::init_time_measurement();
+
+	uint64_t block_number = data.header.block.blockNumber;
+
+	clear_state_snapshot_dir(block_number);
+	make_state_snapshot_dir(block_number);
+
+	std::vector<ChunkPlan> plans;
+
+	for (size_t i = 0; i < data.accounts.size(); i += ACCOUNTS_PER_CHUNK) {
+		plans.push_back(ChunkPlan{
+			SNAPSHOT_ACCOUNTS, 0, i, std::min(i + ACCOUNTS_PER_CHUNK, data.accounts.size())});
+	}
+
+	for (uint32_t idx = 0; idx < data.offers.size(); idx++) {
+		auto const& offers = data.offers[idx];
+		for (size_t i = 0; i < offers.size(); i += OFFERS_PER_CHUNK) {
+			plans.push_back(ChunkPlan{
+				SNAPSHOT_OFFERS, idx, i, std::min(i + OFFERS_PER_CHUNK, offers.size())});
+		}
+	}
+
+	StateSnapshotManifest manifest;
+	manifest.header = data.header;
+	manifest.numOrderbooks = data.offers.size();
+	manifest.chunks.resize(plans.size());
+	manifest.headerHashes.insert(
+		manifest.headerHashes.end(), data.header_hashes.begin(), data.header_hashes.end());
+
+	tbb::parallel_for(
+		tbb::blocked_range<size_t>(0, plans.size()),
+		[&] (auto r) {
+			for (size_t i = r.begin(); i < r.end(); i++) {
+				auto const& plan = plans[i];
+
+				StateSnapshotChunk chunk;
+				chunk.type(plan.type);
+
+				if (plan.type == SNAPSHOT_ACCOUNTS) {
+					chunk.accounts().insert(
+						chunk.accounts().end(),
+						data.accounts.begin() + plan.start,
+						data.accounts.begin() + plan.end);
+				} else {
+					auto& offer_chunk = chunk.offerChunk();
+					auto const& offers = data.offers[plan.orderbook_idx];
+					offer_chunk.orderbookIdx = plan.orderbook_idx;
+					offer_chunk.offers.insert(
+						offer_chunk.offers.end(),
+						offers.begin() + plan.start,
+						offers.begin() + plan.end);
+				}
+
+				auto bytes = xdr::xdr_to_opaque(chunk);
+
+				auto& descriptor = manifest.chunks[i];
+				descriptor.chunkIdx = i;
+				descriptor.type = plan.type;
+				descriptor.numEntries = plan.end - plan.start;
+				descriptor.checksum = checksum(bytes.data(), bytes.size());
+
+				write_chunk_file(chunk_filename(block_number, i), bytes);
+			}
+		});
+
+	auto filename = manifest_filename(block_number);
+	if (save_xdr_to_file(manifest, filename.c_str())) {
+		throw std::runtime_error("failed to write snapshot manifest " + filename);
+	}
+
+	BLOCK_INFO("wrote state snapshot for block %" PRIu64 " (%lu accounts, %lu chunks) in %f s",
+		block_number,
+		data.accounts.size(),
+		plans.size(),
+		utils::measure_time(timestamp));
+}
+
+void
+StateSnapshotWriter::snapshot(
+	SpeedexManagementStructures& management_structures,
+	HashedBlock const& header) {
+
+	uint64_t block_number = header.block.blockNumber;
+
+	{
+		std::lock_guard lock(mtx);
+		if (pending) {
+			BLOCK_INFO("skipping state snapshot for block %" PRIu64 ", previous snapshot still writing",
+				block_number);
+			return;
+		}
+	}
+
+	auto data = std::make_unique<SnapshotData>();
+	data -> header = header;
+
+	management_structures.db.snapshot_persisted_accounts(data -> accounts, block_number);
+	management_structures.orderbook_manager.snapshot_persisted_offers(data -> offers, block_number);
+	data -> header_hashes = management_structures.block_header_hash_map.snapshot_hashes(block_number);
+
+	std::lock_guard lock(mtx);
+	pending = std::move(data);
+	cv.notify_all();
+}
+
+bool
+check_if_state_snapshot_exists(uint64_t block_number) {
+	auto filename = manifest_filename(block_number);
+	if (FILE* file = fopen(filename.c_str(), "r")) {
+		fclose(file);
+		return true;
+	}
+	return false;
+}
+
+HashedBlock
+load_state_snapshot(
+	SpeedexManagementStructures& management_structures,
+	uint64_t block_number) {
+
+	auto timestamp = utils::init_time_measurement();
+
+	if (block_number == 0) {
+		throw std::runtime_error("no state snapshots of genesis");
+	}
+
+	StateSnapshotManifest manifest;
+	auto filename = manifest_filename(block_number);
+	if (load_xdr_from_file(manifest, filename.c_str())) {
+		throw std::runtime_error("no complete state snapshot at " + filename);
+	}
+
+	if (manifest.header.block.blockNumber != block_number) {
+		throw std::runtime_error("snapshot manifest block number mismatch");
+	}
+
+	auto& orderbook_manager = management_structures.orderbook_manager;
+
+	if (manifest.numOrderbooks != orderbook_manager.get_num_orderbooks()) {
+		throw std::runtime_error("snapshot orderbook count mismatch");
+	}
+
+	if (manifest.headerHashes.size() != block_number) {
+		throw std::runtime_error("snapshot header hash count mismatch");
+	}
+
+	std::vector<StateSnapshotChunk> chunks(manifest.chunks.size());
+
+	tbb::parallel_for(
+		tbb::blocked_range<size_t>(0, chunks.size()),
+		[&] (auto r) {
+			for (size_t i = r.begin(); i < r.end(); i++) {
+				load_chunk(chunk_filename(block_number, i), manifest.chunks[i], chunks[i]);
+			}
+		});
+
+	std::vector<xdr::xvector<AccountCommitment>> accounts;
+	std::vector<std::vector<Offer>> offers(manifest.numOrderbooks);
+
+	for (auto& chunk : chunks) {
+		if (chunk.type() == SNAPSHOT_ACCOUNTS) {
+			accounts.push_back(std::move(chunk.accounts()));
+		} else {
+			auto const& offer_chunk = chunk.offerChunk();
+			if (offer_chunk.orderbookIdx >= offers.size()) {
+				throw std::runtime_error("invalid orderbook idx in snapshot");
+			}
+			auto& list = offers[offer_chunk.orderbookIdx];
+			list.insert(list.end(), offer_chunk.offers.begin(), offer_chunk.offers.end());
+		}
+	}
+	chunks.clear();
+
+	auto const& expected_hashes = manifest.header.block.internalHashes;
+
+	Hash db_hash;
+	management_structures.db.load_snapshot_contents_to_memory(accounts, db_hash);
+
+	if (db_hash != expected_hashes.dbHash) {
+		throw std::runtime_error("snapshot account state does not match block header");
+	}
+
+	orderbook_manager.load_snapshot_contents_to_memory(offers);
+
+	OrderbookStateCommitment clearing_details;
+	clearing_details.resize(manifest.numOrderbooks);
+	orderbook_manager.hash(clearing_details);
+
+	if (expected_hashes.clearingDetails.size() != clearing_details.size()) {
+		throw std::runtime_error("snapshot header has wrong number of orderbook commitments");
+	}
+
+	for (size_t i = 0; i < clearing_details.size(); i++) {
+		if (clearing_details[i].rootHash != expected_hashes.clearingDetails[i].rootHash) {
+			throw std::runtime_error("snapshot orderbook state does not match block header");
+		}
+	}
+
+	// The header commits to the map of the blocks before it.
+	// The snapshot block itself goes in last.
+	auto& header_hash_map = management_structures.block_header_hash_map;
+
+	auto const& last_value = manifest.headerHashes.back();
+	if (last_value.hash != hash_xdr(manifest.header.block)) {
+		throw std::runtime_error("snapshot header hash map does not end with the snapshot block");
+	}
+
+	header_hash_map.load_snapshot_contents_to_memory(
+		std::vector<BlockHeaderHashValue>(manifest.headerHashes.begin(), manifest.headerHashes.end() - 1));
+
+	Hash block_map_hash;
+	header_hash_map.hash(block_map_hash);
+	if (block_map_hash != expected_hashes.blockMapHash) {
+		throw std::runtime_error("snapshot header hash map does not match block header");
+	}
+
+	header_hash_map.insert(manifest.header.block, last_value.validation_success);
+
+	BLOCK_INFO("loaded state snapshot for block %" PRIu64 " (%lu chunks) in %f s",
+		block_number,
+		manifest.chunks.size(),
+		utils::measure_time(timestamp));
+
+	return manifest.header;
+}
+
+} /* speedex */
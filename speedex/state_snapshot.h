@@ -0,0 +1,123 @@
+/**
+ * SPEEDEX: A Scalable, Parallelizable, and Economically Efficient Decentralized Exchange
+ * Copyright (C) 2023 Geoffrey Ramseyer
+
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#pragma once
+
+/*! \file state_snapshot.h
+
+Full state snapshots (all accounts and all orderbooks) at a given
+block height.
+
+A snapshot is a directory of chunk files (each one an xdr-serialized
+StateSnapshotChunk) and a manifest that lists the chunks and their
+checksums.  The manifest is written last, so a snapshot without
+a manifest is incomplete.
+
+Taking a snapshot copies the state of a committed block out of the
+lmdbs, once that block is persisted (in a persistence thread, not on
+the block production path), and then serializes and writes that copy
+in a background thread.
+
+Loading reads and checks chunks in parallel, and then checks the
+rebuilt state against the state commitment in the snapshot's block header.
+*/
+
+#include "xdr/block.h"
+#include "xdr/snapshot.h"
+
+#include <utils/async_worker.h>
+
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+namespace speedex {
+
+struct SpeedexManagementStructures;
+
+class StateSnapshotWriter : public utils::AsyncWorker {
+
+	using utils::AsyncWorker::mtx;
+	using utils::AsyncWorker::cv;
+
+	struct SnapshotData {
+		HashedBlock header;
+		std::vector<AccountCommitment> accounts;
+		std::vector<std::vector<Offer>> offers;
+		std::vector<BlockHeaderHashValue> header_hashes;
+	};
+
+	std::unique_ptr<SnapshotData> pending;
+
+	bool exists_work_to_do() override final {
+		return (pending != nullptr);
+	}
+
+	void run();
+
+	void write_snapshot(SnapshotData const& data);
+
+public:
+
+	constexpr static size_t ACCOUNTS_PER_CHUNK = 100'000;
+	constexpr static size_t OFFERS_PER_CHUNK = 100'000;
+
+	StateSnapshotWriter()
+		: utils::AsyncWorker()
+		, pending(nullptr)
+		{
+			start_async_thread([this] {run();});
+		}
+
+	~StateSnapshotWriter() {
+		terminate_worker();
+	}
+
+	/*! Copy out the persisted state, which should be the state
+	committed to in \a header, and write it to disk in the background.
+	Call after \a header's block is persisted to every lmdb,
+	and not concurrently with persistence.
+	Skipped if the previous snapshot is still being written.
+
+	The header is not checked against the decided chain here;
+	a loader should check that the snapshot's block was decided.
+	*/
+	void snapshot(
+		SpeedexManagementStructures& management_structures,
+		HashedBlock const& header);
+
+	void wait_for_snapshot() {
+		wait_for_async_task();
+	}
+};
+
+bool check_if_state_snapshot_exists(uint64_t block_number);
+
+/*! Load a snapshot into empty management structures.
+Throws if a chunk checksum does not match, or if the rebuilt state
+(including the header hash map) does not match the snapshot header.
+Returns the header of the snapshot block.
+
+The lmdbs are not touched.
+*/
+HashedBlock
+load_state_snapshot(
+	SpeedexManagementStructures& management_structures,
+	uint64_t block_number);
+
+} /* speedex */
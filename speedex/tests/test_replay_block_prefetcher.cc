@@ -0,0 +1,99 @@
+#include <catch2/catch_test_macros.hpp>
+
+#include "speedex/replay_block_prefetcher.h"
+
+#include <cstdint>
+#include <mutex>
+#include <stdexcept>
+#include <vector>
+
+namespace speedex
+{
+
+static HashedBlockTransactionListPair
+make_prefetch_test_block(uint64_t round_number)
+{
+	HashedBlockTransactionListPair out;
+	out.hashedBlock.block.blockNumber = round_number;
+	return out;
+}
+
+TEST_CASE("replay prefetcher returns blocks in order", "[speedex]")
+{
+	std::vector<uint64_t> loads;
+
+	ReplayBlockPrefetcher<uint64_t> prefetcher(
+		[&loads] (uint64_t const& hash) {
+			loads.push_back(hash);
+			return make_prefetch_test_block(hash);
+		});
+
+	SECTION("sequential")
+	{
+		prefetcher.prefetch(1);
+		for (uint64_t i = 1; i <= 5; i++)
+		{
+			auto block = prefetcher.get();
+			if (i < 5) {
+				prefetcher.prefetch(i + 1);
+			}
+			REQUIRE(block.hashedBlock.block.blockNumber == i);
+		}
+		REQUIRE(loads == std::vector<uint64_t>{1, 2, 3, 4, 5});
+	}
+
+	SECTION("unclaimed block discarded")
+	{
+		prefetcher.prefetch(1);
+		prefetcher.prefetch(2);
+		REQUIRE(prefetcher.get().hashedBlock.block.blockNumber == 2);
+	}
+
+	SECTION("get without prefetch")
+	{
+		REQUIRE_THROWS_AS(prefetcher.get(), std::runtime_error);
+
+		prefetcher.prefetch(1);
+		prefetcher.get();
+		REQUIRE_THROWS_AS(prefetcher.get(), std::runtime_error);
+	}
+}
+
+TEST_CASE("replay prefetcher loads in background", "[speedex]")
+{
+	std::mutex loader_blocked;
+	std::unique_lock lock(loader_blocked);
+
+	ReplayBlockPrefetcher<uint64_t> prefetcher(
+		[&loader_blocked] (uint64_t const& hash) {
+			std::lock_guard lock(loader_blocked);
+			return make_prefetch_test_block(hash);
+		});
+
+	// returns while the load is still blocked
+	prefetcher.prefetch(7);
+	lock.unlock();
+
+	REQUIRE(prefetcher.get().hashedBlock.block.blockNumber == 7);
+}
+
+TEST_CASE("replay prefetcher rethrows load errors", "[speedex]")
+{
+	ReplayBlockPrefetcher<uint64_t> prefetcher(
+		[] (uint64_t const& hash) {
+			if (hash == 3) {
+				throw std::runtime_error("missing block");
+			}
+			return make_prefetch_test_block(hash);
+		});
+
+	prefetcher.prefetch(3);
+	REQUIRE_THROWS_AS(prefetcher.get(), std::runtime_error);
+
+	// error is reported once, and later loads still work
+	REQUIRE_THROWS_AS(prefetcher.get(), std::runtime_error);
+	prefetcher.prefetch(4);
+	REQUIRE(prefetcher.get().hashedBlock.block.blockNumber == 4);
+}
+
+} /* speedex */
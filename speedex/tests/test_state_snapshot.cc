@@ -0,0 +1,185 @@
+#include <catch2/catch_test_macros.hpp>
+
+#include "orderbook/utils.h"
+
+#include "speedex/speedex_management_structures.h"
+#include "speedex/state_snapshot.h"
+
+#include "utils/hash.h"
+#include "utils/manage_data_dirs.h"
+
+#include <algorithm>
+#include <cstdio>
+#include <vector>
+
+using xdr::operator==;
+
+namespace speedex
+{
+
+constexpr static uint16_t SNAPSHOT_TEST_NUM_ASSETS = 3;
+constexpr static AccountID SNAPSHOT_TEST_NUM_ACCOUNTS = 1000;
+constexpr static uint64_t SNAPSHOT_TEST_ROUND = 5;
+
+static SpeedexManagementStructures
+make_snapshot_test_structures()
+{
+	return SpeedexManagementStructures(
+		SNAPSHOT_TEST_NUM_ASSETS,
+		ApproximationParameters{
+			.tax_rate = 10,
+			.smooth_mult = 10
+		},
+		SpeedexRuntimeConfigs{
+			.check_sigs = false
+		});
+}
+
+//! Fill in accounts and offers, persist them at SNAPSHOT_TEST_ROUND,
+//! and return a header committing to that state.
+static HashedBlock
+make_snapshot_test_state(SpeedexManagementStructures& management_structures)
+{
+	management_structures.open_lmdb_env();
+	management_structures.create_lmdb();
+
+	auto& db = management_structures.db;
+
+	MemoryDatabaseGenesisData data;
+	for (AccountID i = 0; i < SNAPSHOT_TEST_NUM_ACCOUNTS; i++)
+	{
+		data.id_list.push_back(i);
+	}
+	data.pk_list.resize(data.id_list.size());
+
+	db.install_initial_accounts_and_commit(data, [&db] (UserAccount& user) {
+		for (AssetID asset = 0; asset < SNAPSHOT_TEST_NUM_ASSETS; asset++)
+		{
+			db.transfer_available(&user, asset, 100 + user.get_owner() * (asset + 1));
+		}
+		user.commit();
+	});
+
+	auto& orderbook_manager = management_structures.orderbook_manager;
+	size_t num_orderbooks = orderbook_manager.get_num_orderbooks();
+
+	std::vector<std::vector<Offer>> offers(num_orderbooks);
+	for (size_t i = 0; i < num_orderbooks; i++)
+	{
+		for (uint64_t j = 0; j < 10 * i; j++)
+		{
+			Offer offer;
+			offer.category = category_from_idx(i, SNAPSHOT_TEST_NUM_ASSETS);
+			offer.offerId = j;
+			offer.owner = (i + j) % SNAPSHOT_TEST_NUM_ACCOUNTS;
+			offer.amount = 10 + j;
+			offer.minPrice = price::from_double(0.5 + 0.1 * j);
+			offers[i].push_back(offer);
+		}
+	}
+	orderbook_manager.load_snapshot_contents_to_memory(offers);
+
+	auto& header_hash_map = management_structures.block_header_hash_map;
+
+	HashedBlock header;
+	for (uint64_t round = 1; round <= SNAPSHOT_TEST_ROUND; round++)
+	{
+		Block block;
+		block.blockNumber = round;
+		header_hash_map.hash(block.internalHashes.blockMapHash);
+		if (round == SNAPSHOT_TEST_ROUND)
+		{
+			db.produce_state_commitment(block.internalHashes.dbHash);
+			block.internalHashes.clearingDetails.resize(num_orderbooks);
+			orderbook_manager.hash(block.internalHashes.clearingDetails);
+			header.block = block;
+			header.hash = hash_xdr(block);
+		}
+		header_hash_map.insert(block, round != 2);
+	}
+
+	db.persist_lmdb(SNAPSHOT_TEST_ROUND);
+	orderbook_manager.persist_lmdb_after_snapshot(SNAPSHOT_TEST_ROUND);
+	header_hash_map.persist_lmdb(SNAPSHOT_TEST_ROUND);
+
+	return header;
+}
+
+static std::vector<AccountCommitment>
+sorted_snapshot_accounts(MemoryDatabase& db)
+{
+	std::vector<AccountCommitment> out;
+	db.snapshot_accounts(out);
+	std::sort(out.begin(), out.end(), [] (auto const& a, auto const& b) {
+		return a.owner < b.owner;
+	});
+	return out;
+}
+
+TEST_CASE("state snapshot round trip", "[speedex][snapshot]")
+{
+	test::speedex_dirs s;
+	clear_state_snapshot_dir(SNAPSHOT_TEST_ROUND);
+
+	auto original = make_snapshot_test_structures();
+	auto header = make_snapshot_test_state(original);
+
+	{
+		StateSnapshotWriter writer;
+		writer.snapshot(original, header);
+		writer.wait_for_snapshot();
+	}
+
+	REQUIRE(check_if_state_snapshot_exists(SNAPSHOT_TEST_ROUND));
+
+	SECTION("load matches")
+	{
+		auto loaded = make_snapshot_test_structures();
+		REQUIRE(load_state_snapshot(loaded, SNAPSHOT_TEST_ROUND) == header);
+
+		REQUIRE(sorted_snapshot_accounts(loaded.db) == sorted_snapshot_accounts(original.db));
+
+		std::vector<std::vector<Offer>> original_offers, loaded_offers;
+		original.orderbook_manager.snapshot_offers(original_offers);
+		loaded.orderbook_manager.snapshot_offers(loaded_offers);
+		REQUIRE(loaded_offers == original_offers);
+
+		auto& loaded_map = loaded.block_header_hash_map;
+		REQUIRE(loaded_map.get_map_size() == SNAPSHOT_TEST_ROUND);
+		Hash loaded_map_hash, original_map_hash;
+		loaded_map.hash(loaded_map_hash);
+		original.block_header_hash_map.hash(original_map_hash);
+		REQUIRE(loaded_map_hash == original_map_hash);
+	}
+
+	SECTION("corrupted chunk")
+	{
+		auto filename = state_snapshot_dir(SNAPSHOT_TEST_ROUND) + "0.chunk";
+		FILE* f = std::fopen(filename.c_str(), "r+");
+		REQUIRE(f != nullptr);
+		int c = std::fgetc(f);
+		std::fseek(f, 0, SEEK_SET);
+		std::fputc(c ^ 1, f);
+		std::fclose(f);
+
+		auto loaded = make_snapshot_test_structures();
+		REQUIRE_THROWS_AS(load_state_snapshot(loaded, SNAPSHOT_TEST_ROUND), std::runtime_error);
+	}
+
+	clear_state_snapshot_dir(SNAPSHOT_TEST_ROUND);
+}
+
+TEST_CASE("state snapshot requires persisted round", "[speedex][snapshot]")
+{
+	test::speedex_dirs s;
+
+	auto original = make_snapshot_test_structures();
+	auto header = make_snapshot_test_state(original);
+
+	header.block.blockNumber = SNAPSHOT_TEST_ROUND + 1;
+
+	StateSnapshotWriter writer;
+	REQUIRE_THROWS_AS(writer.snapshot(original, header), std::runtime_error);
+}
+
+} /* speedex */
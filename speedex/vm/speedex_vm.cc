@@ -20,6 +20,7 @@
 
 #include "speedex/speedex_operation.h"
 #include "speedex/speedex_options.h"
+#include "speedex/speedex_static_configs.h"
 
 #include "utils/debug_macros.h"
 #include "utils/hash.h"
@@ -50,14 +51,23 @@ SpeedexVM::SpeedexVM(
 	, proposal_base_block()
 	, last_committed_block() // genesis
 	, last_persisted_block_number(0)
+	, last_state_snapshot_block_number(0)
 	, async_persister(management_structures)
+	, state_snapshot_writer()
+	, state_proof_server()
 	, measurements_log(params)
 	, measurement_output_folder(measurement_output_folder)
 	, options(options)
 	, params(params)
 	, TARGET_BLOCK_SIZE(options.block_size)
 	, tatonnement_structs(management_structures.orderbook_manager)
-	, mempool_structs(management_structures.db, options.mempool_chunk, options.mempool_target)
+	, prices()
+	, mempool_structs(
+		management_structures.db, 
+		options.mempool_chunk, 
+		options.mempool_target, 
+		options.mempool_account_shards)
+	, price_predictor(nullptr)
 	, log_merge_worker(management_structures.account_modification_log)
 	, block_producer(management_structures, log_merge_worker)
 	, block_validator(management_structures, log_merge_worker)
@@ -68,16 +78,20 @@ SpeedexVM::SpeedexVM(
 			prices[i] = price::from_double(1.0);
 		}
 
+		if (configs.speculative_price_prediction) {
+			price_predictor = std::make_unique<TatonnementPricePredictor>(num_assets);
+		}
+
 		utils::mkdir_safe(measurement_output_folder.c_str());
 	}
 
 std::unique_ptr<hotstuff::VMBlock>
 SpeedexVM::try_parse(xdr::opaque_vec<> const& body)
 {
-	HashedBlockTransactionListPair out;
+	auto out = std::make_shared<HashedBlockTransactionListPair>();
 	try {
-		xdr::xdr_from_opaque(body, out);
-		return std::make_unique<SpeedexVMBlock>(out);
+		xdr::xdr_from_opaque(body, *out);
+		return std::make_unique<SpeedexVMBlock>(std::move(out));
 	} catch(...)
 	{
 		std::printf("message parsing failed, rejecting\n");
@@ -106,6 +120,61 @@ SpeedexVM::rewind_structs_to_committed_height()
 	proposal_base_block = last_committed_block;
 }
 
+bool
+SpeedexVM::is_state_proof_block(uint64_t block_number)
+{
+	if constexpr (STATE_PROOF_FREQUENCY > 0)
+	{
+		return block_number > 0 && block_number % STATE_PROOF_FREQUENCY == 0;
+	}
+	return false;
+}
+
+std::function<void()>
+SpeedexVM::make_after_persist_callback(HashedBlock const& header)
+{
+	bool take_snapshot = false;
+
+	if constexpr (STATE_SNAPSHOT_FREQUENCY > 0)
+	{
+		// blocks are persisted in batches, so snapshot the first
+		// persisted block at or past each multiple of the frequency
+		uint64_t block_number = header.block.blockNumber;
+		take_snapshot = (block_number / STATE_SNAPSHOT_FREQUENCY)
+			> (last_state_snapshot_block_number / STATE_SNAPSHOT_FREQUENCY);
+		if (take_snapshot)
+		{
+			last_state_snapshot_block_number = block_number;
+		}
+	}
+
+	bool refresh_state_proofs = is_state_proof_block(header.block.blockNumber);
+
+	if (!(take_snapshot || refresh_state_proofs))
+	{
+		return nullptr;
+	}
+
+	return [this, header, take_snapshot, refresh_state_proofs] () {
+		if (refresh_state_proofs)
+		{
+			try
+			{
+				state_proof_server.refresh(management_structures, header);
+			}
+			catch (std::exception const& e)
+			{
+				BLOCK_INFO("state proof refresh for block %lu failed: %s",
+					header.block.blockNumber, e.what());
+			}
+		}
+		if (take_snapshot)
+		{
+			state_snapshot_writer.snapshot(management_structures, header);
+		}
+	};
+}
+
 void
 SpeedexVM::log_commitment(const block_id& id) {
 	std::lock_guard lock(confirmation_mtx);
@@ -113,13 +182,14 @@ SpeedexVM::log_commitment(const block_id& id) {
 	if (id) {
 	//if (id.value) {
 
-		while (!pending_proposed_ids.empty())
+		while (!pending_proposals.empty())
 		{
-			auto front = *pending_proposed_ids.begin();
-			pending_proposed_ids.pop_front();
-			if (front == id)
+			auto front = std::move(pending_proposals.front());
+			pending_proposals.pop_front();
+			if (front.id == id)
 			{
 				xdr::xdr_from_opaque(*(id.value), last_committed_block);
+				log_committed_block(std::move(front.data));
 				break;
 			}
 		}
@@ -135,16 +205,28 @@ SpeedexVM::log_commitment(const block_id& id) {
 		auto last_committed_block_number = last_committed_block.block.blockNumber;
 
 		//if (last_committed_block_number % PERSIST_BATCH == 0) {
-		if (last_committed_block_number >= last_persisted_block_number + PERSIST_BATCH)
+		if (last_committed_block_number >= last_persisted_block_number + PERSIST_BATCH
+			|| is_state_proof_block(last_committed_block_number))
 		{
 			std::printf("activating async persist on block %lu\n", last_committed_block_number);
 			async_persister.do_async_persist(
-				std::make_unique<PersistenceMeasurementLogCallback>(measurements_log, last_committed_block_number));
+				std::make_unique<PersistenceMeasurementLogCallback>(measurements_log, last_committed_block_number),
+				make_after_persist_callback(last_committed_block));
 			last_persisted_block_number = last_committed_block_number;
 		}
 	}
 }
 
+void
+SpeedexVM::log_committed_block(std::shared_ptr<const HashedBlockTransactionListPair> block)
+{
+	if (management_structures.tx_block_log)
+	{
+		// serialization and disk writes happen in the background
+		management_structures.tx_block_log -> log_block(std::move(block));
+	}
+}
+
 TaggedSingleBlockResults
 new_measurements(NodeType state)
 {
@@ -159,7 +241,7 @@ void
 SpeedexVM::exec_block(const hotstuff::VMBlock& blk_unparsed)
 {
 	auto const& blk_ = static_cast<const block_type&>(blk_unparsed);
-	auto const& blk = blk_.data;
+	auto const& blk = *blk_.data;
 
 	BLOCK_INFO("begin exec_block on %lu", blk.hashedBlock.block.blockNumber);
 
@@ -205,6 +287,11 @@ SpeedexVM::exec_block(const hotstuff::VMBlock& blk_unparsed)
 	}
 	
 	if (!res) {
+		// the block commits, but under the corrected header and with no txs
+		auto corrected = std::make_shared<HashedBlockTransactionListPair>();
+		corrected -> hashedBlock = last_committed_block;
+		log_committed_block(std::move(corrected));
+
 		mempool_structs.post_validation_cleanup();
 		return;
 	}
@@ -220,6 +307,9 @@ SpeedexVM::exec_block(const hotstuff::VMBlock& blk_unparsed)
 		false, 
 		false);
 
+	// exec_block() only sees decided blocks
+	log_committed_block(blk_.data);
+
 	current_measurements.total_persistence_time = measure_time(persistence_start);
 
 	current_measurements.total_time = measure_time(timestamp);
@@ -303,6 +393,17 @@ SpeedexVM::propose()
 
 	current_measurements.total_block_build_time = utils::measure_time_from_basept(start_time);
 
+	if (price_predictor) {
+		auto prediction = price_predictor->take_prediction();
+		if (prediction) {
+			BLOCK_INFO("speculative tatonnement: %u rounds in %lf s, converged %u",
+				prediction->measurements.num_rounds, 
+				prediction->measurements.runtime, 
+				prediction->converged);
+			prices = std::move(prediction->prices);
+		}
+	}
+
 	HashedBlock new_block = speedex_block_creation_logic(
 		prices,
 		management_structures,
@@ -335,23 +436,64 @@ SpeedexVM::propose()
 	current_measurements.mempool_wait_time = measure_time(mempool_wait_ts);
 	
 	auto out = std::make_unique<block_type>();
-	out -> data.hashedBlock = proposal_base_block;
-	out -> data.txList = std::move(*output_tx_block);
+	out -> data->hashedBlock = proposal_base_block;
+	out -> data->txList = std::move(*output_tx_block);
 	//out -> data.txList.reserve(block_size);
 	//write_tx_data(out->data.txList, *output_tx_block);
 
 	current_measurements.serialize_time = measure_time(mempool_wait_ts);
 
+	if (price_predictor) {
+		start_price_prediction();
+	}
+
 	current_measurements.total_time_from_basept = utils::measure_time_from_basept(start_time);
 	current_measurements.total_time = measure_time(start_time);
 
 	measurements_log.add_measurement(measurements_base);
 
-	pending_proposed_ids.push_back(out -> get_id());
+	pending_proposals.push_back(PendingProposal{out -> get_id(), out -> data});
 
 	return out;
 }
 
+void
+SpeedexVM::start_price_prediction()
+{
+	// Runs in the predictor thread.
+	auto collect_pending_offers = [this] (std::vector<Offer>& pending_offers) {
+		auto& mempool = mempool_structs.mempool;
+
+		// The next block is built from the front of the mempool.
+		// The lock is held only to copy one chunk at a time,
+		// so block assembly and the mempool filter are not held up
+		// (if chunks are merged in between, a tx may be counted twice,
+		// which only skews the prediction).
+		size_t num_txs = 0;
+		for (size_t i = 0; num_txs < TARGET_BLOCK_SIZE; i++) {
+			std::vector<SignedTransaction> txs;
+			{
+				auto lock = mempool.lock_mempool();
+				if (i >= mempool.num_chunks()) {
+					break;
+				}
+				txs = mempool[i].txs;
+			}
+			for (auto const& tx : txs) {
+				TatonnementPricePredictor::append_pending_offers(tx, pending_offers);
+			}
+			num_txs += txs.size();
+		}
+	};
+
+	price_predictor->start_prediction(
+		management_structures.orderbook_manager,
+		collect_pending_offers,
+		prices,
+		management_structures.approx_params,
+		tatonnement_structs.rolling_averages.get_formatted_avgs());
+}
+
 ExperimentResultsUnion 
 SpeedexVM::get_measurements() {
 	std::lock_guard lock(confirmation_mtx);
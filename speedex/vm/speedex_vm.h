@@ -20,19 +20,27 @@
 
 #include "block_processing/block_producer.h"
 #include "block_processing/block_validator.h"
+#include "block_processing/compact_tx_list.h"
 
 #include "mempool/mempool_structures.h"
 
 #include "modlog/log_merge_worker.h"
 
+#include "price_computation/tatonnement_predictor.h"
+
 #include "speedex/speedex_management_structures.h"
 #include "speedex/speedex_persistence.h"
+#include "speedex/state_snapshot.h"
+
+#include "state_proofs/state_proof_snapshot.h"
 
 #include "hotstuff/vm/vm_base.h"
 
 #include "xdr/block.h"
 
 #include <deque>
+#include <functional>
+#include <memory>
 #include <mutex>
 
 namespace speedex {
@@ -42,32 +50,52 @@ class SpeedexOptions;
 
 struct SpeedexVMBlock : public hotstuff::VMBlock
 {
-	HashedBlockTransactionListPair data;
+	//! Shared, so that the tx block log can hold a block
+	//! without copying its tx list.
+	std::shared_ptr<HashedBlockTransactionListPair> data;
 
-	SpeedexVMBlock(HashedBlockTransactionListPair const& data)
-		: data(data)
+	SpeedexVMBlock(std::shared_ptr<HashedBlockTransactionListPair> data)
+		: data(std::move(data))
 		{}
 
 	SpeedexVMBlock(xdr::opaque_vec<> const& vec)
-		: data()
+		: data(std::make_shared<HashedBlockTransactionListPair>())
 		{
-			xdr::xdr_from_opaque(vec, data);
+			if constexpr (COMPACT_BLOCK_ENCODING)
+			{
+				HashedBlockCompactTransactionList compact;
+				xdr::xdr_from_opaque(vec, compact);
+				data->hashedBlock = compact.hashedBlock;
+				decode_compact_tx_list(
+					compact.compactTxList.data(), compact.compactTxList.size(), data->txList);
+			}
+			else
+			{
+				xdr::xdr_from_opaque(vec, *data);
+			}
 		}
 
 	SpeedexVMBlock()
-		: data()
+		: data(std::make_shared<HashedBlockTransactionListPair>())
 		{}
 
 	hotstuff::VMBlockID 
 	get_id() const override final
 	{
-		xdr::opaque_vec<> out = xdr::xdr_to_opaque(data.hashedBlock);
+		xdr::opaque_vec<> out = xdr::xdr_to_opaque(data->hashedBlock);
 		return hotstuff::VMBlockID(out);
 	}
 
 	xdr::opaque_vec<> serialize() const override final
 	{
-		return xdr::xdr_to_opaque(data);
+		if constexpr (COMPACT_BLOCK_ENCODING)
+		{
+			HashedBlockCompactTransactionList compact;
+			compact.hashedBlock = data->hashedBlock;
+			encode_compact_tx_list(data->txList, compact.compactTxList);
+			return xdr::xdr_to_opaque(compact);
+		}
+		return xdr::xdr_to_opaque(*data);
 	}
 };
 
@@ -83,8 +111,12 @@ class SpeedexVM : public hotstuff::VMBase {
 	HashedBlock proposal_base_block;
 	HashedBlock last_committed_block;
 	uint64_t last_persisted_block_number;
+	uint64_t last_state_snapshot_block_number;
 
 	AsyncPersister async_persister;
+
+	StateSnapshotWriter state_snapshot_writer;
+	StateProofServer state_proof_server;
 	
 	SpeedexMeasurements measurements_log;
 
@@ -104,6 +136,11 @@ class SpeedexVM : public hotstuff::VMBase {
 
 	MempoolStructures mempool_structs;
 
+	//! Predicts the next proposal's prices in the background
+	//! (nullptr unless configs.speculative_price_prediction).
+	//! Declared after mempool_structs, which it reads from its own thread.
+	std::unique_ptr<TatonnementPricePredictor> price_predictor;
+
 	LogMergeWorker log_merge_worker;
 
 	BlockProducer block_producer;
@@ -112,12 +149,34 @@ class SpeedexVM : public hotstuff::VMBase {
 	std::atomic<bool> experiment_done = false;
 
 	void rewind_structs_to_committed_height();
+
+	//! Blocks that are always persisted on commit, so that the state
+	//! proof snapshot of that exact block can be built.
+	static bool is_state_proof_block(uint64_t block_number);
+
+	//! Work to run once a committed block is persisted
+	//! (e.g. a state snapshot), or nullptr if there is none.
+	std::function<void()> make_after_persist_callback(HashedBlock const& header);
 	size_t assemble_block(TaggedSingleBlockResults& measurements_base, BlockStateUpdateStatsWrapper& state_update_stats);
 
+	//! Start predicting the next proposal's prices from the orderbooks 
+	//! and the offers pending in (the front of) the mempool.
+	void start_price_prediction();
+
 	ExperimentResultsUnion 
 	get_measurements_nolock();
 
-	std::deque<hotstuff::VMBlockID> pending_proposed_ids; 
+	struct PendingProposal {
+		hotstuff::VMBlockID id;
+		//! For the tx block log, once the proposal commits.
+		std::shared_ptr<const HashedBlockTransactionListPair> data;
+	};
+
+	std::deque<PendingProposal> pending_proposals;
+
+	//! Queue a committed block on the tx block log (if enabled).
+	void log_committed_block(std::shared_ptr<const HashedBlockTransactionListPair> block);
+
 
 public:
 	using block_type = SpeedexVMBlock;
@@ -166,6 +225,12 @@ public:
 	Mempool& get_mempool() {
 		return mempool_structs.mempool;
 	}
+
+	//! Snapshot to serve account and offer proofs from
+	//! (nullptr if state proofs are disabled or not yet built).
+	std::shared_ptr<const StateProofSnapshot> get_state_proof_snapshot() const {
+		return state_proof_server.get_latest();
+	}
 };
 
 } /* speedex */
@@ -24,10 +24,15 @@
 
 #include "speedex/reload_from_hotstuff.h"
 
+#include "utils/debug_macros.h"
+#include "utils/manage_data_dirs.h"
 #include "utils/save_load_xdr.h"
+#include "utils/time.h"
 
 #include "xdr/experiments.h"
 
+#include <cinttypes>
+
 namespace speedex {
 
 void
@@ -72,13 +77,46 @@ SpeedexVM::init_clean() {
 void
 SpeedexVM::init_from_disk(hotstuff::LogAccessWrapper const& decided_block_cache)
 {
-	management_structures.open_lmdb_env();
-	management_structures.open_lmdb();
+	auto restart_start_ts = utils::init_time_measurement();
+
+	uint64_t snapshot_block = management_structures.configs.state_snapshot_block;
+
+	HashedBlock top_block;
+
+	if (snapshot_block != 0) {
+		// Load and check the whole snapshot in memory first,
+		// so a missing or corrupt snapshot leaves the lmdbs as they were.
+		top_block = speedex_load_state_snapshot(
+			management_structures, decided_block_cache, snapshot_block);
 
-	auto top_block = speedex_load_persisted_data(management_structures, block_validator, decided_block_cache);
+		// the snapshot replaces whatever the lmdbs held
+		clear_memory_database_lmdb_dir();
+		make_memory_database_lmdb_dir();
+		clear_orderbook_lmdb_dir();
+		make_orderbook_lmdb_dir();
+		clear_header_hash_lmdb_dir();
+		make_header_hash_lmdb_dir();
+
+		management_structures.open_lmdb_env();
+		management_structures.create_lmdb();
+
+		speedex_replay_after_state_snapshot(
+			management_structures, block_validator, decided_block_cache, top_block);
+	} else {
+		management_structures.open_lmdb_env();
+		management_structures.open_lmdb();
+
+		top_block = speedex_load_persisted_data(management_structures, block_validator, decided_block_cache);
+	}
 	last_committed_block = top_block;
 	last_persisted_block_number = last_committed_block.block.blockNumber;
+	last_state_snapshot_block_number = last_committed_block.block.blockNumber;
 	proposal_base_block = top_block;
+
+	float restart_time = utils::measure_time(restart_start_ts);
+	measurements_log.set_restart_time(restart_time);
+	BLOCK_INFO("restarted at block %" PRIu64 " in %f s",
+		top_block.block.blockNumber, restart_time);
 }
 
 } /* speedex */
@@ -0,0 +1,340 @@
+/**
+ * SPEEDEX: A Scalable, Parallelizable, and Economically Efficient Decentralized Exchange
+ * Copyright (C) 2023 Geoffrey Ramseyer
+
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "state_proofs/state_proof_snapshot.h"
+
+#include "speedex/speedex_management_structures.h"
+
+#include <utils/time.h>
+
+#include <tbb/parallel_for.h>
+#include <tbb/parallel_sort.h>
+
+#include <algorithm>
+#include <cinttypes>
+#include <cstdio>
+#include <stdexcept>
+
+namespace speedex {
+
+namespace detail {
+
+void
+SortedMerkleTree::build(std::vector<Hash>&& leaf_hashes) {
+	levels.clear();
+	if (leaf_hashes.empty()) {
+		return;
+	}
+	levels.push_back(std::move(leaf_hashes));
+
+	while (levels.back().size() > 1) {
+		auto const& prev = levels.back();
+		std::vector<Hash> next((prev.size() + 1) / 2);
+
+		tbb::parallel_for(
+			tbb::blocked_range<size_t>(0, next.size()),
+			[&prev, &next] (auto r) {
+				for (size_t i = r.begin(); i < r.end(); i++) {
+					if (2 * i + 1 < prev.size()) {
+						next[i] = state_proof::node_hash(prev[2 * i], prev[2 * i + 1]);
+					} else {
+						next[i] = prev[2 * i];
+					}
+				}
+			});
+		levels.push_back(std::move(next));
+	}
+}
+
+Hash
+SortedMerkleTree::root() const {
+	if (levels.empty()) {
+		return state_proof::empty_root();
+	}
+	return levels.back()[0];
+}
+
+void
+SortedMerkleTree::make_proof(
+	std::vector<uint64_t> const& leaf_indices,
+	xdr::xvector<Hash>& out) const {
+
+	// mirrors state_proof::check_multiproof
+	std::vector<uint64_t> known = leaf_indices;
+	std::vector<uint64_t> next;
+
+	for (size_t level = 0; level + 1 < levels.size(); level++) {
+		auto const& nodes = levels[level];
+		next.clear();
+		for (size_t i = 0; i < known.size(); i++) {
+			uint64_t idx = known[i];
+			if (idx & 1) {
+				out.push_back(nodes[idx - 1]);
+			} else if (idx + 1 == nodes.size()) {
+				// moves up unchanged
+			} else if (i + 1 < known.size() && known[i + 1] == idx + 1) {
+				i++;
+			} else {
+				out.push_back(nodes[idx + 1]);
+			}
+			next.push_back(idx >> 1);
+		}
+		std::swap(known, next);
+	}
+}
+
+} /* detail */
+
+namespace {
+
+template<typename Entry, typename GetKey>
+void
+sort_and_check_entries(std::vector<Entry>& entries, GetKey get_key) {
+	auto cmp = [&get_key] (const Entry& a, const Entry& b) {
+		return get_key(a) < get_key(b);
+	};
+
+	if (!std::is_sorted(entries.begin(), entries.end(), cmp)) {
+		tbb::parallel_sort(entries.begin(), entries.end(), cmp);
+	}
+
+	auto dup = std::adjacent_find(entries.begin(), entries.end(), 
+		[&get_key] (const Entry& a, const Entry& b) {
+			return get_key(a) == get_key(b);
+		});
+	if (dup != entries.end()) {
+		throw std::runtime_error("duplicate key in state proof snapshot");
+	}
+}
+
+template<typename Entry>
+void
+build_tree(std::vector<Entry> const& entries, detail::SortedMerkleTree& tree) {
+	std::vector<Hash> leaf_hashes(entries.size());
+	tbb::parallel_for(
+		tbb::blocked_range<size_t>(0, entries.size()),
+		[&entries, &leaf_hashes] (auto r) {
+			for (size_t i = r.begin(); i < r.end(); i++) {
+				leaf_hashes[i] = state_proof::leaf_hash(entries[i]);
+			}
+		});
+	tree.build(std::move(leaf_hashes));
+}
+
+//! The leaves that prove that \a key is present (one leaf),
+//! or absent (its neighbors in sorted order).
+template<typename Entry, typename Key, typename GetKey>
+std::vector<uint64_t>
+proof_leaf_indices(std::vector<Entry> const& entries, const Key& key, GetKey get_key) {
+	auto it = std::lower_bound(entries.begin(), entries.end(), key,
+		[&get_key] (const Entry& e, const Key& k) {
+			return get_key(e) < k;
+		});
+
+	uint64_t pos = it - entries.begin();
+	uint64_t size = entries.size();
+
+	if (pos < size && get_key(*it) == key) {
+		return {pos};
+	}
+	if (size == 0) {
+		return {};
+	}
+	if (pos == 0) {
+		return {0};
+	}
+	if (pos == size) {
+		return {size - 1};
+	}
+	return {pos - 1, pos};
+}
+
+template<typename Entry, typename Key, typename GetKey, typename Proof>
+void
+fill_proof(
+	std::vector<Entry> const& entries,
+	detail::SortedMerkleTree const& tree,
+	const Key& key,
+	GetKey get_key,
+	Proof& proof) {
+
+	auto indices = proof_leaf_indices(entries, key, get_key);
+
+	proof.leafIndices.clear();
+	proof.leaves.clear();
+	proof.hashes.clear();
+
+	for (auto idx : indices) {
+		proof.leafIndices.push_back(idx);
+		proof.leaves.push_back(entries[idx]);
+	}
+	tree.make_proof(indices, proof.hashes);
+}
+
+auto account_key = [] (const AccountCommitment& account) {
+	return account.owner;
+};
+
+auto offer_key = [] (const Offer& offer) {
+	return state_proof::offer_key(offer);
+};
+
+} /* anonymous namespace */
+
+StateProofSnapshot::StateProofSnapshot(
+	HashedBlock const& header,
+	std::vector<AccountCommitment>&& accounts_in,
+	std::vector<std::vector<Offer>>&& offers_in)
+	: header(header)
+	, accounts(std::move(accounts_in))
+	, offers(std::move(offers_in))
+	, account_tree()
+	, offer_trees(offers.size())
+	, roots()
+{
+	sort_and_check_entries(accounts, account_key);
+	build_tree(accounts, account_tree);
+
+	tbb::parallel_for(
+		tbb::blocked_range<size_t>(0, offers.size()),
+		[this] (auto r) {
+			for (size_t i = r.begin(); i < r.end(); i++) {
+				sort_and_check_entries(offers[i], offer_key);
+				build_tree(offers[i], offer_trees[i]);
+			}
+		});
+
+	roots.blockNumber = header.block.blockNumber;
+	roots.blockHash = header.hash;
+	roots.accounts.size = account_tree.size();
+	roots.accounts.root = account_tree.root();
+	for (auto const& tree : offer_trees) {
+		roots.orderbooks.push_back(SortedMerkleRoot(tree.size(), tree.root()));
+	}
+}
+
+void
+StateProofSnapshot::make_account_proof(AccountProof& proof) const {
+	fill_proof(accounts, account_tree, proof.owner, account_key, proof);
+}
+
+void
+StateProofSnapshot::make_offer_proof(OfferProof& proof) const {
+	if (proof.orderbookIdx >= offers.size()) {
+		throw std::runtime_error("invalid orderbook idx in offer proof request");
+	}
+	fill_proof(
+		offers[proof.orderbookIdx],
+		offer_trees[proof.orderbookIdx],
+		state_proof::offer_key(proof.minPrice, proof.owner, proof.offerId),
+		offer_key,
+		proof);
+}
+
+void
+StateProofSnapshot::make_account_proofs(std::vector<AccountProof>& proofs) const {
+	tbb::parallel_for(
+		tbb::blocked_range<size_t>(0, proofs.size()),
+		[this, &proofs] (auto r) {
+			for (size_t i = r.begin(); i < r.end(); i++) {
+				make_account_proof(proofs[i]);
+			}
+		});
+}
+
+void
+StateProofSnapshot::make_offer_proofs(std::vector<OfferProof>& proofs) const {
+	tbb::parallel_for(
+		tbb::blocked_range<size_t>(0, proofs.size()),
+		[this, &proofs] (auto r) {
+			for (size_t i = r.begin(); i < r.end(); i++) {
+				make_offer_proof(proofs[i]);
+			}
+		});
+}
+
+void
+StateProofServer::run() {
+	while(true) {
+		std::unique_lock lock(mtx);
+
+		if ((!done_flag) && (!exists_work_to_do())) {
+			cv.wait(
+				lock, [this] () {return done_flag || exists_work_to_do();});
+		}
+
+		if (done_flag) return;
+
+		auto state = std::move(pending);
+		uint64_t block_number = state -> header.block.blockNumber;
+		building_block_number = block_number;
+		lock.unlock();
+
+		auto timestamp = utils::init_time_measurement();
+
+		// a failed build should not take down the node
+		try {
+			auto snapshot = std::make_shared<const StateProofSnapshot>(
+				state -> header,
+				std::move(state -> accounts),
+				std::move(state -> offers));
+
+			std::printf("built state proof snapshot for block %" PRIu64 " in %f s\n",
+				block_number,
+				utils::measure_time(timestamp));
+
+			std::lock_guard latest_lock(latest_mtx);
+			latest = std::move(snapshot);
+		} catch (std::exception const& e) {
+			std::printf("state proof snapshot for block %" PRIu64 " failed: %s\n",
+				block_number,
+				e.what());
+		}
+
+		lock.lock();
+		building_block_number = 0;
+		cv.notify_all();
+	}
+}
+
+void
+StateProofServer::refresh(
+	SpeedexManagementStructures& management_structures,
+	HashedBlock const& header) {
+
+	uint64_t block_number = header.block.blockNumber;
+
+	auto state = std::make_unique<PendingState>();
+	state -> header = header;
+
+	management_structures.db.snapshot_persisted_accounts(
+		state -> accounts, block_number);
+	management_structures.orderbook_manager.snapshot_persisted_offers(
+		state -> offers, block_number);
+
+	std::lock_guard lock(mtx);
+	if (pending) {
+		std::printf("state proof snapshot for block %" PRIu64 " skipped for block %" PRIu64 "\n",
+			pending -> header.block.blockNumber,
+			block_number);
+	}
+	pending = std::move(state);
+	cv.notify_all();
+}
+
+} /* speedex */
@@ -0,0 +1,192 @@
+/**
+ * SPEEDEX: A Scalable, Parallelizable, and Economically Efficient Decentralized Exchange
+ * Copyright (C) 2023 Geoffrey Ramseyer
+
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#pragma once
+
+/*! \file state_proof_snapshot.h
+
+Serves inclusion (and exclusion) proofs for accounts and open offers.
+
+A StateProofSnapshot is an immutable copy of the committed state at
+one block, along with merkle trees over it (see state_proof_verifier.h
+for the tree shape).  Proofs come only from the copy, so any number
+of threads can generate proofs while blocks keep being produced.
+
+StateProofServer reads the committed state out of the lmdbs once
+they are persisted at a block (off the block production path, as
+for a state snapshot), and then sorts it and builds the trees in a
+background thread.
+
+Block headers do not commit to the roots.  The roots name the block
+they were built from (StateProofRoots.blockHash), so a client that
+does not trust the serving node can compare roots across nodes.
+*/
+
+#include "state_proofs/state_proof_verifier.h"
+
+#include "xdr/block.h"
+#include "xdr/state_proof.h"
+
+#include <utils/async_worker.h>
+
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+namespace speedex {
+
+struct SpeedexManagementStructures;
+
+namespace detail {
+
+//! Merkle tree over a fixed list of leaf hashes.
+class SortedMerkleTree {
+	// levels[0] is the leaf hashes, levels.back() is the root
+	std::vector<std::vector<Hash>> levels;
+
+public:
+
+	//! Builds the tree in parallel.
+	void build(std::vector<Hash>&& leaf_hashes);
+
+	uint64_t size() const {
+		return levels.empty() ? 0 : levels[0].size();
+	}
+
+	Hash root() const;
+
+	//! Append the hashes that state_proof::check_multiproof needs
+	//! to check the given leaves.
+	//! Leaf indices must be sorted, distinct, and less than size().
+	void make_proof(
+		std::vector<uint64_t> const& leaf_indices,
+		xdr::xvector<Hash>& out) const;
+};
+
+} /* detail */
+
+class StateProofSnapshot {
+
+	HashedBlock header;
+
+	std::vector<AccountCommitment> accounts;
+	std::vector<std::vector<Offer>> offers;
+
+	detail::SortedMerkleTree account_tree;
+	std::vector<detail::SortedMerkleTree> offer_trees;
+
+	StateProofRoots roots;
+
+public:
+
+	//! Sorts the input (if not already sorted) and builds the trees.
+	//! Throws if two entries share a key.
+	StateProofSnapshot(
+		HashedBlock const& header,
+		std::vector<AccountCommitment>&& accounts,
+		std::vector<std::vector<Offer>>&& offers);
+
+	StateProofSnapshot(const StateProofSnapshot&) = delete;
+	StateProofSnapshot& operator=(const StateProofSnapshot&) = delete;
+
+	StateProofRoots const& get_roots() const {
+		return roots;
+	}
+
+	uint64_t get_block_number() const {
+		return header.block.blockNumber;
+	}
+
+	//! Fills in \a proof for proof.owner.
+	void make_account_proof(AccountProof& proof) const;
+
+	//! Fills in \a proof for the offer key (and orderbook)
+	//! already set in \a proof.  Throws on an invalid orderbook idx.
+	void make_offer_proof(OfferProof& proof) const;
+
+	//! Fill in many proofs in parallel.
+	void make_account_proofs(std::vector<AccountProof>& proofs) const;
+	void make_offer_proofs(std::vector<OfferProof>& proofs) const;
+};
+
+class StateProofServer : public utils::AsyncWorker {
+
+	using utils::AsyncWorker::mtx;
+	using utils::AsyncWorker::cv;
+
+	struct PendingState {
+		HashedBlock header;
+		std::vector<AccountCommitment> accounts;
+		std::vector<std::vector<Offer>> offers;
+	};
+
+	std::unique_ptr<PendingState> pending;
+	//! Block number of the build in progress (0 if none).
+	uint64_t building_block_number;
+
+	mutable std::mutex latest_mtx;
+	std::shared_ptr<const StateProofSnapshot> latest;
+
+	bool exists_work_to_do() override final {
+		return (pending != nullptr) || (building_block_number != 0);
+	}
+
+	void run();
+
+public:
+
+	StateProofServer()
+		: utils::AsyncWorker()
+		, pending(nullptr)
+		, building_block_number(0)
+		, latest_mtx()
+		, latest(nullptr)
+		{
+			start_async_thread([this] {run();});
+		}
+
+	~StateProofServer() {
+		terminate_worker();
+	}
+
+	/*! Read the committed state out of the lmdbs, which must all be
+	persisted at exactly \a header (and not persist further until this
+	returns), and build a new snapshot in the background.
+
+	Never waits for a previous build.  A snapshot still waiting for a
+	running build is replaced.
+	Throws if the lmdbs are not persisted at \a header.
+	*/
+	void refresh(
+		SpeedexManagementStructures& management_structures,
+		HashedBlock const& header);
+
+	//! Most recent snapshot (nullptr if none is built yet).
+	//! The snapshot stays valid for as long as the caller holds it.
+	std::shared_ptr<const StateProofSnapshot> get_latest() const {
+		std::lock_guard lock(latest_mtx);
+		return latest;
+	}
+
+	void wait_for_refresh() {
+		wait_for_async_task();
+	}
+};
+
+} /* speedex */
@@ -0,0 +1,214 @@
+/**
+ * SPEEDEX: A Scalable, Parallelizable, and Economically Efficient Decentralized Exchange
+ * Copyright (C) 2023 Geoffrey Ramseyer
+
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "state_proofs/state_proof_verifier.h"
+
+#include <sodium.h>
+
+#include <xdrpp/marshal.h>
+
+namespace speedex {
+
+namespace state_proof {
+
+namespace {
+
+constexpr static uint8_t LEAF_TAG = 0;
+constexpr static uint8_t NODE_TAG = 1;
+
+template<typename xdr_type>
+Hash
+hash_tagged_xdr(const xdr_type& value) {
+	auto serialized = xdr::xdr_to_opaque(value);
+
+	Hash out;
+	crypto_generichash_state state;
+	crypto_generichash_init(&state, NULL, 0, out.size());
+	crypto_generichash_update(&state, &LEAF_TAG, 1);
+	crypto_generichash_update(&state, serialized.data(), serialized.size());
+	crypto_generichash_final(&state, out.data(), out.size());
+	return out;
+}
+
+} /* anonymous namespace */
+
+Hash
+leaf_hash(const AccountCommitment& account) {
+	return hash_tagged_xdr(account);
+}
+
+Hash
+leaf_hash(const Offer& offer) {
+	return hash_tagged_xdr(offer);
+}
+
+Hash
+node_hash(const Hash& left, const Hash& right) {
+	Hash out;
+	crypto_generichash_state state;
+	crypto_generichash_init(&state, NULL, 0, out.size());
+	crypto_generichash_update(&state, &NODE_TAG, 1);
+	crypto_generichash_update(&state, left.data(), left.size());
+	crypto_generichash_update(&state, right.data(), right.size());
+	crypto_generichash_final(&state, out.data(), out.size());
+	return out;
+}
+
+bool
+check_multiproof(
+	uint64_t size,
+	const Hash& root,
+	std::vector<std::pair<uint64_t, Hash>> leaves,
+	const xdr::xvector<Hash>& hashes) {
+
+	if (size == 0) {
+		return leaves.empty() && hashes.empty() && root == empty_root();
+	}
+	if (leaves.empty()) {
+		return false;
+	}
+	for (size_t i = 0; i < leaves.size(); i++) {
+		if (leaves[i].first >= size) {
+			return false;
+		}
+		if (i > 0 && leaves[i].first <= leaves[i-1].first) {
+			return false;
+		}
+	}
+
+	size_t used = 0;
+	uint64_t level_size = size;
+
+	std::vector<std::pair<uint64_t, Hash>> next;
+
+	while (level_size > 1) {
+		next.clear();
+		for (size_t i = 0; i < leaves.size(); i++) {
+			auto const& [idx, hash] = leaves[i];
+			Hash parent;
+			if (idx & 1) {
+				// a known left sibling would have consumed this node
+				if (used == hashes.size()) {
+					return false;
+				}
+				parent = node_hash(hashes[used++], hash);
+			} else if (idx + 1 == level_size) {
+				parent = hash;
+			} else if (i + 1 < leaves.size() && leaves[i+1].first == idx + 1) {
+				parent = node_hash(hash, leaves[i+1].second);
+				i++;
+			} else {
+				if (used == hashes.size()) {
+					return false;
+				}
+				parent = node_hash(hash, hashes[used++]);
+			}
+			next.emplace_back(idx >> 1, parent);
+		}
+		std::swap(leaves, next);
+		level_size = (level_size + 1) / 2;
+	}
+
+	return (used == hashes.size()) && (leaves[0].second == root);
+}
+
+} /* state_proof */
+
+namespace {
+
+template<typename Key, typename IdxList, typename LeafList, typename GetKey>
+StateProofResult
+check_sorted_proof(
+	const Key& key,
+	const IdxList& leaf_indices,
+	const LeafList& leaves,
+	const xdr::xvector<Hash>& hashes,
+	const SortedMerkleRoot& root,
+	GetKey get_key) {
+
+	if (leaf_indices.size() != leaves.size()) {
+		return StateProofResult::INVALID;
+	}
+
+	std::vector<std::pair<uint64_t, Hash>> known;
+	for (size_t i = 0; i < leaves.size(); i++) {
+		known.emplace_back(leaf_indices[i], state_proof::leaf_hash(leaves[i]));
+	}
+
+	if (!state_proof::check_multiproof(root.size, root.root, std::move(known), hashes)) {
+		return StateProofResult::INVALID;
+	}
+
+	switch(leaves.size()) {
+		case 0:
+			// tree is empty
+			return StateProofResult::ABSENT;
+		case 1: {
+			auto leaf_key = get_key(leaves[0]);
+			if (leaf_key == key) {
+				return StateProofResult::PRESENT;
+			}
+			if (leaf_indices[0] == 0 && key < leaf_key) {
+				return StateProofResult::ABSENT;
+			}
+			if (leaf_indices[0] + 1 == root.size && leaf_key < key) {
+				return StateProofResult::ABSENT;
+			}
+			return StateProofResult::INVALID;
+		}
+		case 2:
+			if (leaf_indices[1] != leaf_indices[0] + 1) {
+				return StateProofResult::INVALID;
+			}
+			if (get_key(leaves[0]) < key && key < get_key(leaves[1])) {
+				return StateProofResult::ABSENT;
+			}
+			return StateProofResult::INVALID;
+		default:
+			return StateProofResult::INVALID;
+	}
+}
+
+} /* anonymous namespace */
+
+StateProofResult
+check_account_proof(const AccountProof& proof, const StateProofRoots& roots) {
+	return check_sorted_proof(
+		proof.owner,
+		proof.leafIndices,
+		proof.leaves,
+		proof.hashes,
+		roots.accounts,
+		[] (const AccountCommitment& account) { return account.owner; });
+}
+
+StateProofResult
+check_offer_proof(const OfferProof& proof, const StateProofRoots& roots) {
+	if (proof.orderbookIdx >= roots.orderbooks.size()) {
+		return StateProofResult::INVALID;
+	}
+	return check_sorted_proof(
+		state_proof::offer_key(proof.minPrice, proof.owner, proof.offerId),
+		proof.leafIndices,
+		proof.leaves,
+		proof.hashes,
+		roots.orderbooks[proof.orderbookIdx],
+		[] (const Offer& offer) { return state_proof::offer_key(offer); });
+}
+
+} /* speedex */
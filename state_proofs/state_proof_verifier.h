@@ -0,0 +1,94 @@
+/**
+ * SPEEDEX: A Scalable, Parallelizable, and Economically Efficient Decentralized Exchange
+ * Copyright (C) 2023 Geoffrey Ramseyer
+
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#pragma once
+
+/*! \file state_proof_verifier.h
+
+Checks proofs of accounts and open offers against a StateProofRoots.
+
+Accounts (sorted by owner) and the offers of each orderbook
+(sorted by orderbook key) are each committed to in a merkle tree.
+Level k+1 of a tree pairs up adjacent nodes of level k; an odd
+node at the end of a level moves up unchanged.  Leaves and
+internal nodes are hashed with distinct one-byte tags, so a leaf
+can never be confused with an internal node.
+
+Nothing here depends on the rest of speedex, so a client can
+check proofs without running a node.
+*/
+
+#include "xdr/state_proof.h"
+
+#include <cstdint>
+#include <tuple>
+#include <utility>
+#include <vector>
+
+namespace speedex {
+
+enum class StateProofResult {
+	INVALID,
+	PRESENT,
+	ABSENT
+};
+
+namespace state_proof {
+
+Hash leaf_hash(const AccountCommitment& account);
+Hash leaf_hash(const Offer& offer);
+Hash node_hash(const Hash& left, const Hash& right);
+
+//! Root of a tree with no leaves.
+inline Hash empty_root() {
+	return Hash();
+}
+
+//! Offers sort in the same order as their orderbook trie keys
+//! (big-endian price, then owner, then offer id).
+inline std::tuple<Price, AccountID, uint64_t> 
+offer_key(Price min_price, AccountID owner, uint64_t offer_id) {
+	return {min_price, owner, offer_id};
+}
+
+inline std::tuple<Price, AccountID, uint64_t> 
+offer_key(const Offer& offer) {
+	return offer_key(offer.minPrice, offer.owner, offer.offerId);
+}
+
+/*! Check that the given leaves (index, leaf hash) are in the tree
+with \a size leaves and root \a root.
+Indices must be sorted and distinct.  \a hashes are the sibling hashes
+that the leaves do not determine, in the order that they are needed
+going up the tree (left to right within a level).
+*/
+bool check_multiproof(
+	uint64_t size,
+	const Hash& root,
+	std::vector<std::pair<uint64_t, Hash>> leaves,
+	const xdr::xvector<Hash>& hashes);
+
+} /* state_proof */
+
+StateProofResult
+check_account_proof(const AccountProof& proof, const StateProofRoots& roots);
+
+StateProofResult
+check_offer_proof(const OfferProof& proof, const StateProofRoots& roots);
+
+} /* speedex */
@@ -0,0 +1,280 @@
+#include <catch2/catch_test_macros.hpp>
+
+#include "speedex/speedex_management_structures.h"
+
+#include "state_proofs/state_proof_snapshot.h"
+#include "state_proofs/state_proof_verifier.h"
+
+#include "utils/manage_data_dirs.h"
+
+#include "xdr/state_proof.h"
+
+#include <cstdint>
+#include <vector>
+
+namespace speedex {
+
+namespace {
+
+AccountCommitment make_account(AccountID owner, uint64_t amount) {
+	AccountCommitment out;
+	out.owner = owner;
+	out.assets.push_back(AssetCommitment(0, amount));
+	out.last_committed_id = owner;
+	return out;
+}
+
+Offer make_offer(Price min_price, AccountID owner, uint64_t offer_id) {
+	Offer out;
+	out.category.type = OfferType::SELL;
+	out.category.sellAsset = 0;
+	out.category.buyAsset = 1;
+	out.offerId = offer_id;
+	out.owner = owner;
+	out.amount = 100;
+	out.minPrice = min_price;
+	return out;
+}
+
+HashedBlock make_header(uint64_t block_number) {
+	HashedBlock out;
+	out.block.blockNumber = block_number;
+	out.hash[0] = 1;
+	return out;
+}
+
+AccountProof account_query(AccountID owner) {
+	AccountProof out;
+	out.owner = owner;
+	return out;
+}
+
+OfferProof offer_query(uint32_t orderbook_idx, Price min_price, AccountID owner, uint64_t offer_id) {
+	OfferProof out;
+	out.orderbookIdx = orderbook_idx;
+	out.minPrice = min_price;
+	out.owner = owner;
+	out.offerId = offer_id;
+	return out;
+}
+
+} /* anonymous namespace */
+
+TEST_CASE("sorted merkle multiproofs", "[state_proof]")
+{
+	for (uint64_t size : {1, 2, 3, 5, 8, 13, 100}) {
+		std::vector<Hash> leaves(size);
+		for (uint64_t i = 0; i < size; i++) {
+			leaves[i][0] = i;
+			leaves[i][1] = 7;
+		}
+
+		detail::SortedMerkleTree tree;
+		tree.build(std::vector<Hash>(leaves));
+
+		REQUIRE(tree.size() == size);
+
+		for (uint64_t i = 0; i < size; i++) {
+			for (uint64_t j = i; j < size && j < i + 3; j++) {
+				std::vector<uint64_t> indices = {i};
+				if (j != i) {
+					indices.push_back(j);
+				}
+
+				xdr::xvector<Hash> hashes;
+				tree.make_proof(indices, hashes);
+
+				std::vector<std::pair<uint64_t, Hash>> known;
+				for (auto idx : indices) {
+					known.emplace_back(idx, leaves[idx]);
+				}
+
+				REQUIRE(state_proof::check_multiproof(size, tree.root(), known, hashes));
+
+				known[0].second[2] ^= 1;
+				REQUIRE(!state_proof::check_multiproof(size, tree.root(), known, hashes));
+			}
+		}
+	}
+}
+
+TEST_CASE("account proofs", "[state_proof]")
+{
+	std::vector<AccountCommitment> accounts;
+	// out of order, to check sorting
+	for (AccountID owner = 20; owner > 0; owner -= 2) {
+		accounts.push_back(make_account(owner, owner * 10));
+	}
+
+	StateProofSnapshot snapshot(make_header(5), std::move(accounts), {});
+
+	auto const& roots = snapshot.get_roots();
+	REQUIRE(roots.blockNumber == 5);
+	REQUIRE(roots.accounts.size == 10);
+
+	SECTION("present")
+	{
+		auto proof = account_query(8);
+		snapshot.make_account_proof(proof);
+		REQUIRE(check_account_proof(proof, roots) == StateProofResult::PRESENT);
+		REQUIRE(proof.leaves.size() == 1);
+		REQUIRE(proof.leaves[0].assets[0].amount_available == 80);
+	}
+
+	SECTION("absent")
+	{
+		for (AccountID owner : {1, 9, 21}) {
+			auto proof = account_query(owner);
+			snapshot.make_account_proof(proof);
+			REQUIRE(check_account_proof(proof, roots) == StateProofResult::ABSENT);
+		}
+	}
+
+	SECTION("tampered balance")
+	{
+		auto proof = account_query(8);
+		snapshot.make_account_proof(proof);
+		proof.leaves[0].assets[0].amount_available = 1000;
+		REQUIRE(check_account_proof(proof, roots) == StateProofResult::INVALID);
+	}
+
+	SECTION("present account claimed absent")
+	{
+		// neighbors of 8 are not adjacent
+		auto proof = account_query(7);
+		snapshot.make_account_proof(proof);
+		auto proof2 = account_query(9);
+		snapshot.make_account_proof(proof2);
+
+		AccountProof bad = account_query(8);
+		bad.leafIndices = {proof.leafIndices[0], proof2.leafIndices[1]};
+		bad.leaves = {proof.leaves[0], proof2.leaves[1]};
+		REQUIRE(check_account_proof(bad, roots) == StateProofResult::INVALID);
+
+		// an absence proof for 7 does not work for 8
+		proof.owner = 8;
+		REQUIRE(check_account_proof(proof, roots) == StateProofResult::INVALID);
+	}
+
+	SECTION("batched")
+	{
+		std::vector<AccountProof> proofs;
+		for (AccountID owner = 0; owner < 25; owner++) {
+			proofs.push_back(account_query(owner));
+		}
+		snapshot.make_account_proofs(proofs);
+		for (auto const& proof : proofs) {
+			auto expect = (proof.owner % 2 == 0 && proof.owner > 0 && proof.owner <= 20)
+				? StateProofResult::PRESENT
+				: StateProofResult::ABSENT;
+			REQUIRE(check_account_proof(proof, roots) == expect);
+		}
+	}
+}
+
+TEST_CASE("offer proofs", "[state_proof]")
+{
+	std::vector<std::vector<Offer>> offers(2);
+	offers[0].push_back(make_offer(300, 1, 5));
+	offers[0].push_back(make_offer(100, 2, 7));
+	offers[0].push_back(make_offer(100, 1, 9));
+	// orderbook 1 stays empty
+
+	StateProofSnapshot snapshot(make_header(3), {}, std::move(offers));
+	auto const& roots = snapshot.get_roots();
+
+	REQUIRE(roots.orderbooks.size() == 2);
+	REQUIRE(roots.orderbooks[0].size == 3);
+	REQUIRE(roots.orderbooks[1].size == 0);
+
+	std::vector<OfferProof> proofs = {
+		offer_query(0, 100, 1, 9),
+		offer_query(0, 300, 1, 5),
+		offer_query(0, 100, 1, 10),
+		offer_query(0, 200, 0, 0),
+		offer_query(1, 100, 1, 9)
+	};
+
+	snapshot.make_offer_proofs(proofs);
+
+	REQUIRE(check_offer_proof(proofs[0], roots) == StateProofResult::PRESENT);
+	REQUIRE(check_offer_proof(proofs[1], roots) == StateProofResult::PRESENT);
+	REQUIRE(check_offer_proof(proofs[2], roots) == StateProofResult::ABSENT);
+	REQUIRE(check_offer_proof(proofs[3], roots) == StateProofResult::ABSENT);
+	REQUIRE(check_offer_proof(proofs[4], roots) == StateProofResult::ABSENT);
+
+	// a proof for one orderbook does not carry over to another
+	proofs[0].orderbookIdx = 1;
+	REQUIRE(check_offer_proof(proofs[0], roots) == StateProofResult::INVALID);
+
+	auto bad_idx = offer_query(2, 100, 1, 9);
+	REQUIRE_THROWS(snapshot.make_offer_proof(bad_idx));
+}
+
+TEST_CASE("duplicate accounts rejected", "[state_proof]")
+{
+	std::vector<AccountCommitment> accounts;
+	accounts.push_back(make_account(1, 10));
+	accounts.push_back(make_account(1, 20));
+
+	REQUIRE_THROWS(StateProofSnapshot(make_header(1), std::move(accounts), {}));
+}
+
+TEST_CASE("state proof server builds from persisted state", "[state_proof]")
+{
+	constexpr uint64_t round = 4;
+
+	test::speedex_dirs s;
+
+	SpeedexManagementStructures management_structures(
+		2,
+		ApproximationParameters{
+			.tax_rate = 10,
+			.smooth_mult = 10
+		},
+		SpeedexRuntimeConfigs{
+			.check_sigs = false
+		});
+
+	management_structures.open_lmdb_env();
+	management_structures.create_lmdb();
+
+	auto& db = management_structures.db;
+
+	MemoryDatabaseGenesisData data;
+	for (AccountID i = 0; i < 100; i++)
+	{
+		data.id_list.push_back(i);
+	}
+	data.pk_list.resize(data.id_list.size());
+
+	db.install_initial_accounts_and_commit(data, [&db] (UserAccount& user) {
+		db.transfer_available(&user, 0, 100 + user.get_owner());
+		user.commit();
+	});
+
+	db.persist_lmdb(round);
+	management_structures.orderbook_manager.persist_lmdb_after_snapshot(round);
+
+	StateProofServer server;
+
+	REQUIRE(!server.get_latest());
+
+	server.refresh(management_structures, make_header(round));
+	server.wait_for_refresh();
+
+	auto snapshot = server.get_latest();
+	REQUIRE(snapshot);
+	REQUIRE(snapshot->get_block_number() == round);
+	REQUIRE(snapshot->get_roots().accounts.size == 100);
+
+	SECTION("unpersisted round")
+	{
+		REQUIRE_THROWS(server.refresh(management_structures, make_header(2 * round)));
+
+		server.wait_for_refresh();
+		REQUIRE(server.get_latest() == snapshot);
+	}
+}
+
+} /* speedex */
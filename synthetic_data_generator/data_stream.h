@@ -70,4 +70,45 @@ public:
 
 };
 
+/*! Mock txs where a fraction of each buffer is the same on every
+stream (i.e. submitted to every replica), and the rest are unique to
+this stream.  Txs differ by source account and sequence number.
+*/
+class OverlappingMockDataStream : public DataStream {
+	const uint64_t stream_id;
+	const size_t num_shared;
+	size_t count;
+
+	constexpr static size_t BUFFER_SIZE = 100'000;
+
+public:
+
+	OverlappingMockDataStream(uint64_t stream_id, double shared_fraction)
+		: stream_id(stream_id)
+		, num_shared(BUFFER_SIZE * shared_fraction)
+		, count(0)
+		{}
+
+	DataBuffer
+	load_txs_unparsed() override final {
+		ExperimentBlock block;
+		block.resize(BUFFER_SIZE);
+
+		count++;
+
+		for (size_t i = 0; i < BUFFER_SIZE; i++) {
+			auto& metadata = block[i].transaction.metadata;
+			// account 0 is shared, stream k uses account k + 1
+			metadata.sourceAccount = (i < num_shared) ? 0 : stream_id + 1;
+			metadata.sequenceNumber = (static_cast<uint64_t>(count) << 32) + i;
+		}
+
+		std::shared_ptr<xdr::opaque_vec<>> v = std::make_shared<xdr::opaque_vec<>>();
+
+		*v = xdr::xdr_to_opaque(block);
+
+		return DataBuffer{BUFFER_SIZE, v, count, false};
+	}
+};
+
 } /* speedex */
@@ -0,0 +1,196 @@
+/**
+ * SPEEDEX: A Scalable, Parallelizable, and Economically Efficient Decentralized Exchange
+ * Copyright (C) 2023 Geoffrey Ramseyer
+
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#pragma once
+
+/*! \file inline_probing_map.h
+
+Small hash map that stores its first N entries inline (linear probing
+over a fixed array), and spills any further entries to an
+std::unordered_map.
+
+Meant for per-transaction scratch state, which almost always has
+one or two entries: building, filling, and destroying one makes no
+heap allocations unless it spills.
+
+Entries are never moved once inserted, so references to values
+stay valid until clear() or destruction.
+*/
+
+#include <bit>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <new>
+#include <type_traits>
+#include <unordered_map>
+#include <utility>
+
+namespace speedex {
+
+template<typename K, typename V, size_t N, typename Hash = std::hash<K>>
+class InlineProbingMap {
+
+	static_assert(N > 0 && N <= 64 && std::has_single_bit(N), 
+		"inline capacity must be a power of 2, at most 64");
+	static_assert(std::is_trivially_copyable<K>::value, 
+		"keys are stored uninitialized");
+
+	constexpr static uint32_t LOG_N = std::countr_zero(N);
+
+	struct alignas(V) ValueStorage {
+		unsigned char bytes[sizeof(V)];
+	};
+
+	K keys[N];
+	ValueStorage values[N];
+	uint64_t occupied;
+
+	std::unordered_map<K, V, Hash> spill;
+
+	static size_t home_slot(K const& key) {
+		if constexpr (N == 1) {
+			return 0;
+		} else {
+			// Fibonacci hashing, since std::hash is often the identity
+			// (and pointer keys have zero low bits)
+			uint64_t h = static_cast<uint64_t>(Hash{}(key)) * 0x9E37'79B9'7F4A'7C15;
+			return h >> (64 - LOG_N);
+		}
+	}
+
+	bool is_occupied(size_t slot) const {
+		return (occupied >> slot) & 1;
+	}
+
+	V& value_at(size_t slot) {
+		return *std::launder(reinterpret_cast<V*>(values[slot].bytes));
+	}
+
+	// slot holding key, or N if absent from the inline array
+	size_t find_slot(K const& key) const {
+		size_t slot = home_slot(key);
+		for (size_t i = 0; i < N; i++) {
+			if (!is_occupied(slot)) {
+				// no deletions, so the probe sequence ends here
+				return N;
+			}
+			if (keys[slot] == key) {
+				return slot;
+			}
+			slot = (slot + 1) & (N - 1);
+		}
+		return N;
+	}
+
+public:
+
+	InlineProbingMap()
+		: occupied(0)
+		, spill()
+		{}
+
+	InlineProbingMap(InlineProbingMap const&) = delete;
+	InlineProbingMap& operator=(InlineProbingMap const&) = delete;
+	InlineProbingMap(InlineProbingMap&&) = delete;
+	InlineProbingMap& operator=(InlineProbingMap&&) = delete;
+
+	~InlineProbingMap() {
+		clear();
+	}
+
+	//! nullptr if absent.
+	V* find(K const& key) {
+		size_t slot = find_slot(key);
+		if (slot < N) {
+			return &value_at(slot);
+		}
+		if (spill.empty()) {
+			return nullptr;
+		}
+		auto it = spill.find(key);
+		if (it == spill.end()) {
+			return nullptr;
+		}
+		return &(it -> second);
+	}
+
+	//! Value for key, constructed from args if absent.
+	template<typename... Args>
+	V& try_emplace(K const& key, Args&&... args) {
+		size_t slot = home_slot(key);
+		for (size_t i = 0; i < N; i++) {
+			if (!is_occupied(slot)) {
+				keys[slot] = key;
+				new (values[slot].bytes) V(std::forward<Args>(args)...);
+				occupied |= (UINT64_C(1) << slot);
+				return value_at(slot);
+			}
+			if (keys[slot] == key) {
+				return value_at(slot);
+			}
+			slot = (slot + 1) & (N - 1);
+		}
+		// inline array is full
+		return spill.try_emplace(key, std::forward<Args>(args)...).first -> second;
+	}
+
+	V& operator[](K const& key) {
+		return try_emplace(key);
+	}
+
+	//! Calls f(key, value) on every entry, in no particular order.
+	template<typename F>
+	void for_each(F&& f) {
+		for (size_t slot = 0; slot < N; slot++) {
+			if (is_occupied(slot)) {
+				f(keys[slot], value_at(slot));
+			}
+		}
+		for (auto& [k, v] : spill) {
+			f(k, v);
+		}
+	}
+
+	size_t size() const {
+		return std::popcount(occupied) + spill.size();
+	}
+
+	bool empty() const {
+		return size() == 0;
+	}
+
+	//! Whether any entry did not fit inline.
+	bool spilled() const {
+		return !spill.empty();
+	}
+
+	void clear() {
+		if constexpr (!std::is_trivially_destructible<V>::value) {
+			for (size_t slot = 0; slot < N; slot++) {
+				if (is_occupied(slot)) {
+					value_at(slot).~V();
+				}
+			}
+		}
+		occupied = 0;
+		spill.clear();
+	}
+};
+
+} /* speedex */
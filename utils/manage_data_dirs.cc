@@ -23,6 +23,10 @@
 #include <filesystem>
 #include <system_error>
 
+#include <fcntl.h>
+#include <stdio.h>
+#include <unistd.h>
+
 #include "config.h"
 
 #include <utils/mkdir.h>
@@ -60,22 +64,13 @@ std::string memory_database_lmdb_dir() {
 	return std::string(ROOT_DB_DIRECTORY) + std::string(ACCOUNT_DB);
 }
 
-std::string memory_database_lmdb_shard_dir(uint32_t shard)
-{
-	return memory_database_lmdb_dir() + std::to_string(shard) + "/";
-}
-
+//! Shard directories are made by each shard when it opens, so that
+//! there are as many as the db's stored shard count.
 void
 make_memory_database_lmdb_dir() {
 	mkdir_safe(ROOT_DB_DIRECTORY);
 	auto path = memory_database_lmdb_dir();
 	mkdir_safe(path.c_str());
-
-	for (uint32_t shard = 0; shard < NUM_ACCOUNT_DB_SHARDS; shard++)
-	{
-		path = memory_database_lmdb_shard_dir(shard);
-		mkdir_safe(path.c_str());
-	}
 }
 
 void
@@ -88,6 +83,93 @@ clear_memory_database_lmdb_dir() {
 	}
 }
 
+std::string memory_database_lmdb_staging_dir() {
+	return std::string(ROOT_DB_DIRECTORY) + "staging_" + std::string(ACCOUNT_DB);
+}
+
+void
+clear_memory_database_lmdb_staging_dir() {
+	auto path = memory_database_lmdb_staging_dir();
+	std::error_code ec;
+	std::filesystem::remove_all({path}, ec);
+	if (ec) {
+		throw std::runtime_error("failed to clear memory_database staging dir");
+	}
+}
+
+namespace {
+
+std::string
+without_trailing_slash(std::string path) {
+	while (path.size() > 1 && path.back() == '/') {
+		path.pop_back();
+	}
+	return path;
+}
+
+//! Makes renames within the root db directory durable.
+void
+fsync_root_db_directory() {
+	int fd = open(ROOT_DB_DIRECTORY, O_RDONLY | O_DIRECTORY);
+	if (fd < 0) {
+		throw std::runtime_error("failed to open root db dir");
+	}
+	int res = fsync(fd);
+	close(fd);
+	if (res != 0) {
+		throw std::runtime_error("failed to fsync root db dir");
+	}
+}
+
+//! Where an earlier version of reshard() moved the main dir aside.
+std::string
+memory_database_lmdb_old_dir() {
+	return without_trailing_slash(memory_database_lmdb_dir()) + "_old/";
+}
+
+} /* anonymous namespace */
+
+void
+swap_in_memory_database_lmdb_staging_dir() {
+	auto main_dir = without_trailing_slash(memory_database_lmdb_dir());
+	auto staging_dir = without_trailing_slash(memory_database_lmdb_staging_dir());
+
+	// A single atomic rename: either directory is always a complete db.
+	if (renameat2(AT_FDCWD, staging_dir.c_str(), AT_FDCWD, main_dir.c_str(), RENAME_EXCHANGE) != 0) {
+		throw std::runtime_error("failed to swap in staged memory_database dir");
+	}
+	fsync_root_db_directory();
+
+	// now holds the old db
+	clear_memory_database_lmdb_staging_dir();
+}
+
+void
+recover_memory_database_lmdb_dirs() {
+	// Whether or not the swap happened, the main dir is complete,
+	// and the staging dir is either unfinished or the old db.
+	clear_memory_database_lmdb_staging_dir();
+
+	auto old_dir = memory_database_lmdb_old_dir();
+	if (!std::filesystem::exists(old_dir)) {
+		return;
+	}
+
+	if (!std::filesystem::exists(memory_database_lmdb_dir())) {
+		// crashed between moving the main dir aside and moving
+		// the staging dir in, so the old db is still the current one
+		std::filesystem::rename(old_dir, memory_database_lmdb_dir());
+		fsync_root_db_directory();
+		return;
+	}
+
+	std::error_code ec;
+	std::filesystem::remove_all(old_dir, ec);
+	if (ec) {
+		throw std::runtime_error("failed to clear pre-reshard memory_database dir");
+	}
+}
+
 std::string orderbook_lmdb_dir() {
 	return std::string(ROOT_DB_DIRECTORY) + std::string(OFFER_DB);
 }
@@ -131,6 +213,34 @@ clear_header_hash_lmdb_dir() {
 	}
 }
 
+std::string
+state_snapshot_dir() {
+	return std::string(ROOT_DB_DIRECTORY) + std::string(SNAPSHOT_DB);
+}
+
+std::string
+state_snapshot_dir(uint64_t block_number) {
+	return state_snapshot_dir() + std::to_string(block_number) + "/";
+}
+
+void
+make_state_snapshot_dir(uint64_t block_number) {
+	mkdir_safe(ROOT_DB_DIRECTORY);
+	mkdir_safe(state_snapshot_dir().c_str());
+	auto path = state_snapshot_dir(block_number);
+	mkdir_safe(path.c_str());
+}
+
+void
+clear_state_snapshot_dir(uint64_t block_number) {
+	auto path = state_snapshot_dir(block_number);
+	std::error_code ec;
+	std::filesystem::remove_all({path}, ec);
+	if (ec) {
+		throw std::runtime_error("failed to clear state snapshot dir");
+	}
+}
+
 void clear_all_data_dirs(const hotstuff::ReplicaInfo& info) {
 	clear_log_dir();
 	clear_memory_database_lmdb_dir();
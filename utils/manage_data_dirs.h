@@ -18,6 +18,7 @@
 
 #pragma once
 
+#include <cstdint>
 #include <string>
 
 namespace hotstuff
@@ -34,6 +35,18 @@ void
 make_memory_database_lmdb_dir();
 void
 clear_memory_database_lmdb_dir();
+//! Where AccountLMDB::reshard() builds the resharded database.
+std::string memory_database_lmdb_staging_dir();
+void
+clear_memory_database_lmdb_staging_dir();
+//! Atomically exchange the staging and main dirs (the main dir must
+//! be closed), and then remove the old db.
+void
+swap_in_memory_database_lmdb_staging_dir();
+//! Clean up after a reshard that was interrupted by a crash.
+//! Call before opening the account db.
+void
+recover_memory_database_lmdb_dirs();
 
 std::string orderbook_lmdb_dir();
 void
@@ -47,6 +60,13 @@ make_header_hash_lmdb_dir();
 void
 clear_header_hash_lmdb_dir();
 
+std::string state_snapshot_dir();
+std::string state_snapshot_dir(uint64_t block_number);
+void
+make_state_snapshot_dir(uint64_t block_number);
+void
+clear_state_snapshot_dir(uint64_t block_number);
+
 void clear_all_data_dirs(const hotstuff::ReplicaInfo&);
 void make_all_data_dirs(const hotstuff::ReplicaInfo&);
 
@@ -23,11 +23,24 @@
 
 	Prices stored using PRICE_BYTES many bytes.  The real value signified
 	(by the underlying integral value) is 2^(value) / 2^(PRICE_RADIX).
+
+	These run in the inner loops of Tatonnement and clearing, so the
+	kernels here avoid per-byte loops and data-dependent branches where
+	that is possible without changing any output bit.  Functions are
+	constexpr where the operation allows it (byte encodings fall back
+	to the portable loop during constant evaluation).
 	
 */
 
+#include <algorithm>
+#include <array>
+#include <bit>
 #include <concepts>
 #include <cmath>
+#include <cstring>
+#include <stdexcept>
+#include <type_traits>
+
 #include "xdr/types.h"
 
 
@@ -62,87 +75,131 @@ static_assert(PRICE_RADIX % 4 == 0,
 //! The price value that corresponds to a double 1.0.
 constexpr static Price PRICE_ONE = ((uint64_t)1)<<PRICE_RADIX;
 
+//! 2^-PRICE_RADIX.  Multiplying by an exact power of two
+//! is bit-identical to dividing by its inverse, and much cheaper.
+constexpr static double PRICE_INV_SCALE = 1.0 / (double) PRICE_ONE;
+
 //! Fixed-point representation of a price to double representation
-inline static double 
+constexpr inline static double 
 to_double(const Price& price) {
-	return (double)price / (double) ((uint64_t)1<<PRICE_RADIX);
+	return (double)price * PRICE_INV_SCALE;
 }
 
 [[maybe_unused]]
-inline static double
+constexpr inline static double
 amount_times_price_to_double(const uint128_t& amount_times_price)
 {
-	return ((double) amount_times_price) /  ((double) ((uint64_t)1<<PRICE_RADIX));
+	return ((double) amount_times_price) * PRICE_INV_SCALE;
 }
 
 //! Double representation of a price to a fixed-point representation
 //! (rounding away the low bits from the double).
-inline static Price 
+constexpr inline static Price 
 from_double(const double price_d) {
 	return (uint64_t)(price_d * (((uint64_t)1)<<PRICE_RADIX));
 }
 
-//! Writes a price (in big endian) to \a buf.
-//! Uses PRICE_BYTES bytes in buf.
-template<typename ArrayType>
-inline static void 
-write_price_big_endian(ArrayType& buf, const Price& price) {
+namespace detail {
 
+//! Byte-at-a-time encoding, used during constant evaluation
+//! and on big-endian hosts.
+constexpr inline static void
+write_price_big_endian_bytewise(unsigned char* buf, const Price& price) {
 	for (uint8_t loc = 0; loc < PRICE_BYTES; loc++) {
 		uint8_t offset = ((PRICE_BYTES - loc - 1) * 8);
-		buf.at(loc) = (price >> offset) & 0xFF;
+		buf[loc] = (price >> offset) & 0xFF;
+	}
+}
+
+constexpr inline static Price
+read_price_big_endian_bytewise(const unsigned char* buf) {
+	Price p = 0;
+	for (uint8_t loc = 0; loc < PRICE_BYTES; loc++) {
+		p <<=8;
+		p += buf[loc];
 	}
+	return p;
 }
 
+//! Number of unused high bytes in a uint64_t holding a price.
+constexpr static uint8_t PRICE_PAD_BITS = (sizeof(uint64_t) - PRICE_BYTES) * 8;
+
+} /* detail */
+
 //! Writes a price (in big endian) to \a buf.
 //! Overwrites from buf to buf + (PRICE_BYTES -1), inclusive.
-inline static void 
+//! As before, only the low PRICE_BIT_LEN bits of price are written.
+constexpr inline static void 
 write_price_big_endian(unsigned char* buf, const Price& price) {
+	if constexpr (std::endian::native == std::endian::little) {
+		if (!std::is_constant_evaluated()) {
+			// shift the price bytes to the top, so that after
+			// the byteswap they are the first PRICE_BYTES bytes.
+			uint64_t swapped = __builtin_bswap64(price << detail::PRICE_PAD_BITS);
+			std::memcpy(buf, &swapped, PRICE_BYTES);
+			return;
+		}
+	}
+	detail::write_price_big_endian_bytewise(buf, price);
+}
+
+//! Writes a price (in big endian) to \a buf.
+template<size_t ARRAY_LEN>
+constexpr inline static void
+write_price_big_endian(std::array<unsigned char, ARRAY_LEN>& buf, const Price& price) {
+	static_assert(ARRAY_LEN >= PRICE_BYTES, "not enough bytes to write price");
+	write_price_big_endian(buf.data(), price);
+}
+
+//! Writes a price (in big endian) to \a buf.
+//! Uses PRICE_BYTES bytes in buf.
+template<typename ArrayType>
+inline static void 
+write_price_big_endian(ArrayType& buf, const Price& price) {
+
 	for (uint8_t loc = 0; loc < PRICE_BYTES; loc++) {
 		uint8_t offset = ((PRICE_BYTES - loc - 1) * 8);
-		buf[loc] = (price >> offset) & 0xFF;
+		buf.at(loc) = (price >> offset) & 0xFF;
 	}
 }
 
 //! Constrains a uint128 value to lie between 1 and MAX_PRICE.
 //! Does not do any radix conversions.
-inline static Price 
+//! Branch-free (both selects compile to conditional moves).
+constexpr inline static Price 
 impose_price_bounds(const uint128_t& val) {
-	if (val > MAX_PRICE) {
-		return MAX_PRICE;
-	}
-	if (val == 0) {
-		return 1;
-	}
-	return val;
+	Price clamped = ((val >> PRICE_BIT_LEN) != 0) ? MAX_PRICE : (Price) val;
+	return clamped + (clamped == 0);
 }
 
 //! Checks whether the input is within the bounds of a valid
 //! price value.
-inline static bool 
+constexpr inline static bool 
 is_valid_price(const Price& price) {
 	return price <= MAX_PRICE && price != 0;
 }
 
+//! Read in price from array, which should be in big-endian format.
+constexpr inline static Price 
+read_price_big_endian(const unsigned char* buf) {
+	if constexpr (std::endian::native == std::endian::little) {
+		if (!std::is_constant_evaluated()) {
+			uint64_t raw = 0;
+			std::memcpy(&raw, buf, PRICE_BYTES);
+			return __builtin_bswap64(raw) >> detail::PRICE_PAD_BITS;
+		}
+	}
+	return detail::read_price_big_endian_bytewise(buf);
+}
+
 //! Read in price from array, which should be in a big-endian format.
 template<size_t ARRAY_LEN>
-inline static Price 
+constexpr inline static Price 
 read_price_big_endian(const std::array<unsigned char, ARRAY_LEN>& buf) {
 	static_assert(ARRAY_LEN >= PRICE_BYTES, "not enough bytes to read price");
 	return read_price_big_endian(buf.data());
 }
 
-//! Read in price from array, which should be in big-endian format.
-inline static Price 
-read_price_big_endian(const unsigned char* buf) {
-	Price p = 0;
-	for (uint8_t loc = 0; loc < PRICE_BYTES; loc++) {
-		p <<=8;
-		p += buf[loc];
-	}
-	return p;
-}
-
 //! Read in price from an array, which should be in big-endian format.
 //! Should work with any type that has an operator[] and accepts
 //! operator[0] through operator[PRICE_BYTES - 1]
@@ -177,28 +234,28 @@ tax_to_double(const uint8_t tax_rate) {
 
 
 //! subtract 1/2^smooth_mult
-inline static Price 
+constexpr inline static Price 
 smooth_mult(const Price& price, const uint8_t smooth_mult) {
 	return (price - (price>>smooth_mult));
 }
 
 //! Decide if price a / price b <= price c.
 //! Save from overflows.
-inline static bool 
+constexpr inline static bool 
 a_over_b_leq_c(const Price& a, const Price& b, const Price& c) {
 	return (((uint128_t)a)<<PRICE_RADIX) <= ((uint128_t) b) * ((uint128_t) c);
 }
 
 //! Decide if price a / price b < price c.
 //! Save from overflows.
-inline static bool 
+constexpr inline static bool 
 a_over_b_lt_c(const Price& a, const Price& b, const Price &c) {
 	return (((uint128_t)a)<<PRICE_RADIX) < ((uint128_t) b) * ((uint128_t) c);
 }
 
 //! Multiply some value by price a / price b.  Save from overflows on the
 //! multiplication, assuming the result can fit into a 128 bit output.
-inline static uint128_t 
+constexpr inline static uint128_t 
 wide_multiply_val_by_a_over_b(
 	const uint128_t value, const Price& a, const Price& b) 
 {
@@ -209,29 +266,27 @@ wide_multiply_val_by_a_over_b(
 	return modulo + remainder;
 }
 
-//! it's not 100% accurate - there's some carries that get lost, but ah well.
-//! Only use case is computing volume heuristics for Tatonnement,
-//! so small errors are not a problem.
-inline static Price 
-safe_multiply_and_drop_lowbits(
+namespace detail {
+
+//! Body of safe_multiply_and_drop_lowbits, without the range check
+//! on lowbits_to_drop (callers must ensure it lies in [64, 196]).
+constexpr inline static Price 
+multiply_and_drop_lowbits_unchecked(
 	const uint128_t& first, 
 	const uint128_t& second, 
 	const uint64_t& lowbits_to_drop) {
 
-	if (lowbits_to_drop < 64 || lowbits_to_drop > 196) {
-		throw std::runtime_error("unimplemented");
-	}
-
-	uint128_t first_low = first & UINT64_MAX;
-	uint128_t first_high = (first >> 64) & UINT64_MAX;
-	uint128_t second_low = second & UINT64_MAX;
-	uint128_t second_high = (second >> 64) & UINT64_MAX;
+	// 64x64->128 bit multiplies (one mul instruction each on x86-64)
+	uint64_t first_low = first;
+	uint64_t first_high = first >> 64;
+	uint64_t second_low = second;
+	uint64_t second_high = second >> 64;
 
-	uint128_t low_low = first_low * second_low;
+	uint128_t low_low = ((uint128_t) first_low) * second_low;
 
-	uint128_t low_high = first_low * second_high;
-	uint128_t high_low = first_high * second_low;
-	uint128_t high_high = first_high * second_high;
+	uint128_t low_high = ((uint128_t) first_low) * second_high;
+	uint128_t high_low = ((uint128_t) first_high) * second_low;
+	uint128_t high_high = ((uint128_t) first_high) * second_high;
 
 	uint128_t out = 0;
 
@@ -272,8 +327,114 @@ safe_multiply_and_drop_lowbits(
 	return out;
 }
 
+constexpr inline static void
+check_lowbits_to_drop(const uint64_t& lowbits_to_drop) {
+	if (lowbits_to_drop < 64 || lowbits_to_drop > 196) {
+		throw std::runtime_error("unimplemented");
+	}
+}
+
+} /* detail */
+
+//! it's not 100% accurate - there's some carries that get lost, but ah well.
+//! Only use case is computing volume heuristics for Tatonnement,
+//! so small errors are not a problem.
+constexpr inline static Price 
+safe_multiply_and_drop_lowbits(
+	const uint128_t& first, 
+	const uint128_t& second, 
+	const uint64_t& lowbits_to_drop) {
+
+	detail::check_lowbits_to_drop(lowbits_to_drop);
+	return detail::multiply_and_drop_lowbits_unchecked(first, second, lowbits_to_drop);
+}
+
+//! Batch version of safe_multiply_and_drop_lowbits:
+//! out[i] = safe_multiply_and_drop_lowbits(first[i], second[i], lowbits_to_drop).
+//! The range check runs once per batch, and lowbits_to_drop is loop
+//! invariant, so the compiler can unswitch the shift-dependent branches.
+constexpr inline static void
+batch_safe_multiply_and_drop_lowbits(
+	const uint128_t* first,
+	const uint128_t* second,
+	Price* out,
+	const size_t count,
+	const uint64_t lowbits_to_drop) {
+
+	detail::check_lowbits_to_drop(lowbits_to_drop);
+	for (size_t i = 0; i < count; i++) {
+		out[i] = detail::multiply_and_drop_lowbits_unchecked(first[i], second[i], lowbits_to_drop);
+	}
+}
+
+//! Batch version of impose_price_bounds: out[i] = impose_price_bounds(vals[i]).
+constexpr inline static void
+batch_impose_price_bounds(const uint128_t* vals, Price* out, const size_t count) {
+	for (size_t i = 0; i < count; i++) {
+		out[i] = impose_price_bounds(vals[i]);
+	}
+}
+
+/*! One Tatonnement price update step, over count assets.
+
+	For each asset, the price moves by
+	(step * p) * (relativizer * |demand - supply| [* p]) >> lowbits_to_drop,
+	upwards (bounded by MAX_PRICE) when demand exceeds supply,
+	and downwards (but not below 1) otherwise.  The extra factor of p is
+	applied when scale_diff_by_price is set.
+
+	Output is identical to calling safe_multiply_and_drop_lowbits and
+	impose_price_bounds per asset, but the range check on lowbits_to_drop
+	runs once per call instead of once per asset.
+
+	Returns true if any price changed.
+*/
+template<bool scale_diff_by_price>
+constexpr inline static bool
+batch_update_trial_prices(
+	const Price* old_prices,
+	Price* new_prices,
+	const uint128_t* demands,
+	const uint128_t* supplies,
+	const uint16_t* relativizers,
+	const size_t count,
+	const uint64_t step,
+	const uint64_t lowbits_to_drop) {
+
+	detail::check_lowbits_to_drop(lowbits_to_drop);
+
+	bool changed = false;
+
+	for (size_t i = 0; i < count; i++) {
+		const Price old_price = old_prices[i];
+		const bool raise = demands[i] > supplies[i];
+		const uint128_t diff = raise
+			? demands[i] - supplies[i]
+			: supplies[i] - demands[i];
+
+		const uint128_t p_times_step = ((uint128_t)step) * ((uint128_t) old_price);
+		uint128_t p_times_diff;
+		if constexpr (scale_diff_by_price) {
+			p_times_diff = ((uint128_t) old_price * relativizers[i]) * diff;
+		} else {
+			p_times_diff = (relativizers[i]) * diff;
+		}
+
+		const Price delta = detail::multiply_and_drop_lowbits_unchecked(
+			p_times_step, p_times_diff, lowbits_to_drop);
+
+		if (raise) {
+			new_prices[i] = impose_price_bounds(old_price + delta);
+		} else {
+			new_prices[i] = (delta >= old_price) ? 1 : old_price - delta;
+		}
+		changed |= (new_prices[i] != old_price);
+	}
+	return changed;
+}
+
 // breaks if amount could overflow a uint64_t
-inline static
+constexpr inline static
 uint64_t
 round_up_price_times_amount(uint128_t p_times_amount)
 {
@@ -0,0 +1,212 @@
+#include <catch2/catch_test_macros.hpp>
+
+#include "utils/price.h"
+
+#include "xdr/types.h"
+
+#include <array>
+#include <cstdint>
+#include <random>
+#include <vector>
+
+namespace speedex {
+
+/*
+The price kernels must match the byte-at-a-time and branching
+implementations they replaced bit for bit.  The reference versions
+below are copies of those implementations.
+*/
+namespace reference {
+
+static void
+write_price_big_endian(unsigned char* buf, const Price& price) {
+	for (uint8_t loc = 0; loc < price::PRICE_BYTES; loc++) {
+		uint8_t offset = ((price::PRICE_BYTES - loc - 1) * 8);
+		buf[loc] = (price >> offset) & 0xFF;
+	}
+}
+
+static Price
+read_price_big_endian(const unsigned char* buf) {
+	Price p = 0;
+	for (uint8_t loc = 0; loc < price::PRICE_BYTES; loc++) {
+		p <<=8;
+		p += buf[loc];
+	}
+	return p;
+}
+
+static Price
+impose_price_bounds(const uint128_t& val) {
+	if (val > price::MAX_PRICE) {
+		return price::MAX_PRICE;
+	}
+	if (val == 0) {
+		return 1;
+	}
+	return val;
+}
+
+static Price 
+get_trial_price(
+	const uint128_t& demand, 
+	const uint128_t& supply, 
+	const Price& old_price, 
+	const uint64_t& step, 
+	const uint16_t applied_relativizer, 
+	const uint8_t step_radix, 
+	bool scale_diff_by_price) {
+
+	uint128_t diff = (demand > supply) ? demand - supply : supply - demand;
+	uint128_t p_times_step = ((uint128_t)step) * ((uint128_t) old_price);
+	uint128_t p_times_diff = scale_diff_by_price
+		? ((uint128_t) old_price * applied_relativizer) * diff
+		: (applied_relativizer) * diff;
+
+	Price delta = price::safe_multiply_and_drop_lowbits(
+		p_times_step, p_times_diff, step_radix + price::PRICE_RADIX);
+
+	if (demand > supply) {
+		return reference::impose_price_bounds(old_price + delta);
+	}
+	if (delta >= old_price) {
+		return 1;
+	}
+	return old_price - delta;
+}
+
+} /* reference */
+
+static_assert(price::impose_price_bounds(0) == 1);
+static_assert(price::impose_price_bounds(price::MAX_PRICE + 1) == price::MAX_PRICE);
+static_assert(price::read_price_big_endian(std::array<unsigned char, 6>{0, 0, 0, 0, 1, 0}) == 256);
+
+TEST_CASE("price encode decode", "[price]")
+{
+	std::minstd_rand gen(0);
+	std::uniform_int_distribution<uint64_t> dist(0, UINT64_MAX);
+
+	for (int i = 0; i < 10000; i++) {
+		Price p = dist(gen);
+
+		std::array<unsigned char, price::PRICE_BYTES + 2> expect, actual;
+		expect.fill(0xAB);
+		actual.fill(0xAB);
+
+		reference::write_price_big_endian(expect.data(), p);
+		price::write_price_big_endian(actual.data(), p);
+
+		// the trailing bytes must not be touched
+		REQUIRE(expect == actual);
+
+		REQUIRE(price::read_price_big_endian(actual.data()) 
+			== reference::read_price_big_endian(actual.data()));
+		REQUIRE(price::read_price_big_endian(actual) == (p & price::MAX_PRICE));
+	}
+}
+
+TEST_CASE("price bounds", "[price]")
+{
+	std::vector<uint128_t> vals = {
+		0, 
+		1, 
+		price::MAX_PRICE - 1, 
+		price::MAX_PRICE, 
+		((uint128_t) price::MAX_PRICE) + 1, 
+		((uint128_t)1) << 64, 
+		((uint128_t)1) << 100,
+		((uint128_t)1) << 127
+	};
+
+	std::minstd_rand gen(1);
+	std::uniform_int_distribution<uint64_t> dist(0, UINT64_MAX);
+	for (int i = 0; i < 1000; i++) {
+		vals.push_back(dist(gen) >> (i % 64));
+		vals.push_back((((uint128_t) dist(gen)) << (i % 64)) + dist(gen));
+	}
+
+	std::vector<Price> batch(vals.size());
+	price::batch_impose_price_bounds(vals.data(), batch.data(), vals.size());
+
+	for (size_t i = 0; i < vals.size(); i++) {
+		REQUIRE(price::impose_price_bounds(vals[i]) == reference::impose_price_bounds(vals[i]));
+		REQUIRE(batch[i] == reference::impose_price_bounds(vals[i]));
+	}
+}
+
+TEST_CASE("batch trial prices", "[price]")
+{
+	std::minstd_rand gen(2);
+	std::uniform_int_distribution<uint64_t> dist(0, UINT64_MAX);
+
+	const size_t num_assets = 199;
+
+	std::vector<Price> old_prices(num_assets), new_prices(num_assets);
+	std::vector<uint128_t> demands(num_assets), supplies(num_assets);
+	std::vector<uint16_t> relativizers(num_assets);
+
+	for (int trial = 0; trial < 200; trial++) {
+		for (size_t i = 0; i < num_assets; i++) {
+			old_prices[i] = price::impose_price_bounds(dist(gen) >> (16 + (trial % 32)));
+			demands[i] = (((uint128_t) dist(gen)) << 24) >> (trial % 48);
+			supplies[i] = (i % 5 == 0) ? demands[i] : (((uint128_t) dist(gen)) << 24) >> (trial % 48);
+			relativizers[i] = 1 + (dist(gen) & 0xFF);
+		}
+		uint64_t step = dist(gen) >> (trial % 64);
+		uint8_t step_radix = 50 + (trial % 20);
+
+		for (bool scale_diff_by_price : {true, false}) {
+			bool changed = scale_diff_by_price
+				? price::batch_update_trial_prices<true>(
+					old_prices.data(), new_prices.data(), demands.data(), supplies.data(), 
+					relativizers.data(), num_assets, step, step_radix + price::PRICE_RADIX)
+				: price::batch_update_trial_prices<false>(
+					old_prices.data(), new_prices.data(), demands.data(), supplies.data(), 
+					relativizers.data(), num_assets, step, step_radix + price::PRICE_RADIX);
+
+			bool expect_changed = false;
+			for (size_t i = 0; i < num_assets; i++) {
+				Price expect = reference::get_trial_price(
+					demands[i], supplies[i], old_prices[i], step, relativizers[i], step_radix, scale_diff_by_price);
+				REQUIRE(new_prices[i] == expect);
+				expect_changed |= (expect != old_prices[i]);
+			}
+			REQUIRE(changed == expect_changed);
+		}
+	}
+}
+
+TEST_CASE("batch wide multiply", "[price]")
+{
+	std::minstd_rand gen(4);
+	std::uniform_int_distribution<uint64_t> dist(0, UINT64_MAX);
+
+	const size_t count = 100;
+	std::vector<uint128_t> first(count), second(count);
+	std::vector<Price> out(count);
+
+	for (uint64_t lowbits = 64; lowbits < 192; lowbits++) {
+		for (size_t i = 0; i < count; i++) {
+			first[i] = (((uint128_t) dist(gen)) << 64 | dist(gen)) >> (i % 100);
+			second[i] = (((uint128_t) dist(gen)) << 64 | dist(gen)) >> ((3 * i) % 100);
+		}
+		price::batch_safe_multiply_and_drop_lowbits(first.data(), second.data(), out.data(), count, lowbits);
+		for (size_t i = 0; i < count; i++) {
+			REQUIRE(out[i] == price::safe_multiply_and_drop_lowbits(first[i], second[i], lowbits));
+		}
+	}
+
+	REQUIRE_THROWS(price::batch_safe_multiply_and_drop_lowbits(first.data(), second.data(), out.data(), count, 63));
+}
+
+TEST_CASE("price to double", "[price]")
+{
+	std::minstd_rand gen(3);
+	std::uniform_int_distribution<uint64_t> dist(0, price::MAX_PRICE);
+	for (int i = 0; i < 10000; i++) {
+		Price p = dist(gen);
+		REQUIRE(price::to_double(p) == (double)p / (double) ((uint64_t)1<<price::PRICE_RADIX));
+	}
+}
+
+} /* speedex */
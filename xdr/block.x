@@ -80,11 +80,31 @@ struct HashedBlockTransactionListPair {
 	SignedTransactionList txList;
 };
 
+// Wire format of a HashedBlockTransactionListPair when
+// COMPACT_BLOCK_ENCODING is set.  compactTxList holds the columnar
+// encoding from block_processing/compact_tx_list.h
+struct HashedBlockCompactTransactionList {
+	HashedBlock hashedBlock;
+	opaque compactTxList<>;
+};
+
 struct BlockHeaderHashValue {
 	Hash hash;
 	uint32 validation_success;
 };
 
+// Proof that some blocks' header hashes are in the block header hash map.
+// Checked against a block's InternalHashes.blockMapHash.
+struct BlockHeaderHashMapProof {
+	// number of blocks (1 to mapSize) in the map that the root commits to
+	uint64 mapSize;
+	// sorted, distinct
+	uint64 blockNumbers<>;
+	BlockHeaderHashValue values<>;
+	// hashes of subtrees with no proven blocks, in depth-first order
+	Hash hashes<>;
+};
+
 struct TatonnementMeasurements {
 	float runtime;
 	uint32 step_radix;
@@ -121,6 +141,8 @@ struct BlockCreationMeasurements {
 	uint32 tat_timeout_happened; // 1 if yes, 0 if no
 	uint32 num_open_offers;
 	float offer_merge_time;
+	uint32 deferred_retry_txs; // txs included by the deferred retry wave
+	float deferred_retry_time;
 	float reserved_space8;
 	float reserved_space9;
 	float reserved_space0;
@@ -181,7 +203,7 @@ struct BlockValidationMeasurements {
 	float account_log_finalization_time;
 	float header_map_finalization_time;
 
-	float reserved_space1;
+	float tx_validation_filter_time;
 	float reserved_space2;
 	float reserved_space3;
 	float reserved_space4;
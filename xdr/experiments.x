@@ -73,6 +73,7 @@ struct TaggedSingleBlockResults {
 struct ExperimentResultsUnion {
 	ExperimentParameters params;
 	TaggedSingleBlockResults block_results<>;
+	float restart_time; // 0 unless the node loaded its state from disk
 };
 
 //locked
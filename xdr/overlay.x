@@ -26,10 +26,40 @@ namespace speedex {
 
 typedef opaque ForwardingTxs<>;
 
+enum OverlayCompression {
+	OVERLAY_UNCOMPRESSED = 0,
+	OVERLAY_ZSTD = 1,
+	// zstd with a dictionary trained on SignedTransaction xdr.
+	// Sender and receiver must load the same dictionary.
+	OVERLAY_ZSTD_DICT = 2
+};
+
+// A ForwardingTxs, possibly compressed.
+struct CompressedTxBatch {
+	OverlayCompression compression;
+	uint32 uncompressedSize;
+	opaque data<>;
+};
+
+// 64-bit tx digest, the same on every replica (see overlay/tx_digest_filter.h)
+typedef uint64 TxDigest;
+
+// Announces a large batch before sending it.
+// Digests are in the same order as the txs of the batch.
+struct TxInventory {
+	TxDigest digests<>;
+};
+
+// Reply to a TxInventory: bit (i % 8) of byte (i / 8) is set
+// iff the receiver has not seen tx i and wants it sent.
+typedef opaque TxInventoryWants<>;
+
 program Overlay {
 	version OverlayV1 {
 		uint64 mempool_size(void) = 1;
 		void forward_txs(ForwardingTxs, uint32, ReplicaID) = 2;
+		void forward_compressed_txs(CompressedTxBatch, uint32, ReplicaID) = 3;
+		TxInventoryWants offer_inventory(TxInventory, ReplicaID) = 4;
 	} = 1;
 } = 0x11111120;
 
@@ -0,0 +1,80 @@
+/**
+ * SPEEDEX: A Scalable, Parallelizable, and Economically Efficient Decentralized Exchange
+ * Copyright (C) 2023 Geoffrey Ramseyer
+
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#if defined(XDRC_HH) || defined(XDRC_SERVER)
+%#include "xdr/types.h"
+%#include "xdr/transaction.h"
+%#include "xdr/block.h"
+%#include "xdr/database_commitments.h"
+#endif
+
+#if defined(XDRC_PXDI) || defined(XDRC_PXD)
+%from types_xdr cimport *
+%from transaction_xdr cimport *
+%from block_xdr cimport *
+%from database_commitments_xdr cimport *
+%from snapshot_includes cimport *
+#endif
+
+#if defined(XDRC_PYX)
+%from types_xdr cimport *
+%from transaction_xdr cimport *
+%from block_xdr cimport *
+%from database_commitments_xdr cimport *
+%from snapshot_includes cimport *
+#endif
+
+namespace speedex {
+
+enum StateSnapshotChunkType {
+	SNAPSHOT_ACCOUNTS = 0,
+	SNAPSHOT_OFFERS = 1
+};
+
+struct OfferSnapshotChunk {
+	uint32 orderbookIdx;
+	Offer offers<>;
+};
+
+union StateSnapshotChunk switch(StateSnapshotChunkType type) {
+	case SNAPSHOT_ACCOUNTS:
+		AccountCommitment accounts<>;
+	case SNAPSHOT_OFFERS:
+		OfferSnapshotChunk offerChunk;
+};
+
+struct StateSnapshotChunkDescriptor {
+	uint32 chunkIdx;
+	StateSnapshotChunkType type;
+	uint32 numEntries;
+	// hash of the serialized StateSnapshotChunk
+	Hash checksum;
+};
+
+// Written after all chunks, so the presence of a manifest
+// marks a complete snapshot.
+struct StateSnapshotManifest {
+	HashedBlock header;
+	uint32 numOrderbooks;
+	StateSnapshotChunkDescriptor chunks<>;
+	// entry i is the header hash map value of block i + 1,
+	// through the snapshot block
+	BlockHeaderHashValue headerHashes<>;
+};
+
+} /* speedex */
@@ -0,0 +1,76 @@
+/**
+ * SPEEDEX: A Scalable, Parallelizable, and Economically Efficient Decentralized Exchange
+ * Copyright (C) 2023 Geoffrey Ramseyer
+
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#if defined(XDRC_HH) || defined(XDRC_SERVER)
+%#include "xdr/types.h"
+%#include "xdr/database_commitments.h"
+#endif
+
+#if defined(XDRC_PXDI) || defined(XDRC_PXD)
+%from types_xdr cimport *
+%from database_commitments_xdr cimport *
+%from state_proof_includes cimport *
+#endif
+
+#if defined(XDRC_PYX)
+%from types_xdr cimport *
+%from database_commitments_xdr cimport *
+%from state_proof_includes cimport *
+#endif
+
+namespace speedex {
+
+// Root of a merkle tree over a list of entries, sorted by key.
+struct SortedMerkleRoot {
+	uint64 size;
+	Hash root;
+};
+
+// Commitment to all accounts (sorted by owner) and all open offers
+// (per orderbook, sorted by orderbook key) as of one block.
+struct StateProofRoots {
+	uint64 blockNumber;
+	Hash blockHash;
+	SortedMerkleRoot accounts;
+	SortedMerkleRoot orderbooks<>;
+};
+
+// Proves that an account is (or is not) in the committed state.
+// One leaf means that the account exists (leaf matches owner),
+// or that owner sorts before the first / after the last account.
+// Two leaves must be adjacent and bracket owner.
+struct AccountProof {
+	AccountID owner;
+	uint64 leafIndices<2>;
+	AccountCommitment leaves<2>;
+	Hash hashes<>;
+};
+
+// Same as AccountProof, for an offer in one orderbook.
+// Offers are keyed by (minPrice, owner, offerId).
+struct OfferProof {
+	uint32 orderbookIdx;
+	Price minPrice;
+	AccountID owner;
+	uint64 offerId;
+	uint64 leafIndices<2>;
+	Offer leaves<2>;
+	Hash hashes<>;
+};
+
+} /* speedex */